@@ -0,0 +1,61 @@
+/** @file
+ * Implementacja obszaru pamięci, z którego można szybko przydzielać małe obiekty i zwolnić je wszystkie naraz.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include "arena.h"
+
+/**
+ * Rozmiar zwykłego bloku obszaru w bajtach. Większe obiekty dostają własny blok.
+ */
+#define CHUNK_SIZE 65536
+
+void arenaInit(Arena *arena, PhfwdAllocator const *allocator) {
+    static PhfwdAllocator const defaultAllocator;
+
+    arena->chunks = NULL;
+    arena->allocator = (allocator == NULL) ? defaultAllocator : *allocator;
+}
+
+void *arenaAlloc(Arena *arena, size_t size) {
+    size_t align = sizeof(max_align_t);
+    size = (size + align - 1) / align * align;
+
+    ArenaChunk *chunk = arena->chunks;
+
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        size_t chunkSize = (size > CHUNK_SIZE) ? size : CHUNK_SIZE;
+        ArenaChunk *new = (ArenaChunk *) allocatorAlloc(&(arena->allocator), sizeof(ArenaChunk) + chunkSize);
+
+        if (new == NULL)
+            return NULL;
+
+        new->size = chunkSize;
+        new->used = 0;
+
+        // Duży obiekt nie może zabrać miejsca w bieżącym bloku, więc jego blok trafia za bieżący.
+        if (chunk != NULL && chunkSize > CHUNK_SIZE) {
+            new->next = chunk->next;
+            chunk->next = new;
+        } else {
+            new->next = chunk;
+            arena->chunks = new;
+        }
+        chunk = new;
+    }
+
+    void *result = (char *) chunk->data + chunk->used;
+    chunk->used += size;
+    return result;
+}
+
+void arenaFree(Arena *arena) {
+    while (arena->chunks != NULL) {
+        ArenaChunk *tmp = arena->chunks;
+        arena->chunks = tmp->next;
+        allocatorFree(&(arena->allocator), tmp, sizeof(ArenaChunk) + tmp->size);
+    }
+}
@@ -0,0 +1,61 @@
+/** @file
+ * Interfejs obszaru pamięci, z którego można szybko przydzielać małe obiekty i zwolnić je wszystkie naraz.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include "memory_context.h"
+
+/**
+ * @struct ArenaChunk
+ * @brief ArenaChunk jest pojedynczym blokiem pamięci obszaru.
+ */
+struct ArenaChunk {
+    struct ArenaChunk *next; ///< Wskaźnik na poprzednio zaalokowany blok.
+    size_t size; ///< Liczba bajtów w tablicy data.
+    size_t used; ///< Liczba przydzielonych już bajtów z tablicy data.
+    max_align_t data[]; ///< Pamięć przydzielana z bloku.
+};
+typedef struct ArenaChunk ArenaChunk;
+
+/**
+ * @struct Arena
+ * @brief Arena jest listą bloków pamięci. Przydzielonych obiektów nie zwalnia się pojedynczo.
+ * Z jednego obszaru może korzystać naraz tylko jeden wątek.
+ */
+struct Arena {
+    ArenaChunk *chunks; ///< Lista bloków, zaczynająca się od bloku, z którego przydzielana jest pamięć.
+    PhfwdAllocator allocator; ///< Alokator, którym przydzielane są bloki.
+};
+typedef struct Arena Arena;
+
+/**
+ * Inicjalizuje pusty obszar. Obszar zapamiętuje kopię alokatora, więc może istnieć dłużej niż struktura,
+ * do której należy alokator.
+ * @param arena - wskaźnik na obszar.
+ * @param allocator - alokator, którym będą przydzielane bloki, lub NULL, jeśli ma być użyta funkcja malloc.
+ */
+void arenaInit(Arena *arena, PhfwdAllocator const *allocator);
+
+/**
+ * Przydziela z obszaru pamięć na obiekt rozmiaru @p size.
+ * @param arena - wskaźnik na obszar.
+ * @param size - rozmiar obiektu w bajtach.
+ * @return - wskaźnik na przydzieloną pamięć, wyrównany tak jak wynik funkcji malloc.
+ *         - NULL, jeśli nie udało się alokować pamięci.
+ */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/**
+ * Zwalnia wszystkie bloki obszaru, a razem z nimi wszystkie przydzielone z niego obiekty.
+ * @param arena - wskaźnik na obszar.
+ */
+void arenaFree(Arena *arena);
+
+#endif //ARENA_H
@@ -0,0 +1,485 @@
+/** @file
+ * Implementacja kontekstu alokacji pamięci dla węzłów i napisów struktury przechowującej przekierowania.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "memory_context.h"
+#include "trie.h"
+
+/**
+ * Rozmiary obiektów poszczególnych rodzajów.
+ */
+static const size_t kindSize[MEM_KINDS] = {
+        [MEM_PREFIXES_NODE] = sizeof(PhoneForwardPrefixes),
+        [MEM_REVERSE_NODE] = sizeof(PhoneForwardReverse),
+        [MEM_TEARDOWN] = sizeof(PhfwdTeardown),
+};
+
+/**
+ * Sprawdza, czy pamięć ma być przydzielana funkcją malloc.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @return true - jeśli wskaźnik ma wartość NULL lub alokator jest wyzerowany.
+ *         false - w przeciwnym przypadku.
+ */
+static bool isDefaultAllocator(PhfwdAllocator const *allocator) {
+    return allocator == NULL || allocator->alloc == NULL;
+}
+
+void *allocatorAlloc(PhfwdAllocator const *allocator, size_t size) {
+    if (isDefaultAllocator(allocator))
+        return malloc(size);
+    return allocator->alloc(allocator->context, size);
+}
+
+void allocatorFree(PhfwdAllocator const *allocator, void *ptr, size_t size) {
+    if (ptr == NULL)
+        return;
+    if (isDefaultAllocator(allocator))
+        free(ptr);
+    else
+        allocator->free(allocator->context, ptr, size);
+}
+
+void *allocatorRealloc(PhfwdAllocator const *allocator, void *ptr, size_t oldSize, size_t newSize) {
+    if (isDefaultAllocator(allocator))
+        return realloc(ptr, newSize);
+
+    // Alokator nie musi umieć powiększać pamięci, więc jest ona przepisywana do nowego miejsca.
+    void *result = allocator->alloc(allocator->context, newSize);
+    if (result == NULL)
+        return NULL;
+
+    if (ptr != NULL) {
+        memcpy(result, ptr, (oldSize < newSize) ? oldSize : newSize);
+        allocator->free(allocator->context, ptr, oldSize);
+    }
+    return result;
+}
+
+char *allocatorStrdup(PhfwdAllocator const *allocator, char const *string) {
+    size_t size = sizeof(char) * (strlen(string) + 1);
+    char *copy = (char *) allocatorAlloc(allocator, size);
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy, string, size);
+    return copy;
+}
+
+void allocatorFreeString(PhfwdAllocator const *allocator, char *string) {
+    if (string != NULL)
+        allocatorFree(allocator, string, sizeof(char) * (strlen(string) + 1));
+}
+
+size_t stringSize(size_t length) {
+    return offsetof(PhfwdString, chars) + sizeof(char) * (length + 1);
+}
+
+/**
+ * Podaje napis, którego znakami jest @p chars.
+ * @param chars - wskaźnik na znaki napisu utworzonego funkcją stringNew.
+ * @return - wskaźnik na napis.
+ */
+static PhfwdString *stringOf(char *chars) {
+    return (PhfwdString *) (chars - offsetof(PhfwdString, chars));
+}
+
+char *stringNew(PhfwdAllocator const *allocator, char const *chars) {
+    size_t length = strlen(chars);
+    PhfwdString *string = (PhfwdString *) allocatorAlloc(allocator, stringSize(length));
+    if (string == NULL)
+        return NULL;
+
+    atomic_init(&(string->references), 1);
+    memcpy(string->chars, chars, sizeof(char) * (length + 1));
+    return string->chars;
+}
+
+char *stringRetain(char *string) {
+    atomic_fetch_add_explicit(&(stringOf(string)->references), 1, memory_order_relaxed);
+    return string;
+}
+
+void stringRelease(PhfwdAllocator const *allocator, char *string) {
+    if (string == NULL)
+        return;
+
+    PhfwdString *header = stringOf(string);
+    if (atomic_fetch_sub_explicit(&(header->references), 1, memory_order_acq_rel) == 1)
+        allocatorFree(allocator, header, stringSize(strlen(string)));
+}
+
+/**
+ * Dolicza do konta @p bytes bajtów, jeśli mieszczą się one w limicie.
+ * @param account - wskaźnik na konto.
+ * @param bytes - liczba bajtów.
+ * @return true - jeśli bajty zostały doliczone.
+ *         false - jeśli limit zostałby przekroczony.
+ */
+static bool accountCharge(MemoryAccount *account, size_t bytes) {
+    size_t used = atomic_load(&(account->used));
+    size_t budget = atomic_load_explicit(&(account->budget), memory_order_relaxed);
+
+    // Drzewa mogą być budowane przez wiele wątków naraz, więc limit jest sprawdzany razem z doliczeniem.
+    do {
+        if (bytes > budget || used > budget - bytes)
+            return false;
+    } while (!atomic_compare_exchange_weak(&(account->used), &used, used + bytes));
+
+    return true;
+}
+
+/**
+ * Przydziela pamięć alokatorem konta, jeśli mieści się ona w limicie.
+ * @param context - wskaźnik na konto.
+ * @param size - rozmiar w bajtach.
+ * @return - wskaźnik na przydzieloną pamięć lub NULL, jeśli limit zostałby przekroczony lub nie powiodła się
+ *         alokacja pamięci.
+ */
+/**
+ * Zajmuje miejsce na obiekt w bloku konta. Blok jest już policzony do limitu w całości.
+ * @param account - wskaźnik na konto.
+ * @param size - rozmiar obiektu.
+ * @return - wskaźnik na miejsce w bloku lub NULL, jeśli konto nie ma bloku lub brakuje w nim miejsca.
+ */
+static void *slabTake(MemoryAccount *account, size_t size) {
+    if (account->slab == NULL)
+        return NULL;
+
+    size_t used = atomic_load(&(account->slabUsed));
+    size_t offset;
+
+    // Z bloku korzystają wszystkie kopie struktury, więc miejsce jest zajmowane atomowo.
+    do {
+        offset = (used + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+        if (offset > account->slabSize || size > account->slabSize - offset)
+            return NULL;
+    } while (!atomic_compare_exchange_weak(&(account->slabUsed), &used, offset + size));
+
+    return account->slab + offset;
+}
+
+/**
+ * Sprawdza, czy obiekt leży w bloku konta.
+ * @param account - wskaźnik na konto.
+ * @param ptr - wskaźnik na obiekt.
+ * @return true - jeśli obiekt leży w bloku.
+ *         false - w przeciwnym przypadku.
+ */
+static bool inSlab(MemoryAccount const *account, void const *ptr) {
+    char const *object = (char const *) ptr;
+    return account->slab != NULL && object >= account->slab && object < account->slab + account->slabSize;
+}
+
+static void *accountAlloc(void *context, size_t size) {
+    MemoryAccount *account = (MemoryAccount *) context;
+    void *object = slabTake(account, size);
+
+    if (object != NULL)
+        return object;
+
+    if (!accountCharge(account, size))
+        return NULL;
+
+    void *result = allocatorAlloc(&(account->base), size);
+    if (result == NULL)
+        atomic_fetch_sub(&(account->used), size);
+    return result;
+}
+
+/**
+ * Zwalnia pamięć przydzieloną funkcją accountAlloc.
+ * @param context - wskaźnik na konto.
+ * @param ptr - wskaźnik na zwalnianą pamięć.
+ * @param size - rozmiar podany przy przydzieleniu pamięci.
+ */
+static void accountFree(void *context, void *ptr, size_t size) {
+    MemoryAccount *account = (MemoryAccount *) context;
+
+    // Pamięć obiektów z bloku zostaje zajęta do usunięcia konta.
+    if (inSlab(account, ptr))
+        return;
+
+    allocatorFree(&(account->base), ptr, size);
+    atomic_fetch_sub(&(account->used), size);
+}
+
+MemoryAccount *accountNew(PhfwdAllocator const *base, size_t budget) {
+    MemoryAccount *account = (MemoryAccount *) allocatorAlloc(base, sizeof(MemoryAccount));
+    if (account == NULL)
+        return NULL;
+
+    account->allocator.alloc = accountAlloc;
+    account->allocator.free = accountFree;
+    account->allocator.context = account;
+    account->base = (base == NULL) ? (PhfwdAllocator) {NULL, NULL, NULL} : *base;
+    atomic_init(&(account->used), 0);
+    atomic_init(&(account->budget), budget);
+    account->slab = NULL;
+    account->slabSize = 0;
+    atomic_init(&(account->slabUsed), 0);
+    atomic_init(&(account->references), 1);
+    for (int i = 0; i < MEM_KINDS; i++) {
+        atomic_flag_clear(&(account->pools[i].lock));
+        account->pools[i].free = NULL;
+        account->pools[i].chunks = NULL;
+    }
+    return account;
+}
+
+bool accountAddSlab(MemoryAccount *account, size_t size) {
+    if (!accountCharge(account, size))
+        return false;
+
+    account->slab = (char *) allocatorAlloc(&(account->base), size);
+    if (account->slab == NULL) {
+        atomic_fetch_sub(&(account->used), size);
+        return false;
+    }
+
+    account->slabSize = size;
+    atomic_store(&(account->slabUsed), 0);
+    return true;
+}
+
+size_t accountSlabSpace(size_t size) {
+    // Każdy obiekt zaczyna się od wyrównanego adresu, więc po nim może wystąpić dopełnienie.
+    return (size + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+}
+
+MemoryAccount *accountRetain(MemoryAccount *account) {
+    atomic_fetch_add_explicit(&(account->references), 1, memory_order_relaxed);
+    return account;
+}
+
+void accountRelease(MemoryAccount *account) {
+    if (account == NULL || atomic_fetch_sub_explicit(&(account->references), 1, memory_order_acq_rel) != 1)
+        return;
+
+    PhfwdAllocator base = account->base;
+    for (int i = 0; i < MEM_KINDS; i++) {
+        while (account->pools[i].chunks != NULL) {
+            MemoryChunk *chunk = account->pools[i].chunks;
+            account->pools[i].chunks = chunk->next;
+            allocatorFree(&base, chunk, chunk->size);
+        }
+    }
+    allocatorFree(&base, account->slab, account->slabSize);
+    allocatorFree(&base, account, sizeof(MemoryAccount));
+}
+
+/**
+ * Podaje wskaźnik na pierwsze słowo wolnego obiektu, które łączy go z kolejnym wolnym obiektem.
+ * @param object - wskaźnik na wolny obiekt.
+ * @return - wskaźnik na pierwsze słowo obiektu.
+ */
+static void **nextOf(void *object) {
+    return (void **) object;
+}
+
+/**
+ * Dopisuje obiekt na początek listy rezerwy.
+ * @param stock - wskaźnik na rezerwę.
+ * @param object - wskaźnik na obiekt.
+ */
+static void stockPush(MemoryStock *stock, void *object) {
+    *nextOf(object) = stock->items;
+    stock->items = object;
+    (stock->count)++;
+}
+
+/**
+ * Zajmuje blokadę puli.
+ * @param pool - wskaźnik na pulę.
+ */
+static void poolLock(MemoryPool *pool) {
+    while (atomic_flag_test_and_set_explicit(&(pool->lock), memory_order_acquire))
+        continue;
+}
+
+/**
+ * Zwalnia blokadę puli.
+ * @param pool - wskaźnik na pulę.
+ */
+static void poolUnlock(MemoryPool *pool) {
+    atomic_flag_clear_explicit(&(pool->lock), memory_order_release);
+}
+
+/**
+ * Dopisuje do rezerwy @p count obiektów rodzaju @p kind z konta: najpierw z bloku konta, potem z listy wolnych
+ * obiektów puli, a brakujące z nowego bloku puli, którego pozostałe obiekty trafiają na listę wolnych.
+ * @param account - wskaźnik na konto.
+ * @param kind - rodzaj obiektów.
+ * @param count - liczba obiektów.
+ * @param stock - wskaźnik na rezerwę.
+ * @return true - jeśli udało się dopisać wszystkie obiekty.
+ *         false - jeśli limit zostałby przekroczony lub nie powiodła się alokacja pamięci. Obiekty dopisane
+ *         wcześniej zostają w rezerwie.
+ */
+static bool poolTake(MemoryAccount *account, MemoryKind kind, size_t count, MemoryStock *stock) {
+    MemoryPool *pool = &(account->pools)[kind];
+    size_t size = kindSize[kind];
+    void *object;
+
+    // Blok ułożony przez phfwdRelayout jest już policzony do limitu.
+    while (count > 0 && (object = slabTake(account, size)) != NULL) {
+        stockPush(stock, object);
+        count--;
+    }
+    if (count == 0)
+        return true;
+
+    if (count > SIZE_MAX / size || !accountCharge(account, count * size))
+        return false;
+
+    poolLock(pool);
+    while (count > 0 && pool->free != NULL) {
+        object = pool->free;
+        pool->free = *nextOf(object);
+        stockPush(stock, object);
+        count--;
+    }
+    poolUnlock(pool);
+    if (count == 0)
+        return true;
+
+    size_t stride = accountSlabSpace(size);
+    size_t header = accountSlabSpace(sizeof(MemoryChunk));
+    size_t objects = (count > POOL_CHUNK_OBJECTS) ? count : POOL_CHUNK_OBJECTS;
+    MemoryChunk *chunk = NULL;
+
+    if (objects <= (SIZE_MAX - header) / stride)
+        chunk = (MemoryChunk *) allocatorAlloc(&(account->base), header + objects * stride);
+    if (chunk == NULL) {
+        atomic_fetch_sub(&(account->used), count * size);
+        return false;
+    }
+    chunk->size = header + objects * stride;
+
+    char *first = (char *) chunk + header;
+    for (size_t i = 0; i < count; i++)
+        stockPush(stock, first + i * stride);
+
+    poolLock(pool);
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    for (size_t i = count; i < objects; i++) {
+        *nextOf(first + i * stride) = pool->free;
+        pool->free = first + i * stride;
+    }
+    poolUnlock(pool);
+    return true;
+}
+
+/**
+ * Zwraca do puli konta listę obiektów rodzaju @p kind i odlicza je od konta. Obiekty z bloku konta zostają
+ * zajęte do jego usunięcia.
+ * @param account - wskaźnik na konto.
+ * @param kind - rodzaj obiektów.
+ * @param list - pierwszy obiekt listy połączonej przez pierwsze słowa obiektów.
+ */
+static void poolPut(MemoryAccount *account, MemoryKind kind, void *list) {
+    MemoryPool *pool = &(account->pools)[kind];
+    size_t returned = 0;
+
+    if (list == NULL)
+        return;
+
+    poolLock(pool);
+    while (list != NULL) {
+        void *object = list;
+        list = *nextOf(object);
+
+        if (!inSlab(account, object)) {
+            *nextOf(object) = pool->free;
+            pool->free = object;
+            returned++;
+        }
+    }
+    poolUnlock(pool);
+    atomic_fetch_sub(&(account->used), returned * kindSize[kind]);
+}
+
+void memInit(PhfwdMemory *mem, MemoryAccount *account) {
+    mem->account = account;
+    for (int i = 0; i < MEM_KINDS; i++) {
+        mem->stock[i].items = NULL;
+        mem->stock[i].count = 0;
+    }
+}
+
+PhfwdAllocator const *memAllocator(PhfwdMemory const *mem) {
+    return (mem == NULL || mem->account == NULL) ? NULL : &(mem->account->allocator);
+}
+
+PhfwdAllocator const *memBaseAllocator(PhfwdMemory const *mem) {
+    return (mem->account == NULL) ? NULL : &(mem->account->base);
+}
+
+bool memReserve(PhfwdMemory *mem, MemoryKind kind, size_t count) {
+    MemoryStock *stock = &(mem->stock)[kind];
+
+    if (mem->account != NULL)
+        return poolTake(mem->account, kind, count, stock);
+
+    for (size_t i = 0; i < count; i++) {
+        void *item = malloc(kindSize[kind]);
+        if (item == NULL)
+            return false;
+        stockPush(stock, item);
+    }
+    return true;
+}
+
+void memRelease(PhfwdMemory *mem) {
+    for (int i = 0; i < MEM_KINDS; i++) {
+        MemoryStock *stock = &(mem->stock)[i];
+
+        if (mem->account != NULL) {
+            poolPut(mem->account, (MemoryKind) i, stock->items);
+        } else {
+            while (stock->items != NULL) {
+                void *item = stock->items;
+                stock->items = *nextOf(item);
+                free(item);
+            }
+        }
+        stock->items = NULL;
+        stock->count = 0;
+    }
+}
+
+void *memAlloc(PhfwdMemory *mem, MemoryKind kind) {
+    if (mem == NULL)
+        return malloc(kindSize[kind]);
+
+    MemoryStock *stock = &(mem->stock)[kind];
+    if (stock->count == 0) {
+        if (mem->account == NULL)
+            return malloc(kindSize[kind]);
+        if (!poolTake(mem->account, kind, 1, stock))
+            return NULL;
+    }
+
+    void *item = stock->items;
+    stock->items = *nextOf(item);
+    (stock->count)--;
+    return item;
+}
+
+void memFree(PhfwdAllocator const *allocator, void *ptr, MemoryKind kind) {
+    if (ptr == NULL)
+        return;
+
+    if (allocator != NULL && allocator->free == accountFree) {
+        *nextOf(ptr) = NULL;
+        poolPut((MemoryAccount *) allocator->context, kind, ptr);
+    } else {
+        allocatorFree(allocator, ptr, kindSize[kind]);
+    }
+}
@@ -0,0 +1,287 @@
+/** @file
+ * Interfejs kontekstu alokacji pamięci dla węzłów i napisów struktury przechowującej przekierowania.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef MEMORY_CONTEXT_H
+#define MEMORY_CONTEXT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "phone_forward.h"
+
+/**
+ * Rodzaje obiektów, które mogą być wcześniej zarezerwowane w kontekście alokacji.
+ */
+enum MemoryKind {
+    MEM_PREFIXES_NODE, ///< Węzeł drzewa PhoneForwardPrefixes.
+    MEM_REVERSE_NODE, ///< Węzeł drzewa PhoneForwardReverse.
+    MEM_TEARDOWN, ///< Struktura PhfwdTeardown.
+    MEM_KINDS ///< Liczba rodzajów obiektów.
+};
+typedef enum MemoryKind MemoryKind;
+
+/**
+ * @struct MemoryStock
+ * @brief MemoryStock jest listą wcześniej zaalokowanych obiektów jednego rodzaju, połączonych przez pierwsze
+ * słowo obiektu.
+ */
+struct MemoryStock {
+    void *items; ///< Pierwszy wolny obiekt lub NULL.
+    size_t count; ///< Liczba wolnych obiektów.
+};
+typedef struct MemoryStock MemoryStock;
+
+/**
+ * Najmniejsza liczba obiektów w bloku puli.
+ */
+#define POOL_CHUNK_OBJECTS 64
+
+/**
+ * @struct MemoryChunk
+ * @brief MemoryChunk jest nagłówkiem bloku pamięci puli, po którym leżą obiekty jednego rodzaju.
+ */
+struct MemoryChunk {
+    struct MemoryChunk *next; ///< Kolejny blok tej samej puli lub NULL.
+    size_t size; ///< Rozmiar bloku w bajtach, razem z nagłówkiem.
+};
+typedef struct MemoryChunk MemoryChunk;
+
+/**
+ * @struct MemoryPool
+ * @brief MemoryPool przydziela obiekty jednego rodzaju z bloków pamięci, w których leży ich wiele obok siebie.
+ * Zwolnione obiekty trafiają na listę wolnych obiektów i są przydzielane ponownie. Bloki są zwalniane dopiero
+ * razem z kontem.
+ */
+struct MemoryPool {
+    atomic_flag lock; ///< Blokada obu list, bo z konta mogą korzystać kopie struktury w różnych wątkach.
+    void *free; ///< Lista wolnych obiektów, połączonych przez pierwsze słowo obiektu.
+    MemoryChunk *chunks; ///< Lista bloków puli.
+};
+typedef struct MemoryPool MemoryPool;
+
+/**
+ * Wyrównanie obiektów w bloku konta. Napisy też są wyrównywane, bo zaczynają się od licznika odwołań.
+ */
+#define SLAB_ALIGN 8
+
+/**
+ * @struct PhfwdString
+ * @brief PhfwdString jest napisem z licznikiem odwołań. Numery w drzewach są przechowywane jako takie napisy,
+ * więc kopia węzła może współdzielić napisy z oryginałem. Funkcje przyjmują i zwracają wskaźnik na pole chars.
+ */
+struct PhfwdString {
+    atomic_uint references; ///< Liczba miejsc w drzewach wskazujących na napis.
+    char chars[]; ///< Znaki napisu zakończone znakiem '\0'.
+};
+typedef struct PhfwdString PhfwdString;
+
+/**
+ * @struct MemoryAccount
+ * @brief MemoryAccount liczy bajty zajmowane przez drzewa: węzły, tablice Prefix, struktury PhfwdTeardown
+ * oraz napisy. Przydział, który przekroczyłby limit, kończy się błędem tak samo jak nieudana alokacja. Konto
+ * należy do drzew, a nie do struktury: kopie utworzone funkcją phfwdClone współdzielą je razem z węzłami drzew.
+ * Obiekty rodzajów MemoryKind są przydzielane z pul konta, a liczone są tylko obiekty w użyciu.
+ */
+struct MemoryAccount {
+    PhfwdAllocator allocator; ///< Alokator przekazywany funkcjom modyfikującym drzewa. Liczy bajty i przekazuje
+    ///< żądania alokatorowi base; jego kontekstem jest to konto.
+    PhfwdAllocator base; ///< Alokator struktury, którym naprawdę przydzielana jest pamięć.
+    atomic_size_t used; ///< Liczba przydzielonych bajtów.
+    atomic_size_t budget; ///< Największa dopuszczalna wartość used. Może być zmieniany przez kopię struktury
+    ///< w czasie, gdy inna kopia modyfikuje drzewa.
+    char *slab; ///< Ciągły blok, z którego obiekty są przydzielane po kolei, lub NULL. Obiekty z bloku nie są
+    ///< zwalniane pojedynczo; blok jest zwalniany razem z kontem.
+    size_t slabSize; ///< Rozmiar bloku slab.
+    atomic_size_t slabUsed; ///< Liczba bajtów bloku slab, które zostały już przydzielone.
+    atomic_uint references; ///< Liczba struktur, których drzewa są liczone na tym koncie.
+    MemoryPool pools[MEM_KINDS]; ///< Pule obiektów, osobno dla każdego rodzaju.
+};
+typedef struct MemoryAccount MemoryAccount;
+
+/**
+ * @struct PhfwdMemory
+ * @brief PhfwdMemory jest kontekstem, z którego funkcje modyfikujące drzewa biorą pamięć.
+ * Obiekty są brane najpierw z rezerwy, a dopiero gdy jej zabraknie, alokowane alokatorem kontekstu.
+ * Rezerwa pozwala wykonać ciąg operacji, który na pewno nie zakończy się błędem alokacji.
+ */
+struct PhfwdMemory {
+    MemoryAccount *account; ///< Konto drzew, które są modyfikowane, lub NULL, jeśli pamięć nie jest liczona.
+    MemoryStock stock[MEM_KINDS]; ///< Zarezerwowane obiekty, osobno dla każdego rodzaju.
+};
+typedef struct PhfwdMemory PhfwdMemory;
+
+/**
+ * Przydziela pamięć alokatorem @p allocator. Wskaźnik NULL i alokator o wyzerowanych polach oznaczają we
+ * wszystkich funkcjach przyjmujących alokator, że ma być użyta funkcja malloc.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @param size - rozmiar w bajtach.
+ * @return - wskaźnik na przydzieloną pamięć lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+void *allocatorAlloc(PhfwdAllocator const *allocator, size_t size);
+
+/**
+ * Zwalnia pamięć przydzieloną funkcją allocatorAlloc z tym samym alokatorem. Nic nie robi, jeśli @p ptr ma
+ * wartość NULL.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @param ptr - wskaźnik na zwalnianą pamięć lub NULL.
+ * @param size - rozmiar podany przy przydzieleniu pamięci.
+ */
+void allocatorFree(PhfwdAllocator const *allocator, void *ptr, size_t size);
+
+/**
+ * Zmienia rozmiar pamięci przydzielonej funkcją allocatorAlloc, tak jak funkcja realloc.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @param ptr - wskaźnik na pamięć lub NULL.
+ * @param oldSize - dotychczasowy rozmiar.
+ * @param newSize - nowy rozmiar.
+ * @return - wskaźnik na pamięć nowego rozmiaru lub NULL, jeśli nie powiodła się alokacja pamięci. Wtedy
+ *         @p ptr pozostaje ważny.
+ */
+void *allocatorRealloc(PhfwdAllocator const *allocator, void *ptr, size_t oldSize, size_t newSize);
+
+/**
+ * Tworzy kopię napisu alokatorem @p allocator.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @param string - kopiowany napis.
+ * @return - wskaźnik na kopię lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+char *allocatorStrdup(PhfwdAllocator const *allocator, char const *string);
+
+/**
+ * Zwalnia napis przydzielony alokatorem @p allocator. Nic nie robi, jeśli @p string ma wartość NULL.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @param string - zwalniany napis lub NULL.
+ */
+void allocatorFreeString(PhfwdAllocator const *allocator, char *string);
+
+/**
+ * Tworzy napis z licznikiem odwołań równym 1, będący kopią @p chars.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @param chars - kopiowany napis.
+ * @return - wskaźnik na znaki nowego napisu lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+char *stringNew(PhfwdAllocator const *allocator, char const *chars);
+
+/**
+ * Zwiększa licznik odwołań napisu utworzonego funkcją stringNew.
+ * @param string - wskaźnik na znaki napisu.
+ * @return - @p string.
+ */
+char *stringRetain(char *string);
+
+/**
+ * Zmniejsza licznik odwołań napisu utworzonego funkcją stringNew i zwalnia napis, jeśli licznik spadł do zera.
+ * Nic nie robi, jeśli @p string ma wartość NULL.
+ * @param allocator - alokator, którym przydzielono napis, lub NULL.
+ * @param string - wskaźnik na znaki napisu lub NULL.
+ */
+void stringRelease(PhfwdAllocator const *allocator, char *string);
+
+/**
+ * Podaje, ile bajtów zajmuje napis utworzony funkcją stringNew z napisu o długości @p length.
+ * @param length - długość napisu.
+ * @return - liczba bajtów.
+ */
+size_t stringSize(size_t length);
+
+/**
+ * Tworzy konto bez przydzielonych bajtów, używane przez jedną strukturę. Samo konto nie jest liczone.
+ * @param base - alokator, którym będzie przydzielana pamięć, lub NULL, jeśli ma być użyta funkcja malloc.
+ * @param budget - limit bajtów lub SIZE_MAX, jeśli pamięć ma nie być ograniczona.
+ * @return - wskaźnik na konto lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+MemoryAccount *accountNew(PhfwdAllocator const *base, size_t budget);
+
+/**
+ * Przydziela kontu ciągły blok pamięci, z którego kolejne obiekty będą brane po kolei, więc leżą w pamięci
+ * w kolejności przydzielenia. Cały blok jest od razu liczony do limitu. Gdy blok się skończy, obiekty są
+ * przydzielane pojedynczo.
+ * @param account - wskaźnik na konto bez bloku.
+ * @param size - rozmiar bloku, np. suma wartości accountSlabSpace dla obiektów, które mają się w nim zmieścić.
+ * @return true - jeśli udało się przydzielić blok.
+ *         false - jeśli limit zostałby przekroczony lub nie powiodła się alokacja pamięci.
+ */
+bool accountAddSlab(MemoryAccount *account, size_t size);
+
+/**
+ * Podaje, ile najwięcej bajtów bloku konta zajmie obiekt o rozmiarze @p size, razem z wyrównaniem.
+ * @param size - rozmiar obiektu.
+ * @return - liczba bajtów.
+ */
+size_t accountSlabSpace(size_t size);
+
+/**
+ * Zwiększa liczbę struktur używających konta.
+ * @param account - wskaźnik na konto.
+ * @return - @p account.
+ */
+MemoryAccount *accountRetain(MemoryAccount *account);
+
+/**
+ * Zmniejsza liczbę struktur używających konta i usuwa konto, jeśli żadna już go nie używa. Wszystkie obiekty
+ * przydzielone z konta poza blokiem i pulami muszą być wtedy zwolnione. Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param account - wskaźnik na konto.
+ */
+void accountRelease(MemoryAccount *account);
+
+/**
+ * Inicjalizuje pusty kontekst alokacji.
+ * @param mem - wskaźnik na kontekst.
+ * @param account - konto, na które będą liczone przydzielane obiekty, lub NULL, jeśli ma być użyta funkcja malloc.
+ */
+void memInit(PhfwdMemory *mem, MemoryAccount *account);
+
+/**
+ * Podaje alokator kontekstu.
+ * @param mem - wskaźnik na kontekst lub NULL.
+ * @return - alokator konta kontekstu lub NULL, jeśli kontekst ma wartość NULL lub używa funkcji malloc.
+ */
+PhfwdAllocator const *memAllocator(PhfwdMemory const *mem);
+
+/**
+ * Podaje alokator, którym przydzielane są pomocnicze tablice kontekstu. Nie są one liczone na koncie.
+ * @param mem - wskaźnik na kontekst.
+ * @return - alokator struktury lub NULL, jeśli ma być użyta funkcja malloc.
+ */
+PhfwdAllocator const *memBaseAllocator(PhfwdMemory const *mem);
+
+/**
+ * Rezerwuje w kontekście @p count obiektów rodzaju @p kind. Obiekty są liczone do limitu konta jednym
+ * doliczeniem i brane z puli konta jednym zajęciem jej blokady, a brakujące są przydzielane jednym blokiem.
+ * @param mem - wskaźnik na kontekst.
+ * @param kind - rodzaj obiektów.
+ * @param count - liczba obiektów do zarezerwowania.
+ * @return true - jeśli udało się zarezerwować wszystkie obiekty.
+ *         false - jeśli nie powiodła się alokacja pamięci (obiekty zarezerwowane wcześniej zostają w rezerwie).
+ */
+bool memReserve(PhfwdMemory *mem, MemoryKind kind, size_t count);
+
+/**
+ * Zwalnia wszystkie niewykorzystane obiekty z kontekstu.
+ * @param mem - wskaźnik na kontekst.
+ */
+void memRelease(PhfwdMemory *mem);
+
+/**
+ * Daje obiekt rodzaju @p kind z rezerwy lub alokuje nowy.
+ * @param mem - wskaźnik na kontekst lub NULL, jeśli obiekt ma być po prostu zaalokowany funkcją malloc.
+ * @param kind - rodzaj obiektu.
+ * @return - wskaźnik na obiekt lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+void *memAlloc(PhfwdMemory *mem, MemoryKind kind);
+
+/**
+ * Zwalnia obiekt rodzaju @p kind, przydzielony alokatorem @p allocator. Obiekt przydzielony z konta wraca do
+ * jego puli.
+ * @param allocator - wskaźnik na alokator lub NULL.
+ * @param ptr - wskaźnik na obiekt lub NULL.
+ * @param kind - rodzaj obiektu.
+ */
+void memFree(PhfwdAllocator const *allocator, void *ptr, MemoryKind kind);
+
+#endif //MEMORY_CONTEXT_H
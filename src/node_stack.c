@@ -0,0 +1,48 @@
+/** @file
+ * Implementacja stosu, zawierającego pary odpowiadających sobie węzłów przeglądanych drzew.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include "node_stack.h"
+
+void nodeStackInit(NodeStack *s, PhfwdAllocator const *allocator) {
+    s->frames = NULL;
+    s->count = 0;
+    s->size = 0;
+    s->allocator = allocator;
+}
+
+bool nodeStackEmpty(NodeStack const *s) {
+    return s->count == 0;
+}
+
+bool nodeStackPush(NodeStack *s, void *first, void *second, size_t depth, int sign) {
+    if (s->count == s->size) {
+        size_t newSize = (s->size == 0) ? 64 : 2 * s->size;
+        NodeFrame *frames = (NodeFrame *) allocatorRealloc(s->allocator, s->frames, sizeof(NodeFrame) * s->size,
+                                                           sizeof(NodeFrame) * newSize);
+        if (frames == NULL)
+            return false;
+        s->frames = frames;
+        s->size = newSize;
+    }
+
+    NodeFrame *frame = &(s->frames)[(s->count)++];
+    frame->first = first;
+    frame->second = second;
+    frame->depth = depth;
+    frame->sign = sign;
+    return true;
+}
+
+NodeFrame nodeStackPop(NodeStack *s) {
+    return (s->frames)[--(s->count)];
+}
+
+void nodeStackFree(NodeStack *s) {
+    allocatorFree(s->allocator, s->frames, sizeof(NodeFrame) * s->size);
+    nodeStackInit(s, s->allocator);
+}
@@ -0,0 +1,81 @@
+/** @file
+ * Interfejs stosu, zawierającego pary odpowiadających sobie węzłów przeglądanych drzew.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef NODE_STACK_H
+#define NODE_STACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "memory_context.h"
+
+/**
+ * @struct NodeFrame
+ * @brief NodeFrame jest pojedynczym elementem stosu NodeStack.
+ */
+struct NodeFrame {
+    void *first; ///< Węzeł pierwszego drzewa.
+    void *second; ///< Odpowiadający mu węzeł drugiego drzewa lub NULL.
+    size_t depth; ///< Głębokość węzłów w drzewach.
+    int sign; ///< Liczba odpowiadająca znakowi na krawędzi prowadzącej do węzłów.
+};
+typedef struct NodeFrame NodeFrame;
+
+/**
+ * @struct NodeStack
+ * @brief NodeStack jest stosem par węzłów, przechowywanym w tablicy powiększanej w miarę potrzeby.
+ */
+struct NodeStack {
+    NodeFrame *frames; ///< Tablica elementów stosu.
+    size_t count; ///< Liczba elementów na stosie.
+    size_t size; ///< Rozmiar tablicy frames.
+    PhfwdAllocator const *allocator; ///< Alokator, którym przydzielana jest tablica frames, lub NULL.
+};
+typedef struct NodeStack NodeStack;
+
+/**
+ * Inicjalizuje pusty stos.
+ * @param s - wskaźnik na stos.
+ * @param allocator - alokator, którym będzie przydzielana pamięć stosu, lub NULL, jeśli ma być użyta funkcja
+ *                    malloc. Alokator musi istnieć, dopóki stos nie zostanie zwolniony.
+ */
+void nodeStackInit(NodeStack *s, PhfwdAllocator const *allocator);
+
+/**
+ * Sprawdza, czy stos jest pusty.
+ * @param s - wskaźnik na stos.
+ * @return - true, jeśli stos jest pusty,
+ *           false w przeciwnym wypadku.
+ */
+bool nodeStackEmpty(NodeStack const *s);
+
+/**
+ * Wstawia nowy element do stosu.
+ * @param s - wskaźnik na stos.
+ * @param first - węzeł pierwszego drzewa.
+ * @param second - węzeł drugiego drzewa lub NULL.
+ * @param depth - głębokość węzłów.
+ * @param sign - liczba odpowiadająca znakowi na krawędzi prowadzącej do węzłów.
+ * @return - false, jeśli nie powiodła się alokacja pamięci,
+ *           true, w pozostałych przypadkach.
+ */
+bool nodeStackPush(NodeStack *s, void *first, void *second, size_t depth, int sign);
+
+/**
+ * Zdejmuje element ze stosu.
+ * @param s - wskaźnik na niepusty stos.
+ * @return - zdjęty element.
+ */
+NodeFrame nodeStackPop(NodeStack *s);
+
+/**
+ * Zwalnia pamięć zajmowaną przez stos.
+ * @param s - wskaźnik na stos.
+ */
+void nodeStackFree(NodeStack *s);
+
+#endif //NODE_STACK_H
@@ -8,22 +8,38 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
-#include <ctype.h>
+#include <stdint.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "trie.h"
+#include "phone_forward_journal.h"
+#include "phone_forward_clone.h"
+#include "phone_forward_query.h"
+#include "phone_forward_lookup.h"
+#include "phone_forward_layout.h"
 
-struct PhoneForward {
-    PhoneForwardReverse *reverse; ///< Wskaźnik na drzewo trie przechowujące przekierowania numerów telefonów.
-    ///< Gałęzie drzewa reverse oznaczają kolejne cyfry przekierowania numeru.
-    PhoneForwardPrefixes *prefixes; ///< Wskaźnik na drzewo trie przechowujące wskaźniki na przekierowania numerów telefonu.
-    ///< Gałęzie drzewa prefixes oznaczają kolejne cyfry prefiksu numeru telefonu.
-};
-typedef struct PhoneForward PhoneForward;
+/**
+ * Maksymalna liczba węzłów odłączonych poddrzew, które są usuwane przy okazji jednej operacji modyfikującej.
+ */
+#define RECLAIM_STEP 64
+
+/**
+ * Liczba numerów wyniku, które można uporządkować bez przydzielania pomocniczej tablicy.
+ */
+#define MERGE_LOCAL 64
+
+/**
+ * Ostatni nadany numer wersji struktury.
+ */
+static atomic_uint_fast64_t lastVersion;
 
 struct PhoneNumbers {
     char **num; ///< Tablica numerów telefonu.
     size_t elements; ///< Ilość przechowywanych numerów.
     size_t size; ///< Rozmiar tablicy num.
+    Arena *arena; ///< Obszar, z którego przydzielono pamięć na numery lub NULL, jeśli użyto alokatora.
+    PhfwdAllocator allocator; ///< Alokator, którym przydzielono strukturę i numery, jeśli @p arena ma wartość NULL.
 };
 typedef struct PhoneNumbers PhoneNumbers;
 
@@ -35,38 +51,72 @@ char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
 }
 
 void phnumDelete(PhoneNumbers *pnum) {
-    if (pnum == NULL)
+    // Numery przydzielone z obszaru są zwalniane razem z nim.
+    if (pnum == NULL || pnum->arena != NULL)
         return;
+
+    PhfwdAllocator allocator = pnum->allocator;
     if (pnum->num != NULL) {
         for (size_t i = 0; i < pnum->elements; i++) {
             char *tmp = (pnum->num)[i];
             if (tmp != NULL)
-                free(tmp);
+                allocatorFreeString(&allocator, tmp);
         }
-        free(pnum->num);
+        allocatorFree(&allocator, pnum->num, sizeof(char *) * pnum->size);
     }
-    free(pnum);
+    allocatorFree(&allocator, pnum, sizeof(PhoneNumbers));
+}
+
+/**
+ * Przydziela pamięć na część wyniku zapytania z obszaru wyniku lub jego alokatorem.
+ * @param phnum - wynik zapytania.
+ * @param size - rozmiar w bajtach.
+ * @return - wskaźnik na przydzieloną pamięć lub NULL, jeśli alokacja pamięci się nie powiodła.
+ */
+static void *phnumAlloc(PhoneNumbers const *phnum, size_t size) {
+    return (phnum->arena == NULL) ? allocatorAlloc(&(phnum->allocator), size) : arenaAlloc(phnum->arena, size);
+}
+
+/**
+ * Zwalnia numer przydzielony funkcją phnumAlloc, który nie trafił do wyniku. Numery z obszaru są zwalniane
+ * razem z nim.
+ * @param phnum - wynik zapytania.
+ * @param num - numer telefonu.
+ */
+static void phnumFreeNumber(PhoneNumbers const *phnum, char *num) {
+    if (phnum->arena == NULL)
+        allocatorFreeString(&(phnum->allocator), num);
 }
 
 /**
  * Tworzy nową strukturę, alokując pamięć do przechowywania numerów telefonu.
+ * @param allocator - alokator, którym zostanie przydzielona pamięć, jeśli @p arena ma wartość NULL, lub NULL,
+ *                    jeśli ma być użyta funkcja malloc.
+ * @param arena - obszar, z którego zostanie przydzielona pamięć, lub NULL.
  * @param howManyNumbers - ile numerów telefonu może pomieścić (rozmiar struktury można potem dynamicznie powiększać).
  * @return stworzoną strukturę,
  *         NULL - jeśli alokacja pamięci się nie powiodła.
  */
-static PhoneNumbers *phnumNew(size_t howManyNumbers) {
-    PhoneNumbers *phnum = (PhoneNumbers *) malloc(sizeof(PhoneNumbers));
+static PhoneNumbers *phnumNew(PhfwdAllocator const *allocator, Arena *arena, size_t howManyNumbers) {
+    PhoneNumbers *phnum = (PhoneNumbers *) ((arena == NULL) ? allocatorAlloc(allocator, sizeof(PhoneNumbers))
+                                                            : arenaAlloc(arena, sizeof(PhoneNumbers)));
     if (phnum == NULL)
         return NULL;
     phnum->elements = 0;
+    phnum->arena = arena;
+    if (allocator == NULL)
+        memset(&(phnum->allocator), 0, sizeof(PhfwdAllocator));
+    else
+        phnum->allocator = *allocator;
     if (howManyNumbers == 0) {
         phnum->num = NULL;
         phnum->size = 0;
         return phnum;
     }
-    char **nums = (char **) malloc(sizeof(char *) * howManyNumbers); //< tablica wskaźników na numery.
+    char **nums = (char **) phnumAlloc(phnum, sizeof(char *) * howManyNumbers); //< tablica wskaźników na numery.
     if (nums == NULL) {
-        free(phnum);
+        if (arena == NULL)
+            allocatorFree(allocator, phnum, sizeof(PhoneNumbers));
         return NULL;
     }
     phnum->num = nums;
@@ -77,34 +127,6 @@ static PhoneNumbers *phnumNew(size_t howManyNumbers) {
     return phnum;
 }
 
-/**
- * Sprawdza, czy w tablicy zmieści się słowo długości @p newLength. Jeśli nie, to zwiększa rozmiar tablicy.
- * @param A - wskaźnik na wskaźnik na tablicę.
- * @param size - aktualny rozmiar tablicy.
- * @param newLength - długość słowa, które powinno zmieścić się w tablicy.
- * @return - false, jeśli nie powiodła się alokacja pamięci,
- *           true, w pozostałych przypadkach.
- */
-static bool adjustSizeOfString(char **A, size_t *size, size_t newLength) {
-    if (*size == 0) {
-        // Tworzy nową tablicę.
-        (*A) = (char *) malloc(sizeof(char) * (newLength + 1));
-        if (*A == NULL) return false;
-        (*A)[0] = '\0'; //< Umieszcza w tablicy pusty string.
-        *size = newLength + 1;
-    } else if (newLength + 1 > *size) {
-        // Zwiększa rozmiar tablicy.
-        (*size) = newLength + 1;
-        char *newString = (char *) realloc(*A, sizeof(char) * (*size));
-
-        if (newString == NULL) {
-            free(*A);
-            return false;
-        }
-    }
-    return true;
-}
-
 /**
  * Umieszcza numer telefonu w strukturze.
  * @param phnum - wskaźnik na strukturę.
@@ -119,14 +141,23 @@ static bool phnumAddNumber(PhoneNumbers *phnum, char newNumber[]) {
         // Trzeba zwiększyć rozmiar tablicy.
         if (phnum->size == 0) {
             // Tworzy nową tablicę.
-            phnum->num = (char **) malloc(sizeof(char *));
+            phnum->num = (char **) phnumAlloc(phnum, sizeof(char *));
             if (phnum->num == NULL)
                 return false;
             phnum->size = 1;
+        } else if (phnum->arena != NULL) {
+            // Pamięci z obszaru nie można powiększyć, więc tablica jest przepisywana do nowego miejsca.
+            char **tmp = (char **) arenaAlloc(phnum->arena, (phnum->size) * 2 * sizeof(char *));
+            if (tmp == NULL)
+                return false;
+            memcpy(tmp, phnum->num, (phnum->size) * sizeof(char *));
+            phnum->num = tmp;
+            (phnum->size) *= 2;
         } else {
             // Zwiększa rozmiar tablicy.
             char **tmp = phnum->num;
-            tmp = realloc(tmp, (phnum->size) * 2 * sizeof(char *));
+            tmp = allocatorRealloc(&(phnum->allocator), tmp, (phnum->size) * sizeof(char *),
+                                   (phnum->size) * 2 * sizeof(char *));
             if (tmp == NULL) {
                 return false;
             }
@@ -141,142 +172,214 @@ static bool phnumAddNumber(PhoneNumbers *phnum, char newNumber[]) {
 }
 
 /**
- * Sprawdza, czy napis jest numerem telefonu.
- * @param string - wskaźnik na napis.
- * @return true, jeśli napis jest numerem telefonu.
- *         false, jeśli wskaźnik na napis ma wartość NULL lub napis nie jest numerem telefonu.
+ * Tworzy nową, pustą strukturę, której pamięć jest przydzielana alokatorem @p allocator.
+ * @param allocator - alokator struktury.
+ * @return - wskaźnik na utworzoną strukturę lub NULL, jeśli nie powiodła się alokacja pamięci.
  */
-static bool isStringAPhoneNumber(char const *string) {
-    if (string == NULL)
-        return false;
-    int i = 0;
-    while (isdigit(string[i]) || string[i] == '*' || string[i] == '#') i++;
-    if (string[i] != '\0' || i == 0)
-        return false;
-    return true;
-}
-
-PhoneForward *phfwdNew() {
+static PhoneForward *phfwdCreate(PhfwdAllocator const *allocator) {
     // 1
-    PhoneForward *new = (PhoneForward *) malloc(sizeof(PhoneForward));
+    PhoneForward *new = (PhoneForward *) allocatorAlloc(allocator, sizeof(PhoneForward));
 
     if (new == NULL)
         return NULL;
 
-    new->prefixes = phfwdPrefixesNew(); // Struktura drzewa prefiksowego po prefiksach numerów telefonu.
+    new->allocator = *allocator;
+    new->budget = SIZE_MAX;
+    new->account = accountNew(allocator, new->budget);
 
-    if (new->prefixes == NULL) {
-        free(new);
+    if (new->account == NULL) {
+        allocatorFree(allocator, new, sizeof(PhoneForward));
         return NULL;
     }
 
-    new->reverse = phfwdReverseNew(); // Struktura drzewa prefiksowego po przekierowaniach numerów telefonu.
+    PhfwdMemory mem;
+    memInit(&mem, new->account);
 
-    if (new->reverse == NULL) {
-        free(new->prefixes);
-        free(new);
+    new->prefixes = phfwdPrefixesNew(&mem); // Struktura drzewa prefiksowego po prefiksach numerów telefonu.
+    new->reverse = phfwdReverseNew(&mem); // Struktura drzewa prefiksowego po przekierowaniach numerów telefonu.
+
+    if (new->prefixes == NULL || new->reverse == NULL) {
+        memFree(memAllocator(&mem), new->prefixes, MEM_PREFIXES_NODE);
+        memFree(memAllocator(&mem), new->reverse, MEM_REVERSE_NODE);
+        accountRelease(new->account);
+        allocatorFree(allocator, new, sizeof(PhoneForward));
         return NULL;
     }
 
+    new->pending = NULL;
+    new->journal = NULL;
+    new->lookup = NULL;
+    new->samplePeriod = 0;
+    phfwdTouch(new);
+
     return new;
 }
 
-void phfwdDelete(PhoneForward *pf) {
-    if (pf == NULL)
-        return;
+PhoneForward *phfwdNew() {
+    static PhfwdAllocator const defaultAllocator;
 
-    phfwdReverseDelete(pf->reverse);
-    phfwdPrefixesDelete(pf->prefixes);
-    free(pf);
+    return phfwdCreate(&defaultAllocator);
 }
 
-bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
+PhoneForward *phfwdNewWithAllocator(PhfwdAllocator const *allocator) {
+    if (allocator == NULL || allocator->alloc == NULL || allocator->free == NULL)
+        return NULL;
 
-    if (!isStringAPhoneNumber(num1) || !isStringAPhoneNumber(num2) || !strcmp(num1, num2))
-        return false;
+    return phfwdCreate(allocator);
+}
+
+bool phfwdSetMemoryBudget(PhoneForward *pf, size_t budget) {
     if (pf == NULL)
         return false;
-    if (pf->prefixes == NULL || pf->reverse == NULL)
-        return false;
 
-    PhfwdPointers *pointers = addToReverse(pf->reverse, num1, num2);
+    pf->budget = (budget == 0) ? SIZE_MAX : budget;
 
-    if (pointers == NULL)
-        return false;
+    // Kopie współdzielą konto, więc limit dotyczy ich wszystkich.
+    atomic_store_explicit(&(pf->account->budget), pf->budget, memory_order_relaxed);
+    return true;
+}
 
-    if (addToPrefixes(pf->prefixes, num1, pointers))
-        return true;
+size_t phfwdMemoryUsage(PhoneForward const *pf) {
+    if (pf == NULL)
+        return 0;
 
-    free(pointers);
-    return false;
+    return atomic_load(&(pf->account->used));
+}
+
+void phfwdTouch(PhoneForward *pf) {
+    pf->version = atomic_fetch_add(&lastVersion, 1) + 1;
+}
+
+void phfwdDelete(PhoneForward *pf) {
+    if (pf == NULL)
+        return;
+
+    PhfwdAllocator allocator = pf->allocator;
+    journalClose(pf->journal);
+    lookupDelete(&allocator, pf->lookup);
+
+    releaseTries(&(pf->account->allocator), pf->prefixes, pf->reverse, pf->pending);
+    accountRelease(pf->account);
+    allocatorFree(&allocator, pf, sizeof(PhoneForward));
 }
 
 /**
- * Znajduje najdłuższy możliwy prefiks, do którego istnieje przekierowanie, przechowywane w strukturze @p pf.
- * @p *length przyjmuje wartość długości znalezionego prefiksu.
- * @param tree  – wskaźnik na strukturę przechowującą wskaźniki na przekierowania numerów;
- * @param num – wskaźnik na napis reprezentujący numer.
- * @param length - wskaźnik na zmienną, która będzie przechowywać długość odnalezionego prefiksu.
- * @return - wskaźnik na napis reprezentujący przekierowanie numeru.
- *         - NULL, jeśli w strukturze @p pf nie ma żadnego pasującego prefiksu.
+ * Funkcja wątku usuwającego strukturę w tle.
+ * @param pf - wskaźnik na usuwaną strukturę.
+ * @return NULL.
  */
-static const char *findOnePrefix(PhoneForwardPrefixes *tree, char const *num, size_t *length) {
-    size_t prefixLength = strlen(num);
-    size_t idx = 0;
-    char *diversion = NULL;
+static void *phfwdDeleteThread(void *pf) {
+    phfwdDelete((PhoneForward *) pf);
+    return NULL;
+}
 
-    while (idx < prefixLength && (tree->children)[charToNum(num[idx])] != NULL) {
-        tree = (tree->children)[charToNum(num[idx])];
-        idx++;
-        if (tree->pointersToReverse != NULL) {
-            *length = idx;
-            diversion = tree->pointersToReverse->node->diversion;
+void phfwdDeleteAsync(PhoneForward *pf) {
+    if (pf == NULL)
+        return;
+
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, phfwdDeleteThread, pf) != 0) {
+        phfwdDelete(pf);
+        return;
+    }
+    pthread_detach(thread);
+}
+
+bool phfwdReclaim(PhoneForward *pf, size_t budget) {
+    if (pf == NULL)
+        return true;
+
+    while (pf->pending != NULL && budget > 0) {
+        PhfwdTeardown *t = pf->pending;
+        budget -= teardownStep(&(pf->account->allocator), t, budget);
+
+        if (t->node == NULL) {
+            pf->pending = t->next;
+            memFree(&(pf->account->allocator), t, MEM_TEARDOWN);
         }
     }
-    if (diversion == NULL) {
-        *length = 0;
+    return pf->pending == NULL;
+}
+
+bool phfwdAddRule(PhoneForward *pf, char const *num1, char const *num2, bool commit) {
+    // Po nieudanym dodaniu w drzewach nie może zostać żaden nowy węzeł, bo zajmowałby miejsce w limicie,
+    // więc cała pamięć jest rezerwowana przed pierwszą zmianą. Operacja trafia do dziennika, zanim zmieni
+    // strukturę, więc błąd zapisu dziennika jest zgłaszany wynikiem funkcji.
+    PhfwdMemory mem;
+    PhfwdAddition addition;
+    memInit(&mem, pf->account);
+    if (!additionPrepare(&mem, pf->prefixes, pf->reverse, num1, num2, &addition)) {
+        memRelease(&mem);
+        return false;
     }
-    return diversion;
+    if (addition.unchanged)
+        return true;
+
+    JournalMark mark = journalMark(pf->journal);
+    if (!journalRecord(pf->journal, PHFWD_OPERATION_ADD, num1, num2) || (commit && !journalGroupCommit(pf->journal))) {
+        journalRewind(pf->journal, mark);
+        additionCancel(memAllocator(&mem), &addition);
+        memRelease(&mem);
+        return false;
+    }
+
+    lookupAddRule(pf, num1);
+    additionApply(&mem, &(pf->prefixes), &(pf->reverse), &addition);
+    memRelease(&mem);
+
+    uint64_t version = pf->version;
+    phfwdTouch(pf);
+    lookupUpdate(pf, version, num1);
+    return true;
 }
 
-PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
+bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
+
+    if (!isStringAPhoneNumber(num1) || !isStringAPhoneNumber(num2) || !strcmp(num1, num2))
+        return false;
+    if (pf == NULL)
+        return false;
+    if (pf->prefixes == NULL || pf->reverse == NULL)
+        return false;
+
+    phfwdReclaim(pf, RECLAIM_STEP);
+    return phfwdAddRule(pf, num1, num2, true);
+}
+
+PhoneNumbers *phfwdGetInArena(PhoneForward const *pf, char const *num, Arena *arena) {
     if (pf == NULL)
         return NULL;
     if (!isStringAPhoneNumber(num))
-        return phnumNew(0);
+        return phnumNew(&(pf->allocator), arena, 0);
 
-    size_t resultSize = 0; //< rozmiar tablicy, w której będzie przechowywane przekierowanie num.
-    char *result = NULL; //< wskaźnik na numer, będący przekierowaniem num.
     size_t num_length = 0;  //< długość znalezionego prefiksu, do którego istnieje przekierowanie.
-    char const *tmp = findOnePrefix(pf->prefixes, num, &num_length);
+    char const *tmp = phfwdFindPrefix(pf, num, &num_length);
 
     size_t tmpLength = (tmp == NULL) ? 0 : strlen(tmp);
     size_t afterPrefix =
             strlen(num) - num_length; //< indeks w num, od którego numer nie zmienia się na jego przekierowanie.
     size_t newLength = afterPrefix + tmpLength;  //< całkowita długość wynikowego przekierowania.
+    PhoneNumbers *diversion = phnumNew(&(pf->allocator), arena, 1);
+    if (diversion == NULL)
+        return NULL;
+
+    char *result = (char *) phnumAlloc(diversion, sizeof(char) * (newLength + 1)); //< numer, będący przekierowaniem num.
 
-    if (!adjustSizeOfString(&result, &resultSize, newLength)) {
+    if (result == NULL) {
+        phnumDelete(diversion);
         return NULL;
     }
 
     if (num_length != 0) { //< Jeśli istnieje przekierowanie prefiksu num.
-        strcat(result, tmp);
+        memcpy(result, tmp, tmpLength);
     }
 
-    size_t j = num_length; //< indeks w tablicy num.
     // Kopiuje resztę num, która nie zamieniła się na przekierowanie.
-    for (size_t i = tmpLength; i <= newLength; i++) {
-        result[i] = num[j];
-        j++;
-    }
-
-    PhoneNumbers *diversion = phnumNew(1);
-    if (diversion == NULL) {
-        free(result);
-        return NULL;
-    }
+    memcpy(result + tmpLength, num + num_length, afterPrefix + 1);
 
     if (!phnumAddNumber(diversion, result)) {
+        phnumFreeNumber(diversion, result);
         phnumDelete(diversion);
         return NULL;
     }
@@ -284,63 +387,117 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
     return diversion;
 }
 
-void phfwdRemove(PhoneForward *pf, char const *num) {
+PhoneNumbers *phnumSingle(PhfwdAllocator const *allocator, char const *num) {
+    if (num == NULL)
+        return phnumNew(allocator, NULL, 0);
+
+    char *copy = allocatorStrdup(allocator, num);
+    if (copy == NULL)
+        return NULL;
+
+    PhoneNumbers *result = phnumNew(allocator, NULL, 1);
+    if (result == NULL || !phnumAddNumber(result, copy)) {
+        allocatorFreeString(allocator, copy);
+        phnumDelete(result);
+        return NULL;
+    }
+    return result;
+}
+
+bool phnumAppend(PhoneNumbers *pnum, char const *prefix, char const *rest) {
+    size_t prefixLength = strlen(prefix);
+    char *num = (char *) phnumAlloc(pnum, sizeof(char) * (prefixLength + strlen(rest) + 1));
+
+    if (num == NULL)
+        return false;
+
+    memcpy(num, prefix, prefixLength);
+    strcpy(num + prefixLength, rest);
+
+    if (!phnumAddNumber(pnum, num)) {
+        phnumFreeNumber(pnum, num);
+        return false;
+    }
+    return true;
+}
+
+PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
+    return phfwdGetInArena(pf, num, NULL);
+}
+
+/**
+ * Usuwa przekierowania wszystkich prefiksów zaczynających się od @p num albo tylko przekierowanie prefiksu @p num.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @param num - prefiks numeru telefonu.
+ * @param operation - PHFWD_OPERATION_REMOVE lub PHFWD_OPERATION_REMOVE_ONE.
+ */
+static void phfwdRemoveWith(PhoneForward *pf, char const *num, PhfwdOperation operation) {
     if (pf == NULL || !isStringAPhoneNumber(num))
         return;
-    PhoneForwardPrefixes *node = pf->prefixes;
-    PhoneForwardPrefixes *parent = node;
-    size_t prefixLength = strlen(num);
-    size_t idx = 0;
 
+    phfwdReclaim(pf, RECLAIM_STEP);
 
-    while (idx < prefixLength && (node->children)[charToNum(num[idx])] != NULL) {
-        parent = node;
-        node = (node->children)[charToNum(num[idx])];
-        idx++;
-    }
+    // Węzły skopiowane przez nieudane przygotowanie nie zmieniają przekierowań, więc mogą zostać w drzewach.
+    PhfwdMemory mem;
+    PhfwdRemoval removal;
+    bool subtree = operation == PHFWD_OPERATION_REMOVE;
+    memInit(&mem, pf->account);
+    if (!removalPrepare(&mem, &(pf->prefixes), &(pf->reverse), num, subtree, &removal) ||
+        (removal.slot == NULL && removal.node == NULL))
+        return;
 
-    if (idx != prefixLength)
+    if (!journalRecord(pf->journal, operation, num, NULL) || !journalGroupCommit(pf->journal)) {
+        removalCancel(&mem, &removal);
         return;
+    }
+
+    lookupRemoveRules(pf, removal.rules, removal.count);
+    removalApply(&mem, &(pf->reverse), &(pf->pending), &removal);
+
+    uint64_t version = pf->version;
+    phfwdTouch(pf);
+    lookupUpdate(pf, version, num);
+}
+
+void phfwdRemove(PhoneForward *pf, char const *num) {
+    phfwdRemoveWith(pf, num, PHFWD_OPERATION_REMOVE);
+}
 
-    idx--;
-    (parent->children)[charToNum(num[idx])] = NULL;
-    deleteSubtree(node);
+void phfwdRemoveOne(PhoneForward *pf, char const *num) {
+    phfwdRemoveWith(pf, num, PHFWD_OPERATION_REMOVE_ONE);
 }
 
 /**
  * Zwraca numery z jednego węzła @p node, których przekierowaniem mógłby być numer @p num.
- * @param node - węzeł drzewa PhoneForwardReverse, zawierający listę przekierowywanych prefiksów numeru telefonu.
+ * @param node - węzeł drzewa PhoneForwardReverse, zawierający tablicę przekierowywanych prefiksów numeru telefonu.
  * @param num - numer telefonu.
  * @param result - tablica, przechowująca wynikowe numery.
  * @return - true - jeśli udało się dodać wszystkie przekierowywane numery.
  *          - false - jeśli nie powiodła się alokacja pamięci.
  */
 static bool reverseOneNode(PhoneForwardReverse *node, char const *num, PhoneNumbers *result) {
-    Prefix *list = node->prefixes;
+    Prefix *prefixes = node->prefixes;
 
-    if (list == NULL)
+    if (prefixes == NULL)
         return true;
 
-    list = list->next;
     size_t diversionLength = strlen(node->diversion);
     size_t rest = strlen(num) - diversionLength;
 
-    while (list != NULL) {
-        size_t prefixLength = strlen(list->num);
-        char *rev = (char *) malloc(sizeof(char) * (prefixLength + rest + 1));
+    for (size_t i = 0; i < prefixes->count; i++) {
+        size_t prefixLength = strlen((prefixes->nums)[i]);
+        char *rev = (char *) phnumAlloc(result, sizeof(char) * (prefixLength + rest + 1));
 
         if (rev == NULL)
             return false;
 
-        strcpy(rev, list->num);
-        strcat(rev, num + diversionLength);
+        memcpy(rev, (prefixes->nums)[i], prefixLength);
+        strcpy(rev + prefixLength, num + diversionLength);
 
         if (!phnumAddNumber(result, rev)) {
-            free(rev);
+            phnumFreeNumber(result, rev);
             return false;
         }
-
-        list = list->next;
     }
 
     return true;
@@ -389,36 +546,129 @@ static int compare(const void *a, const void *b) {
 }
 
 /**
- * Usuwa element ze środka tablicy @p phnum.
+ * Usuwa powtarzające się elementy w posortowanej niemalejąca względem porządku leksykograficznego tablicy.
  * @param phnum - wskaźnik na tablicę.
- * @param idx - indeks usuwanego elementu.
  */
-static void phnumRemoveElement(PhoneNumbers *phnum, size_t idx) {
-    if (phnum == NULL || idx >= phnum->elements)
+static void phnumRemoveRepetitions(PhoneNumbers *phnum) {
+    if (phnum->elements == 0)
         return;
 
-    free((phnum->num)[idx]);
+    size_t kept = 1;
 
-    for (size_t j = idx + 1; j < phnum->elements; j++) {
-        (phnum->num)[j - 1] = (phnum->num)[j];
+    for (size_t i = 1; i < phnum->elements; i++) {
+        if (strcmp((phnum->num)[kept - 1], (phnum->num)[i]) != 0)
+            (phnum->num)[kept++] = (phnum->num)[i];
+        else
+            phnumFreeNumber(phnum, (phnum->num)[i]);
     }
-    (phnum->elements)--;
+    phnum->elements = kept;
 }
 
 /**
- * Usuwa powtarzające się elementy w posortowanej niemalejąca względem porządku leksykograficznego tablicy.
- * @param phnum - wskaźnik na tablicę.
+ * Sprawdza, czy @p num jest wynikiem wywołania funkcji phfwdGet z numerem @p candidate, nie alokując pamięci.
+ * @param pf - struktura przechowująca przekierowania prefiksów numerów telefonu.
+ * @param candidate - numer telefonu.
+ * @param num - numer, który powinien być przekierowaniem numeru @p candidate.
+ * @return true - jeśli przekierowaniem numeru @p candidate jest @p num.
+ *         false - w przeciwnym wypadku.
  */
-static void phnumRemoveRepetitions(PhoneNumbers *phnum) {
-    char const *prev = phnumGet(phnum, 0);
+static bool isForwardedTo(PhoneForward const *pf, char const *candidate, char const *num) {
+    size_t length = 0;
+    char const *diversion = phfwdFindPrefix(pf, candidate, &length);
+    size_t diversionLength = (diversion == NULL) ? 0 : strlen(diversion);
 
-    for (size_t i = 1; i < phnum->elements; i++) {
+    if (diversion != NULL && strncmp(diversion, num, diversionLength) != 0)
+        return false;
+    return strcmp(candidate + length, num + diversionLength) == 0;
+}
 
-        if (!strcmp(prev, phnumGet(phnum, i)))
-            phnumRemoveElement(phnum, i);
-        else
-            prev = phnumGet(phnum, i);
+/**
+ * Podaje koniec rosnącego ciągu numerów zaczynającego się na pozycji @p start.
+ * @param nums - tablica numerów.
+ * @param start - początek ciągu, mniejszy od @p count.
+ * @param count - liczba numerów w tablicy.
+ * @return - pozycja za ostatnim numerem ciągu.
+ */
+static size_t runEnd(char **nums, size_t start, size_t count) {
+    size_t end = start + 1;
+    while (end < count && compare(&nums[end - 1], &nums[end]) <= 0)
+        end++;
+    return end;
+}
+
+/**
+ * Scala dwa uporządkowane ciągi numerów.
+ * @param left - pierwszy ciąg.
+ * @param leftCount - długość pierwszego ciągu.
+ * @param right - drugi ciąg, leżący w tablicy zaraz za pierwszym.
+ * @param rightCount - długość drugiego ciągu.
+ * @param out - miejsce na scalony ciąg, rozłączne z oboma ciągami.
+ */
+static void mergeRuns(char **left, size_t leftCount, char **right, size_t rightCount, char **out) {
+    size_t i = 0, j = 0;
+
+    while (i < leftCount && j < rightCount)
+        *(out++) = (compare(&right[j], &left[i]) < 0) ? right[j++] : left[i++];
+    while (i < leftCount)
+        *(out++) = left[i++];
+    while (j < rightCount)
+        *(out++) = right[j++];
+}
+
+/**
+ * Porządkuje numery wyniku, scalając parami kolejne rosnące ciągi. Tablica prefiksów węzła drzewa
+ * PhoneForwardReverse jest uporządkowana, więc numery dopisane z jednego węzła tworzą zwykle jeden ciąg, który
+ * przerywa tylko prefiks będący początkiem kolejnego prefiksu. Granice ciągów są wyznaczane raz, więc dla k ciągów
+ * to około n log k porównań zamiast sortowania całego wyniku.
+ * @param phnum - wynik zapytania.
+ * @return true - jeśli udało się uporządkować numery.
+ *         false - jeśli nie powiodła się alokacja pamięci. Wtedy kolejność numerów się nie zmienia.
+ */
+static bool phnumMergeRuns(PhoneNumbers *phnum) {
+    size_t count = phnum->elements;
+    if (count < 2 || runEnd(phnum->num, 0, count) == count)
+        return true;
+
+    // Ciągów jest najwyżej tyle, co numerów, więc tablice granic i numerów mieszczą się w jednym bloku.
+    char *localNums[MERGE_LOCAL];
+    size_t localBounds[MERGE_LOCAL + 1];
+    size_t bytes = (sizeof(char *) + sizeof(size_t)) * count + sizeof(size_t);
+    void *block = (count <= MERGE_LOCAL) ? NULL : phnumAlloc(phnum, bytes);
+    if (count > MERGE_LOCAL && block == NULL)
+        return false;
+
+    size_t *bounds = (block == NULL) ? localBounds : (size_t *) block;
+    char **from = phnum->num;
+    char **to = (block == NULL) ? localNums : (char **) (bounds + count + 1);
+    size_t runs = 0;
+
+    for (size_t start = 0; start < count; start = runEnd(from, start, count))
+        bounds[runs++] = start;
+    bounds[runs] = count;
+
+    while (runs > 1) {
+        size_t merged = 0;
+
+        for (size_t r = 0; r < runs; r += 2) {
+            size_t start = bounds[r];
+            size_t mid = bounds[(r + 1 < runs) ? r + 1 : runs];
+            size_t end = bounds[(r + 2 < runs) ? r + 2 : runs];
+            mergeRuns(from + start, mid - start, from + mid, end - mid, to + start);
+            bounds[merged++] = start;
+        }
+        bounds[merged] = count;
+        runs = merged;
+
+        char **tmp = from;
+        from = to;
+        to = tmp;
     }
+
+    if (from != phnum->num)
+        memcpy(phnum->num, from, sizeof(char *) * count);
+    if (block != NULL && phnum->arena == NULL)
+        allocatorFree(&(phnum->allocator), block, bytes);
+    return true;
 }
 
 /**
@@ -426,41 +676,60 @@ static void phnumRemoveRepetitions(PhoneNumbers *phnum) {
  * @param pf - struktura przechowująca przekierowania prefiksów numerów telefonu.
  * @param num - numer, który powinien być wynikiem funkcji phfwdGet z numerami z @p phnum.
  * @param phnum - struktura, z której zostaną usunięte niespełniające powyższego warunku numery.
- * @return true - jeśli alokacja pamięci się powiodła, false - w przeciwnym wypadku.
  */
-static bool phnumDeleteIncorrectReverseResults(PhoneForward const *pf, char const *num, PhoneNumbers *phnum) {
-    if (phnum == NULL || phnum->elements == 0)
-        return true;
+static void phnumDeleteIncorrectReverseResults(PhoneForward const *pf, char const *num, PhoneNumbers *phnum) {
+    size_t kept = 0;
 
     for (size_t i = 0; i < phnum->elements; i++) {
-        PhoneNumbers *phfwdGetResult = phfwdGet(pf, phnumGet(phnum, i));
+        if (isForwardedTo(pf, (phnum->num)[i], num))
+            (phnum->num)[kept++] = (phnum->num)[i];
+        else
+            phnumFreeNumber(phnum, (phnum->num)[i]);
+    }
+    phnum->elements = kept;
+}
 
-        if (phfwdGetResult == NULL)
-            return false;
+PhoneNumbers *reverseFinish(PhoneNumbers *result, char const *num) {
+    size_t prefixLength = strlen(num);
+    char *copy = (char *) phnumAlloc(result, sizeof(char) * (prefixLength + 1));
 
-        if (strcmp(phnumGet(phfwdGetResult, 0), num)) {
-            phnumRemoveElement(phnum, i);
-            i--;
-        }
-        phnumDelete(phfwdGetResult);
+    if (copy == NULL) {
+        phnumDelete(result);
+        return NULL;
     }
-    return true;
+
+    strcpy(copy, num);
+
+    if (!phnumAddNumber(result, copy)) {
+        phnumFreeNumber(result, copy);
+        phnumDelete(result);
+        return NULL;
+    }
+    if (!phnumMergeRuns(result)) {
+        phnumDelete(result);
+        return NULL;
+    }
+    phnumRemoveRepetitions(result);
+    return result;
 }
 
-PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
+PhoneNumbers *phfwdReverseInArena(PhoneForward const *pf, char const *num, Arena *arena) {
     if (pf == NULL)
         return NULL;
     if (!isStringAPhoneNumber(num)) {
-        return phnumNew(0);
+        return phnumNew(&(pf->allocator), arena, 0);
     }
 
     size_t prefixLength = strlen(num);
     PhoneForwardReverse *node = pf->reverse;
     size_t idx = 0;
-    PhoneNumbers *result = phnumNew(0);
+    PhoneNumbers *result = phnumNew(&(pf->allocator), arena, 0);
     if (result == NULL)
         return NULL; //1
 
+    if (pf->samplePeriod != 0)
+        layoutSampleReverse(pf, num);
+
     while (idx <= prefixLength && node != NULL) {
         if (node->diversion != NULL && !reverseOneNode(node, num, result)) {
             phnumDelete(result);
@@ -471,38 +740,250 @@ PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
         idx++;
     }
 
-    char *copy = (char *) malloc(sizeof(char) * (prefixLength + 1));
+    return reverseFinish(result, num);
+}
 
-    if (copy == NULL) {
-        phnumDelete(result);
-        return NULL; //3
+PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
+    return phfwdReverseInArena(pf, num, NULL);
+}
+
+/**
+ * @struct ReverseQuery
+ * @brief ReverseQuery jest numerem z zapytania phfwdReverseBatch razem z jego pozycją w tablicy zapytań.
+ */
+struct ReverseQuery {
+    char const *num; ///< Numer telefonu.
+    size_t idx; ///< Indeks numeru w tablicy zapytań.
+};
+typedef struct ReverseQuery ReverseQuery;
+
+/**
+ * Porównuje dwa zapytania według numerów, tak żeby zapytania o wspólnym prefiksie były obok siebie.
+ * @param a - pierwsze zapytanie.
+ * @param b - drugie zapytanie.
+ * @return - wynik funkcji strcmp dla numerów zapytań.
+ */
+static int compareQueries(const void *a, const void *b) {
+    return strcmp(((ReverseQuery const *) a)->num, ((ReverseQuery const *) b)->num);
+}
+
+bool phfwdReverseBatch(PhoneForward const *pf, char const *const *nums, size_t count, PhoneNumbers **results) {
+    if (pf == NULL || ((nums == NULL || results == NULL) && count > 0))
+        return false;
+
+    PhfwdAllocator const *allocator = &(pf->allocator);
+    ReverseQuery *queries = (ReverseQuery *) allocatorAlloc(allocator, sizeof(ReverseQuery) * (count + 1));
+    if (queries == NULL)
+        return false;
+
+    size_t valid = 0;
+    size_t maxLength = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        results[i] = NULL;
+
+        if (isStringAPhoneNumber(nums[i])) {
+            queries[valid].num = nums[i];
+            queries[valid].idx = i;
+            valid++;
+
+            size_t length = strlen(nums[i]);
+            if (length > maxLength)
+                maxLength = length;
+        }
     }
 
-    strcpy(copy, num);
+    qsort(queries, valid, sizeof(ReverseQuery), compareQueries);
+
+    // path[d] jest węzłem na głębokości d ścieżki poprzedniego zapytania, a diversions zawiera głębokości
+    // tych węzłów ścieżki, które przechowują przekierowanie.
+    PhoneForwardReverse **path = (PhoneForwardReverse **) allocatorAlloc(allocator, sizeof(PhoneForwardReverse *) *
+                                                                                    (maxLength + 1));
+    size_t *diversions = (size_t *) allocatorAlloc(allocator, sizeof(size_t) * (maxLength + 1));
+    bool result = path != NULL && diversions != NULL;
+    size_t reached = 0;
+    size_t diversionsCount = 0;
+    char const *prev = "";
+
+    if (result) {
+        path[0] = pf->reverse;
+        if (pf->reverse->diversion != NULL)
+            diversions[diversionsCount++] = 0;
+    }
 
-    if (!phnumAddNumber(result, copy)) {
-        phnumDelete(result);
-        free(copy);
-        return NULL;
+    for (size_t q = 0; q < valid && result; q++) {
+        char const *num = queries[q].num;
+        size_t depth = 0;
+
+        while (depth < reached && num[depth] == prev[depth])
+            depth++;
+        while (diversionsCount > 0 && diversions[diversionsCount - 1] > depth)
+            diversionsCount--;
+
+        // Ścieżka jest przedłużana tylko od miejsca, w którym numer różni się od poprzedniego.
+        while (num[depth] != '\0' && (path[depth]->children)[charToNum(num[depth])] != NULL) {
+            path[depth + 1] = (path[depth]->children)[charToNum(num[depth])];
+            depth++;
+            if (path[depth]->diversion != NULL)
+                diversions[diversionsCount++] = depth;
+        }
+        reached = depth;
+        prev = num;
+
+        PhoneNumbers *found = phnumNew(&(pf->allocator), NULL, 0);
+
+        for (size_t k = 0; found != NULL && k < diversionsCount; k++) {
+            if (!reverseOneNode(path[diversions[k]], num, found)) {
+                phnumDelete(found);
+                found = NULL;
+            }
+        }
+
+        results[queries[q].idx] = (found == NULL) ? NULL : reverseFinish(found, num);
+        result = results[queries[q].idx] != NULL;
     }
-    qsort(result->num, result->elements, sizeof(char *), compare);
-    phnumRemoveRepetitions(result);
+
+    for (size_t i = 0; i < count && result; i++) {
+        if (results[i] == NULL) {
+            results[i] = phnumNew(&(pf->allocator), NULL, 0);
+            result = results[i] != NULL;
+        }
+    }
+
+    if (!result) {
+        for (size_t i = 0; i < count; i++) {
+            phnumDelete(results[i]);
+            results[i] = NULL;
+        }
+    }
+
+    allocatorFree(allocator, path, sizeof(PhoneForwardReverse *) * (maxLength + 1));
+    allocatorFree(allocator, diversions, sizeof(size_t) * (maxLength + 1));
+    allocatorFree(allocator, queries, sizeof(ReverseQuery) * (count + 1));
     return result;
 }
 
-PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
-    PhoneNumbers *pnum = phfwdReverse(pf, num);
+/**
+ * Sprawdza, czy numer powstały z prefiksu @p prefix zapisanego w węźle drzewa PhoneForwardReverse na głębokości
+ * @p depth pojawia się też wśród numerów z płytszego węzła na ścieżce numeru @p num. Jest tak wtedy, gdy
+ * @p prefix jest postaci p + num[d..depth), gdzie p jest przekierowywane na num[0..d). Kandydaci p są
+ * sprawdzani jednym przejściem drzewa PhoneForwardPrefixes po ścieżce @p prefix, równolegle z przejściem
+ * drzewa PhoneForwardReverse po ścieżce @p num, więc czas działania jest liniowy względem długości numerów.
+ * @param pf - struktura przechowująca przekierowania.
+ * @param num - numer telefonu.
+ * @param depth - głębokość węzła, w którym zapisany jest @p prefix.
+ * @param prefix - prefiks numeru telefonu.
+ * @return true - jeśli numer się powtarza.
+ *         false - w przeciwnym wypadku.
+ */
+static bool isRepeatedCandidate(PhoneForward const *pf, char const *num, size_t depth, char const *prefix) {
+    size_t length = strlen(prefix);
+    size_t shift = 0;
+
+    // Najdłuższe wspólne zakończenie prefix i num[0..depth), po którym p pozostaje niepuste.
+    while (shift < depth && shift + 1 < length && prefix[length - 1 - shift] == num[depth - 1 - shift])
+        shift++;
+    if (shift == 0)
+        return false;
 
-    if (pnum == NULL)
-        return NULL;
+    PhoneForwardPrefixes *pnode = findPrefixesNode(pf->prefixes, prefix, length - shift);
+    PhoneForwardReverse *rnode = pf->reverse;
+    for (size_t idx = 0; idx < depth - shift; idx++)
+        rnode = (rnode->children)[charToNum(num[idx])];
+
+    // Węzeł przekierowany na num[0..d) dzieli napis przekierowania z węzłem num[0..d) drzewa PhoneForwardReverse.
+    for (size_t k = length - shift, d = depth - shift; k < length && pnode != NULL; k++, d++) {
+        if (pnode->diversion != NULL && pnode->diversion == rnode->diversion)
+            return true;
+        pnode = (pnode->children)[charToNum(prefix[k])];
+        rnode = (rnode->children)[charToNum(num[d])];
+    }
+    return false;
+}
 
-    if (pnum->elements == 0)
-        return pnum;
+size_t phfwdReverseCount(PhoneForward const *pf, char const *num) {
+    if (pf == NULL || !isStringAPhoneNumber(num))
+        return 0;
 
-    if (!phnumDeleteIncorrectReverseResults(pf, num, pnum)) {
-        phnumDelete(pnum);
-        return NULL;
+    size_t result = 1; //< sam numer num.
+    size_t diversionNodes = 0;
+    PhoneForwardReverse *node = pf->reverse;
+
+    for (size_t depth = 0; node != NULL; depth++) {
+        if (node->diversion != NULL) {
+            diversionNodes++;
+            result += node->prefixes->count;
+
+            // Numery z najpłytszego węzła nie mogą się powtórzyć, więc wystarczy rozmiar tablicy.
+            for (size_t i = 0; i < node->prefixes->count && diversionNodes > 1; i++)
+                result -= isRepeatedCandidate(pf, num, depth, (node->prefixes->nums)[i]) ? 1 : 0;
+        }
+
+        if (num[depth] == '\0')
+            break;
+        node = (node->children)[charToNum(num[depth])];
+    }
+    return result;
+}
+
+/**
+ * Sprawdza, czy wynik phfwdGet dla numeru @p prefix + @p rest pochodzi z dłuższego przekierowywanego prefiksu niż
+ * @p prefix, czyli czy numer nie należy do wyniku phfwdGetReverse, mimo że należy do wyniku phfwdReverse.
+ * @param pf - struktura przechowująca przekierowania.
+ * @param prefix - prefiks z tablicy węzła drzewa PhoneForwardReverse.
+ * @param rest - niepusta pozostała część numeru.
+ * @return true - jeśli warunek jest spełniony.
+ *         false - w przeciwnym wypadku.
+ */
+static bool isShadowed(PhoneForward const *pf, char const *prefix, char const *rest) {
+    PhoneForwardPrefixes *tree = findPrefixesNode(pf->prefixes, prefix, strlen(prefix));
+
+    for (size_t i = 0; rest[i] != '\0'; i++) {
+        tree = (tree->children)[charToNum(rest[i])];
+
+        if (tree == NULL)
+            return false;
+        if (tree->diversion != NULL)
+            return true;
+    }
+    return false;
+}
+
+size_t phfwdGetReverseCount(PhoneForward const *pf, char const *num) {
+    if (pf == NULL || !isStringAPhoneNumber(num))
+        return 0;
+
+    size_t length = 0;
+    size_t result = (phfwdFindPrefix(pf, num, &length) == NULL) ? 1 : 0;
+    PhoneForwardReverse *node = pf->reverse;
+
+    // Każdy numer jest liczony tylko przy swoim najdłuższym przekierowywanym prefiksie, więc się nie powtarza.
+    // Prefiksy z węzła całego numeru są samymi numerami, więc nie mają dłuższych prefiksów i wystarczy licznik.
+    for (size_t depth = 0; node != NULL; depth++) {
+        if (node->diversion != NULL) {
+            result += node->prefixes->count;
+
+            for (size_t i = 0; i < node->prefixes->count && num[depth] != '\0'; i++)
+                result -= isShadowed(pf, (node->prefixes->nums)[i], num + depth) ? 1 : 0;
+        }
+
+        if (num[depth] == '\0')
+            break;
+        node = (node->children)[charToNum(num[depth])];
     }
+    return result;
+}
+
+PhoneNumbers *phfwdGetReverseInArena(PhoneForward const *pf, char const *num, Arena *arena) {
+    PhoneNumbers *pnum = phfwdReverseInArena(pf, num, arena);
+
+    if (pnum == NULL)
+        return NULL;
 
+    phnumDeleteIncorrectReverseResults(pf, num, pnum);
     return pnum;
-}
\ No newline at end of file
+}
+
+PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+    return phfwdGetReverseInArena(pf, num, NULL);
+}
@@ -24,6 +24,104 @@ typedef struct PhoneForward PhoneForward;
 struct PhoneNumbers;
 typedef struct PhoneNumbers PhoneNumbers;
 
+/**
+ * To jest struktura przechowująca ciąg operacji, które mają zostać wykonane
+ * na strukturze @ref PhoneForward jednocześnie.
+ */
+struct PhfwdTransaction;
+typedef struct PhfwdTransaction PhfwdTransaction;
+
+/**
+ * To jest struktura przechowująca wyniki zapytań wykonanych przez
+ * @ref phfwdBatchRun.
+ */
+struct PhfwdBatch;
+typedef struct PhfwdBatch PhfwdBatch; ///< @ref PhfwdBatch
+
+/**
+ * To jest struktura przechowująca stan przeglądania przekierowań przez
+ * @ref phfwdIteratorNext.
+ */
+struct PhfwdIterator;
+typedef struct PhfwdIterator PhfwdIterator; ///< @ref PhfwdIterator
+
+/**
+ * To jest struktura zapamiętująca wyniki @ref phfwdResolveChain.
+ */
+struct PhfwdChainMemo;
+typedef struct PhfwdChainMemo PhfwdChainMemo; ///< @ref PhfwdChainMemo
+
+/**
+ * To jest rodzaj zapytań wykonywanych przez @ref phfwdBatchRun.
+ */
+typedef enum PhfwdQuery {
+    PHFWD_QUERY_GET,        ///< Zapytanie @ref phfwdGet.
+    PHFWD_QUERY_REVERSE,    ///< Zapytanie @ref phfwdReverse.
+    PHFWD_QUERY_GET_REVERSE ///< Zapytanie @ref phfwdGetReverse.
+} PhfwdQuery;
+
+/**
+ * To jest rodzaj operacji modyfikującej strukturę, przekazywanej przez
+ * @ref phfwdDiff.
+ */
+typedef enum PhfwdOperation {
+    PHFWD_OPERATION_ADD,       ///< Operacja @ref phfwdAdd.
+    PHFWD_OPERATION_REMOVE,    ///< Operacja @ref phfwdRemove.
+    PHFWD_OPERATION_REMOVE_ONE ///< Operacja @ref phfwdRemoveOne.
+} PhfwdOperation;
+
+/**
+ * To jest funkcja, do której przekazywane są kolejne operacje wyznaczone przez
+ * @ref phfwdDiff. Operacja @p operation ma zostać wykonana z parametrem
+ * @p num1 i, jeśli dodaje przekierowanie, z parametrem @p num2, który
+ * w przeciwnym przypadku ma wartość NULL. Napisy są ważne tylko w czasie
+ * wywołania. Zwrócenie wartości @p false przerywa wyznaczanie różnic.
+ */
+typedef bool (*PhfwdDiffCallback)(void *context, PhfwdOperation operation, char const *num1, char const *num2);
+
+/**
+ * To jest funkcja, do której @ref phfwdQueryEach przekazuje kolejne numery
+ * wyniku zapytania. Napis @p num ma długość @p length, jest zakończony
+ * znakiem @p '\0' i jest ważny tylko w czasie wywołania. Zwrócenie wartości
+ * @p false przerywa przekazywanie numerów.
+ */
+typedef bool (*PhfwdNumberCallback)(void *context, char const *num, size_t length);
+
+/**
+ * To jest typ wyznaczający, które przekierowanie zostaje zachowane przez
+ * @ref phfwdMerge, jeśli obie scalane struktury mają przekierowanie tego
+ * samego prefiksu.
+ */
+typedef enum PhfwdMergePolicy {
+    PHFWD_MERGE_SRC_WINS, ///< Zostaje przekierowanie ze struktury źródłowej.
+    PHFWD_MERGE_DST_WINS  ///< Zostaje przekierowanie ze struktury docelowej.
+} PhfwdMergePolicy;
+
+/**
+ * To jest sposób wyszukiwania najdłuższego przekierowywanego prefiksu numeru,
+ * wybierany przez @ref phfwdSetLookupEngine.
+ */
+typedef enum PhfwdLookupEngine {
+    PHFWD_LOOKUP_TRIE, ///< Przejście drzewa prefiksów znak po znaku.
+    PHFWD_LOOKUP_HASH  ///< Przeszukiwanie binarne długości prefiksów
+                       ///< w tablicach z haszowaniem.
+} PhfwdLookupEngine;
+
+/**
+ * To są funkcje, którymi struktura @ref PhoneForward przydziela i zwalnia
+ * pamięć, np. żeby korzystać z osobnego obszaru alokatora jemalloc albo
+ * z pamięci na dużych stronach. Funkcja alloc przydziela @p size bajtów
+ * wyrównanych tak jak wynik funkcji malloc albo zwraca NULL, gdy brakuje
+ * pamięci. Funkcja free zwalnia pamięć @p ptr przydzieloną przez alloc
+ * i dostaje ten sam rozmiar @p size, który był podany przy jej przydzieleniu.
+ * Obie funkcje dostają jako pierwszy parametr wskaźnik context.
+ */
+typedef struct PhfwdAllocator {
+    void *(*alloc)(void *context, size_t size);          ///< Przydziela pamięć.
+    void (*free)(void *context, void *ptr, size_t size); ///< Zwalnia pamięć.
+    void *context; ///< Wskaźnik przekazywany obu funkcjom.
+} PhfwdAllocator;
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -31,6 +129,26 @@ typedef struct PhoneNumbers PhoneNumbers;
  */
 PhoneForward *phfwdNew(void);
 
+/** @brief Tworzy nową strukturę z własnym alokatorem.
+ * Działa jak @ref phfwdNew, ale cała pamięć struktury, jej kopii utworzonych
+ * przez @ref phfwdClone, zapisanych w niej transakcji, dziennika i tablic
+ * wyszukiwania, a także wyników zapytań o nią, w tym wyników
+ * @ref phfwdBatchRun, jest przydzielana i zwalniana funkcjami z @p allocator.
+ * Węzły drzew są przydzielane blokami po wiele naraz, a pamięć zwolnionych
+ * węzłów jest używana ponownie i wraca do alokatora dopiero po usunięciu
+ * struktury i wszystkich jej kopii.
+ * Struktura zapamiętuje kopię @p allocator. Funkcje alokatora mogą być
+ * wywoływane z wielu wątków naraz, jeśli struktura jest używana przez wiele
+ * wątków, np. przez @ref phfwdBatchRun lub @ref phfwdDeleteAsync. Pamięć
+ * wyników zapytań jest zwalniana tym samym alokatorem, więc musi on działać,
+ * dopóki nie zostaną usunięte wszystkie wyniki.
+ * @param[in] allocator – wskaźnik na funkcje alokatora.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wskaźnik
+ *         @p allocator lub któraś z jego funkcji ma wartość NULL albo nie
+ *         udało się alokować pamięci.
+ */
+PhoneForward *phfwdNewWithAllocator(PhfwdAllocator const *allocator);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pf. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -38,6 +156,97 @@ PhoneForward *phfwdNew(void);
  */
 void phfwdDelete(PhoneForward *pf);
 
+/** @brief Usuwa strukturę w tle.
+ * Działa jak @ref phfwdDelete, ale zwalnianie pamięci odbywa się w osobnym
+ * wątku, więc funkcja wraca od razu. Jeśli nie udało się utworzyć wątku,
+ * struktura jest usuwana od razu. Nic nie robi, jeśli wskaźnik @p pf ma
+ * wartość NULL. Po wywołaniu tej funkcji nie wolno już używać @p pf.
+ * @param[in] pf – wskaźnik na usuwaną strukturę.
+ */
+void phfwdDeleteAsync(PhoneForward *pf);
+
+/** @brief Tworzy kopię struktury.
+ * Tworzy strukturę zawierającą te same przekierowania co @p pf. Kopia
+ * współdzieli z @p pf całą pamięć, więc jest tworzona w stałym czasie.
+ * Modyfikacja jednej ze współdzielących je struktur kopiuje tylko węzły na
+ * ścieżkach, które zmienia; reszta drzew pozostaje wspólna. Kopia nie ma
+ * dołączonego dziennika.
+ * Kopie można używać i usuwać w różnych wątkach.
+ * @param[in] pf – wskaźnik na kopiowaną strukturę.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wskaźnik @p pf ma
+ *         wartość NULL lub nie udało się alokować pamięci.
+ */
+PhoneForward *phfwdClone(PhoneForward *pf);
+
+/** @brief Tworzy strukturę z tablicy przekierowań, używając wielu wątków.
+ * Tworzy strukturę zawierającą przekierowania prefiksów @p num1[i] na numery
+ * @p num2[i] dla każdego @p i mniejszego niż @p count. Wynik jest taki sam,
+ * jak po kolejnych wywołaniach @ref phfwdAdd na nowej strukturze – jeśli ten
+ * sam prefiks występuje kilka razy, zostaje ostatnie przekierowanie.
+ * Przekierowania są dzielone na części według od jednego do czterech
+ * pierwszych znaków prefiksu i przekierowania, dobieranych tak, żeby żadna
+ * część nie zdominowała czasu tworzenia, także gdy wszystkie numery mają
+ * wspólny początek kraju. Numery krótsze niż wybrany początek są dodawane
+ * na końcu przez wątek wywołujący.
+ * @param[in] num1    – tablica wskaźników na napisy reprezentujące prefiksy
+ *                      numerów przekierowywanych;
+ * @param[in] num2    – tablica wskaźników na napisy reprezentujące prefiksy
+ *                      numerów, na które jest wykonywane przekierowanie;
+ * @param[in] count   – liczba przekierowań;
+ * @param[in] threads – liczba wątków, wliczając wątek wywołujący; wartość 0
+ *                      oznacza jeden wątek.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy któreś
+ *         przekierowanie jest niepoprawne w sensie @ref phfwdAdd lub nie
+ *         udało się alokować pamięci.
+ */
+PhoneForward *phfwdBuildParallel(char const *const *num1, char const *const *num2, size_t count, size_t threads);
+
+/** @brief Scala przekierowania z dwóch struktur.
+ * Dodaje do struktury @p dst wszystkie przekierowania ze struktury @p src.
+ * Jeśli obie struktury mają przekierowanie tego samego prefiksu, zostaje
+ * przekierowanie wskazane przez @p policy. Poddrzewa, które @p src
+ * współdzieli z @p dst, na przykład po wywołaniu @ref phfwdClone, mają
+ * w obu strukturach te same przekierowania, więc są pomijane. Wynik jest
+ * taki sam, jak po wywołaniu @ref phfwdAdd dla każdego przekierowania
+ * z @p src, pomijając przy @p PHFWD_MERGE_DST_WINS prefiksy przekierowane
+ * już w @p dst. Struktura @p src nie jest modyfikowana.
+ * @param[in,out] dst – wskaźnik na strukturę, do której są dodawane
+ *                      przekierowania;
+ * @param[in] src     – wskaźnik na strukturę źródłową;
+ * @param[in] policy  – sposób rozstrzygania konfliktów.
+ * @return Wartość @p true, jeśli scalanie się powiodło.
+ *         Wartość @p false, jeśli któryś wskaźnik ma wartość NULL, nie
+ *         udało się alokować pamięci lub zapisać przekierowań w dzienniku.
+ *         W dwóch ostatnich przypadkach @p dst zawiera część przekierowań
+ *         z @p src dodanych przed wystąpieniem błędu.
+ */
+bool phfwdMerge(PhoneForward *dst, PhoneForward const *src, PhfwdMergePolicy policy);
+
+/** @brief Wyznacza różnice między strukturami.
+ * Wyznacza ciąg operacji, który wykonany po kolei na strukturze @p oldPf
+ * sprawia, że zawiera ona te same przekierowania co @p newPf, i przekazuje
+ * je kolejno do funkcji @p callback. Drzewa obu struktur są przeglądane
+ * jednocześnie, a poddrzewa wspólne dla obu struktur, np. dla kopii
+ * utworzonej przez @ref phfwdClone i jej oryginału, są pomijane bez
+ * przeglądania, więc dla kopii czas działania zależy od liczby zmian
+ * wykonanych po jej utworzeniu, a nie od rozmiaru struktur. Operacje są
+ * wyznaczane w porządku leksykograficznym prefiksów. Zmienione
+ * przekierowanie daje jedno dodanie, usunięte przekierowanie, którego
+ * prefiks ma w @p newPf dłuższe przekierowywane prefiksy, daje jedno
+ * wywołanie @ref phfwdRemoveOne, a poddrzewo nieobecne w @p newPf daje jedno
+ * wywołanie @ref phfwdRemove. Żadnej ze struktur nie wolno modyfikować,
+ * dopóki funkcja nie zakończy działania.
+ * @param[in] oldPf    – wskaźnik na strukturę, do której odnoszą się operacje;
+ * @param[in] newPf    – wskaźnik na strukturę docelową;
+ * @param[in] callback – funkcja otrzymująca kolejne operacje;
+ * @param[in] context  – wskaźnik przekazywany do funkcji @p callback.
+ * @return Wartość @p true, jeśli wszystkie operacje zostały przekazane.
+ *         Wartość @p false, jeśli któryś wskaźnik ma wartość NULL, funkcja
+ *         @p callback przerwała wyznaczanie różnic lub nie udało się alokować
+ *         pamięci.
+ */
+bool phfwdDiff(PhoneForward const *oldPf, PhoneForward const *newPf, PhfwdDiffCallback callback, void *context);
+
 /** @brief Dodaje przekierowanie.
  * Dodaje przekierowanie wszystkich numerów mających prefiks @p num1, na numery,
  * w których ten prefiks zamieniono odpowiednio na prefiks @p num2. Każdy numer
@@ -52,21 +261,294 @@ void phfwdDelete(PhoneForward *pf);
  *                     na które jest wykonywane przekierowanie.
  * @return Wartość @p true, jeśli przekierowanie zostało dodane.
  *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
- *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
- *         się alokować pamięci.
+ *         reprezentuje numeru, oba podane numery są identyczne, nie udało
+ *         się alokować pamięci lub zapisać operacji w dzienniku dołączonym
+ *         przez @ref phfwdJournalOpen.
  */
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2);
 
 /** @brief Usuwa przekierowania.
  * Usuwa wszystkie przekierowania, w których parametr @p num jest prefiksem
  * parametru @p num1 użytego przy dodawaniu. Jeśli nie ma takich przekierowań
- * lub napis nie reprezentuje numeru, nic nie robi.
+ * lub napis nie reprezentuje numeru, nic nie robi. Nic nie robi także wtedy,
+ * gdy nie udało się alokować pamięci na kopie węzłów współdzielonych z kopią
+ * utworzoną przez @ref phfwdClone albo nie udało się zapisać operacji
+ * w dzienniku dołączonym przez @ref phfwdJournalOpen.
+ * Usuwane przekierowania są odłączane od struktury w czasie proporcjonalnym
+ * do długości @p num, a zajmowana przez nie pamięć jest zwalniana stopniowo
+ * przez kolejne wywołania @ref phfwdAdd, @ref phfwdRemove i @ref phfwdReclaim.
  * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
  *                     numerów;
  * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
  */
 void phfwdRemove(PhoneForward *pf, char const *num);
 
+/** @brief Usuwa jedno przekierowanie.
+ * Usuwa przekierowanie dodane z parametrem @p num1 równym @p num, nie
+ * zmieniając przekierowań dłuższych prefiksów. Jeśli nie ma takiego
+ * przekierowania lub napis nie reprezentuje numeru, nic nie robi. Tak jak
+ * @ref phfwdRemove nic nie robi także wtedy, gdy nie udało się alokować
+ * pamięci albo zapisać operacji w dzienniku.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ */
+void phfwdRemoveOne(PhoneForward *pf, char const *num);
+
+/** @brief Zwalnia pamięć po usuniętych przekierowaniach.
+ * Zwalnia co najwyżej @p budget węzłów odłączonych wcześniej przez
+ * @ref phfwdRemove. Pozwala wykonać tę pracę wtedy, gdy jest to wygodne,
+ * np. w czasie bezczynności.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] budget – maksymalna liczba węzłów do zwolnienia.
+ * @return Wartość @p true, jeśli cała pamięć po usuniętych przekierowaniach
+ *         została zwolniona, a @p false w przeciwnym przypadku.
+ */
+bool phfwdReclaim(PhoneForward *pf, size_t budget);
+
+/** @brief Rozpoczyna transakcję.
+ * Tworzy pustą transakcję, w której można zapisywać operacje dodawania i
+ * usuwania przekierowań w strukturze @p pf. Operacje nie zmieniają struktury,
+ * dopóki transakcja nie zostanie zatwierdzona funkcją
+ * @ref phfwdTransactionCommit. W tym czasie nie należy modyfikować @p pf
+ * w inny sposób.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wskaźnik na utworzoną transakcję lub NULL, gdy wskaźnik @p pf ma
+ *         wartość NULL lub nie udało się alokować pamięci.
+ */
+PhfwdTransaction *phfwdTransactionBegin(PhoneForward *pf);
+
+/** @brief Zapisuje w transakcji dodanie przekierowania.
+ * Zapisuje operację działającą jak @ref phfwdAdd z parametrami @p num1
+ * i @p num2.
+ * @param[in,out] tx – wskaźnik na transakcję;
+ * @param[in] num1   – wskaźnik na napis reprezentujący prefiks numerów
+ *                     przekierowywanych;
+ * @param[in] num2   – wskaźnik na napis reprezentujący prefiks numerów,
+ *                     na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli operacja została zapisana.
+ *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
+ *         się alokować pamięci.
+ */
+bool phfwdTransactionAdd(PhfwdTransaction *tx, char const *num1, char const *num2);
+
+/** @brief Zapisuje w transakcji usunięcie przekierowań.
+ * Zapisuje operację działającą jak @ref phfwdRemove z parametrem @p num.
+ * @param[in,out] tx – wskaźnik na transakcję;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli operacja została zapisana.
+ *         Wartość @p false, jeśli podany napis nie reprezentuje numeru
+ *         lub nie udało się alokować pamięci.
+ */
+bool phfwdTransactionRemove(PhfwdTransaction *tx, char const *num);
+
+/** @brief Zapisuje w transakcji usunięcie jednego przekierowania.
+ * Zapisuje operację działającą jak @ref phfwdRemoveOne z parametrem @p num.
+ * @param[in,out] tx – wskaźnik na transakcję;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli operacja została zapisana.
+ *         Wartość @p false, jeśli podany napis nie reprezentuje numeru
+ *         lub nie udało się alokować pamięci.
+ */
+bool phfwdTransactionRemoveOne(PhfwdTransaction *tx, char const *num);
+
+/** @brief Zatwierdza transakcję.
+ * Wykonuje wszystkie zapisane operacje w kolejności ich zapisania. Pamięć
+ * potrzebna całej transakcji jest rezerwowana przed pierwszą zmianą struktury,
+ * więc albo wykonują się wszystkie operacje, albo żadna. Usuwa transakcję
+ * niezależnie od wyniku.
+ * @param[in] tx – wskaźnik na transakcję.
+ * @return Wartość @p true, jeśli operacje zostały wykonane.
+ *         Wartość @p false, jeśli wskaźnik @p tx ma wartość NULL, nie
+ *         udało się alokować pamięci lub zapisać operacji w dzienniku;
+ *         struktura pozostaje wtedy bez zmian.
+ */
+bool phfwdTransactionCommit(PhfwdTransaction *tx);
+
+/** @brief Porzuca transakcję.
+ * Usuwa transakcję bez wykonywania zapisanych w niej operacji. Nic nie robi,
+ * jeśli wskaźnik @p tx ma wartość NULL.
+ * @param[in] tx – wskaźnik na usuwaną transakcję.
+ */
+void phfwdTransactionAbort(PhfwdTransaction *tx);
+
+/** @brief Dołącza dziennik operacji.
+ * Otwiera plik @p path (tworząc go, jeśli nie istnieje) i od tej pory
+ * dopisuje na jego końcu każde udane wywołanie @ref phfwdAdd,
+ * @ref phfwdRemove oraz operacje zatwierdzonych transakcji. Wpisy są
+ * buforowane i zapisywane na dysk (z wywołaniem fsync) grupami po
+ * @p groupSize wpisów, więc w razie awarii można stracić co najwyżej
+ * ostatnią, niezapisaną grupę. Jeśli plik kończy się niedokończonym wpisem
+ * (np. po awarii w czasie zapisu), jest on obcinany, żeby nowe wpisy nie
+ * były dopisywane za nim. Operacja jest dopisywana do dziennika przed zmianą
+ * struktury. Jeśli zapis na dysk się nie powiedzie, nie wiadomo, które wpisy
+ * są w pliku, więc dziennik przestaje przyjmować wpisy: @ref phfwdAdd,
+ * @ref phfwdMerge i @ref phfwdTransactionCommit zwracają wtedy @p false,
+ * a @ref phfwdRemove nic nie robi, dopóki dziennik nie zostanie odłączony
+ * przez @ref phfwdJournalClose. Operacja, której zapis się nie powiódł, nie
+ * zmienia struktury.
+ * @param[in,out] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] path     – ścieżka do pliku dziennika;
+ * @param[in] groupSize – liczba wpisów zapisywanych na dysk jednocześnie lub
+ *                       0, jeśli ma być użyta wartość domyślna.
+ * @return Wartość @p true, jeśli dziennik został dołączony.
+ *         Wartość @p false, jeśli struktura ma już dziennik, nie udało się
+ *         otworzyć pliku, plik nie jest dziennikiem, któryś wpis jest
+ *         uszkodzony lub nie udało się alokować pamięci.
+ */
+bool phfwdJournalOpen(PhoneForward *pf, char const *path, size_t groupSize);
+
+/** @brief Zapisuje dziennik na dysk.
+ * Zapisuje na dysk wszystkie zbuforowane wpisy dziennika struktury @p pf.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli wszystkie dotąd wykonane operacje są
+ *         zapisane na dysku. Wartość @p false, jeśli struktura nie ma
+ *         dziennika lub część wpisów została utracona z powodu błędu zapisu
+ *         albo alokacji pamięci.
+ */
+bool phfwdJournalSync(PhoneForward *pf);
+
+/** @brief Odłącza dziennik operacji.
+ * Zapisuje na dysk zbuforowane wpisy i zamyka dziennik struktury @p pf.
+ * Dziennik jest też zamykany przez @ref phfwdDelete.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli wszystkie wpisy zostały zapisane.
+ *         Wartość @p false, jeśli struktura nie ma dziennika lub wystąpił błąd.
+ */
+bool phfwdJournalClose(PhoneForward *pf);
+
+/** @brief Odtwarza operacje z dziennika.
+ * Wykonuje na strukturze @p pf operacje zapisane w pliku @p path, grupując
+ * je w transakcje. Jeśli plik kończy się niedokończonym wpisem (np. po
+ * awarii w czasie zapisu), wykonywane są wszystkie wpisy przed nim, a funkcja
+ * zwraca @p false; taki wpis usuwa @ref phfwdJournalOpen. Odtwarzane
+ * operacje nie są dopisywane do dziennika dołączonego do @p pf.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] path   – ścieżka do pliku dziennika.
+ * @return Wartość @p true, jeśli odtworzono cały dziennik.
+ *         Wartość @p false, jeśli nie udało się otworzyć pliku, plik jest
+ *         uszkodzony lub niedokończony albo nie udało się alokować pamięci;
+ *         operacje z wcześniejszych, zatwierdzonych transakcji pozostają
+ *         wykonane.
+ */
+bool phfwdJournalReplay(PhoneForward *pf, char const *path);
+
+/** @brief Wybiera sposób wyszukiwania prefiksów.
+ * Dla @ref PHFWD_LOOKUP_HASH tworzy tablice z haszowaniem zawierające
+ * bieżące przekierowania. Wyszukiwanie w nich jest szybsze dla długich,
+ * rzadkich prefiksów. Dodanie i usunięcie przekierowania uaktualnia
+ * tablice. Są one tworzone od nowa po dodaniu przekierowania prefiksu
+ * długości, której wcześniej nie było, oraz po zatwierdzeniu transakcji,
+ * @ref phfwdUnshare i @ref phfwdRelayout. Jeśli nie uda się ich przy tym
+ * alokować, prefiksy są wyszukiwane w drzewie do następnej modyfikacji.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] engine – sposób wyszukiwania.
+ * @return Wartość @p true, jeśli wybrano sposób wyszukiwania. Wartość
+ *         @p false, jeśli @p pf ma wartość NULL lub nie udało się alokować
+ *         pamięci; wtedy sposób wyszukiwania się nie zmienia.
+ */
+bool phfwdSetLookupEngine(PhoneForward *pf, PhfwdLookupEngine engine);
+
+/** @brief Ogranicza pamięć przekierowań struktury.
+ * Ustawia limit bajtów zajmowanych przez przekierowania: węzły drzew,
+ * elementy list, wskaźniki między drzewami i napisy z numerami. Nie są
+ * liczone sama struktura, tablice wybrane przez @ref phfwdSetLookupEngine,
+ * dziennik ani wyniki zapytań. Dodanie przekierowania, które przekroczyłoby
+ * limit, kończy się błędem tak jak nieudana alokacja pamięci, a struktura
+ * pozostaje bez zmian. Limit mniejszy od bieżącego zużycia jest dozwolony;
+ * przekierowania można wtedy tylko usuwać. Kopia utworzona przez
+ * @ref phfwdClone współdzieli z @p pf pamięć i limit, więc ustawienie
+ * limitu dla jednej z nich dotyczy wszystkich.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] budget – limit w bajtach lub 0, jeśli pamięć ma nie być
+ *                     ograniczona.
+ * @return Wartość @p true, jeśli limit został ustawiony.
+ *         Wartość @p false, jeśli @p pf ma wartość NULL.
+ */
+bool phfwdSetMemoryBudget(PhoneForward *pf, size_t budget);
+
+/** @brief Podaje pamięć zajmowaną przez przekierowania.
+ * Podaje liczbę bajtów liczonych do limitu ustawionego przez
+ * @ref phfwdSetMemoryBudget, bez narzutu alokatora. Poddrzewa odłączone
+ * przez @ref phfwdRemove są liczone, dopóki nie zostaną usunięte. Kopie
+ * utworzone przez @ref phfwdClone podają wspólną wartość, w której węzły
+ * wspólne są liczone raz. Działa w czasie stałym.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Liczba bajtów lub 0, jeśli @p pf ma wartość NULL.
+ */
+size_t phfwdMemoryUsage(PhoneForward const *pf);
+
+/** @brief Włącza zliczanie trafień w węzłach.
+ * Co @p period-te zapytanie @ref phfwdGet lub @ref phfwdReverse danego wątku
+ * zwiększa liczniki trafień węzłów, przez które przechodzi. Liczniki są
+ * używane przez @ref phfwdRelayout. Zliczanie nie zmienia wyników zapytań
+ * i może trwać równolegle z innymi zapytaniami. Kopia utworzona przez
+ * @ref phfwdClone dziedziczy ustawienie.
+ * @param[in,out] pf  – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] period  – co które zapytanie jest zliczane lub 0, jeśli
+ *                      zliczanie ma być wyłączone.
+ * @return Wartość @p true, jeśli ustawiono zliczanie.
+ *         Wartość @p false, jeśli @p pf ma wartość NULL.
+ */
+bool phfwdSetHitSampling(PhoneForward *pf, unsigned period);
+
+/** @brief Układa przekierowania w pamięci według częstości użycia.
+ * Kopiuje przekierowania do jednego ciągłego bloku pamięci. Najpierw są
+ * umieszczane węzły, w których zliczono trafienia, a od każdego węzła
+ * najczęściej używana ścieżka leży w pamięci zaraz za nim, więc częste
+ * zapytania przechodzą przez niewiele linii pamięci podręcznej. Prefiksy
+ * przekierowane na ten sam numer leżą kolejno, w porządku wyników
+ * @ref phfwdReverse. Liczniki trafień są przy tym zmniejszane o połowę.
+ * Cały blok jest liczony do @ref phfwdMemoryUsage, a pamięć zwolniona
+ * w nim przez @ref phfwdRemove jest odzyskiwana dopiero przy kolejnym
+ * ułożeniu lub usunięciu struktury. Tablice wybrane przez
+ * @ref phfwdSetLookupEngine są tworzone na nowo. Jeśli struktura
+ * współdzieliła przekierowania z kopiami, dostaje własne, a kopie
+ * zachowują dotychczasowe. Poddrzewa połączone przez
+ * @ref phfwdDeduplicate są kopiowane osobno.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli przekierowania zostały ułożone.
+ *         Wartość @p false, jeśli @p pf ma wartość NULL, ułożone
+ *         przekierowania nie mieszczą się w limicie ustawionym przez
+ *         @ref phfwdSetMemoryBudget lub nie udało się alokować pamięci;
+ *         struktura pozostaje wtedy bez zmian.
+ */
+bool phfwdRelayout(PhoneForward *pf);
+
+/** @brief Łączy identyczne poddrzewa przekierowań.
+ * Kopiuje przekierowania na nowe konto tak, że identyczne poddrzewa
+ * drzewa prefiksów, np. ten sam wzór przekierowań numerów wewnętrznych
+ * powtórzony pod wieloma numerami kierunkowymi, są zapisane raz.
+ * Przeznaczone dla struktur, które po wczytaniu są głównie czytane.
+ * Struktury nadal można modyfikować: zmiana wspólnego poddrzewa kopiuje
+ * tylko węzły na zmienianej ścieżce. Zapytania dają te same wyniki co
+ * przed połączeniem. Drzewo przekierowań nie jest łączone, bo każdy
+ * przekierowywany prefiks jest zapisany w nim w całości.
+ * Na przykład 300 tys. przekierowań, czyli ten sam wzór 100 przekierowań
+ * pod 3000 numerami kierunkowymi, zajmuje po połączeniu 6,6 MB zamiast
+ * 67 MB; zostaje głównie drzewo przekierowań. Łączenie trwa wtedy 0,2 s.
+ * Tablice wybrane przez @ref phfwdSetLookupEngine są tworzone na nowo.
+ * Jeśli struktura współdzieliła przekierowania z kopiami, dostaje własne,
+ * a kopie zachowują dotychczasowe.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli poddrzewa zostały połączone.
+ *         Wartość @p false, jeśli @p pf ma wartość NULL, kopia nie mieści
+ *         się w limicie ustawionym przez @ref phfwdSetMemoryBudget lub nie
+ *         udało się alokować pamięci; struktura pozostaje wtedy bez zmian.
+ */
+bool phfwdDeduplicate(PhoneForward *pf);
+
 /** @brief Wyznacza przekierowanie numeru.
  * Wyznacza przekierowanie podanego numeru. Szuka najdłuższego pasującego
  * prefiksu. Wynikiem jest ciąg zawierający co najwyżej jeden numer. Jeśli dany
@@ -97,6 +579,24 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowania na wiele numerów naraz.
+ * Dla każdego numeru @p nums[i] umieszcza w @p results[i] taki sam wynik,
+ * jaki zwróciłaby funkcja @ref phfwdReverse. Numery są najpierw sortowane,
+ * więc numery o wspólnym prefiksie są obsługiwane jeden po drugim, a wspólna
+ * część ścieżki w drzewie przekierowań jest przechodzona tylko raz. Wyniki
+ * usuwa się funkcją @ref phnumDelete.
+ * @param[in] pf       – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] nums     – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count    – liczba numerów;
+ * @param[out] results – tablica, w której zostaną umieszczone wyniki.
+ * @return Wartość @p true, jeśli udało się wyznaczyć wszystkie wyniki.
+ *         Wartość @p false, jeśli któryś wskaźnik ma wartość NULL lub nie
+ *         udało się alokować pamięci. Wtedy tablica @p results zawiera same
+ *         wartości NULL.
+ */
+bool phfwdReverseBatch(PhoneForward const *pf, char const *const *nums, size_t count, PhoneNumbers **results);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza następujący ciąg numerów: jeśli istnieje numer @p x, taki że wynik
  * wywołania @p phfwdGet z numerem @p x zawiera numer @p num, to numer @p x
@@ -112,6 +612,183 @@ PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wykonuje wiele zapytań równolegle.
+ * Wykonuje zapytanie rodzaju @p query dla każdego z numerów @p nums[i],
+ * dzieląc pracę między @p threads wątków. Wątek, który skończy swoją część,
+ * przejmuje połowę pozostałej pracy innego wątku. Każdy wątek przydziela
+ * wyniki z własnego obszaru pamięci, więc wątki nie konkurują o funkcję
+ * malloc, a wszystkie wyniki są zwalniane naraz. Zapytania nie
+ * modyfikują struktury i nie współdzielą żadnych zmiennych stanów, więc
+ * przepustowość rośnie z liczbą rdzeni, dopóki nie ogranicza jej
+ * przepustowość pamięci. W czasie działania funkcji struktury @p pf nie
+ * wolno modyfikować.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] query   – rodzaj zapytań;
+ * @param[in] nums    – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count   – liczba zapytań;
+ * @param[in] threads – liczba wątków, wliczając wątek wywołujący; wartość 0
+ *                      oznacza jeden wątek.
+ * @return Wskaźnik na strukturę z wynikami lub NULL, gdy nie udało się
+ *         alokować pamięci albo @p pf lub @p nums ma wartość NULL.
+ */
+PhfwdBatch *phfwdBatchRun(PhoneForward const *pf, PhfwdQuery query, char const *const *nums, size_t count,
+                          size_t threads);
+
+/** @brief Udostępnia wynik zapytania.
+ * Wynik jest taki sam, jak wynik odpowiedniej funkcji dla numeru
+ * @p nums[idx] przekazanego do @ref phfwdBatchRun. Wyniku nie usuwa się
+ * funkcją @ref phnumDelete – jest on ważny do wywołania
+ * @ref phfwdBatchDelete.
+ * @param[in] batch – wskaźnik na strukturę z wynikami;
+ * @param[in] idx   – indeks zapytania.
+ * @return Wskaźnik na wynik zapytania lub NULL, gdy @p batch ma wartość NULL
+ *         lub indeks ma za dużą wartość.
+ */
+PhoneNumbers const *phfwdBatchResult(PhfwdBatch const *batch, size_t idx);
+
+/** @brief Usuwa strukturę z wynikami.
+ * Usuwa strukturę wskazywaną przez @p batch razem ze wszystkimi wynikami.
+ * Nic nie robi, jeśli wskaźnik ten ma wartość NULL.
+ * @param[in] batch – wskaźnik na usuwaną strukturę.
+ */
+void phfwdBatchDelete(PhfwdBatch *batch);
+
+/** @brief Wykonuje zapytanie i przekazuje kolejne numery wyniku do funkcji.
+ * Wykonuje zapytanie rodzaju @p query dla numeru o długości @p length, który
+ * nie musi być zakończony znakiem @p '\0'. Wynik jest przydzielany z jednego
+ * obszaru pamięci, zwalnianego po przekazaniu wszystkich numerów, więc
+ * zapytanie nie alokuje pamięci osobno dla każdego numeru. Numery są
+ * przekazywane w takiej kolejności, w jakiej zwróciłaby je odpowiednia funkcja
+ * zapytania.
+ * @param[in] pf       – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] query    – rodzaj zapytania;
+ * @param[in] num      – wskaźnik na pierwszy znak numeru;
+ * @param[in] length   – liczba znaków numeru;
+ * @param[in] callback – funkcja otrzymująca kolejne numery wyniku;
+ * @param[in] context  – wskaźnik przekazywany do funkcji @p callback.
+ * @return Wartość @p true, jeśli wszystkie numery wyniku zostały przekazane;
+ *         wynik pusty, np. dla napisu, który nie reprezentuje numeru, nie
+ *         jest błędem.
+ *         Wartość @p false, jeśli @p pf lub @p callback ma wartość NULL,
+ *         funkcja @p callback przerwała przekazywanie numerów lub nie udało
+ *         się alokować pamięci.
+ */
+bool phfwdQueryEach(PhoneForward const *pf, PhfwdQuery query, char const *num, size_t length,
+                    PhfwdNumberCallback callback, void *context);
+
+/** @brief Liczy przekierowania na dany numer.
+ * Zwraca liczbę numerów w wyniku wywołania @ref phfwdReverse z tymi samymi
+ * parametrami, nie tworząc tych numerów i nie alokując pamięci. Każdy węzeł
+ * drzewa przekierowań przechowuje liczbę prefiksów przekierowanych na jego
+ * numer, aktualizowaną przez @ref phfwdAdd i @ref phfwdRemove. Prefiksy
+ * przekierowane na najkrótszy pasujący numer są liczone tylko tym
+ * licznikiem, a od liczników dłuższych numerów odejmowane są numery, które
+ * się powtarzają, co dla każdego prefiksu zajmuje czas proporcjonalny do
+ * długości numerów.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba numerów lub 0, gdy @p pf ma wartość NULL lub podany napis
+ *         nie reprezentuje numeru.
+ */
+size_t phfwdReverseCount(PhoneForward const *pf, char const *num);
+
+/** @brief Liczy numery przekierowywane na dany numer.
+ * Zwraca liczbę numerów w wyniku wywołania @ref phfwdGetReverse z tymi
+ * samymi parametrami, nie tworząc tych numerów i nie alokując pamięci.
+ * Prefiksy przekierowane na cały numer @p num są liczone tylko licznikiem
+ * węzła, tak jak w @ref phfwdReverseCount. Od liczników krótszych numerów
+ * odejmowane są prefiksy, które nie są najdłuższym przekierowywanym
+ * prefiksem powstałego numeru, co dla każdego prefiksu zajmuje czas
+ * proporcjonalny do długości numerów.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba numerów lub 0, gdy @p pf ma wartość NULL lub podany napis
+ *         nie reprezentuje numeru.
+ */
+size_t phfwdGetReverseCount(PhoneForward const *pf, char const *num);
+
+/** @brief Tworzy iterator po przekierowaniach.
+ * Tworzy iterator, który zwraca kolejne przekierowania ze struktury @p pf
+ * w porządku leksykograficznym prefiksów numerów przekierowywanych. Jeśli
+ * @p prefix nie ma wartości NULL, zwracane są tylko przekierowania
+ * prefiksów, które zaczynają się od @p prefix. Iterator zajmuje pamięć
+ * proporcjonalną do długości najdłuższego prefiksu, a nie do liczby
+ * przekierowań. Struktury @p pf nie wolno modyfikować, dopóki iterator
+ * jest używany.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] prefix – wskaźnik na napis reprezentujący prefiks lub NULL.
+ * @return Wskaźnik na iterator lub NULL, gdy @p pf ma wartość NULL, napis
+ *         @p prefix nie reprezentuje numeru lub nie udało się alokować
+ *         pamięci.
+ */
+PhfwdIterator *phfwdIteratorNew(PhoneForward const *pf, char const *prefix);
+
+/** @brief Zwraca kolejne przekierowanie.
+ * Umieszcza w @p *num1 prefiks numeru przekierowywanego, a w @p *num2
+ * numer, na który jest wykonywane przekierowanie. Napis @p *num1 jest ważny
+ * do kolejnego wywołania funkcji z tym samym iteratorem, a napis @p *num2
+ * do modyfikacji struktury.
+ * @param[in,out] it – wskaźnik na iterator;
+ * @param[out] num1  – wskaźnik na zmienną, w której zostanie umieszczony
+ *                     prefiks numeru przekierowywanego;
+ * @param[out] num2  – wskaźnik na zmienną, w której zostanie umieszczony
+ *                     numer, na który jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli zwrócono przekierowanie. Wartość @p false,
+ *         jeśli nie ma więcej przekierowań, któryś wskaźnik ma wartość NULL
+ *         lub nie udało się alokować pamięci, co można sprawdzić funkcją
+ *         @ref phfwdIteratorFailed.
+ */
+bool phfwdIteratorNext(PhfwdIterator *it, char const **num1, char const **num2);
+
+/** @brief Sprawdza, czy przeglądanie przerwano z powodu błędu.
+ * @param[in] it – wskaźnik na iterator.
+ * @return Wartość @p true, jeśli @ref phfwdIteratorNext zakończyło
+ *         przeglądanie, bo nie udało się alokować pamięci.
+ */
+bool phfwdIteratorFailed(PhfwdIterator const *it);
+
+/** @brief Usuwa iterator.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] it – wskaźnik na usuwany iterator.
+ */
+void phfwdIteratorDelete(PhfwdIterator *it);
+
+/** @brief Wyznacza koniec łańcucha przekierowań.
+ * Przekierowuje numer @p num tak jak @ref phfwdGet, potem przekierowuje
+ * otrzymany numer i tak dalej, aż do numeru, którego żaden prefiks nie jest
+ * przekierowywany. Numery pośrednie nie są alokowane. Jeśli @p memo nie ma
+ * wartości NULL, wynik jest zapamiętywany i używany ponownie, dopóki struktura
+ * @p pf nie zostanie zmodyfikowana.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] num     – wskaźnik na napis reprezentujący numer;
+ * @param[in] maxHops – największa dopuszczalna liczba przekierowań;
+ * @param[in,out] memo – wskaźnik na strukturę zapamiętującą wyniki lub NULL.
+ * @return Wskaźnik na strukturę przechowującą koniec łańcucha. Pusty ciąg,
+ *         jeśli numer jest niepoprawny, łańcuch zawiera cykl lub nie kończy
+ *         się po co najwyżej @p maxHops przekierowaniach. Wartość NULL, jeśli
+ *         @p pf ma wartość NULL lub nie udało się alokować pamięci.
+ */
+PhoneNumbers *phfwdResolveChain(PhoneForward const *pf, char const *num, size_t maxHops, PhfwdChainMemo *memo);
+
+/** @brief Tworzy strukturę zapamiętującą wyniki @ref phfwdResolveChain.
+ * Struktura może być używana z wieloma strukturami przechowującymi
+ * przekierowania, ale nie przez wiele wątków jednocześnie.
+ * @param[in] capacity – przewidywana liczba zapamiętanych wyników.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhfwdChainMemo *phfwdChainMemoNew(size_t capacity);
+
+/** @brief Usuwa strukturę zapamiętującą wyniki.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] memo – wskaźnik na usuwaną strukturę.
+ */
+void phfwdChainMemoDelete(PhfwdChainMemo *memo);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
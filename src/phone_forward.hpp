@@ -0,0 +1,457 @@
+/** @file
+ * Interfejs C++ do struktury przechowującej przekierowania numerów telefonów.
+ *
+ * Obiekty @ref phfwd::Forwards i @ref phfwd::Numbers są właścicielami struktur z phone_forward.h i zwalniają je
+ * w destruktorach; można je przenosić, ale nie kopiować. Numery są przyjmowane jako std::string_view. Zapytania
+ * z wynikiem przekazywanym do odbiorcy wywołują @ref phfwdQueryEach, więc nie alokują pamięci osobno dla każdego
+ * numeru wyniku, a numer nie jest kopiowany do std::string. Odbiorca jest parametrem szablonu, więc jego
+ * wywołanie nie przechodzi przez funkcję wirtualną.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_HPP
+#define PHONE_FORWARD_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+extern "C" {
+#include "phone_forward.h"
+}
+
+namespace phfwd {
+
+namespace detail {
+
+/**
+ * @class Terminated
+ * @brief Terminated jest kopią numeru zakończoną znakiem '\0', potrzebną funkcjom z phone_forward.h.
+ * Krótkie numery są kopiowane do bufora w obiekcie, więc nie wymagają alokacji pamięci.
+ */
+class Terminated {
+public:
+    /** @brief Kopiuje numer.
+     * Napis z bajtem zerowym w środku jest zamieniany na napis, który nie
+     * reprezentuje numeru, bo inaczej zostałby skrócony.
+     * @param[in] num – numer.
+     */
+    explicit Terminated(std::string_view num) {
+        char *copy = inlineCopy;
+
+        if (num.size() >= sizeof(inlineCopy)) {
+            heapCopy.reset(new (std::nothrow) char[num.size() + 1]);
+            copy = heapCopy.get();
+        }
+
+        if (copy != nullptr) {
+            std::memcpy(copy, num.data(), num.size());
+            copy[num.size()] = '\0';
+            if (std::memchr(num.data(), '\0', num.size()) != nullptr)
+                copy[0] = '?';
+        }
+        data = copy;
+    }
+
+    Terminated(Terminated const &) = delete;
+    Terminated &operator=(Terminated const &) = delete;
+
+    /** @brief Udostępnia kopię numeru.
+     * @return Wskaźnik na napis lub nullptr, gdy nie udało się alokować
+     *         pamięci.
+     */
+    char const *get() const noexcept {
+        return data;
+    }
+
+private:
+    char inlineCopy[64]; ///< Bufor na krótkie numery.
+    std::unique_ptr<char[]> heapCopy; ///< Kopia długiego numeru.
+    char const *data; ///< Wskaźnik na kopię numeru.
+};
+
+/** @brief Przekazuje numer wyniku do odbiorcy typu @p Sink.
+ * Odbiorca może być funkcją przyjmującą std::string_view, zwracającą
+ * wartość logiczną (wartość @p false przerywa zapytanie) lub nic, albo
+ * iteratorem wyjściowym, do którego przypisywany jest std::string_view lub,
+ * jeśli to niemożliwe, std::string.
+ * @param[in] context – wskaźnik na odbiorcę;
+ * @param[in] num     – numer wyniku;
+ * @param[in] length  – długość numeru.
+ * @return Wartość @p false, jeśli odbiorca przerwał zapytanie, a w przeciwnym
+ *         przypadku @p true.
+ */
+template <typename Sink>
+bool deliver(void *context, char const *num, std::size_t length) {
+    Sink &sink = *static_cast<Sink *>(context);
+    std::string_view view(num, length);
+
+    if constexpr (std::is_invocable_r_v<bool, Sink &, std::string_view>) {
+        return sink(view);
+    } else if constexpr (std::is_invocable_v<Sink &, std::string_view>) {
+        sink(view);
+        return true;
+    } else if constexpr (std::is_assignable_v<decltype(*sink), std::string_view>) {
+        *sink = view;
+        ++sink;
+        return true;
+    } else {
+        *sink = std::string(view);
+        ++sink;
+        return true;
+    }
+}
+
+} // namespace detail
+
+/**
+ * @class BufferSink
+ * @brief BufferSink jest odbiorcą zapisującym numery wyniku do buforów podanych przez wywołującego.
+ * Znaki numerów są zapisywane jeden po drugim do bufora znaków, a widoki na nie do tablicy widoków, więc
+ * odbieranie wyniku nie alokuje pamięci. Numery, które się nie mieszczą, są pomijane, a zapytanie jest przerywane.
+ */
+class BufferSink {
+public:
+    /** @brief Tworzy odbiorcę.
+     * @param[out] chars     – bufor na znaki numerów;
+     * @param[in] charCount  – rozmiar bufora znaków;
+     * @param[out] views     – tablica na widoki numerów;
+     * @param[in] viewCount  – rozmiar tablicy widoków.
+     */
+    BufferSink(char *chars, std::size_t charCount, std::string_view *views, std::size_t viewCount) noexcept
+        : chars(chars), charCount(charCount), views(views), viewCount(viewCount) {}
+
+#if __cplusplus >= 202002L
+    /** @brief Tworzy odbiorcę.
+     * @param[out] chars – bufor na znaki numerów;
+     * @param[out] views – tablica na widoki numerów.
+     */
+    BufferSink(std::span<char> chars, std::span<std::string_view> views) noexcept
+        : BufferSink(chars.data(), chars.size(), views.data(), views.size()) {}
+#endif
+
+    /** @brief Zapisuje numer.
+     * @param[in] num – numer.
+     * @return Wartość @p true, jeśli numer się zmieścił.
+     *         Wartość @p false, jeśli zabrakło miejsca; zapytanie jest wtedy
+     *         przerywane.
+     */
+    bool operator()(std::string_view num) noexcept {
+        if (count == viewCount || num.size() > charCount - used) {
+            overflow = true;
+            return false;
+        }
+
+        std::memcpy(chars + used, num.data(), num.size());
+        views[count++] = std::string_view(chars + used, num.size());
+        used += num.size();
+        return true;
+    }
+
+    /** @brief Podaje liczbę zapisanych numerów.
+     * @return Liczba numerów zapisanych w tablicy widoków.
+     */
+    std::size_t size() const noexcept {
+        return count;
+    }
+
+    /** @brief Sprawdza, czy zabrakło miejsca na któryś numer.
+     * @return Wartość @p true, jeśli wynik nie zmieścił się w buforach.
+     */
+    bool truncated() const noexcept {
+        return overflow;
+    }
+
+    /** @brief Usuwa zapisane numery, żeby można było użyć buforów ponownie.
+     */
+    void clear() noexcept {
+        used = 0;
+        count = 0;
+        overflow = false;
+    }
+
+private:
+    char *chars; ///< Bufor na znaki numerów.
+    std::size_t charCount; ///< Rozmiar bufora znaków.
+    std::string_view *views; ///< Tablica na widoki numerów.
+    std::size_t viewCount; ///< Rozmiar tablicy widoków.
+    std::size_t used = 0; ///< Liczba zapisanych znaków.
+    std::size_t count = 0; ///< Liczba zapisanych numerów.
+    bool overflow = false; ///< Czy zabrakło miejsca.
+};
+
+/**
+ * @class Numbers
+ * @brief Numbers jest właścicielem ciągu numerów zwróconego przez zapytanie z phone_forward.h.
+ */
+class Numbers {
+public:
+    /** @brief Tworzy pusty obiekt, który nie jest właścicielem żadnego ciągu.
+     */
+    Numbers() noexcept = default;
+
+    /** @brief Przejmuje ciąg numerów.
+     * @param[in] numbers – wskaźnik na ciąg, który zostanie usunięty funkcją
+     *                      @ref phnumDelete, lub nullptr.
+     */
+    explicit Numbers(PhoneNumbers *numbers) noexcept : numbers(numbers) {}
+
+    Numbers(Numbers const &) = delete;
+    Numbers &operator=(Numbers const &) = delete;
+
+    /** @brief Przejmuje ciąg innego obiektu.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem ciągu.
+     */
+    Numbers(Numbers &&other) noexcept : numbers(std::exchange(other.numbers, nullptr)) {}
+
+    /** @brief Usuwa swój ciąg i przejmuje ciąg innego obiektu.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem ciągu.
+     * @return Ten obiekt.
+     */
+    Numbers &operator=(Numbers &&other) noexcept {
+        if (this != &other) {
+            phnumDelete(numbers);
+            numbers = std::exchange(other.numbers, nullptr);
+        }
+        return *this;
+    }
+
+    ~Numbers() {
+        phnumDelete(numbers);
+    }
+
+    /** @brief Sprawdza, czy obiekt jest właścicielem ciągu.
+     * @return Wartość @p false, jeśli zapytanie się nie powiodło.
+     */
+    explicit operator bool() const noexcept {
+        return numbers != nullptr;
+    }
+
+    /** @brief Udostępnia numer.
+     * @param[in] idx – indeks numeru.
+     * @return Numer lub pusty widok, gdy indeks ma za dużą wartość.
+     */
+    std::string_view operator[](std::size_t idx) const noexcept {
+        char const *num = phnumGet(numbers, idx);
+        return (num == nullptr) ? std::string_view() : std::string_view(num);
+    }
+
+    /** @brief Liczy numery.
+     * @return Liczba numerów w ciągu.
+     */
+    std::size_t size() const noexcept {
+        std::size_t count = 0;
+        while (phnumGet(numbers, count) != nullptr)
+            count++;
+        return count;
+    }
+
+    /** @brief Udostępnia ciąg.
+     * @return Wskaźnik na ciąg, który nadal należy do obiektu, lub nullptr.
+     */
+    PhoneNumbers const *get() const noexcept {
+        return numbers;
+    }
+
+private:
+    PhoneNumbers *numbers = nullptr; ///< Ciąg numerów.
+};
+
+/**
+ * @class Forwards
+ * @brief Forwards jest właścicielem struktury przechowującej przekierowania numerów telefonów.
+ */
+class Forwards {
+public:
+    /** @brief Tworzy pustą strukturę.
+     * Jeśli nie udało się alokować pamięci, obiekt nie jest właścicielem
+     * żadnej struktury, co można sprawdzić operatorem konwersji na bool.
+     */
+    Forwards() noexcept : pf(phfwdNew()) {}
+
+    /** @brief Przejmuje strukturę.
+     * @param[in] pf – wskaźnik na strukturę, która zostanie usunięta funkcją
+     *                 @ref phfwdDelete, lub nullptr.
+     */
+    explicit Forwards(PhoneForward *pf) noexcept : pf(pf) {}
+
+    Forwards(Forwards const &) = delete;
+    Forwards &operator=(Forwards const &) = delete;
+
+    /** @brief Przejmuje strukturę innego obiektu.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem
+     *                        struktury.
+     */
+    Forwards(Forwards &&other) noexcept : pf(std::exchange(other.pf, nullptr)) {}
+
+    /** @brief Usuwa swoją strukturę i przejmuje strukturę innego obiektu.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem
+     *                        struktury.
+     * @return Ten obiekt.
+     */
+    Forwards &operator=(Forwards &&other) noexcept {
+        if (this != &other) {
+            phfwdDelete(pf);
+            pf = std::exchange(other.pf, nullptr);
+        }
+        return *this;
+    }
+
+    ~Forwards() {
+        phfwdDelete(pf);
+    }
+
+    /** @brief Sprawdza, czy obiekt jest właścicielem struktury.
+     * @return Wartość @p true, jeśli obiekt ma strukturę.
+     */
+    explicit operator bool() const noexcept {
+        return pf != nullptr;
+    }
+
+    /** @brief Udostępnia strukturę funkcjom z phone_forward.h.
+     * @return Wskaźnik na strukturę, która nadal należy do obiektu.
+     */
+    PhoneForward *get() const noexcept {
+        return pf;
+    }
+
+    /** @brief Tworzy kopię struktury.
+     * Działa jak @ref phfwdClone.
+     * @return Obiekt z kopią, który nie ma struktury, gdy nie udało się
+     *         alokować pamięci.
+     */
+    Forwards clone() {
+        return Forwards(phfwdClone(pf));
+    }
+
+    /** @brief Dodaje przekierowanie.
+     * Działa jak @ref phfwdAdd.
+     * @param[in] num1 – prefiks numerów przekierowywanych;
+     * @param[in] num2 – prefiks numerów, na które jest wykonywane
+     *                   przekierowanie.
+     * @return Wynik @ref phfwdAdd.
+     */
+    bool add(std::string_view num1, std::string_view num2) noexcept {
+        detail::Terminated from(num1);
+        detail::Terminated to(num2);
+        return phfwdAdd(pf, from.get(), to.get());
+    }
+
+    /** @brief Usuwa przekierowania.
+     * Działa jak @ref phfwdRemove.
+     * @param[in] num – prefiks numerów.
+     */
+    void remove(std::string_view num) noexcept {
+        detail::Terminated prefix(num);
+        phfwdRemove(pf, prefix.get());
+    }
+
+    /** @brief Usuwa jedno przekierowanie.
+     * Działa jak @ref phfwdRemoveOne.
+     * @param[in] num – prefiks numerów.
+     */
+    void removeOne(std::string_view num) noexcept {
+        detail::Terminated prefix(num);
+        phfwdRemoveOne(pf, prefix.get());
+    }
+
+    /** @brief Wyznacza przekierowanie numeru.
+     * Działa jak @ref phfwdGet.
+     * @param[in] num – numer.
+     * @return Obiekt z wynikiem, który nie ma ciągu, gdy zapytanie się nie
+     *         powiodło.
+     */
+    Numbers get(std::string_view num) const noexcept {
+        detail::Terminated copy(num);
+        return Numbers(phfwdGet(pf, copy.get()));
+    }
+
+    /** @brief Wyznacza przekierowania na dany numer.
+     * Działa jak @ref phfwdReverse.
+     * @param[in] num – numer.
+     * @return Obiekt z wynikiem, który nie ma ciągu, gdy zapytanie się nie
+     *         powiodło.
+     */
+    Numbers reverse(std::string_view num) const noexcept {
+        detail::Terminated copy(num);
+        return Numbers(phfwdReverse(pf, copy.get()));
+    }
+
+    /** @brief Wyznacza numery przekierowywane na dany numer.
+     * Działa jak @ref phfwdGetReverse.
+     * @param[in] num – numer.
+     * @return Obiekt z wynikiem, który nie ma ciągu, gdy zapytanie się nie
+     *         powiodło.
+     */
+    Numbers getReverse(std::string_view num) const noexcept {
+        detail::Terminated copy(num);
+        return Numbers(phfwdGetReverse(pf, copy.get()));
+    }
+
+    /** @brief Wyznacza przekierowanie numeru i przekazuje je do odbiorcy.
+     * Działa jak @ref phfwdQueryEach z zapytaniem @ref PHFWD_QUERY_GET.
+     * Widok przekazany do odbiorcy jest ważny tylko w czasie wywołania.
+     * @param[in] num      – numer;
+     * @param[in,out] sink – odbiorca: funkcja przyjmująca std::string_view,
+     *                       iterator wyjściowy lub @ref BufferSink.
+     * @return Wynik @ref phfwdQueryEach.
+     */
+    template <typename Sink>
+    bool get(std::string_view num, Sink &&sink) const {
+        return query(PHFWD_QUERY_GET, num, sink);
+    }
+
+    /** @brief Wyznacza przekierowania na dany numer i przekazuje je do odbiorcy.
+     * Działa jak @ref phfwdQueryEach z zapytaniem @ref PHFWD_QUERY_REVERSE.
+     * @param[in] num      – numer;
+     * @param[in,out] sink – odbiorca, jak w @ref get.
+     * @return Wynik @ref phfwdQueryEach.
+     */
+    template <typename Sink>
+    bool reverse(std::string_view num, Sink &&sink) const {
+        return query(PHFWD_QUERY_REVERSE, num, sink);
+    }
+
+    /** @brief Wyznacza numery przekierowywane na dany numer i przekazuje je do
+     * odbiorcy.
+     * Działa jak @ref phfwdQueryEach z zapytaniem
+     * @ref PHFWD_QUERY_GET_REVERSE.
+     * @param[in] num      – numer;
+     * @param[in,out] sink – odbiorca, jak w @ref get.
+     * @return Wynik @ref phfwdQueryEach.
+     */
+    template <typename Sink>
+    bool getReverse(std::string_view num, Sink &&sink) const {
+        return query(PHFWD_QUERY_GET_REVERSE, num, sink);
+    }
+
+private:
+    /** @brief Wykonuje zapytanie z wynikiem przekazywanym do odbiorcy.
+     * @param[in] kind     – rodzaj zapytania;
+     * @param[in] num      – numer;
+     * @param[in,out] sink – odbiorca.
+     * @return Wynik @ref phfwdQueryEach.
+     */
+    template <typename Sink>
+    bool query(PhfwdQuery kind, std::string_view num, Sink &sink) const {
+        void *context = const_cast<void *>(static_cast<void const *>(std::addressof(sink)));
+        return phfwdQueryEach(pf, kind, num.data(), num.size(), &detail::deliver<Sink>, context);
+    }
+
+    PhoneForward *pf; ///< Struktura przechowująca przekierowania.
+};
+
+} // namespace phfwd
+
+#endif //PHONE_FORWARD_HPP
@@ -0,0 +1,289 @@
+/** @file
+ * Implementacja równoległego wykonywania wielu zapytań o przekierowania.
+ *
+ * Zapytania są dzielone na bloki, a każdy wątek dostaje na początek spójny przedział bloków. Wątek bierze bloki
+ * z początku swojego przedziału, a gdy przedział się skończy, zabiera połowę pozostałych bloków z końca przedziału
+ * innego wątku. Wyniki każdego wątku są przydzielane z jego własnego obszaru pamięci.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "phone_forward_query.h"
+#include "structures.h"
+
+/**
+ * Najmniejsza liczba zapytań w jednym bloku.
+ */
+#define BATCH_BLOCK 64
+
+/**
+ * Największa liczba bloków, tak żeby początek i koniec przedziału zmieściły się w jednej 64-bitowej liczbie.
+ */
+#define MAX_BLOCKS ((size_t) UINT32_MAX)
+
+/**
+ * @struct PhfwdBatch
+ * @brief PhfwdBatch przechowuje wyniki zapytań wykonanych przez phfwdBatchRun.
+ */
+struct PhfwdBatch {
+    PhoneNumbers **results; ///< Wyniki zapytań w kolejności zapytań.
+    size_t count; ///< Liczba zapytań.
+    Arena *arenas; ///< Obszary, z których przydzielono wyniki, po jednym dla każdego wątku.
+    size_t threads; ///< Liczba obszarów.
+};
+
+/**
+ * @struct BatchWorker
+ * @brief BatchWorker przechowuje przedział bloków jednego wątku.
+ */
+struct BatchWorker {
+    _Alignas(64) _Atomic uint64_t range; ///< Początek przedziału w starszych 32 bitach, koniec w młodszych.
+    struct BatchContext *ctx; ///< Wskaźnik na stan wspólny dla wszystkich wątków.
+    size_t id; ///< Numer wątku.
+    pthread_t thread; ///< Identyfikator wątku.
+};
+typedef struct BatchWorker BatchWorker;
+
+/**
+ * @struct BatchContext
+ * @brief BatchContext przechowuje stan wykonywania zapytań, wspólny dla wszystkich wątków.
+ */
+struct BatchContext {
+    PhoneForward const *pf; ///< Struktura, której dotyczą zapytania.
+    PhfwdQuery query; ///< Rodzaj zapytań.
+    char const *const *nums; ///< Numery, których dotyczą zapytania.
+    size_t blockSize; ///< Liczba zapytań w jednym bloku.
+    PhfwdBatch *batch; ///< Wyniki zapytań.
+    BatchWorker *workers; ///< Przedziały bloków wszystkich wątków.
+    atomic_bool failed; ///< Czy nie powiodła się alokacja pamięci na któryś wynik.
+};
+typedef struct BatchContext BatchContext;
+
+/**
+ * Łączy początek i koniec przedziału bloków w jedną liczbę.
+ * @param head - początek przedziału.
+ * @param tail - koniec przedziału.
+ * @return - przedział zapisany jako jedna liczba.
+ */
+static uint64_t packRange(uint64_t head, uint64_t tail) {
+    return (head << 32) | tail;
+}
+
+/**
+ * Bierze pierwszy blok z przedziału wątku @p worker.
+ * @param worker - wskaźnik na przedział wątku.
+ * @param block - wskaźnik na zmienną, w której zostanie zapisany numer bloku.
+ * @return true - jeśli w przedziale był blok.
+ *         false - jeśli przedział jest pusty.
+ */
+static bool takeBlock(BatchWorker *worker, size_t *block) {
+    uint64_t range = atomic_load(&worker->range);
+
+    while ((range >> 32) < (range & UINT32_MAX)) {
+        uint64_t head = range >> 32;
+
+        if (atomic_compare_exchange_weak(&worker->range, &range, packRange(head + 1, range & UINT32_MAX))) {
+            *block = head;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Zabiera połowę pozostałych bloków z końca przedziału innego wątku i przypisuje je wątkowi @p thief.
+ * Przedział wątku @p thief musi być pusty, więc nikt inny nie może go w tym czasie zmienić.
+ * @param thief - wskaźnik na przedział wątku, który zabiera bloki.
+ * @return true - jeśli udało się zabrać jakieś bloki.
+ *         false - jeśli wszystkie przedziały są puste.
+ */
+static bool stealBlocks(BatchWorker *thief) {
+    BatchContext *ctx = thief->ctx;
+    size_t threads = ctx->batch->threads;
+
+    for (size_t k = 1; k < threads; k++) {
+        BatchWorker *victim = &ctx->workers[(thief->id + k) % threads];
+        uint64_t range = atomic_load(&victim->range);
+
+        while ((range >> 32) < (range & UINT32_MAX)) {
+            uint64_t head = range >> 32;
+            uint64_t tail = range & UINT32_MAX;
+            uint64_t middle = tail - (tail - head + 1) / 2;
+
+            if (atomic_compare_exchange_weak(&victim->range, &range, packRange(head, middle))) {
+                atomic_store(&thief->range, packRange(middle, tail));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Wykonuje jedno zapytanie.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @param query - rodzaj zapytania.
+ * @param num - numer, którego dotyczy zapytanie.
+ * @param arena - obszar, z którego zostanie przydzielony wynik.
+ * @return - wynik zapytania lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+static PhoneNumbers *runQuery(PhoneForward const *pf, PhfwdQuery query, char const *num, Arena *arena) {
+    switch (query) {
+        case PHFWD_QUERY_GET:
+            return phfwdGetInArena(pf, num, arena);
+        case PHFWD_QUERY_REVERSE:
+            return phfwdReverseInArena(pf, num, arena);
+        default:
+            return phfwdGetReverseInArena(pf, num, arena);
+    }
+}
+
+/**
+ * Wykonuje zapytania z bloków swojego przedziału, a potem z bloków zabranych innym wątkom.
+ * @param arg - wskaźnik na przedział wątku.
+ * @return - NULL.
+ */
+static void *batchWorker(void *arg) {
+    BatchWorker *worker = (BatchWorker *) arg;
+    BatchContext *ctx = worker->ctx;
+    PhfwdBatch *batch = ctx->batch;
+    Arena *arena = &batch->arenas[worker->id];
+    size_t block;
+
+    while (!atomic_load(&ctx->failed) &&
+           (takeBlock(worker, &block) || (stealBlocks(worker) && takeBlock(worker, &block)))) {
+        size_t end = (block + 1) * ctx->blockSize;
+        if (end > batch->count)
+            end = batch->count;
+
+        for (size_t i = block * ctx->blockSize; i < end; i++) {
+            batch->results[i] = runQuery(ctx->pf, ctx->query, ctx->nums[i], arena);
+
+            if (batch->results[i] == NULL) {
+                atomic_store(&ctx->failed, true);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+PhfwdBatch *phfwdBatchRun(PhoneForward const *pf, PhfwdQuery query, char const *const *nums, size_t count,
+                          size_t threads) {
+    if (pf == NULL || (nums == NULL && count > 0))
+        return NULL;
+    if (threads == 0)
+        threads = 1;
+
+    PhfwdBatch *batch = (PhfwdBatch *) malloc(sizeof(PhfwdBatch));
+    if (batch == NULL)
+        return NULL;
+
+    batch->count = count;
+    batch->threads = threads;
+    batch->results = (PhoneNumbers **) calloc(count == 0 ? 1 : count, sizeof(PhoneNumbers *));
+    batch->arenas = (Arena *) malloc(sizeof(Arena) * threads);
+    BatchWorker *workers = (BatchWorker *) aligned_alloc(_Alignof(BatchWorker), sizeof(BatchWorker) * threads);
+
+    if (batch->results == NULL || batch->arenas == NULL || workers == NULL) {
+        free(batch->results);
+        free(batch->arenas);
+        free(batch);
+        free(workers);
+        return NULL;
+    }
+
+    BatchContext ctx = {.pf = pf, .query = query, .nums = nums, .batch = batch, .workers = workers};
+    atomic_init(&ctx.failed, false);
+
+    ctx.blockSize = BATCH_BLOCK;
+    if (count / BATCH_BLOCK >= MAX_BLOCKS)
+        ctx.blockSize = count / MAX_BLOCKS + 1;
+    size_t blocks = (count + ctx.blockSize - 1) / ctx.blockSize;
+
+    for (size_t w = 0; w < threads; w++) {
+        arenaInit(&batch->arenas[w], &(pf->allocator));
+        workers[w].ctx = &ctx;
+        workers[w].id = w;
+        atomic_init(&workers[w].range, packRange(blocks * w / threads, blocks * (w + 1) / threads));
+    }
+
+    // Przedziały wątków, których nie udało się uruchomić, zostaną zabrane przez pozostałe wątki.
+    bool *started = (bool *) calloc(threads, sizeof(bool));
+    for (size_t w = 1; started != NULL && w < threads; w++)
+        started[w] = pthread_create(&workers[w].thread, NULL, batchWorker, &workers[w]) == 0;
+
+    batchWorker(&workers[0]);
+
+    for (size_t w = 1; started != NULL && w < threads; w++) {
+        if (started[w])
+            pthread_join(workers[w].thread, NULL);
+    }
+
+    free(started);
+    free(workers);
+
+    if (atomic_load(&ctx.failed)) {
+        phfwdBatchDelete(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+PhoneNumbers const *phfwdBatchResult(PhfwdBatch const *batch, size_t idx) {
+    if (batch == NULL || idx >= batch->count)
+        return NULL;
+
+    return batch->results[idx];
+}
+
+void phfwdBatchDelete(PhfwdBatch *batch) {
+    if (batch == NULL)
+        return;
+
+    for (size_t w = 0; w < batch->threads; w++)
+        arenaFree(&batch->arenas[w]);
+
+    free(batch->arenas);
+    free(batch->results);
+    free(batch);
+}
+
+bool phfwdQueryEach(PhoneForward const *pf, PhfwdQuery query, char const *num, size_t length,
+                    PhfwdNumberCallback callback, void *context) {
+    if (pf == NULL || (num == NULL && length > 0) || callback == NULL)
+        return false;
+
+    // Kopia numeru i wynik są przydzielane z jednego obszaru, zwalnianego w całości po zapytaniu.
+    Arena arena;
+    arenaInit(&arena, &(pf->allocator));
+
+    char *copy = (char *) arenaAlloc(&arena, length + 1);
+    bool result = copy != NULL;
+
+    if (result) {
+        if (length > 0)
+            memcpy(copy, num, length);
+        copy[length] = '\0';
+        // Napis z bajtem zerowym w środku nie jest numerem, a bez tego zostałby skrócony.
+        if (length > 0 && memchr(num, '\0', length) != NULL)
+            copy[0] = '?';
+
+        PhoneNumbers *numbers = runQuery(pf, query, copy, &arena);
+        char const *found;
+        result = numbers != NULL;
+
+        for (size_t i = 0; result && (found = phnumGet(numbers, i)) != NULL; i++)
+            result = callback(context, found, strlen(found));
+    }
+
+    arenaFree(&arena);
+    return result;
+}
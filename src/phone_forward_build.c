@@ -0,0 +1,548 @@
+/** @file
+ * Implementacja równoległego tworzenia struktury przechowującej przekierowania numerów telefonu.
+ *
+ * Przekierowania są dzielone na części według pierwszych znaków numeru. Każda część drzewa
+ * PhoneForwardPrefixes (według początku prefiksu) i drzewa PhoneForwardReverse (według początku przekierowania)
+ * jest budowana przez jeden wątek pod własnym tymczasowym korzeniem, a potem poddrzewa są podpinane pod
+ * korzenie jednej struktury PhoneForward. Liczba znaków wyznaczających część jest dobierana osobno dla każdego
+ * drzewa tak, żeby największa część była mała w stosunku do pracy przypadającej na wątek, bo numery z jednego
+ * kraju zwykle mają wspólny początek. Numery krótsze niż ten początek są dodawane na końcu przez wątek
+ * wywołujący, bo ich węzły leżą na ścieżkach wspólnych dla wielu części.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "trie.h"
+#include "prefix.h"
+#include "node_stack.h"
+
+/**
+ * Znacznik węzła drzewa PhoneForwardPrefixes, którego przekierowanie zostanie dodane w drugiej fazie.
+ */
+static char claimed;
+
+/**
+ * Największa liczba znaków wyznaczających część, czyli co najwyżej 12^4 części jednego drzewa.
+ */
+#define PARTITION_MAX_DEPTH 4
+
+/**
+ * Największa część powinna mieć co najwyżej 1 / (PARTS_PER_THREAD * liczba wątków) wszystkich numerów, żeby
+ * wątki kończyły pracę w podobnym czasie.
+ */
+#define PARTS_PER_THREAD 4
+
+/**
+ * @struct BuildPartition
+ * @brief BuildPartition opisuje podział numerów jednego drzewa na części według ich pierwszych znaków.
+ * Część o numerze @p parts zawiera numery krótsze niż @p depth.
+ */
+struct BuildPartition {
+    size_t depth; ///< Liczba znaków wyznaczających część.
+    size_t parts; ///< Liczba części numerów o długości co najmniej @p depth.
+    size_t *sorted; ///< Indeksy numerów posortowane stabilnie według części.
+    size_t *start; ///< Początki kolejnych części w tablicy @p sorted, @p parts + 2 elementy.
+    void **roots; ///< Tymczasowe korzenie części lub NULL, @p parts + 1 elementów.
+};
+typedef struct BuildPartition BuildPartition;
+
+/**
+ * @struct BuildContext
+ * @brief BuildContext przechowuje stan tworzenia struktury, wspólny dla wszystkich wątków.
+ */
+struct BuildContext {
+    char const *const *num1; ///< Tablica prefiksów numerów telefonu.
+    char const *const *num2; ///< Tablica przekierowań.
+    MemoryAccount *account; ///< Konto tworzonej struktury, na które liczona jest pamięć drzew.
+    BuildPartition byPrefix; ///< Podział przekierowań według początku prefiksu.
+    BuildPartition byDiversion; ///< Podział przekierowań według początku przekierowania.
+    PhoneForwardPrefixes **nodeOf; ///< Węzeł drzewa PhoneForwardPrefixes odpowiadający każdemu prefiksowi.
+    bool *wins; ///< Czy przekierowanie nie jest nadpisywane przez późniejsze przekierowanie tego samego prefiksu.
+    void (*phase)(struct BuildContext *, size_t); ///< Funkcja budująca jedną część w bieżącej fazie.
+    size_t parts; ///< Liczba części w bieżącej fazie.
+    atomic_size_t next; ///< Numer kolejnej części do zbudowania w bieżącej fazie.
+    atomic_bool failed; ///< Czy któraś część nie została zbudowana.
+};
+typedef struct BuildContext BuildContext;
+
+/**
+ * Buduje część drzewa PhoneForwardPrefixes złożoną z prefiksów części @p part i zaznacza węzły, których
+ * przekierowania zostaną dodane. Z kilku przekierowań tego samego prefiksu zostaje ostatnie.
+ * @param ctx - wskaźnik na stan tworzenia struktury.
+ * @param part - numer części.
+ */
+static void buildPrefixes(BuildContext *ctx, size_t part) {
+    BuildPartition *by = &ctx->byPrefix;
+    if (by->start[part] == by->start[part + 1])
+        return;
+
+    PhfwdMemory mem;
+    memInit(&mem, ctx->account);
+    if (by->roots[part] == NULL && (by->roots[part] = phfwdPrefixesNew(&mem)) == NULL) {
+        atomic_store(&ctx->failed, true);
+        return;
+    }
+    PhoneForwardPrefixes *root = by->roots[part];
+
+    for (size_t k = by->start[part]; k < by->start[part + 1]; k++) {
+        size_t i = by->sorted[k];
+        char const *num1 = ctx->num1[i];
+
+        if (!isStringAPhoneNumber(num1) || !isStringAPhoneNumber(ctx->num2[i]) || strcmp(num1, ctx->num2[i]) == 0) {
+            atomic_store(&ctx->failed, true);
+            return;
+        }
+
+        PhoneForwardPrefixes *node = root;
+
+        for (size_t j = 0; num1[j] != '\0'; j++) {
+            PhoneForwardPrefixes **child = &(node->children)[charToNum(num1[j])];
+
+            if (*child == NULL && (*child = phfwdPrefixesNew(&mem)) == NULL) {
+                atomic_store(&ctx->failed, true);
+                return;
+            }
+            node = *child;
+        }
+        ctx->nodeOf[i] = node;
+    }
+
+    for (size_t k = by->start[part + 1]; k > by->start[part]; k--) {
+        size_t i = by->sorted[k - 1];
+
+        if (ctx->nodeOf[i]->diversion == NULL) {
+            ctx->nodeOf[i]->diversion = &claimed;
+            ctx->wins[i] = true;
+        }
+    }
+}
+
+/**
+ * Szuka węzła przekierowania @p num w części drzewa PhoneForwardReverse, tworząc brakujące węzły ścieżki.
+ * Węzły części należą tylko do jednego wątku i nie są współdzielone.
+ * @param mem - kontekst alokacji drzew.
+ * @param root - tymczasowy korzeń części.
+ * @param num - przekierowanie.
+ * @return - węzeł przekierowania lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+static PhoneForwardReverse *reverseNodeFor(PhfwdMemory *mem, PhoneForwardReverse *root, char const *num) {
+    PhoneForwardReverse *node = root;
+
+    for (size_t j = 0; num[j] != '\0' && node != NULL; j++) {
+        PhoneForwardReverse **child = &(node->children)[charToNum(num[j])];
+
+        if (*child == NULL)
+            *child = phfwdReverseNew(mem);
+        node = *child;
+    }
+    return node;
+}
+
+/**
+ * Porządkuje tablice prefiksów węzłów drzewa PhoneForwardReverse leżących płycej niż @p depth.
+ * @param allocator - alokator stosu.
+ * @param root - korzeń drzewa.
+ * @param depth - głębokość, od której węzły są pomijane.
+ * @return true - jeśli udało się uporządkować tablice.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool sortReverse(PhfwdAllocator const *allocator, PhoneForwardReverse *root, size_t depth) {
+    NodeStack stack;
+    nodeStackInit(&stack, allocator);
+    bool result = nodeStackPush(&stack, root, NULL, 0, 0);
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardReverse *node = frame.first;
+
+        if (node->prefixes != NULL)
+            prefixSort(node->prefixes);
+
+        for (int i = 0; i < SIGNS_IN_NUMBER && result && frame.depth + 1 < depth; i++) {
+            if ((node->children)[i] != NULL)
+                result = nodeStackPush(&stack, (node->children)[i], NULL, frame.depth + 1, i);
+        }
+    }
+
+    nodeStackFree(&stack);
+    return result;
+}
+
+/**
+ * Buduje część drzewa PhoneForwardReverse złożoną z przekierowań części @p part i zapisuje przekierowania
+ * w zaznaczonych węzłach drzewa PhoneForwardPrefixes. Każdy zaznaczony węzeł należy do dokładnie jednej części,
+ * więc wątki nie modyfikują tych samych węzłów. Prefiksy są dopisywane na koniec tablic, które są porządkowane
+ * raz, po zbudowaniu całej części. Tablice części krótkich przekierowań leżą płycej niż węzły innych części.
+ * @param ctx - wskaźnik na stan tworzenia struktury.
+ * @param part - numer części.
+ */
+static void buildReverse(BuildContext *ctx, size_t part) {
+    BuildPartition *by = &ctx->byDiversion;
+    if (by->start[part] == by->start[part + 1])
+        return;
+
+    PhfwdMemory mem;
+    memInit(&mem, ctx->account);
+    PhfwdAllocator const *allocator = memAllocator(&mem);
+    if (by->roots[part] == NULL && (by->roots[part] = phfwdReverseNew(&mem)) == NULL) {
+        atomic_store(&ctx->failed, true);
+        return;
+    }
+    PhoneForwardReverse *root = by->roots[part];
+
+    for (size_t k = by->start[part]; k < by->start[part + 1]; k++) {
+        size_t i = by->sorted[k];
+
+        if (!ctx->wins[i])
+            continue;
+
+        PhoneForwardReverse *node = reverseNodeFor(&mem, root, ctx->num2[i]);
+        if (node != NULL && node->diversion == NULL)
+            node->diversion = stringNew(allocator, ctx->num2[i]);
+
+        char *prefix = (node == NULL || node->diversion == NULL) ? NULL : stringNew(allocator, ctx->num1[i]);
+        if (prefix == NULL || !prefixAppend(allocator, &(node->prefixes), prefix)) {
+            stringRelease(allocator, prefix);
+            atomic_store(&ctx->failed, true);
+            return;
+        }
+
+        ctx->nodeOf[i]->diversion = stringRetain(node->diversion);
+    }
+
+    if (!sortReverse(&(ctx->account->base), root, (part == by->parts) ? by->depth : SIZE_MAX))
+        atomic_store(&ctx->failed, true);
+}
+
+/**
+ * Pobiera kolejne części do zbudowania w bieżącej fazie, dopóki jakieś zostały.
+ * @param arg - wskaźnik na stan tworzenia struktury.
+ * @return - NULL.
+ */
+static void *buildWorker(void *arg) {
+    BuildContext *ctx = (BuildContext *) arg;
+    size_t part;
+
+    while (!atomic_load(&ctx->failed) && (part = atomic_fetch_add(&ctx->next, 1)) < ctx->parts)
+        ctx->phase(ctx, part);
+
+    return NULL;
+}
+
+/**
+ * Wykonuje jedną fazę tworzenia struktury na @p threads wątkach, z których jednym jest wątek wywołujący.
+ * Jeśli nie uda się uruchomić któregoś wątku, jego pracę wykonają pozostałe.
+ * @param ctx - wskaźnik na stan tworzenia struktury.
+ * @param phase - funkcja budująca jedną część.
+ * @param parts - liczba części.
+ * @param workers - tablica na identyfikatory wątków.
+ * @param threads - liczba wątków.
+ * @return true - jeśli wszystkie części zostały zbudowane.
+ *         false - w przeciwnym przypadku.
+ */
+static bool runPhase(BuildContext *ctx, void (*phase)(BuildContext *, size_t), size_t parts, pthread_t *workers,
+                     size_t threads) {
+    ctx->phase = phase;
+    ctx->parts = parts;
+    atomic_store(&ctx->next, 0);
+
+    size_t started = 0;
+    while (started + 1 < threads && pthread_create(&workers[started], NULL, buildWorker, ctx) == 0)
+        started++;
+
+    buildWorker(ctx);
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    return !atomic_load(&ctx->failed);
+}
+
+/**
+ * Buduje w wątku wywołującym część numerów krótszych niż początek wyznaczający pozostałe części. Ich węzły
+ * leżą na ścieżkach, które powstały przy podpinaniu części, więc część jest budowana od razu w drzewie struktury.
+ * @param ctx - wskaźnik na stan tworzenia struktury.
+ * @param phase - funkcja budująca jedną część.
+ * @param by - podział numerów.
+ * @param root - korzeń drzewa struktury.
+ * @return true - jeśli udało się zbudować część.
+ *         false - w przeciwnym przypadku.
+ */
+static bool buildShort(BuildContext *ctx, void (*phase)(BuildContext *, size_t), BuildPartition *by, void *root) {
+    by->roots[by->parts] = root;
+    phase(ctx, by->parts);
+    by->roots[by->parts] = NULL;
+    return !atomic_load(&ctx->failed);
+}
+
+/**
+ * Podaje części, do których należy numer przy podziale według od 1 do @p depth pierwszych znaków.
+ * @param num - numer.
+ * @param depth - największa liczba znaków wyznaczających część.
+ * @param part - tablica, w której pod indeksem d zostanie zapisany numer części przy podziale według d znaków;
+ *               numer krótszy niż d należy do części o numerze 12^d.
+ * @return true - jeśli pierwsze znaki numeru są znakami numeru telefonu.
+ *         false - w przeciwnym przypadku.
+ */
+static bool partsOf(char const *num, size_t depth, size_t part[]) {
+    size_t key = 0;
+    size_t parts = 1;
+    size_t d = 1;
+
+    for (; d <= depth && num[d - 1] != '\0'; d++) {
+        if (!(isdigit((unsigned char) num[d - 1]) || num[d - 1] == '*' || num[d - 1] == '#'))
+            return false;
+        key = key * SIGNS_IN_NUMBER + (size_t) charToNum(num[d - 1]);
+        parts *= SIGNS_IN_NUMBER;
+        part[d] = key;
+    }
+    for (; d <= depth; d++) {
+        parts *= SIGNS_IN_NUMBER;
+        part[d] = parts;
+    }
+    return true;
+}
+
+/**
+ * Dzieli numery na części według ich pierwszych znaków. Liczba znaków jest najmniejszą, przy której największa
+ * część, wliczając część krótkich numerów, ma co najwyżej 1 / (PARTS_PER_THREAD * @p threads) wszystkich
+ * numerów, a jeśli żadna liczba do PARTITION_MAX_DEPTH na to nie pozwala, tą, przy której największa część jest
+ * najmniejsza. Jeden wątek buduje wszystko sam, więc wtedy wystarcza jeden znak.
+ * @param nums - tablica numerów.
+ * @param count - liczba numerów.
+ * @param threads - liczba wątków.
+ * @param by - wskaźnik na wyzerowany podział, który zostanie wypełniony.
+ * @return true - jeśli udało się podzielić numery.
+ *         false - jeśli któryś numer ma wartość NULL lub zaczyna się znakiem spoza numeru telefonu albo nie
+ *         powiodła się alokacja pamięci.
+ */
+static bool partitionNums(char const *const *nums, size_t count, size_t threads, BuildPartition *by) {
+    size_t *counts[PARTITION_MAX_DEPTH + 1];
+    size_t total = 0;
+    size_t parts = 1;
+    size_t maxDepth = (threads == 1) ? 1 : PARTITION_MAX_DEPTH;
+
+    for (size_t d = 1; d <= maxDepth; d++) {
+        parts *= SIGNS_IN_NUMBER;
+        total += parts + 1;
+    }
+    size_t *all = (size_t *) calloc(total, sizeof(size_t));
+    if (all == NULL)
+        return false;
+
+    parts = 1;
+    counts[1] = all;
+    for (size_t d = 1; d < maxDepth; d++) {
+        parts *= SIGNS_IN_NUMBER;
+        counts[d + 1] = counts[d] + parts + 1;
+    }
+
+    size_t part[PARTITION_MAX_DEPTH + 1];
+    for (size_t i = 0; i < count; i++) {
+        if (nums[i] == NULL || !partsOf(nums[i], maxDepth, part)) {
+            free(all);
+            return false;
+        }
+        for (size_t d = 1; d <= maxDepth; d++)
+            counts[d][part[d]]++;
+    }
+
+    size_t bestLargest = SIZE_MAX;
+    parts = 1;
+    for (size_t d = 1; d <= maxDepth; d++) {
+        parts *= SIGNS_IN_NUMBER;
+        size_t largest = 0;
+        for (size_t p = 0; p <= parts; p++)
+            largest = (counts[d][p] > largest) ? counts[d][p] : largest;
+
+        if (largest < bestLargest) {
+            bestLargest = largest;
+            by->depth = d;
+            by->parts = parts;
+        }
+        if (largest <= count / (PARTS_PER_THREAD * threads))
+            break;
+    }
+
+    by->sorted = (size_t *) malloc(sizeof(size_t) * (count == 0 ? 1 : count));
+    by->start = (size_t *) malloc(sizeof(size_t) * (by->parts + 2));
+    by->roots = (void **) calloc(by->parts + 1, sizeof(void *));
+    if (by->sorted == NULL || by->start == NULL || by->roots == NULL) {
+        free(all);
+        return false;
+    }
+
+    size_t *position = counts[by->depth];
+    by->start[0] = 0;
+    for (size_t p = 0; p <= by->parts; p++) {
+        by->start[p + 1] = by->start[p] + position[p];
+        position[p] = by->start[p];
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        partsOf(nums[i], by->depth, part);
+        by->sorted[position[part[by->depth]]++] = i;
+    }
+
+    free(all);
+    return true;
+}
+
+/**
+ * Podpina zbudowane części drzewa PhoneForwardPrefixes pod korzeń struktury @p pf. Węzły części leżące płycej
+ * niż @p by->depth nie mają przekierowań, więc są zwalniane, a ich miejsce zajmują węzły wspólne dla części.
+ * @param ctx - wskaźnik na stan tworzenia struktury.
+ * @param pf - wskaźnik na strukturę.
+ * @return true - jeśli udało się podpiąć wszystkie części.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool stitchPrefixes(BuildContext *ctx, PhoneForward *pf) {
+    BuildPartition *by = &ctx->byPrefix;
+    PhfwdMemory mem;
+    memInit(&mem, ctx->account);
+
+    for (size_t part = 0; part < by->parts; part++) {
+        if (by->roots[part] == NULL)
+            continue;
+
+        char const *num = ctx->num1[by->sorted[by->start[part]]];
+        PhoneForwardPrefixes *target = pf->prefixes;
+        for (size_t j = 0; j + 1 < by->depth; j++) {
+            PhoneForwardPrefixes **slot = &(target->children)[charToNum(num[j])];
+            if (*slot == NULL && (*slot = phfwdPrefixesNew(&mem)) == NULL)
+                return false;
+            target = *slot;
+        }
+
+        PhoneForwardPrefixes *node = by->roots[part];
+        for (size_t j = 0; j < by->depth; j++) {
+            PhoneForwardPrefixes *child = (node->children)[charToNum(num[j])];
+            memFree(memAllocator(&mem), node, MEM_PREFIXES_NODE);
+            node = child;
+        }
+        (target->children)[charToNum(num[by->depth - 1])] = node;
+        by->roots[part] = NULL;
+    }
+    return true;
+}
+
+/**
+ * Podpina zbudowane części drzewa PhoneForwardReverse pod korzeń struktury @p pf tak jak stitchPrefixes.
+ * @param ctx - wskaźnik na stan tworzenia struktury.
+ * @param pf - wskaźnik na strukturę.
+ * @return true - jeśli udało się podpiąć wszystkie części.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool stitchReverse(BuildContext *ctx, PhoneForward *pf) {
+    BuildPartition *by = &ctx->byDiversion;
+    PhfwdMemory mem;
+    memInit(&mem, ctx->account);
+
+    for (size_t part = 0; part < by->parts; part++) {
+        if (by->roots[part] == NULL)
+            continue;
+
+        char const *num = ctx->num2[by->sorted[by->start[part]]];
+        PhoneForwardReverse *root = by->roots[part];
+        by->roots[part] = NULL;
+
+        // Część, której wszystkie przekierowania zostały nadpisane, nie ma węzłów poza korzeniem.
+        if ((root->children)[charToNum(num[0])] == NULL) {
+            memFree(memAllocator(&mem), root, MEM_REVERSE_NODE);
+            continue;
+        }
+
+        PhoneForwardReverse *target = pf->reverse;
+        for (size_t j = 0; j + 1 < by->depth; j++) {
+            PhoneForwardReverse **slot = &(target->children)[charToNum(num[j])];
+            if (*slot == NULL && (*slot = phfwdReverseNew(&mem)) == NULL) {
+                by->roots[part] = root;
+                return false;
+            }
+            target = *slot;
+        }
+
+        PhoneForwardReverse *node = root;
+        for (size_t j = 0; j < by->depth; j++) {
+            PhoneForwardReverse *child = (node->children)[charToNum(num[j])];
+            memFree(memAllocator(&mem), node, MEM_REVERSE_NODE);
+            node = child;
+        }
+        (target->children)[charToNum(num[by->depth - 1])] = node;
+    }
+    return true;
+}
+
+/**
+ * Zwalnia podział numerów razem z niepodpiętymi częściami.
+ * @param allocator - alokator drzew.
+ * @param by - wskaźnik na podział.
+ * @param prefixes - czy części są częściami drzewa PhoneForwardPrefixes.
+ */
+static void partitionFree(PhfwdAllocator const *allocator, BuildPartition *by, bool prefixes) {
+    for (size_t part = 0; by->roots != NULL && part < by->parts; part++) {
+        if (prefixes)
+            phfwdPrefixesRelease(allocator, by->roots[part]);
+        else
+            phfwdReverseRelease(allocator, by->roots[part]);
+    }
+    free(by->sorted);
+    free(by->start);
+    free(by->roots);
+}
+
+PhoneForward *phfwdBuildParallel(char const *const *num1, char const *const *num2, size_t count, size_t threads) {
+    if ((num1 == NULL || num2 == NULL) && count > 0)
+        return NULL;
+
+    PhoneForward *pf = phfwdNew();
+    if (pf == NULL || count == 0)
+        return pf;
+
+    if (threads == 0)
+        threads = 1;
+
+    BuildContext ctx = {.num1 = num1, .num2 = num2, .account = pf->account};
+    atomic_init(&ctx.next, 0);
+    atomic_init(&ctx.failed, false);
+
+    ctx.nodeOf = (PhoneForwardPrefixes **) malloc(sizeof(PhoneForwardPrefixes *) * count);
+    ctx.wins = (bool *) calloc(count, sizeof(bool));
+    pthread_t *workers = (pthread_t *) malloc(sizeof(pthread_t) * threads);
+
+    // Krótkie prefiksy muszą być w drzewie struktury, zanim zostaną im zapisane przekierowania.
+    bool result = ctx.nodeOf != NULL && ctx.wins != NULL && workers != NULL &&
+                  partitionNums(num1, count, threads, &ctx.byPrefix) &&
+                  partitionNums(num2, count, threads, &ctx.byDiversion) &&
+                  runPhase(&ctx, buildPrefixes, ctx.byPrefix.parts, workers, threads) &&
+                  stitchPrefixes(&ctx, pf) && buildShort(&ctx, buildPrefixes, &ctx.byPrefix, pf->prefixes) &&
+                  runPhase(&ctx, buildReverse, ctx.byDiversion.parts, workers, threads) &&
+                  stitchReverse(&ctx, pf) && buildShort(&ctx, buildReverse, &ctx.byDiversion, pf->reverse);
+
+    if (!result && ctx.nodeOf != NULL && ctx.wins != NULL) {
+        // Węzły zaznaczone w pierwszej fazie, którym nie dodano przekierowania, nie mogą zostać zwolnione.
+        for (size_t i = 0; i < count; i++) {
+            if (ctx.wins[i] && ctx.nodeOf[i]->diversion == &claimed)
+                ctx.nodeOf[i]->diversion = NULL;
+        }
+    }
+
+    partitionFree(&(ctx.account->allocator), &ctx.byPrefix, true);
+    partitionFree(&(ctx.account->allocator), &ctx.byDiversion, false);
+    free(ctx.nodeOf);
+    free(ctx.wins);
+    free(workers);
+
+    if (!result) {
+        phfwdDelete(pf);
+        return NULL;
+    }
+    return pf;
+}
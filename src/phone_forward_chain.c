@@ -0,0 +1,308 @@
+/** @file
+ * Implementacja wyznaczania końca łańcucha przekierowań numeru telefonu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "trie.h"
+#include "phone_forward_query.h"
+#include "phone_forward_lookup.h"
+
+/**
+ * Najmniejsza liczba miejsc w tablicy zapamiętanych łańcuchów.
+ */
+#define MEMO_MIN_CAPACITY 16
+
+/**
+ * @struct ChainBuffer
+ * @brief ChainBuffer jest tablicą na numer telefonu, powiększaną tylko wtedy, gdy numer się w niej nie mieści.
+ */
+struct ChainBuffer {
+    char *data; ///< Numer telefonu.
+    size_t size; ///< Rozmiar tablicy data.
+};
+typedef struct ChainBuffer ChainBuffer;
+
+/**
+ * Wynik jednego kroku łańcucha przekierowań.
+ */
+enum ChainStep {
+    STEP_FORWARDED, ///< Numer został przekierowany.
+    STEP_FINAL, ///< Żaden prefiks numeru nie jest przekierowywany.
+    STEP_NO_MEMORY ///< Nie powiodła się alokacja pamięci.
+};
+typedef enum ChainStep ChainStep;
+
+/**
+ * @struct ChainEntry
+ * @brief ChainEntry jest zapamiętanym wynikiem wyznaczania łańcucha dla jednego numeru.
+ */
+struct ChainEntry {
+    char *num; ///< Numer, od którego zaczyna się łańcuch, lub NULL, jeśli miejsce jest wolne.
+    char *result; ///< Koniec łańcucha lub NULL, jeśli łańcuch zawiera cykl.
+    size_t hops; ///< Liczba przekierowań potrzebnych do dojścia do końca łańcucha.
+};
+typedef struct ChainEntry ChainEntry;
+
+/**
+ * @struct PhfwdChainMemo
+ * @brief PhfwdChainMemo jest tablicą z haszowaniem zapamiętanych łańcuchów jednej wersji jednej struktury.
+ */
+struct PhfwdChainMemo {
+    PhoneForward const *pf; ///< Struktura, której dotyczą zapamiętane łańcuchy.
+    uint64_t version; ///< Wersja struktury, której dotyczą zapamiętane łańcuchy.
+    ChainEntry *entries; ///< Tablica zapamiętanych łańcuchów.
+    size_t capacity; ///< Rozmiar tablicy entries, będący potęgą dwójki.
+    size_t count; ///< Liczba zajętych miejsc w tablicy entries.
+};
+
+/**
+ * Zapewnia, że w tablicy zmieści się napis długości @p length.
+ * @param buffer - wskaźnik na tablicę.
+ * @param length - długość napisu.
+ * @return true - jeśli napis się mieści.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool bufferReserve(ChainBuffer *buffer, size_t length) {
+    if (length + 1 <= buffer->size)
+        return true;
+
+    size_t newSize = 2 * (length + 1);
+    char *data = (char *) realloc(buffer->data, sizeof(char) * newSize);
+    if (data == NULL)
+        return false;
+
+    buffer->data = data;
+    buffer->size = newSize;
+    return true;
+}
+
+/**
+ * Kopiuje numer do tablicy.
+ * @param buffer - wskaźnik na tablicę.
+ * @param num - numer telefonu.
+ * @return true - jeśli udało się skopiować numer.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool bufferCopy(ChainBuffer *buffer, char const *num) {
+    size_t length = strlen(num);
+    if (!bufferReserve(buffer, length))
+        return false;
+
+    memcpy(buffer->data, num, length + 1);
+    return true;
+}
+
+/**
+ * Zapisuje w tablicy @p next wynik phfwdGet dla numeru @p num, nie tworząc struktury PhoneNumbers.
+ * @param pf - struktura przechowująca przekierowania.
+ * @param num - numer telefonu.
+ * @param next - tablica na przekierowany numer.
+ * @return - wynik kroku.
+ */
+static ChainStep chainForward(PhoneForward const *pf, char const *num, ChainBuffer *next) {
+    size_t length = 0;
+    char const *diversion = phfwdFindPrefix(pf, num, &length);
+
+    if (diversion == NULL)
+        return STEP_FINAL;
+
+    size_t diversionLength = strlen(diversion);
+    size_t rest = strlen(num + length);
+
+    if (!bufferReserve(next, diversionLength + rest))
+        return STEP_NO_MEMORY;
+
+    memcpy(next->data, diversion, diversionLength);
+    memcpy(next->data + diversionLength, num + length, rest + 1);
+    return STEP_FORWARDED;
+}
+
+/**
+ * Liczy skrót numeru telefonu (FNV-1a).
+ * @param num - numer telefonu.
+ * @return - skrót numeru.
+ */
+static size_t chainHash(char const *num) {
+    uint64_t hash = 14695981039346656037u;
+
+    for (size_t i = 0; num[i] != '\0'; i++) {
+        hash ^= (unsigned char) num[i];
+        hash *= 1099511628211u;
+    }
+    return (size_t) hash;
+}
+
+/**
+ * Usuwa wszystkie zapamiętane łańcuchy.
+ * @param memo - wskaźnik na tablicę zapamiętanych łańcuchów.
+ */
+static void memoClear(PhfwdChainMemo *memo) {
+    for (size_t i = 0; i < memo->capacity && memo->count > 0; i++) {
+        if (memo->entries[i].num != NULL) {
+            free(memo->entries[i].num);
+            free(memo->entries[i].result);
+            memo->entries[i].num = NULL;
+            memo->count--;
+        }
+    }
+}
+
+/**
+ * Szuka miejsca, w którym jest lub powinien być zapamiętany łańcuch numeru @p num.
+ * Łańcuchy zapamiętane dla innej struktury lub innej jej wersji są wcześniej usuwane.
+ * @param memo - wskaźnik na tablicę zapamiętanych łańcuchów.
+ * @param pf - struktura przechowująca przekierowania.
+ * @param num - numer telefonu.
+ * @return - wskaźnik na miejsce w tablicy.
+ */
+static ChainEntry *memoFind(PhfwdChainMemo *memo, PhoneForward const *pf, char const *num) {
+    if (memo->pf != pf || memo->version != pf->version) {
+        memoClear(memo);
+        memo->pf = pf;
+        memo->version = pf->version;
+    }
+
+    size_t idx = chainHash(num) & (memo->capacity - 1);
+
+    while (memo->entries[idx].num != NULL && strcmp(memo->entries[idx].num, num) != 0)
+        idx = (idx + 1) & (memo->capacity - 1);
+
+    return &memo->entries[idx];
+}
+
+/**
+ * Zapamiętuje łańcuch numeru @p num. Jeśli tablica jest w połowie pełna, najpierw ją czyści.
+ * Błąd alokacji pamięci jest pomijany, bo zapamiętanie łańcucha nie jest konieczne.
+ * @param memo - wskaźnik na tablicę zapamiętanych łańcuchów.
+ * @param pf - struktura przechowująca przekierowania.
+ * @param num - numer, od którego zaczyna się łańcuch.
+ * @param result - koniec łańcucha lub NULL, jeśli łańcuch zawiera cykl.
+ * @param hops - liczba przekierowań potrzebnych do dojścia do końca łańcucha.
+ */
+static void memoInsert(PhfwdChainMemo *memo, PhoneForward const *pf, char const *num, char const *result,
+                       size_t hops) {
+    if (2 * (memo->count + 1) > memo->capacity)
+        memoClear(memo);
+
+    ChainEntry *entry = memoFind(memo, pf, num);
+    entry->num = (char *) malloc(sizeof(char) * (strlen(num) + 1));
+    entry->result = (result == NULL) ? NULL : (char *) malloc(sizeof(char) * (strlen(result) + 1));
+
+    if (entry->num == NULL || (result != NULL && entry->result == NULL)) {
+        free(entry->num);
+        free(entry->result);
+        entry->num = NULL;
+        return;
+    }
+
+    strcpy(entry->num, num);
+    if (result != NULL)
+        strcpy(entry->result, result);
+    entry->hops = hops;
+    memo->count++;
+}
+
+PhfwdChainMemo *phfwdChainMemoNew(size_t capacity) {
+    PhfwdChainMemo *memo = (PhfwdChainMemo *) malloc(sizeof(PhfwdChainMemo));
+    if (memo == NULL)
+        return NULL;
+
+    memo->capacity = MEMO_MIN_CAPACITY;
+    while (memo->capacity < 2 * capacity)
+        memo->capacity *= 2;
+
+    memo->entries = (ChainEntry *) calloc(memo->capacity, sizeof(ChainEntry));
+    if (memo->entries == NULL) {
+        free(memo);
+        return NULL;
+    }
+
+    memo->pf = NULL;
+    memo->version = 0;
+    memo->count = 0;
+    return memo;
+}
+
+void phfwdChainMemoDelete(PhfwdChainMemo *memo) {
+    if (memo == NULL)
+        return;
+
+    memoClear(memo);
+    free(memo->entries);
+    free(memo);
+}
+
+PhoneNumbers *phfwdResolveChain(PhoneForward const *pf, char const *num, size_t maxHops, PhfwdChainMemo *memo) {
+    if (pf == NULL)
+        return NULL;
+    if (!isStringAPhoneNumber(num))
+        return phnumSingle(&(pf->allocator), NULL);
+
+    if (memo != NULL) {
+        ChainEntry *entry = memoFind(memo, pf, num);
+
+        if (entry->num != NULL)
+            return phnumSingle(&(pf->allocator), entry->hops <= maxHops ? entry->result : NULL);
+    }
+
+    ChainBuffer hare = {NULL, 0};
+    ChainBuffer next = {NULL, 0};
+    ChainBuffer tortoise = {NULL, 0};
+    ChainStep step = (bufferCopy(&hare, num) && bufferCopy(&tortoise, num)) ? STEP_FORWARDED : STEP_NO_MEMORY;
+    bool cycle = false;
+    size_t hops = 0;
+    size_t power = 1;
+    size_t lambda = 0;
+
+    // Wykrywanie cyklu metodą Brenta: żółw stoi w miejscu, a zając co potęgę dwójki kroków zabiera go ze sobą.
+    while (step == STEP_FORWARDED) {
+        if (hops == maxHops) {
+            size_t length = 0;
+            step = (phfwdFindPrefix(pf, hare.data, &length) == NULL) ? STEP_FINAL : STEP_FORWARDED;
+            break;
+        }
+
+        step = chainForward(pf, hare.data, &next);
+        if (step != STEP_FORWARDED)
+            break;
+
+        ChainBuffer tmp = hare;
+        hare = next;
+        next = tmp;
+        hops++;
+        lambda++;
+
+        if (strcmp(hare.data, tortoise.data) == 0) {
+            cycle = true;
+            break;
+        }
+
+        if (lambda == power) {
+            if (!bufferCopy(&tortoise, hare.data))
+                step = STEP_NO_MEMORY;
+            power *= 2;
+            lambda = 0;
+        }
+    }
+
+    PhoneNumbers *result = NULL;
+
+    if (step != STEP_NO_MEMORY) {
+        // Łańcuch, który nie skończył się w ciągu maxHops przekierowań, nie jest zapamiętywany.
+        bool resolved = cycle || step == STEP_FINAL;
+        result = phnumSingle(&(pf->allocator), (step == STEP_FINAL && !cycle) ? hare.data : NULL);
+
+        if (memo != NULL && resolved)
+            memoInsert(memo, pf, num, cycle ? NULL : hare.data, hops);
+    }
+
+    free(hare.data);
+    free(next.data);
+    free(tortoise.data);
+    return result;
+}
@@ -0,0 +1,327 @@
+/** @file
+ * Implementacja klienta serwera przekierowań numerów telefonu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "phone_forward_client.h"
+#include "phone_forward_protocol.h"
+#include "phone_forward_query.h"
+
+/**
+ * Liczba bajtów w buforze żądań, po której przekroczeniu żądania są wysyłane.
+ */
+#define CLIENT_FLUSH (64 * 1024)
+
+/**
+ * Liczba bajtów odczytywanych naraz z gniazda.
+ */
+#define CLIENT_READ (64 * 1024)
+
+/**
+ * @struct PhfwdClient
+ * @brief PhfwdClient jest połączeniem z serwerem przekierowań.
+ */
+struct PhfwdClient {
+    int fd; ///< Gniazdo połączenia.
+    FrameBuffer out; ///< Żądania, które nie zostały jeszcze wysłane.
+    FrameBuffer in; ///< Odebrane dane, które nie zostały jeszcze odczytane.
+    uint32_t nextId; ///< Numer kolejnego żądania.
+};
+
+/**
+ * Tworzy klienta dla połączonego gniazda.
+ * @param fd - gniazdo połączone z serwerem.
+ * @return - wskaźnik na klienta lub NULL, jeśli nie powiodła się alokacja pamięci. Wtedy gniazdo jest zamykane.
+ */
+static PhfwdClient *clientNew(int fd) {
+    PhfwdClient *client = (PhfwdClient *) malloc(sizeof(PhfwdClient));
+
+    if (client == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    client->fd = fd;
+    frameInit(&client->out);
+    frameInit(&client->in);
+    client->nextId = 0;
+    return client;
+}
+
+PhfwdClient *phfwdClientConnectUnix(char const *path) {
+    struct sockaddr_un address;
+
+    if (path == NULL || strlen(path) >= sizeof(address.sun_path))
+        return NULL;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    return clientNew(fd);
+}
+
+PhfwdClient *phfwdClientConnectTcp(char const *host, uint16_t port) {
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+
+    if (host == NULL || inet_pton(AF_INET, host, &address.sin_addr) != 1)
+        return NULL;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+
+    // Żądania są grupowane w buforze, więc algorytm Nagle'a tylko opóźniałby ich wysłanie.
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    return clientNew(fd);
+}
+
+void phfwdClientClose(PhfwdClient *client) {
+    if (client == NULL)
+        return;
+
+    close(client->fd);
+    frameFree(&client->out);
+    frameFree(&client->in);
+    free(client);
+}
+
+/**
+ * Odczytuje dane, które serwer już wysłał, nie czekając na kolejne.
+ * @param client - wskaźnik na połączenie.
+ * @return true - jeśli połączenie działa.
+ *         false - jeśli zostało przerwane lub nie powiodła się alokacja pamięci.
+ */
+static bool receiveAvailable(PhfwdClient *client) {
+    if (!frameReserve(&client->in, CLIENT_READ))
+        return false;
+
+    ssize_t received = recv(client->fd, client->in.data + client->in.used, client->in.size - client->in.used,
+                            MSG_DONTWAIT);
+
+    if (received < 0)
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    if (received == 0)
+        return false;
+    client->in.used += (size_t) received;
+    return true;
+}
+
+bool phfwdClientFlush(PhfwdClient *client) {
+    if (client == NULL)
+        return false;
+
+    size_t sent = 0;
+    bool result = true;
+
+    // Przy długim potoku serwer przestaje czytać żądania, dopóki klient nie odbierze odpowiedzi, więc czekając
+    // na możliwość wysłania, trzeba odbierać odpowiedzi do bufora.
+    while (result && sent < client->out.used) {
+        struct pollfd poller = {.fd = client->fd, .events = POLLIN | POLLOUT};
+
+        if (poll(&poller, 1, -1) < 0) {
+            result = errno == EINTR;
+            continue;
+        }
+
+        if ((poller.revents & POLLIN) != 0)
+            result = receiveAvailable(client);
+        if (!result || (poller.revents & (POLLOUT | POLLERR | POLLHUP)) == 0)
+            continue;
+
+        ssize_t written = send(client->fd, client->out.data + sent, client->out.used - sent,
+                               MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (written > 0)
+            sent += (size_t) written;
+        else
+            result = written < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    frameConsume(&client->out, sent);
+    return result;
+}
+
+bool phfwdClientSend(PhfwdClient *client, PhfwdRequest request, char const *num1, char const *num2, uint32_t *id) {
+    if (client == NULL || num1 == NULL || (request == PHFWD_REQUEST_ADD) != (num2 != NULL) ||
+        request < PHFWD_REQUEST_GET || request > PHFWD_REQUEST_REMOVE)
+        return false;
+
+    size_t start;
+    uint32_t requestId = client->nextId;
+
+    if (!frameBegin(&client->out, requestId, (uint8_t) request, &start))
+        return false;
+
+    bool written = frameAppendString(&client->out, num1) && (num2 == NULL || frameAppendString(&client->out, num2));
+
+    if (!frameEnd(&client->out, start, written))
+        return false;
+
+    client->nextId++;
+    if (id != NULL)
+        *id = requestId;
+    return client->out.used < CLIENT_FLUSH || phfwdClientFlush(client);
+}
+
+/**
+ * Czeka, aż na początku odebranych danych będzie cała ramka.
+ * @param client - wskaźnik na połączenie.
+ * @param length - wskaźnik, pod którym zostanie zapisana długość ramki.
+ * @return true - jeśli odebrano ramkę.
+ *         false - jeśli połączenie zostało przerwane, ramka jest niepoprawna lub nie powiodła się alokacja pamięci.
+ */
+static bool receiveFrame(PhfwdClient *client, size_t *length) {
+    int complete;
+
+    while ((complete = frameComplete(client->in.data, client->in.used, length)) == 0) {
+        if (!frameReserve(&client->in, CLIENT_READ))
+            return false;
+
+        ssize_t received = recv(client->fd, client->in.data + client->in.used, client->in.size - client->in.used, 0);
+
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        client->in.used += (size_t) received;
+    }
+    return complete == 1;
+}
+
+/**
+ * Odczytuje numery z treści odpowiedzi na zapytanie.
+ * @param data - początek treści.
+ * @param end - koniec treści.
+ * @return - wskaźnik na ciąg numerów lub NULL, jeśli treść jest niepoprawna lub nie powiodła się alokacja pamięci.
+ */
+static PhoneNumbers *decodeNumbers(char const *data, char const *end) {
+    if (end - data < 4)
+        return NULL;
+
+    uint32_t count = frameNumber(data);
+    data += 4;
+
+    PhoneNumbers *numbers = phnumSingle(NULL, NULL);
+
+    for (uint32_t i = 0; i < count && numbers != NULL; i++) {
+        char const *num = frameString(&data, end);
+
+        if (num == NULL || !phnumAppend(numbers, num, "")) {
+            phnumDelete(numbers);
+            numbers = NULL;
+        }
+    }
+    return numbers;
+}
+
+bool phfwdClientReceive(PhfwdClient *client, uint32_t *id, bool *result, PhoneNumbers **numbers) {
+    size_t length;
+
+    if (numbers != NULL)
+        *numbers = NULL;
+    if (!phfwdClientFlush(client) || !receiveFrame(client, &length))
+        return false;
+
+    char const *frame = client->in.data;
+    uint8_t status = (uint8_t) frame[PROTOCOL_HEADER - 1];
+    bool query = length > PROTOCOL_HEADER;
+    bool valid = status == PROTOCOL_OK || (status == PROTOCOL_FALSE && !query);
+
+    if (id != NULL)
+        *id = frameNumber(frame + 4);
+    if (result != NULL)
+        *result = status == PROTOCOL_OK;
+
+    if (valid && query && numbers != NULL) {
+        *numbers = decodeNumbers(frame + PROTOCOL_HEADER, frame + length);
+        valid = *numbers != NULL;
+    }
+
+    frameConsume(&client->in, length);
+    return valid;
+}
+
+/**
+ * Wysyła jedno żądanie i odbiera na nie odpowiedź.
+ * @param client - wskaźnik na połączenie bez żądań czekających na odpowiedź.
+ * @param request - rodzaj żądania.
+ * @param num1 - numer, którego dotyczy żądanie.
+ * @param num2 - drugi numer żądania lub NULL.
+ * @param numbers - wskaźnik, pod którym zostanie zapisany wynik zapytania, lub NULL.
+ * @return true - jeśli żądanie zostało wykonane z wynikiem true.
+ *         false - w przeciwnym przypadku.
+ */
+static bool clientCall(PhfwdClient *client, PhfwdRequest request, char const *num1, char const *num2,
+                       PhoneNumbers **numbers) {
+    uint32_t sentId;
+    uint32_t receivedId;
+    bool result = false;
+
+    if (!phfwdClientSend(client, request, num1, num2, &sentId) ||
+        !phfwdClientReceive(client, &receivedId, &result, numbers))
+        return false;
+
+    if (receivedId != sentId && numbers != NULL) {
+        phnumDelete(*numbers);
+        *numbers = NULL;
+    }
+    return receivedId == sentId && result;
+}
+
+PhoneNumbers *phfwdClientGet(PhfwdClient *client, char const *num) {
+    PhoneNumbers *numbers = NULL;
+    clientCall(client, PHFWD_REQUEST_GET, num, NULL, &numbers);
+    return numbers;
+}
+
+PhoneNumbers *phfwdClientReverse(PhfwdClient *client, char const *num) {
+    PhoneNumbers *numbers = NULL;
+    clientCall(client, PHFWD_REQUEST_REVERSE, num, NULL, &numbers);
+    return numbers;
+}
+
+PhoneNumbers *phfwdClientGetReverse(PhfwdClient *client, char const *num) {
+    PhoneNumbers *numbers = NULL;
+    clientCall(client, PHFWD_REQUEST_GET_REVERSE, num, NULL, &numbers);
+    return numbers;
+}
+
+bool phfwdClientAdd(PhfwdClient *client, char const *num1, char const *num2) {
+    return clientCall(client, PHFWD_REQUEST_ADD, num1, num2, NULL);
+}
+
+bool phfwdClientRemove(PhfwdClient *client, char const *num) {
+    return clientCall(client, PHFWD_REQUEST_REMOVE, num, NULL, NULL);
+}
@@ -0,0 +1,164 @@
+/** @file
+ * Interfejs klienta serwera przekierowań numerów telefonu (tools/phfwd_server).
+ *
+ * Klient łączy się z serwerem przez gniazdo domeny uniksowej lub przez TCP na adresie lokalnym. Żądania można
+ * wysyłać potokowo: @ref phfwdClientSend tylko dopisuje żądanie do bufora, a @ref phfwdClientReceive odbiera
+ * kolejne odpowiedzi, w kolejności żądań. Funkcje takie jak @ref phfwdClientGet wysyłają jedno żądanie i czekają
+ * na odpowiedź. Jednego klienta może naraz używać tylko jeden wątek.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_CLIENT_H
+#define PHONE_FORWARD_CLIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "phone_forward.h"
+
+/**
+ * To jest połączenie z serwerem przekierowań.
+ */
+struct PhfwdClient;
+typedef struct PhfwdClient PhfwdClient; ///< @ref PhfwdClient
+
+/**
+ * To jest rodzaj żądania wysyłanego do serwera.
+ */
+typedef enum PhfwdRequest {
+    PHFWD_REQUEST_GET = 1,         ///< @ref phfwdGet
+    PHFWD_REQUEST_REVERSE = 2,     ///< @ref phfwdReverse
+    PHFWD_REQUEST_GET_REVERSE = 3, ///< @ref phfwdGetReverse
+    PHFWD_REQUEST_ADD = 4,         ///< @ref phfwdAdd
+    PHFWD_REQUEST_REMOVE = 5       ///< @ref phfwdRemove
+} PhfwdRequest;
+
+/** @brief Łączy się z serwerem przez gniazdo domeny uniksowej.
+ * @param[in] path – ścieżka gniazda serwera.
+ * @return Wskaźnik na połączenie lub NULL, gdy nie udało się połączyć lub
+ *         alokować pamięci.
+ */
+PhfwdClient *phfwdClientConnectUnix(char const *path);
+
+/** @brief Łączy się z serwerem przez TCP.
+ * @param[in] host – adres IPv4 serwera w postaci kropkowej, np. "127.0.0.1";
+ * @param[in] port – port serwera.
+ * @return Wskaźnik na połączenie lub NULL, gdy adres jest niepoprawny, nie
+ *         udało się połączyć lub alokować pamięci.
+ */
+PhfwdClient *phfwdClientConnectTcp(char const *host, uint16_t port);
+
+/** @brief Zamyka połączenie.
+ * Żądania, które nie zostały wysłane, są porzucane. Nic nie robi, jeśli
+ * wskaźnik ma wartość NULL.
+ * @param[in] client – wskaźnik na połączenie.
+ */
+void phfwdClientClose(PhfwdClient *client);
+
+/** @brief Dopisuje żądanie do bufora połączenia.
+ * Żądanie jest wysyłane, gdy bufor się zapełni, przy wywołaniu
+ * @ref phfwdClientFlush lub przed odebraniem odpowiedzi. Odpowiedzi, które
+ * przyjdą w trakcie wysyłania, czekają w buforze połączenia na odebranie.
+ * @param[in,out] client – wskaźnik na połączenie;
+ * @param[in] request    – rodzaj żądania;
+ * @param[in] num1       – numer, którego dotyczy żądanie;
+ * @param[in] num2       – dla @ref PHFWD_REQUEST_ADD numer, na który jest
+ *                         wykonywane przekierowanie, a dla pozostałych
+ *                         żądań NULL;
+ * @param[out] id        – wskaźnik, pod którym zostanie zapisany numer
+ *                         żądania, lub NULL.
+ * @return Wartość @p true, jeśli żądanie zostało dopisane.
+ *         Wartość @p false, jeśli któryś wskaźnik ma niepoprawną wartość,
+ *         żądanie jest za długie, nie udało się alokować pamięci lub wysłać
+ *         danych.
+ */
+bool phfwdClientSend(PhfwdClient *client, PhfwdRequest request, char const *num1, char const *num2, uint32_t *id);
+
+/** @brief Wysyła wszystkie żądania z bufora połączenia.
+ * Czekając na możliwość wysłania, odbiera do bufora połączenia odpowiedzi,
+ * które przysłał już serwer, więc dowolnie długi potok żądań nie blokuje
+ * połączenia.
+ * @param[in,out] client – wskaźnik na połączenie.
+ * @return Wartość @p true, jeśli żądania zostały wysłane.
+ *         Wartość @p false, jeśli @p client ma wartość NULL lub połączenie
+ *         zostało przerwane.
+ */
+bool phfwdClientFlush(PhfwdClient *client);
+
+/** @brief Odbiera odpowiedź na najstarsze żądanie.
+ * Najpierw wysyła żądania z bufora, a potem czeka na odpowiedź.
+ * @param[in,out] client – wskaźnik na połączenie;
+ * @param[out] id        – wskaźnik, pod którym zostanie zapisany numer
+ *                         żądania, lub NULL;
+ * @param[out] result    – wskaźnik, pod którym zostanie zapisany wynik
+ *                         @ref phfwdAdd lub @ref phfwdRemove, a dla zapytań
+ *                         wartość @p true, lub NULL;
+ * @param[out] numbers   – wskaźnik, pod którym zostanie zapisany wynik
+ *                         zapytania, który musi być zwolniony za pomocą
+ *                         funkcji @ref phnumDelete, a dla pozostałych żądań
+ *                         NULL, lub NULL, jeśli wynik nie jest potrzebny.
+ * @return Wartość @p true, jeśli odebrano odpowiedź.
+ *         Wartość @p false, jeśli @p client ma wartość NULL, serwer nie
+ *         wykonał żądania, połączenie zostało przerwane, odpowiedź jest
+ *         niepoprawna lub nie udało się alokować pamięci.
+ */
+bool phfwdClientReceive(PhfwdClient *client, uint32_t *id, bool *result, PhoneNumbers **numbers);
+
+/** @brief Wyznacza przekierowanie numeru na serwerze.
+ * Działa jak @ref phfwdGet dla przekierowań serwera.
+ * @param[in,out] client – wskaźnik na połączenie bez żądań czekających na
+ *                         odpowiedź;
+ * @param[in] num        – wskaźnik na napis reprezentujący numer.
+ * @return Wynik taki jak @ref phfwdGet lub NULL, gdy nie udało się wykonać
+ *         żądania.
+ */
+PhoneNumbers *phfwdClientGet(PhfwdClient *client, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer na serwerze.
+ * Działa jak @ref phfwdReverse dla przekierowań serwera.
+ * @param[in,out] client – wskaźnik na połączenie bez żądań czekających na
+ *                         odpowiedź;
+ * @param[in] num        – wskaźnik na napis reprezentujący numer.
+ * @return Wynik taki jak @ref phfwdReverse lub NULL, gdy nie udało się
+ *         wykonać żądania.
+ */
+PhoneNumbers *phfwdClientReverse(PhfwdClient *client, char const *num);
+
+/** @brief Wyznacza numery przekierowywane na dany numer na serwerze.
+ * Działa jak @ref phfwdGetReverse dla przekierowań serwera.
+ * @param[in,out] client – wskaźnik na połączenie bez żądań czekających na
+ *                         odpowiedź;
+ * @param[in] num        – wskaźnik na napis reprezentujący numer.
+ * @return Wynik taki jak @ref phfwdGetReverse lub NULL, gdy nie udało się
+ *         wykonać żądania.
+ */
+PhoneNumbers *phfwdClientGetReverse(PhfwdClient *client, char const *num);
+
+/** @brief Dodaje przekierowanie na serwerze.
+ * Działa jak @ref phfwdAdd dla przekierowań serwera.
+ * @param[in,out] client – wskaźnik na połączenie bez żądań czekających na
+ *                         odpowiedź;
+ * @param[in] num1       – wskaźnik na napis reprezentujący prefiks numerów
+ *                         przekierowywanych;
+ * @param[in] num2       – wskaźnik na napis reprezentujący prefiks numerów,
+ *                         na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli serwer zwrócił błąd lub nie udało się
+ *         wykonać żądania.
+ */
+bool phfwdClientAdd(PhfwdClient *client, char const *num1, char const *num2);
+
+/** @brief Usuwa przekierowania na serwerze.
+ * Działa jak @ref phfwdRemove dla przekierowań serwera.
+ * @param[in,out] client – wskaźnik na połączenie bez żądań czekających na
+ *                         odpowiedź;
+ * @param[in] num        – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli operacja została wykonana.
+ *         Wartość @p false, jeśli podany napis nie reprezentuje numeru lub
+ *         nie udało się wykonać żądania.
+ */
+bool phfwdClientRemove(PhfwdClient *client, char const *num);
+
+#endif //PHONE_FORWARD_CLIENT_H
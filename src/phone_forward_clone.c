@@ -0,0 +1,95 @@
+/** @file
+ * Implementacja współdzielenia drzew przez kopie struktury przechowującej przekierowania numerów telefonu.
+ *
+ * Kopie utworzone funkcją phfwdClone wskazują na te same drzewa i to samo konto. Każdy węzeł ma licznik odwołań,
+ * a węzeł z więcej niż jednym odwołaniem nie jest nigdy zmieniany. Modyfikacja kopiuje tylko węzły na zmienianej
+ * ścieżce, które są współdzielone, więc kosztuje tyle co sama ścieżka, a nie całe drzewo.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "phone_forward_clone.h"
+#include "trie.h"
+#include "memory_context.h"
+#include "phone_forward_query.h"
+#include "phone_forward_lookup.h"
+
+bool phfwdUnshare(PhoneForward *pf) {
+    PhoneForwardPrefixes *prefixes;
+    PhoneForwardReverse *reverse;
+    // Kopia drzew jest liczona na nowym koncie z limitem tej struktury.
+    MemoryAccount *account = accountNew(&(pf->allocator), pf->budget);
+
+    if (account == NULL)
+        return false;
+
+    if (!copyTries(account, pf->prefixes, pf->reverse, &prefixes, &reverse)) {
+        accountRelease(account);
+        return false;
+    }
+
+    phfwdReplaceTries(pf, account, prefixes, reverse);
+    return true;
+}
+
+bool phfwdDeduplicate(PhoneForward *pf) {
+    if (pf == NULL)
+        return false;
+
+    MemoryAccount *account = accountNew(&(pf->allocator), pf->budget);
+    if (account == NULL)
+        return false;
+
+    PhoneForwardPrefixes *prefixes;
+    PhoneForwardReverse *reverse;
+
+    if (!copyTriesShared(account, pf->prefixes, pf->reverse, &prefixes, &reverse)) {
+        accountRelease(account);
+        return false;
+    }
+
+    phfwdReplaceTries(pf, account, prefixes, reverse);
+    return true;
+}
+
+void phfwdReplaceTries(PhoneForward *pf, MemoryAccount *account, PhoneForwardPrefixes *prefixes,
+                       PhoneForwardReverse *reverse) {
+    releaseTries(&(pf->account->allocator), pf->prefixes, pf->reverse, pf->pending);
+    accountRelease(pf->account);
+
+    pf->account = account;
+    pf->prefixes = prefixes;
+    pf->reverse = reverse;
+    pf->pending = NULL;
+    // Wskaźniki do starych drzew, zapamiętane na przykład w tablicach z haszowaniem, tracą ważność.
+    phfwdTouch(pf);
+    lookupRebuild(pf);
+}
+
+PhoneForward *phfwdClone(PhoneForward *pf) {
+    if (pf == NULL)
+        return NULL;
+
+    PhoneForward *clone = (PhoneForward *) allocatorAlloc(&(pf->allocator), sizeof(PhoneForward));
+    if (clone == NULL)
+        return NULL;
+
+    atomic_fetch_add_explicit(&(pf->prefixes->references), 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&(pf->reverse->references), 1, memory_order_relaxed);
+    clone->prefixes = pf->prefixes;
+    clone->reverse = pf->reverse;
+    // Odłączone poddrzewa nie są już częścią drzew, więc usuwa je tylko struktura, która je odłączyła.
+    clone->pending = NULL;
+    clone->journal = NULL;
+    clone->lookup = NULL;
+    clone->version = pf->version;
+    clone->allocator = pf->allocator;
+    clone->account = accountRetain(pf->account);
+    clone->budget = pf->budget;
+    clone->samplePeriod = pf->samplePeriod;
+    return clone;
+}
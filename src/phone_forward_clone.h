@@ -0,0 +1,37 @@
+/** @file
+ * Interfejs współdzielenia drzew przez kopie struktury przechowującej przekierowania numerów telefonu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_CLONE_H
+#define PHONE_FORWARD_CLONE_H
+
+#include <stdbool.h>
+#include "phone_forward.h"
+#include "structures.h"
+
+/**
+ * Kopiuje drzewa struktury @p pf na nowe konto, tak że struktura nie współdzieli już żadnego węzła ani napisu
+ * z innymi kopiami. Pamięć kopii jest przydzielana w wątku wywołującym, co pozwala umieścić ją w pamięci
+ * lokalnej dla procesora, na którym ten wątek działa.
+ * @param pf - wskaźnik na strukturę.
+ * @return true - jeśli udało się skopiować drzewa.
+ *         false - jeśli nie powiodła się alokacja pamięci. Struktura się wtedy nie zmienia.
+ */
+bool phfwdUnshare(PhoneForward *pf);
+
+/**
+ * Zastępuje drzewa struktury @p pf kopią zaalokowaną na koncie @p account. Zwalniane są odwołania do starych
+ * drzew i starego konta, więc węzły i konto są usuwane, jeśli nie używa ich żadna inna kopia struktury.
+ * @param pf - wskaźnik na strukturę.
+ * @param account - konto nowych drzew.
+ * @param prefixes - korzeń nowego drzewa PhoneForwardPrefixes.
+ * @param reverse - korzeń nowego drzewa PhoneForwardReverse.
+ */
+void phfwdReplaceTries(PhoneForward *pf, struct MemoryAccount *account, PhoneForwardPrefixes *prefixes,
+                       PhoneForwardReverse *reverse);
+
+#endif //PHONE_FORWARD_CLONE_H
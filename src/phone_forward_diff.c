@@ -0,0 +1,92 @@
+/** @file
+ * Implementacja wyznaczania różnic między dwiema strukturami przechowującymi przekierowania numerów telefonu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "trie.h"
+#include "node_stack.h"
+
+/**
+ * Zwraca przekierowanie zapisane w węźle drzewa PhoneForwardPrefixes.
+ * @param node - węzeł drzewa lub NULL.
+ * @return - przekierowanie lub NULL, jeśli w węźle nie ma przekierowania.
+ */
+static char const *diversionOf(PhoneForwardPrefixes const *node) {
+    return (node == NULL) ? NULL : node->diversion;
+}
+
+/**
+ * Wstawia do stosu pary różnych dzieci węzłów @p oldNode i @p newNode, tak żeby były zdejmowane w kolejności
+ * znaków. Dziecko wspólne dla obu drzew ma w obu te same przekierowania w całym poddrzewie, więc jest pomijane.
+ * @param stack - wskaźnik na stos.
+ * @param oldNode - węzeł starego drzewa lub NULL.
+ * @param newNode - węzeł nowego drzewa.
+ * @param depth - głębokość węzłów.
+ * @return true - jeśli udało się wstawić dzieci do stosu.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool pushChildren(NodeStack *stack, PhoneForwardPrefixes *oldNode, PhoneForwardPrefixes *newNode,
+                         size_t depth) {
+    for (int i = SIGNS_IN_NUMBER - 1; i >= 0; i--) {
+        PhoneForwardPrefixes *oldChild = (oldNode == NULL) ? NULL : (oldNode->children)[i];
+        PhoneForwardPrefixes *newChild = (newNode->children)[i];
+
+        if (oldChild != newChild && !nodeStackPush(stack, oldChild, newChild, depth + 1, i))
+            return false;
+    }
+    return true;
+}
+
+bool phfwdDiff(PhoneForward const *oldPf, PhoneForward const *newPf, PhfwdDiffCallback callback, void *context) {
+    if (oldPf == NULL || newPf == NULL || callback == NULL)
+        return false;
+
+    NodeStack stack;
+    nodeStackInit(&stack, &(newPf->allocator));
+    char *path = NULL;
+    size_t pathSize = 0;
+    bool result = true;
+
+    // Drzewa kopii utworzonej przez phfwdClone, której ani oryginału nie zmieniono, są wspólne w całości.
+    if (oldPf->prefixes != newPf->prefixes)
+        result = pushChildren(&stack, oldPf->prefixes, newPf->prefixes, 0);
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardPrefixes *oldNode = frame.first;
+        PhoneForwardPrefixes *newNode = frame.second;
+
+        if (!pathSet(&path, &pathSize, frame.depth, frame.sign)) {
+            result = false;
+            continue;
+        }
+
+        // Każdy liść drzewa ma przekierowanie, więc poddrzewo, którego nie ma w nowym drzewie, ma co usuwać.
+        if (newNode == NULL) {
+            result = callback(context, PHFWD_OPERATION_REMOVE, path, NULL);
+            continue;
+        }
+
+        char const *oldDiversion = diversionOf(oldNode);
+        char const *newDiversion = diversionOf(newNode);
+
+        if (oldDiversion != NULL && newDiversion == NULL) {
+            result = callback(context, PHFWD_OPERATION_REMOVE_ONE, path, NULL);
+        } else if (newDiversion != NULL && oldDiversion != newDiversion &&
+                   (oldDiversion == NULL || strcmp(oldDiversion, newDiversion) != 0)) {
+            result = callback(context, PHFWD_OPERATION_ADD, path, newDiversion);
+        }
+
+        if (result)
+            result = pushChildren(&stack, oldNode, newNode, frame.depth);
+    }
+
+    nodeStackFree(&stack);
+    free(path);
+    return result;
+}
@@ -0,0 +1,156 @@
+/** @file
+ * Implementacja przeglądania przekierowań w porządku leksykograficznym prefiksów.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "trie.h"
+
+/**
+ * Początkowa liczba poziomów, na które jest miejsce w iteratorze.
+ */
+#define ITERATOR_DEPTH 32
+
+/**
+ * @struct IteratorFrame
+ * @brief IteratorFrame jest węzłem na ścieżce od korzenia przeglądanego poddrzewa do bieżącego węzła.
+ */
+struct IteratorFrame {
+    PhoneForwardPrefixes *node; ///< Węzeł drzewa PhoneForwardPrefixes.
+    int next; ///< Indeks kolejnego dziecka do odwiedzenia lub -1, jeśli sam węzeł nie był jeszcze odwiedzony.
+};
+typedef struct IteratorFrame IteratorFrame;
+
+/**
+ * @struct PhfwdIterator
+ * @brief PhfwdIterator przechowuje stan przeglądania przekierowań. Zajmuje pamięć proporcjonalną do długości
+ * najdłuższego prefiksu, a nie do liczby przekierowań.
+ */
+struct PhfwdIterator {
+    IteratorFrame *frames; ///< Stos węzłów na ścieżce do bieżącego węzła.
+    size_t count; ///< Liczba węzłów na stosie.
+    char *path; ///< Prefiks odpowiadający bieżącemu węzłowi.
+    size_t base; ///< Długość prefiksu, do którego ograniczone jest przeglądanie.
+    size_t size; ///< Liczba poziomów, na które jest miejsce w tablicach frames i path.
+    bool failed; ///< Czy przeglądanie zostało przerwane z powodu braku pamięci.
+};
+
+PhfwdIterator *phfwdIteratorNew(PhoneForward const *pf, char const *prefix) {
+    if (pf == NULL || pf->prefixes == NULL || (prefix != NULL && !isStringAPhoneNumber(prefix)))
+        return NULL;
+
+    PhfwdIterator *it = (PhfwdIterator *) malloc(sizeof(PhfwdIterator));
+    if (it == NULL)
+        return NULL;
+
+    it->base = (prefix == NULL) ? 0 : strlen(prefix);
+    it->size = ITERATOR_DEPTH;
+    it->count = 0;
+    it->failed = false;
+    it->frames = (IteratorFrame *) malloc(sizeof(IteratorFrame) * it->size);
+    it->path = (char *) malloc(sizeof(char) * (it->base + it->size + 1));
+
+    if (it->frames == NULL || it->path == NULL) {
+        phfwdIteratorDelete(it);
+        return NULL;
+    }
+
+    if (prefix != NULL)
+        memcpy(it->path, prefix, it->base);
+
+    PhoneForwardPrefixes *start = findPrefixesNode(pf->prefixes, it->path, it->base);
+
+    if (start != NULL) {
+        it->frames[0].node = start;
+        it->frames[0].next = -1;
+        it->count = 1;
+    }
+    return it;
+}
+
+/**
+ * Powiększa tablice iteratora, jeśli nie ma w nich miejsca na kolejny poziom.
+ * @param it - wskaźnik na iterator.
+ * @return true - jeśli jest miejsce na kolejny poziom.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool iteratorReserve(PhfwdIterator *it) {
+    if (it->count < it->size)
+        return true;
+
+    size_t newSize = 2 * it->size;
+    IteratorFrame *frames = (IteratorFrame *) realloc(it->frames, sizeof(IteratorFrame) * newSize);
+    if (frames == NULL)
+        return false;
+    it->frames = frames;
+
+    char *path = (char *) realloc(it->path, sizeof(char) * (it->base + newSize + 1));
+    if (path == NULL)
+        return false;
+    it->path = path;
+
+    it->size = newSize;
+    return true;
+}
+
+bool phfwdIteratorNext(PhfwdIterator *it, char const **num1, char const **num2) {
+    if (it == NULL || num1 == NULL || num2 == NULL)
+        return false;
+
+    while (it->count > 0) {
+        IteratorFrame *frame = &it->frames[it->count - 1];
+        PhoneForwardPrefixes *node = frame->node;
+
+        // Prefiks jest mniejszy od wszystkich swoich przedłużeń, więc węzeł jest zwracany przed dziećmi.
+        if (frame->next < 0) {
+            frame->next = 0;
+
+            if (node->diversion != NULL) {
+                it->path[it->base + it->count - 1] = '\0';
+                *num1 = it->path;
+                *num2 = node->diversion;
+                return true;
+            }
+        }
+
+        while (frame->next < SIGNS_IN_NUMBER && (node->children)[frame->next] == NULL)
+            frame->next++;
+
+        if (frame->next == SIGNS_IN_NUMBER) {
+            it->count--;
+            continue;
+        }
+
+        if (!iteratorReserve(it)) {
+            it->failed = true;
+            it->count = 0;
+            return false;
+        }
+
+        // Tablice mogły zostać przeniesione.
+        frame = &it->frames[it->count - 1];
+        it->path[it->base + it->count - 1] = numToChar(frame->next);
+        it->frames[it->count].node = (node->children)[frame->next];
+        it->frames[it->count].next = -1;
+        frame->next++;
+        it->count++;
+    }
+    return false;
+}
+
+bool phfwdIteratorFailed(PhfwdIterator const *it) {
+    return it != NULL && it->failed;
+}
+
+void phfwdIteratorDelete(PhfwdIterator *it) {
+    if (it == NULL)
+        return;
+
+    free(it->frames);
+    free(it->path);
+    free(it);
+}
@@ -0,0 +1,557 @@
+/** @file
+ * Implementacja dziennika operacji modyfikujących strukturę przechowującą przekierowania numerów telefonu.
+ *
+ * Dziennik jest plikiem, który zaczyna się od nagłówka JOURNAL_MAGIC, po którym następują kolejne wpisy.
+ * Wpis składa się z bajtu rodzaju operacji, długości numerów zapisanych jako liczby o zmiennej długości
+ * (po 7 bitów w bajcie) oraz cyfr obu numerów, zapisanych po dwie w bajcie.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "phone_forward_journal.h"
+#include "trie.h"
+#include "memory_context.h"
+
+/**
+ * Nagłówek pliku dziennika.
+ */
+#define JOURNAL_MAGIC "PHFJ"
+
+/**
+ * Długość nagłówka pliku dziennika.
+ */
+#define JOURNAL_MAGIC_LENGTH 4
+
+/**
+ * Domyślna liczba wpisów zapisywanych na dysk jednym wywołaniem fsync.
+ */
+#define JOURNAL_GROUP 64
+
+/**
+ * Liczba wpisów stosowanych do struktury jedną transakcją podczas odtwarzania dziennika.
+ */
+#define REPLAY_BATCH 4096
+
+/**
+ * Rozmiar bloku wczytywanego z pliku podczas odtwarzania dziennika.
+ */
+#define REPLAY_CHUNK 65536
+
+/**
+ * Wpis dodający przekierowanie.
+ */
+#define RECORD_ADD 1
+
+/**
+ * Wpis usuwający przekierowania.
+ */
+#define RECORD_REMOVE 2
+
+/**
+ * Wpis usuwający jedno przekierowanie.
+ */
+#define RECORD_REMOVE_ONE 3
+
+/**
+ * Wartość półbajtu dopełniającego numer o nieparzystej długości.
+ */
+#define NIBBLE_PADDING 0xF
+
+/**
+ * Największa liczba bajtów liczby w zapisie o zmiennej długości.
+ */
+#define VARINT_MAX_BYTES 10
+
+struct PhfwdJournal {
+    int fd; ///< Deskryptor pliku dziennika.
+    unsigned char *buffer; ///< Wpisy, które nie zostały jeszcze zapisane na dysk.
+    size_t length; ///< Liczba bajtów w buforze.
+    size_t size; ///< Rozmiar bufora.
+    size_t records; ///< Liczba wpisów w buforze.
+    size_t groupSize; ///< Liczba wpisów, po której bufor jest zapisywany na dysk.
+    bool failed; ///< Czy wystąpił błąd, przez który część wpisów została utracona.
+    PhfwdAllocator allocator; ///< Alokator struktury, do której należy dziennik.
+};
+
+/**
+ * Sprawdza, czy w buforze zmieści się jeszcze @p extra bajtów. Jeśli nie, to zwiększa bufor.
+ * @param journal - wskaźnik na dziennik.
+ * @param extra - liczba dopisywanych bajtów.
+ * @return true - jeśli bufor jest wystarczająco duży.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool bufferReserve(PhfwdJournal *journal, size_t extra) {
+    if (journal->length + extra <= journal->size)
+        return true;
+
+    size_t newSize = (journal->size == 0) ? 4096 : journal->size;
+    while (newSize < journal->length + extra)
+        newSize *= 2;
+
+    unsigned char *buffer = (unsigned char *) allocatorRealloc(&(journal->allocator), journal->buffer,
+                                                              journal->size, newSize);
+    if (buffer == NULL)
+        return false;
+
+    journal->buffer = buffer;
+    journal->size = newSize;
+    return true;
+}
+
+/**
+ * Dopisuje do bufora liczbę w zapisie o zmiennej długości.
+ * @param journal - wskaźnik na dziennik z wystarczająco dużym buforem.
+ * @param value - zapisywana liczba.
+ */
+static void putVarint(PhfwdJournal *journal, size_t value) {
+    while (value >= 0x80) {
+        (journal->buffer)[(journal->length)++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    (journal->buffer)[(journal->length)++] = (unsigned char) value;
+}
+
+/**
+ * Dopisuje do bufora cyfry numeru, po dwie w bajcie.
+ * @param journal - wskaźnik na dziennik z wystarczająco dużym buforem.
+ * @param num - numer telefonu.
+ * @param length - długość numeru.
+ */
+static void putNumber(PhfwdJournal *journal, char const *num, size_t length) {
+    for (size_t i = 0; i < length; i += 2) {
+        int high = charToNum(num[i]);
+        int low = (i + 1 < length) ? charToNum(num[i + 1]) : NIBBLE_PADDING;
+        (journal->buffer)[(journal->length)++] = (unsigned char) ((high << 4) | low);
+    }
+}
+
+/**
+ * Zapisuje cały bufor na dysk i wywołuje fsync. Wywołania przerwane przez sygnał są powtarzane. Po błędzie
+ * zapisu nie wiadomo, które wpisy są na dysku, więc dziennik przestaje przyjmować kolejne wpisy.
+ * @param journal - wskaźnik na dziennik.
+ * @return true - jeśli udało się zapisać wpisy.
+ *         false - jeśli wystąpił błąd zapisu teraz lub wcześniej.
+ */
+static bool journalFlush(PhfwdJournal *journal) {
+    size_t written = 0;
+
+    while (!journal->failed && written < journal->length) {
+        ssize_t result = write(journal->fd, journal->buffer + written, journal->length - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            journal->failed = true;
+        else
+            written += (size_t) result;
+    }
+
+    while (!journal->failed && fsync(journal->fd) != 0) {
+        if (errno != EINTR)
+            journal->failed = true;
+    }
+
+    journal->length = 0;
+    journal->records = 0;
+    return !journal->failed;
+}
+
+bool journalRecord(PhfwdJournal *journal, PhfwdOperation operation, char const *num1, char const *num2) {
+    if (journal == NULL)
+        return true;
+    if (journal->failed)
+        return false;
+
+    size_t length1 = strlen(num1);
+    size_t length2 = (num2 == NULL) ? 0 : strlen(num2);
+
+    // Bajt rodzaju, dwie liczby po co najwyżej 10 bajtów i cyfry obu numerów.
+    if (!bufferReserve(journal, 21 + (length1 + 1) / 2 + (length2 + 1) / 2))
+        return false;
+
+    unsigned char kind = RECORD_ADD;
+    if (operation == PHFWD_OPERATION_REMOVE)
+        kind = RECORD_REMOVE;
+    else if (operation == PHFWD_OPERATION_REMOVE_ONE)
+        kind = RECORD_REMOVE_ONE;
+
+    (journal->buffer)[(journal->length)++] = kind;
+    putVarint(journal, length1);
+    if (num2 != NULL)
+        putVarint(journal, length2);
+    putNumber(journal, num1, length1);
+    if (num2 != NULL)
+        putNumber(journal, num2, length2);
+    (journal->records)++;
+    return true;
+}
+
+JournalMark journalMark(PhfwdJournal const *journal) {
+    return (journal == NULL) ? (JournalMark) {0, 0} : (JournalMark) {journal->length, journal->records};
+}
+
+void journalRewind(PhfwdJournal *journal, JournalMark mark) {
+    // Po zapisie bufora na dysk nie ma już czego wycofywać.
+    if (journal != NULL && !journal->failed && mark.length <= journal->length) {
+        journal->length = mark.length;
+        journal->records = mark.records;
+    }
+}
+
+bool journalGroupCommit(PhfwdJournal *journal) {
+    if (journal == NULL)
+        return true;
+    if (journal->records >= journal->groupSize)
+        return journalFlush(journal);
+    return !journal->failed;
+}
+
+bool journalClose(PhfwdJournal *journal) {
+    if (journal == NULL)
+        return true;
+
+    bool result = journalFlush(journal);
+
+    if (close(journal->fd) != 0)
+        result = false;
+    PhfwdAllocator allocator = journal->allocator;
+    allocatorFree(&allocator, journal->buffer, journal->size);
+    allocatorFree(&allocator, journal, sizeof(PhfwdJournal));
+    return result;
+}
+
+/**
+ * Rodzaje wyników odczytu pojedynczego wpisu.
+ */
+enum ReplayStatus {
+    REPLAY_RECORD, ///< Odczytano wpis.
+    REPLAY_END, ///< Plik skończył się za ostatnim wpisem.
+    REPLAY_TORN, ///< Plik skończył się w połowie wpisu, np. po awarii w czasie zapisu.
+    REPLAY_ERROR ///< Wpis jest niepoprawny lub wystąpił błąd odczytu albo alokacji pamięci.
+};
+typedef enum ReplayStatus ReplayStatus;
+
+/**
+ * @struct ReplayReader
+ * @brief ReplayReader przechowuje stan odczytu pliku dziennika.
+ */
+struct ReplayReader {
+    int fd; ///< Deskryptor pliku dziennika.
+    unsigned char *buffer; ///< Wczytana, jeszcze nieodczytana część pliku.
+    size_t begin; ///< Indeks pierwszego nieodczytanego bajtu bufora.
+    size_t end; ///< Liczba wczytanych bajtów bufora.
+    size_t size; ///< Rozmiar bufora.
+    size_t consumed; ///< Liczba bajtów pliku przed pierwszym nieodczytanym bajtem bufora.
+    bool eof; ///< Czy wczytano już cały plik.
+    bool failed; ///< Czy wystąpił błąd odczytu lub alokacji pamięci.
+};
+typedef struct ReplayReader ReplayReader;
+
+/**
+ * Sprawia, że w buforze jest co najmniej @p needed nieodczytanych bajtów, o ile plik jest wystarczająco długi.
+ * @param reader - wskaźnik na stan odczytu.
+ * @param needed - liczba potrzebnych bajtów.
+ * @return true - jeśli w buforze jest @p needed bajtów.
+ *         false - jeśli plik się skończył, wystąpił błąd odczytu lub alokacji pamięci. Błąd jest zapamiętywany
+ *         w @p reader->failed.
+ */
+static bool readerFill(ReplayReader *reader, size_t needed) {
+    while (reader->end - reader->begin < needed && !reader->eof) {
+        if (reader->begin > 0) {
+            memmove(reader->buffer, reader->buffer + reader->begin, reader->end - reader->begin);
+            reader->end -= reader->begin;
+            reader->begin = 0;
+        }
+
+        if (reader->size - reader->end < REPLAY_CHUNK) {
+            size_t newSize = 2 * reader->size + REPLAY_CHUNK;
+            unsigned char *buffer = (newSize > reader->size) ? (unsigned char *) realloc(reader->buffer, newSize) : NULL;
+            if (buffer == NULL) {
+                reader->failed = true;
+                return false;
+            }
+            reader->buffer = buffer;
+            reader->size = newSize;
+        }
+
+        ssize_t result = read(reader->fd, reader->buffer + reader->end, reader->size - reader->end);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0)
+            reader->failed = true;
+        if (result <= 0)
+            reader->eof = true;
+        else
+            reader->end += (size_t) result;
+    }
+    return reader->end - reader->begin >= needed;
+}
+
+/**
+ * Odczytuje liczbę zapisaną w zapisie o zmiennej długości, zaczynającą się @p offset bajtów za początkiem wpisu.
+ * @param reader - wskaźnik na stan odczytu.
+ * @param offset - wskaźnik na przesunięcie względem początku wpisu, zwiększane o długość liczby.
+ * @param value - wskaźnik na zmienną, w której zostanie zapisana liczba.
+ * @return - REPLAY_RECORD, jeśli udało się odczytać liczbę, REPLAY_TORN, jeśli plik skończył się w jej trakcie,
+ *         a REPLAY_ERROR, jeśli liczba ma więcej niż VARINT_MAX_BYTES bajtów, nie mieści się w typie size_t lub
+ *         wystąpił błąd odczytu.
+ */
+static ReplayStatus readVarint(ReplayReader *reader, size_t *offset, size_t *value) {
+    *value = 0;
+
+    for (unsigned shift = 0; shift < 7 * VARINT_MAX_BYTES; shift += 7) {
+        if (!readerFill(reader, *offset + 1))
+            return reader->failed ? REPLAY_ERROR : REPLAY_TORN;
+
+        unsigned char byte = (reader->buffer)[reader->begin + (*offset)++];
+        size_t bits = byte & 0x7F;
+
+        if (bits != 0 && (shift >= sizeof(size_t) * 8 || bits > (SIZE_MAX >> shift)))
+            return REPLAY_ERROR;
+        if (bits != 0)
+            *value |= bits << shift;
+        if ((byte & 0x80) == 0)
+            return REPLAY_RECORD;
+    }
+    return REPLAY_ERROR;
+}
+
+/**
+ * Odczytuje cyfry numeru, zapisane po dwie w bajcie.
+ * @param bytes - zapisane cyfry.
+ * @param length - długość numeru.
+ * @param num - tablica, w której zostanie zapisany numer zakończony znakiem '\0'.
+ * @return true - jeśli numer jest poprawny.
+ *         false - w przeciwnym wypadku.
+ */
+static bool readNumber(unsigned char const *bytes, size_t length, char *num) {
+    for (size_t i = 0; i < length; i++) {
+        int value = (i % 2 == 0) ? (bytes[i / 2] >> 4) : (bytes[i / 2] & 0xF);
+        if (value >= SIGNS_IN_NUMBER)
+            return false;
+        num[i] = numToChar(value);
+    }
+    num[length] = '\0';
+    return true;
+}
+
+/**
+ * Odczytuje kolejny wpis dziennika i zapisuje go w transakcji.
+ * @param reader - wskaźnik na stan odczytu.
+ * @param tx - transakcja, w której zostanie zapisana operacja, lub NULL, jeśli wpis ma być tylko sprawdzony.
+ * @param num - wskaźnik na tablicę pomocniczą na numery.
+ * @param numSize - wskaźnik na rozmiar tablicy pomocniczej.
+ * @return - wynik odczytu.
+ */
+static ReplayStatus replayRecord(ReplayReader *reader, PhfwdTransaction *tx, char **num, size_t *numSize) {
+    size_t offset = 1;
+    size_t length1 = 0, length2 = 0;
+
+    if (!readerFill(reader, 1))
+        return reader->failed ? REPLAY_ERROR : REPLAY_END;
+
+    unsigned char kind = (reader->buffer)[reader->begin];
+    if (kind != RECORD_ADD && kind != RECORD_REMOVE && kind != RECORD_REMOVE_ONE)
+        return REPLAY_ERROR;
+
+    ReplayStatus status = readVarint(reader, &offset, &length1);
+    if (status == REPLAY_RECORD && kind == RECORD_ADD)
+        status = readVarint(reader, &offset, &length2);
+    if (status != REPLAY_RECORD)
+        return status;
+
+    // Długości z uszkodzonego wpisu mogłyby przepełnić poniższe sumy.
+    if (length1 > SIZE_MAX / 4 || length2 > SIZE_MAX / 4)
+        return REPLAY_ERROR;
+
+    size_t bytes1 = (length1 + 1) / 2;
+    size_t bytes2 = (length2 + 1) / 2;
+
+    if (!readerFill(reader, offset + bytes1 + bytes2))
+        return reader->failed ? REPLAY_ERROR : REPLAY_TORN;
+
+    if (length1 + length2 + 2 > *numSize) {
+        char *tmp = (char *) realloc(*num, length1 + length2 + 2);
+        if (tmp == NULL)
+            return REPLAY_ERROR;
+        *num = tmp;
+        *numSize = length1 + length2 + 2;
+    }
+
+    unsigned char const *bytes = reader->buffer + reader->begin + offset;
+    char *num1 = *num;
+    char *num2 = *num + length1 + 1;
+
+    if (!readNumber(bytes, length1, num1) || !readNumber(bytes + bytes1, length2, num2))
+        return REPLAY_ERROR;
+
+    reader->begin += offset + bytes1 + bytes2;
+    reader->consumed += offset + bytes1 + bytes2;
+
+    if (tx == NULL)
+        return REPLAY_RECORD;
+
+    bool staged;
+    if (kind == RECORD_ADD)
+        staged = phfwdTransactionAdd(tx, num1, num2);
+    else if (kind == RECORD_REMOVE)
+        staged = phfwdTransactionRemove(tx, num1);
+    else
+        staged = phfwdTransactionRemoveOne(tx, num1);
+    return staged ? REPLAY_RECORD : REPLAY_ERROR;
+}
+
+/**
+ * Zaczyna odczyt pliku dziennika od początku i sprawdza jego nagłówek.
+ * @param reader - wskaźnik na inicjalizowany stan odczytu.
+ * @param fd - deskryptor pliku dziennika.
+ * @return true - jeśli plik zaczyna się od nagłówka dziennika.
+ *         false - w przeciwnym wypadku.
+ */
+static bool readerStart(ReplayReader *reader, int fd) {
+    reader->fd = fd;
+    reader->buffer = NULL;
+    reader->begin = 0;
+    reader->end = 0;
+    reader->size = 0;
+    reader->consumed = 0;
+    reader->eof = false;
+    reader->failed = false;
+
+    if (!readerFill(reader, JOURNAL_MAGIC_LENGTH) || memcmp(reader->buffer, JOURNAL_MAGIC, JOURNAL_MAGIC_LENGTH) != 0)
+        return false;
+
+    reader->begin = JOURNAL_MAGIC_LENGTH;
+    reader->consumed = JOURNAL_MAGIC_LENGTH;
+    return true;
+}
+
+/**
+ * Sprawdza wszystkie wpisy dziennika i obcina plik za ostatnim kompletnym wpisem, żeby nowe wpisy nie były
+ * dopisywane za niedokończonym.
+ * @param fd - deskryptor pliku dziennika, ustawiony na jego początku.
+ * @return true - jeśli plik jest poprawnym dziennikiem, być może z obciętym niedokończonym ostatnim wpisem.
+ *         false - jeśli plik nie jest dziennikiem, któryś wpis jest uszkodzony lub wystąpił błąd.
+ */
+static bool journalRepair(int fd) {
+    ReplayReader reader;
+    char *num = NULL;
+    size_t numSize = 0;
+    ReplayStatus status = REPLAY_ERROR;
+
+    if (readerStart(&reader, fd)) {
+        while ((status = replayRecord(&reader, NULL, &num, &numSize)) == REPLAY_RECORD)
+            continue;
+    }
+
+    bool result = status == REPLAY_END ||
+                  (status == REPLAY_TORN && ftruncate(fd, (off_t) reader.consumed) == 0 && fsync(fd) == 0);
+    free(num);
+    free(reader.buffer);
+    return result;
+}
+
+bool phfwdJournalOpen(PhoneForward *pf, char const *path, size_t groupSize) {
+    if (pf == NULL || path == NULL || pf->journal != NULL)
+        return false;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    bool valid = fstat(fd, &st) == 0;
+
+    if (valid && st.st_size == 0)
+        valid = write(fd, JOURNAL_MAGIC, JOURNAL_MAGIC_LENGTH) == JOURNAL_MAGIC_LENGTH;
+    else if (valid)
+        valid = journalRepair(fd);
+
+    PhfwdJournal *journal = valid ? (PhfwdJournal *) allocatorAlloc(&(pf->allocator), sizeof(PhfwdJournal)) : NULL;
+    if (journal == NULL) {
+        close(fd);
+        return false;
+    }
+
+    journal->fd = fd;
+    journal->buffer = NULL;
+    journal->length = 0;
+    journal->size = 0;
+    journal->records = 0;
+    journal->groupSize = (groupSize == 0) ? JOURNAL_GROUP : groupSize;
+    journal->failed = false;
+    journal->allocator = pf->allocator;
+    pf->journal = journal;
+    return true;
+}
+
+bool phfwdJournalSync(PhoneForward *pf) {
+    if (pf == NULL || pf->journal == NULL)
+        return false;
+
+    return journalFlush(pf->journal);
+}
+
+bool phfwdJournalClose(PhoneForward *pf) {
+    if (pf == NULL || pf->journal == NULL)
+        return false;
+
+    bool result = journalClose(pf->journal);
+    pf->journal = NULL;
+    return result;
+}
+
+bool phfwdJournalReplay(PhoneForward *pf, char const *path) {
+    if (pf == NULL || path == NULL)
+        return false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    ReplayReader reader;
+    char *num = NULL;
+    size_t numSize = 0;
+    bool result = readerStart(&reader, fd);
+
+    // Odtwarzane operacje nie są ponownie zapisywane w dzienniku.
+    PhfwdJournal *journal = pf->journal;
+    pf->journal = NULL;
+
+    ReplayStatus status = REPLAY_RECORD;
+    while (result && status == REPLAY_RECORD) {
+        PhfwdTransaction *tx = phfwdTransactionBegin(pf);
+        if (tx == NULL) {
+            result = false;
+            break;
+        }
+
+        size_t staged = 0;
+        while (staged < REPLAY_BATCH && (status = replayRecord(&reader, tx, &num, &numSize)) == REPLAY_RECORD)
+            staged++;
+
+        // Wpisy przed niedokończonym są wykonywane, ale dziennik nie został odtworzony w całości.
+        if (status == REPLAY_ERROR) {
+            phfwdTransactionAbort(tx);
+            result = false;
+        } else {
+            result = phfwdTransactionCommit(tx) && status != REPLAY_TORN;
+        }
+    }
+
+    pf->journal = journal;
+    free(num);
+    free(reader.buffer);
+    close(fd);
+    return result;
+}
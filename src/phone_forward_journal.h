@@ -0,0 +1,75 @@
+/** @file
+ * Interfejs dziennika operacji modyfikujących strukturę przechowującą przekierowania numerów telefonu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_JOURNAL_H
+#define PHONE_FORWARD_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "phone_forward.h"
+
+/**
+ * @struct PhfwdJournal
+ * @brief PhfwdJournal jest dziennikiem, do którego dopisywane są udane operacje dodawania i usuwania przekierowań.
+ */
+struct PhfwdJournal;
+typedef struct PhfwdJournal PhfwdJournal;
+
+/**
+ * @struct JournalMark
+ * @brief JournalMark zapamiętuje koniec bufora dziennika, żeby można było wycofać dopisane za nim wpisy.
+ */
+struct JournalMark {
+    size_t length; ///< Liczba bajtów w buforze.
+    size_t records; ///< Liczba wpisów w buforze.
+};
+typedef struct JournalMark JournalMark;
+
+/**
+ * Dopisuje do dziennika operację. Wpisy są buforowane i zapisywane na dysk grupami. Operacja jest dopisywana
+ * przed zmianą struktury, więc jeśli się to nie uda, struktura nie może zostać zmieniona.
+ * @param journal - wskaźnik na dziennik lub NULL, jeśli struktura nie ma dziennika.
+ * @param operation - rodzaj operacji.
+ * @param num1 - prefiks numerów, których dotyczy operacja.
+ * @param num2 - przekierowanie prefiksu @p num1, jeśli operacja je dodaje, lub NULL.
+ * @return true - jeśli wpis został dopisany lub struktura nie ma dziennika.
+ *         false - jeśli nie powiodła się alokacja pamięci lub wcześniej wystąpił błąd zapisu.
+ */
+bool journalRecord(PhfwdJournal *journal, PhfwdOperation operation, char const *num1, char const *num2);
+
+/**
+ * Zapamiętuje koniec bufora dziennika.
+ * @param journal - wskaźnik na dziennik lub NULL.
+ * @return - położenie, do którego można wycofać wpisy funkcją journalRewind.
+ */
+JournalMark journalMark(PhfwdJournal const *journal);
+
+/**
+ * Wycofuje wpisy dopisane za zapamiętanym położeniem, jeśli nie zostały jeszcze zapisane na dysk.
+ * @param journal - wskaźnik na dziennik lub NULL.
+ * @param mark - położenie zwrócone przez journalMark.
+ */
+void journalRewind(PhfwdJournal *journal, JournalMark mark);
+
+/**
+ * Zapisuje na dysk zbuforowane wpisy, jeśli uzbierała się ich cała grupa.
+ * @param journal - wskaźnik na dziennik lub NULL, jeśli struktura nie ma dziennika.
+ * @return true - jeśli nie wystąpił błąd zapisu lub struktura nie ma dziennika.
+ *         false - jeśli wystąpił błąd zapisu, teraz lub wcześniej.
+ */
+bool journalGroupCommit(PhfwdJournal *journal);
+
+/**
+ * Zapisuje zbuforowane wpisy na dysk i zamyka dziennik.
+ * @param journal - wskaźnik na dziennik lub NULL.
+ * @return true - jeśli wszystkie wpisy zostały zapisane.
+ *         false - jeśli wystąpił błąd zapisu lub alokacji pamięci.
+ */
+bool journalClose(PhfwdJournal *journal);
+
+#endif //PHONE_FORWARD_JOURNAL_H
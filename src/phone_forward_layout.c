@@ -0,0 +1,108 @@
+/** @file
+ * Implementacja układania drzew w pamięci według częstości użycia węzłów.
+ *
+ * Zapytania co pewien czas zwiększają liczniki trafień węzłów, przez które przechodzą. Funkcja phfwdRelayout
+ * kopiuje drzewa do jednego bloku pamięci, najpierw węzły z trafieniami, w kolejności przeszukiwania w głąb
+ * od najczęściej używanego dziecka.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdatomic.h>
+#include "phone_forward_layout.h"
+#include "phone_forward_clone.h"
+#include "memory_context.h"
+#include "trie.h"
+
+/**
+ * Liczba zapytań wątku od ostatniej próbki.
+ */
+static _Thread_local unsigned sampleClock;
+
+/**
+ * Sprawdza, czy bieżące zapytanie wątku ma być próbką.
+ * @param pf - wskaźnik na strukturę z włączonym zliczaniem.
+ * @return true - jeśli zapytanie ma zwiększyć liczniki.
+ *         false - w przeciwnym przypadku.
+ */
+static bool sampleDue(PhoneForward const *pf) {
+    if (++sampleClock < pf->samplePeriod)
+        return false;
+
+    sampleClock = 0;
+    return true;
+}
+
+/**
+ * Zwiększa liczniki trafień węzłów drzewa PhoneForwardReverse na ścieżce numeru @p num.
+ * @param tree - korzeń drzewa.
+ * @param num - numer telefonu.
+ */
+static void countReversePath(PhoneForwardReverse *tree, char const *num) {
+    atomic_fetch_add_explicit(&(tree->hits), 1, memory_order_relaxed);
+
+    for (size_t idx = 0; num[idx] != '\0'; idx++) {
+        tree = (tree->children)[charToNum(num[idx])];
+        if (tree == NULL)
+            return;
+        atomic_fetch_add_explicit(&(tree->hits), 1, memory_order_relaxed);
+    }
+}
+
+void layoutSampleGet(PhoneForward const *pf, char const *num) {
+    if (!sampleDue(pf))
+        return;
+
+    PhoneForwardPrefixes *tree = pf->prefixes;
+    char const *diversion = NULL;
+    atomic_fetch_add_explicit(&(tree->hits), 1, memory_order_relaxed);
+
+    for (size_t idx = 0; num[idx] != '\0' && (tree->children)[charToNum(num[idx])] != NULL; idx++) {
+        tree = (tree->children)[charToNum(num[idx])];
+        atomic_fetch_add_explicit(&(tree->hits), 1, memory_order_relaxed);
+        if (tree->diversion != NULL)
+            diversion = tree->diversion;
+    }
+
+    // Wynik zapytania jest czytany z węzła drzewa PhoneForwardReverse, więc jego ścieżka też jest używana.
+    if (diversion != NULL)
+        countReversePath(pf->reverse, diversion);
+}
+
+void layoutSampleReverse(PhoneForward const *pf, char const *num) {
+    if (sampleDue(pf))
+        countReversePath(pf->reverse, num);
+}
+
+bool phfwdSetHitSampling(PhoneForward *pf, unsigned period) {
+    if (pf == NULL)
+        return false;
+
+    pf->samplePeriod = period;
+    return true;
+}
+
+bool phfwdRelayout(PhoneForward *pf) {
+    if (pf == NULL)
+        return false;
+
+    MemoryAccount *account = accountNew(&(pf->allocator), pf->budget);
+    if (account == NULL)
+        return false;
+
+    size_t size = 0;
+    PhoneForwardPrefixes *prefixes;
+    PhoneForwardReverse *reverse;
+
+    if (!triesSlabSize(&(pf->allocator), pf->prefixes, pf->reverse, &size) ||
+        !accountAddSlab(account, size) ||
+        !copyTriesByHits(account, pf->prefixes, pf->reverse, &prefixes, &reverse)) {
+        accountRelease(account);
+        return false;
+    }
+
+    phfwdReplaceTries(pf, account, prefixes, reverse);
+    return true;
+}
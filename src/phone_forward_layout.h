@@ -0,0 +1,31 @@
+/** @file
+ * Interfejs zliczania trafień w węzłach drzew, używanego do ich układania w pamięci.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_LAYOUT_H
+#define PHONE_FORWARD_LAYOUT_H
+
+#include "phone_forward.h"
+#include "structures.h"
+
+/**
+ * Jeśli wypada kolej wątku na próbkę, zwiększa liczniki trafień węzłów drzewa PhoneForwardPrefixes na ścieżce
+ * numeru @p num oraz węzłów drzewa PhoneForwardReverse na ścieżce znalezionego przekierowania.
+ * @param pf - wskaźnik na strukturę z włączonym zliczaniem.
+ * @param num - poprawny numer telefonu.
+ */
+void layoutSampleGet(PhoneForward const *pf, char const *num);
+
+/**
+ * Jeśli wypada kolej wątku na próbkę, zwiększa liczniki trafień węzłów drzewa PhoneForwardReverse na ścieżce
+ * numeru @p num.
+ * @param pf - wskaźnik na strukturę z włączonym zliczaniem.
+ * @param num - poprawny numer telefonu.
+ */
+void layoutSampleReverse(PhoneForward const *pf, char const *num);
+
+#endif //PHONE_FORWARD_LAYOUT_H
@@ -0,0 +1,595 @@
+/** @file
+ * Implementacja wyszukiwania najdłuższego przekierowywanego prefiksu numeru w tablicach z haszowaniem.
+ *
+ * Prefiks długości co najwyżej LOOKUP_MAX_LENGTH jest zapisywany jako 64-bitowa liczba, po 4 bity na znak.
+ * Dla każdej długości prefiksu jest osobna tablica z haszowaniem. Długości występujące w przekierowaniach są
+ * przeszukiwane binarnie: jeśli w tablicy danej długości jest prefiks numeru, to szukanie jest kontynuowane
+ * wśród dłuższych prefiksów, a w przeciwnym przypadku wśród krótszych. Żeby to działało, w tablicach na drodze
+ * do każdego przekierowania są znaczniki. Znacznik pamięta najdłuższy krótszy od siebie przekierowywany prefiks,
+ * więc zejście na fałszywym znaczniku nie wymaga cofania się.
+ *
+ * Dodanie i usunięcie przekierowania uaktualnia tablice: zmienia liczniki odwołań prefiksu i jego znaczników,
+ * a potem poprawia najdłuższe przekierowywane prefiksy zapisane w poddrzewie zmienionego prefiksu. Tablice są
+ * tworzone od nowa tylko wtedy, gdy pojawia się przekierowanie prefiksu nowej długości, bo to zmienia położenie
+ * wszystkich znaczników, oraz po wymianie całych drzew.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "memory_context.h"
+#include "trie.h"
+#include "phone_forward_lookup.h"
+#include "phone_forward_layout.h"
+
+/**
+ * Największa długość prefiksu, która mieści się w 64-bitowej liczbie.
+ */
+#define LOOKUP_MAX_LENGTH 16
+
+/**
+ * Liczba bitów przypadających na jeden znak prefiksu.
+ */
+#define SIGN_BITS 4
+
+/**
+ * @struct LookupEntry
+ * @brief LookupEntry jest prefiksem zapisanym w tablicy z haszowaniem: przekierowywanym prefiksem lub znacznikiem.
+ */
+struct LookupEntry {
+    uint64_t key; ///< Prefiks zapisany jako liczba.
+    char const *diversion; ///< Przekierowanie najdłuższego przekierowywanego prefiksu, który jest prefiksem
+    ///< @p key (także równym), lub NULL, jeśli takiego nie ma.
+    uint8_t length; ///< Długość prefiksu, którego przekierowaniem jest @p diversion.
+    bool rule; ///< Czy prefiks @p key jest przekierowywany.
+    uint32_t refs; ///< Liczba przekierowań, dla których prefiks jest w tablicy: jego własnego i tych, dla których
+    ///< jest znacznikiem. Miejsce w tablicy jest wolne, jeśli licznik jest zerem.
+};
+typedef struct LookupEntry LookupEntry;
+
+/**
+ * @struct LookupTable
+ * @brief LookupTable jest tablicą z haszowaniem prefiksów jednej długości.
+ */
+struct LookupTable {
+    LookupEntry *entries; ///< Tablica prefiksów lub NULL, jeśli żaden prefiks nie ma tej długości.
+    unsigned shift; ///< Przesunięcie skrótu, 64 minus logarytm z rozmiaru tablicy.
+    size_t used; ///< Liczba zajętych miejsc.
+};
+typedef struct LookupTable LookupTable;
+
+/**
+ * @struct PhfwdLookup
+ * @brief PhfwdLookup przechowuje tablice z haszowaniem wszystkich przekierowań jednej wersji struktury.
+ */
+struct PhfwdLookup {
+    uint64_t version; ///< Wersja struktury, z której utworzono tablice.
+    LookupTable tables[LOOKUP_MAX_LENGTH + 1]; ///< Tablice prefiksów kolejnych długości.
+    uint8_t lengths[LOOKUP_MAX_LENGTH]; ///< Rosnący ciąg długości prefiksów, które są przekierowywane. Usunięcie
+    ///< ostatniego przekierowania danej długości nie usuwa jej z ciągu.
+    size_t lengthCount; ///< Liczba elementów ciągu lengths.
+    uint32_t markers[LOOKUP_MAX_LENGTH + 1]; ///< Zbiór długości, w których prefiks danej długości ma znaczniki.
+    bool hasLonger; ///< Czy są przekierowania prefiksów dłuższych niż LOOKUP_MAX_LENGTH.
+};
+typedef struct PhfwdLookup PhfwdLookup;
+
+/**
+ * @struct LookupBuild
+ * @brief LookupBuild przechowuje stan tworzenia tablic.
+ */
+struct LookupBuild {
+    PhfwdLookup *lookup; ///< Tworzone tablice.
+    size_t counts[LOOKUP_MAX_LENGTH + 1]; ///< Liczba przekierowywanych prefiksów każdej długości.
+    uint64_t keys[LOOKUP_MAX_LENGTH + 1]; ///< Kolejne prefiksy bieżącego prefiksu zapisane jako liczby.
+    char const *best[LOOKUP_MAX_LENGTH + 1]; ///< Przekierowanie najdłuższego przekierowywanego prefiksu
+    ///< nie dłuższego niż indeks, na drodze do bieżącego prefiksu.
+    uint8_t bestLength[LOOKUP_MAX_LENGTH + 1]; ///< Długości prefiksów, których przekierowania są w best.
+};
+typedef struct LookupBuild LookupBuild;
+
+/**
+ * Liczy skrót prefiksu zapisanego jako liczba.
+ * @param table - tablica, w której prefiks jest szukany.
+ * @param key - prefiks zapisany jako liczba.
+ * @return - indeks w tablicy, od którego zaczyna się szukanie.
+ */
+static size_t tableIndex(LookupTable const *table, uint64_t key) {
+    return (size_t) ((key * 0x9E3779B97F4A7C15u) >> table->shift);
+}
+
+/**
+ * Szuka prefiksu w tablicy.
+ * @param table - tablica prefiksów jednej długości.
+ * @param key - prefiks zapisany jako liczba.
+ * @return - wskaźnik na miejsce zajęte przez prefiks lub na wolne miejsce, w którym powinien się znaleźć.
+ */
+static LookupEntry *tableFind(LookupTable const *table, uint64_t key) {
+    size_t mask = ((size_t) 1 << (64 - table->shift)) - 1;
+    size_t idx = tableIndex(table, key);
+
+    while (table->entries[idx].refs != 0 && table->entries[idx].key != key)
+        idx = (idx + 1) & mask;
+
+    return &table->entries[idx];
+}
+
+/**
+ * Przydziela wyzerowaną tablicę o podanym rozmiarze.
+ * @param allocator - alokator tablic.
+ * @param table - tablica, której miejsca są przydzielane.
+ * @param capacity - liczba miejsc, potęga dwójki nie mniejsza niż 2.
+ * @return true - jeśli udało się przydzielić pamięć.
+ *         false - jeśli nie powiodła się alokacja pamięci. Wtedy tablica się nie zmienia.
+ */
+static bool tableAlloc(PhfwdAllocator const *allocator, LookupTable *table, size_t capacity) {
+    LookupEntry *entries = (LookupEntry *) allocatorAlloc(allocator, sizeof(LookupEntry) * capacity);
+    if (entries == NULL)
+        return false;
+    memset(entries, 0, sizeof(LookupEntry) * capacity);
+
+    unsigned shift = 64;
+    for (size_t c = capacity; c > 1; c /= 2)
+        shift--;
+
+    table->entries = entries;
+    table->shift = shift;
+    table->used = 0;
+    return true;
+}
+
+/**
+ * Zapewnia w tablicy miejsce na jeszcze jeden prefiks, podwajając ją, jeśli byłaby zajęta w więcej niż połowie.
+ * @param allocator - alokator tablic.
+ * @param table - tablica prefiksów jednej długości.
+ * @return true - jeśli w tablicy jest miejsce.
+ *         false - jeśli nie powiodła się alokacja pamięci. Wtedy tablica się nie zmienia.
+ */
+static bool tableReserve(PhfwdAllocator const *allocator, LookupTable *table) {
+    size_t capacity = (size_t) 1 << (64 - table->shift);
+    if (2 * (table->used + 1) <= capacity)
+        return true;
+
+    LookupTable grown;
+    if (!tableAlloc(allocator, &grown, 2 * capacity))
+        return false;
+
+    for (size_t i = 0; i < capacity; i++) {
+        if (table->entries[i].refs != 0)
+            *tableFind(&grown, table->entries[i].key) = table->entries[i];
+    }
+    grown.used = table->used;
+    allocatorFree(allocator, table->entries, sizeof(LookupEntry) * capacity);
+    *table = grown;
+    return true;
+}
+
+/**
+ * Zwiększa licznik odwołań prefiksu w tablicy, wstawiając go, jeśli go w niej nie ma. W tablicy musi być miejsce.
+ * @param table - tablica prefiksów jednej długości.
+ * @param key - prefiks zapisany jako liczba.
+ * @return - wskaźnik na miejsce zajęte przez prefiks.
+ */
+static LookupEntry *tableRetain(LookupTable *table, uint64_t key) {
+    LookupEntry *entry = tableFind(table, key);
+
+    if (entry->refs == 0) {
+        *entry = (LookupEntry) {.key = key, .diversion = NULL, .length = 0, .rule = false, .refs = 0};
+        table->used++;
+    }
+    entry->refs++;
+    return entry;
+}
+
+/**
+ * Zmniejsza licznik odwołań prefiksu w tablicy i usuwa go z niej, jeśli licznik spadł do zera. Dalsze prefiksy
+ * z tego samego ciągu zajętych miejsc są przesuwane tak, żeby tableFind nadal je znajdowała.
+ * @param table - tablica prefiksów jednej długości.
+ * @param key - prefiks zapisany jako liczba, który jest w tablicy.
+ */
+static void tableRelease(LookupTable *table, uint64_t key) {
+    size_t mask = ((size_t) 1 << (64 - table->shift)) - 1;
+    LookupEntry *entry = tableFind(table, key);
+
+    if (entry->refs == 0 || --(entry->refs) != 0)
+        return;
+
+    size_t hole = (size_t) (entry - table->entries);
+    size_t idx = hole;
+    while (table->entries[idx = (idx + 1) & mask].refs != 0) {
+        size_t home = tableIndex(table, table->entries[idx].key);
+
+        // Prefiks może zająć dziurę, jeśli leży ona między jego miejscem docelowym a obecnym.
+        if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+            table->entries[hole] = table->entries[idx];
+            hole = idx;
+        }
+    }
+    table->entries[hole].refs = 0;
+    table->used--;
+}
+
+/**
+ * Zapisuje prefiks numeru jako liczbę, razem ze wszystkimi jego prefiksami.
+ * @param num - numer telefonu.
+ * @param keys - tablica, w której pod indeksem i zostanie zapisany prefiks długości i.
+ * @return - długość numeru, ale nie większa niż LOOKUP_MAX_LENGTH.
+ */
+static size_t numKeys(char const *num, uint64_t *keys) {
+    size_t length = 0;
+    keys[0] = 0;
+
+    while (length < LOOKUP_MAX_LENGTH && num[length] != '\0') {
+        keys[length + 1] = (keys[length] << SIGN_BITS) | (uint64_t) charToNum(num[length]);
+        length++;
+    }
+    return length;
+}
+
+/**
+ * Liczy przekierowywane prefiksy każdej długości w poddrzewie.
+ * @param build - wskaźnik na stan tworzenia tablic.
+ * @param node - węzeł drzewa PhoneForwardPrefixes.
+ * @param depth - długość prefiksu odpowiadającego węzłowi.
+ */
+static void countRules(LookupBuild *build, PhoneForwardPrefixes const *node, size_t depth) {
+    if (node->diversion != NULL)
+        build->counts[depth]++;
+
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        if ((node->children)[i] == NULL)
+            continue;
+
+        if (depth == LOOKUP_MAX_LENGTH)
+            build->lookup->hasLonger = true;
+        else
+            countRules(build, (node->children)[i], depth + 1);
+    }
+}
+
+/**
+ * Wstawia do tablic przekierowywane prefiksy z poddrzewa i ich znaczniki.
+ * @param build - wskaźnik na stan tworzenia tablic.
+ * @param node - węzeł drzewa PhoneForwardPrefixes.
+ * @param depth - długość prefiksu odpowiadającego węzłowi.
+ */
+static void insertRules(LookupBuild *build, PhoneForwardPrefixes const *node, size_t depth) {
+    PhfwdLookup *lookup = build->lookup;
+
+    build->best[depth] = (depth == 0) ? NULL : build->best[depth - 1];
+    build->bestLength[depth] = (depth == 0) ? 0 : build->bestLength[depth - 1];
+
+    // Węzeł jest odwiedzany przed swoim poddrzewem, więc znaczniki poddrzewa dostają już jego przekierowanie.
+    if (node->diversion != NULL) {
+        build->best[depth] = node->diversion;
+        build->bestLength[depth] = (uint8_t) depth;
+
+        for (size_t m = 1; m <= depth; m++) {
+            if (m == depth || (lookup->markers[depth] & (1u << m))) {
+                LookupEntry *entry = tableRetain(&lookup->tables[m], build->keys[m]);
+                entry->rule = entry->rule || m == depth;
+                entry->diversion = build->best[m];
+                entry->length = build->bestLength[m];
+            }
+        }
+    }
+
+    for (int i = 0; i < SIGNS_IN_NUMBER && depth < LOOKUP_MAX_LENGTH; i++) {
+        if ((node->children)[i] != NULL) {
+            build->keys[depth + 1] = (build->keys[depth] << SIGN_BITS) | (uint64_t) i;
+            insertRules(build, (node->children)[i], depth + 1);
+        }
+    }
+}
+
+/**
+ * Wyznacza długości, w których prefiks długości @p length potrzebuje znaczników: te, po których przeszukiwanie
+ * binarne musi pójść w stronę dłuższych prefiksów, żeby do niego dojść.
+ * @param lookup - wskaźnik na tablice z wypełnionym ciągiem długości.
+ * @param length - długość przekierowywanego prefiksu.
+ * @return - zbiór długości zapisany jako maska bitowa.
+ */
+static uint32_t markerLengths(PhfwdLookup const *lookup, size_t length) {
+    uint32_t result = 0;
+    size_t low = 0;
+    size_t high = lookup->lengthCount;
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+
+        if (lookup->lengths[mid] == length)
+            break;
+
+        if (lookup->lengths[mid] < length) {
+            result |= 1u << lookup->lengths[mid];
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return result;
+}
+
+void lookupDelete(PhfwdAllocator const *allocator, PhfwdLookup *lookup) {
+    if (lookup == NULL)
+        return;
+
+    for (size_t i = 0; i <= LOOKUP_MAX_LENGTH; i++) {
+        LookupTable *table = &lookup->tables[i];
+        if (table->entries != NULL)
+            allocatorFree(allocator, table->entries, sizeof(LookupEntry) * ((size_t) 1 << (64 - table->shift)));
+    }
+    allocatorFree(allocator, lookup, sizeof(PhfwdLookup));
+}
+
+/**
+ * Tworzy tablice z haszowaniem zawierające wszystkie przekierowania struktury @p pf w jej bieżącej wersji.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @return - wskaźnik na utworzone tablice lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+static PhfwdLookup *lookupNew(PhoneForward const *pf) {
+    PhfwdLookup *lookup = (PhfwdLookup *) allocatorAlloc(&(pf->allocator), sizeof(PhfwdLookup));
+    if (lookup == NULL)
+        return NULL;
+    memset(lookup, 0, sizeof(PhfwdLookup));
+
+    LookupBuild build = {.lookup = lookup};
+    lookup->version = pf->version;
+    countRules(&build, pf->prefixes, 0);
+
+    for (size_t length = 1; length <= LOOKUP_MAX_LENGTH; length++) {
+        if (build.counts[length] > 0)
+            lookup->lengths[lookup->lengthCount++] = (uint8_t) length;
+    }
+
+    // Górne ograniczenie liczby prefiksów i znaczników każdej długości.
+    size_t sizes[LOOKUP_MAX_LENGTH + 1];
+    for (size_t length = 0; length <= LOOKUP_MAX_LENGTH; length++)
+        sizes[length] = build.counts[length];
+
+    for (size_t length = 1; length <= LOOKUP_MAX_LENGTH; length++) {
+        lookup->markers[length] = markerLengths(lookup, length);
+
+        for (size_t m = 1; m < length; m++) {
+            if (lookup->markers[length] & (1u << m))
+                sizes[m] += build.counts[length];
+        }
+    }
+
+    for (size_t i = 0; i < lookup->lengthCount; i++) {
+        size_t capacity = 2;
+        while (capacity < 2 * sizes[lookup->lengths[i]])
+            capacity *= 2;
+
+        if (!tableAlloc(&(pf->allocator), &lookup->tables[lookup->lengths[i]], capacity)) {
+            lookupDelete(&(pf->allocator), lookup);
+            return NULL;
+        }
+    }
+
+    insertRules(&build, pf->prefixes, 0);
+    return lookup;
+}
+
+bool phfwdSetLookupEngine(PhoneForward *pf, PhfwdLookupEngine engine) {
+    if (pf == NULL)
+        return false;
+
+    PhfwdLookup *lookup = NULL;
+
+    if (engine == PHFWD_LOOKUP_HASH && (lookup = lookupNew(pf)) == NULL)
+        return false;
+
+    lookupDelete(&(pf->allocator), pf->lookup);
+    pf->lookup = lookup;
+    return true;
+}
+
+/**
+ * Oznacza tablice jako nieaktualne. Wersja 0 nie jest nadawana żadnej strukturze, więc tablice zostaną
+ * utworzone od nowa przy uaktualnianiu ich po modyfikacji.
+ * @param lookup - wskaźnik na tablice.
+ */
+static void lookupInvalidate(PhfwdLookup *lookup) {
+    lookup->version = 0;
+}
+
+/**
+ * Zapisuje najdłuższe przekierowywane prefiksy w prefiksach poddrzewa węzła, który odpowiada zmienionemu
+ * prefiksowi. Nie schodzi poniżej głębszych przekierowywanych prefiksów, bo ich poddrzew zmiana nie dotyczy.
+ * @param lookup - wskaźnik na tablice.
+ * @param node - węzeł drzewa PhoneForwardPrefixes.
+ * @param depth - długość prefiksu odpowiadającego węzłowi.
+ * @param key - prefiks odpowiadający węzłowi zapisany jako liczba.
+ * @param diversion - przekierowanie najdłuższego przekierowywanego prefiksu krótszego niż @p depth lub NULL.
+ * @param length - długość prefiksu, którego przekierowaniem jest @p diversion.
+ * @param top - czy węzeł odpowiada zmienionemu prefiksowi.
+ */
+static void refreshBest(PhfwdLookup *lookup, PhoneForwardPrefixes const *node, size_t depth, uint64_t key,
+                        char const *diversion, uint8_t length, bool top) {
+    if (node->diversion != NULL) {
+        if (!top)
+            return;
+        diversion = node->diversion;
+        length = (uint8_t) depth;
+    }
+
+    if (lookup->tables[depth].entries != NULL) {
+        LookupEntry *entry = tableFind(&lookup->tables[depth], key);
+        if (entry->refs != 0) {
+            entry->diversion = diversion;
+            entry->length = length;
+        }
+    }
+
+    for (int i = 0; i < SIGNS_IN_NUMBER && depth < LOOKUP_MAX_LENGTH; i++) {
+        if ((node->children)[i] != NULL)
+            refreshBest(lookup, (node->children)[i], depth + 1, (key << SIGN_BITS) | (uint64_t) i, diversion, length,
+                        false);
+    }
+}
+
+void lookupAddRule(PhoneForward *pf, char const *num) {
+    PhfwdLookup *lookup = pf->lookup;
+    if (lookup == NULL || lookup->version != pf->version)
+        return;
+
+    uint64_t keys[LOOKUP_MAX_LENGTH + 1];
+    size_t length = numKeys(num, keys);
+
+    if (num[length] != '\0') {
+        lookup->hasLonger = true;
+        return;
+    }
+
+    // Prefiks nowej długości zmienia ciąg długości, a razem z nim położenie wszystkich znaczników.
+    if (lookup->tables[length].entries == NULL) {
+        lookupInvalidate(lookup);
+        return;
+    }
+
+    LookupEntry const *entry = tableFind(&lookup->tables[length], keys[length]);
+    if (entry->refs != 0 && entry->rule)
+        return;
+
+    uint32_t lengths = lookup->markers[length] | (1u << length);
+    for (size_t m = 1; m <= length; m++) {
+        if ((lengths & (1u << m)) && !tableReserve(&(pf->allocator), &lookup->tables[m])) {
+            lookupInvalidate(lookup);
+            return;
+        }
+    }
+
+    // Najdłuższe przekierowywane prefiksy krótszych znaczników nie zależą od dodawanego przekierowania.
+    PhoneForwardPrefixes const *node = pf->prefixes;
+    char const *diversion = NULL;
+    uint8_t bestLength = 0;
+
+    for (size_t m = 1; m <= length; m++) {
+        node = (node == NULL) ? NULL : (node->children)[charToNum(num[m - 1])];
+        if (node != NULL && node->diversion != NULL && m < length) {
+            diversion = node->diversion;
+            bestLength = (uint8_t) m;
+        }
+
+        if (lengths & (1u << m)) {
+            LookupEntry *retained = tableRetain(&lookup->tables[m], keys[m]);
+            if (retained->refs == 1) {
+                retained->diversion = diversion;
+                retained->length = bestLength;
+            }
+            retained->rule = retained->rule || m == length;
+        }
+    }
+}
+
+void lookupRemoveRules(PhoneForward *pf, PhfwdRemovalRule const *rules, size_t count) {
+    PhfwdLookup *lookup = pf->lookup;
+    if (lookup == NULL || lookup->version != pf->version)
+        return;
+
+    uint64_t keys[LOOKUP_MAX_LENGTH + 1];
+
+    for (size_t i = 0; i < count; i++) {
+        size_t length = numKeys(rules[i].num, keys);
+        if (rules[i].num[length] != '\0' || lookup->tables[length].entries == NULL)
+            continue;
+
+        tableFind(&lookup->tables[length], keys[length])->rule = false;
+
+        uint32_t lengths = lookup->markers[length] | (1u << length);
+        for (size_t m = 1; m <= length; m++) {
+            if (lengths & (1u << m))
+                tableRelease(&lookup->tables[m], keys[m]);
+        }
+    }
+}
+
+void lookupRebuild(PhoneForward *pf) {
+    if (pf->lookup == NULL || pf->lookup->version == pf->version)
+        return;
+
+    // Jeśli zabrakło pamięci, zostają nieaktualne tablice, więc prefiksy są wyszukiwane w drzewie do kolejnej próby.
+    PhfwdLookup *lookup = lookupNew(pf);
+    if (lookup != NULL) {
+        lookupDelete(&(pf->allocator), pf->lookup);
+        pf->lookup = lookup;
+    }
+}
+
+void lookupUpdate(PhoneForward *pf, uint64_t version, char const *num) {
+    PhfwdLookup *lookup = pf->lookup;
+    if (lookup == NULL)
+        return;
+
+    if (lookup->version != version) {
+        lookupRebuild(pf);
+        return;
+    }
+
+    uint64_t keys[LOOKUP_MAX_LENGTH + 1];
+    size_t length = numKeys(num, keys);
+    PhoneForwardPrefixes const *node = pf->prefixes;
+    char const *diversion = NULL;
+    uint8_t bestLength = 0;
+
+    for (size_t depth = 0; depth < length && node != NULL; depth++) {
+        if (node->diversion != NULL) {
+            diversion = node->diversion;
+            bestLength = (uint8_t) depth;
+        }
+        node = (node->children)[charToNum(num[depth])];
+    }
+
+    // Prefiksy dłuższe niż LOOKUP_MAX_LENGTH nie są w tablicach, a usuniętego poddrzewa nie ma już w drzewie.
+    if (num[length] == '\0' && node != NULL)
+        refreshBest(lookup, node, length, keys[length], diversion, bestLength, true);
+    lookup->version = pf->version;
+}
+
+char const *phfwdFindPrefix(PhoneForward const *pf, char const *num, size_t *length) {
+    PhfwdLookup const *lookup = pf->lookup;
+
+    if (pf->samplePeriod != 0)
+        layoutSampleGet(pf, num);
+
+    // Tablice, których nie udało się uaktualnić po ostatniej modyfikacji struktury, nie są używane.
+    if (lookup == NULL || lookup->version != pf->version)
+        return findOnePrefix(pf->prefixes, num, length);
+
+    uint64_t keys[LOOKUP_MAX_LENGTH + 1];
+    size_t numLength = numKeys(num, keys);
+
+    if (num[numLength] != '\0' && lookup->hasLonger)
+        return findOnePrefix(pf->prefixes, num, length);
+
+    char const *diversion = NULL;
+    size_t low = 0;
+    size_t high = lookup->lengthCount;
+    *length = 0;
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        size_t prefixLength = lookup->lengths[mid];
+
+        if (prefixLength > numLength) {
+            high = mid;
+            continue;
+        }
+
+        LookupEntry const *entry = tableFind(&lookup->tables[prefixLength], keys[prefixLength]);
+
+        if (entry->refs != 0) {
+            if (entry->diversion != NULL) {
+                diversion = entry->diversion;
+                *length = entry->length;
+            }
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return diversion;
+}
@@ -0,0 +1,68 @@
+/** @file
+ * Interfejs wyszukiwania najdłuższego przekierowywanego prefiksu numeru w tablicach z haszowaniem.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_LOOKUP_H
+#define PHONE_FORWARD_LOOKUP_H
+
+#include "phone_forward.h"
+#include "structures.h"
+#include "trie.h"
+
+/**
+ * Usuwa tablice z haszowaniem. Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param allocator - alokator, którym zaalokowano tablice.
+ * @param lookup - wskaźnik na usuwane tablice.
+ */
+void lookupDelete(PhfwdAllocator const *allocator, struct PhfwdLookup *lookup);
+
+/**
+ * Wstawia do aktualnych tablic z haszowaniem przekierowanie prefiksu @p num, zanim zostanie ono dodane do drzew.
+ * Jeśli nie da się tego zrobić bez tworzenia tablic od nowa, oznacza je jako nieaktualne. Po zmianie drzew trzeba
+ * wywołać funkcję lookupUpdate.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @param num - prefiks, którego przekierowanie jest dodawane.
+ */
+void lookupAddRule(PhoneForward *pf, char const *num);
+
+/**
+ * Usuwa z aktualnych tablic z haszowaniem przekierowania, zanim zostaną usunięte z drzew. Po zmianie drzew
+ * trzeba wywołać funkcję lookupUpdate.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @param rules - usuwane przekierowania.
+ * @param count - liczba usuwanych przekierowań.
+ */
+void lookupRemoveRules(PhoneForward *pf, PhfwdRemovalRule const *rules, size_t count);
+
+/**
+ * Kończy uaktualnianie tablic z haszowaniem po dodaniu lub usunięciu przekierowań prefiksu @p num i jego
+ * poddrzewa: poprawia zapisane w tablicach przekierowania w poddrzewie @p num. Tablice, które nie były aktualne
+ * przed modyfikacją, tworzy od nowa.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania, z nową wersją.
+ * @param version - wersja struktury sprzed modyfikacji.
+ * @param num - zmieniony prefiks.
+ */
+void lookupUpdate(PhoneForward *pf, uint64_t version, char const *num);
+
+/**
+ * Tworzy od nowa tablice z haszowaniem, jeśli zostały wybrane i nie są aktualne. Jeśli nie powiodła się alokacja
+ * pamięci, tablice pozostają nieaktualne i nie są używane.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ */
+void lookupRebuild(PhoneForward *pf);
+
+/**
+ * Szuka najdłuższego prefiksu numeru @p num, który jest przekierowywany. Używa tablic z haszowaniem, jeśli
+ * zostały wybrane i są aktualne, a w przeciwnym przypadku drzewa PhoneForwardPrefixes.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @param num - poprawny numer telefonu.
+ * @param length - wskaźnik na zmienną, w której zostanie zapisana długość znalezionego prefiksu lub 0.
+ * @return - przekierowanie znalezionego prefiksu lub NULL, jeśli żaden prefiks nie jest przekierowywany.
+ */
+char const *phfwdFindPrefix(PhoneForward const *pf, char const *num, size_t *length);
+
+#endif //PHONE_FORWARD_LOOKUP_H
@@ -0,0 +1,77 @@
+/** @file
+ * Implementacja scalania dwóch struktur przechowujących przekierowania numerów telefonu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "trie.h"
+#include "memory_context.h"
+#include "node_stack.h"
+#include "phone_forward_journal.h"
+#include "phone_forward_query.h"
+
+/**
+ * Przepisuje przekierowanie zapisane w węźle @p srcNode do struktury @p dst, jeśli pozwala na to @p policy.
+ * @param dst - wskaźnik na strukturę, do której dodawane jest przekierowanie.
+ * @param srcNode - węzeł drzewa PhoneForwardPrefixes struktury źródłowej.
+ * @param num1 - prefiks numeru telefonu odpowiadający węzłowi.
+ * @param policy - sposób rozstrzygania konfliktów.
+ * @return true - jeśli udało się przepisać przekierowanie lub nie było czego przepisywać.
+ *         false - jeśli nie powiodła się alokacja pamięci lub zapis dziennika.
+ */
+static bool mergeDiversion(PhoneForward *dst, PhoneForwardPrefixes *srcNode, char const *num1,
+                           PhfwdMergePolicy policy) {
+    if (srcNode->diversion == NULL)
+        return true;
+
+    PhoneForwardPrefixes *dstNode = findPrefixesNode(dst->prefixes, num1, strlen(num1));
+    if (dstNode != NULL && dstNode->diversion != NULL && policy == PHFWD_MERGE_DST_WINS)
+        return true;
+
+    return phfwdAddRule(dst, num1, srcNode->diversion, false);
+}
+
+bool phfwdMerge(PhoneForward *dst, PhoneForward const *src, PhfwdMergePolicy policy) {
+    if (dst == NULL || src == NULL || dst->prefixes == NULL || src->prefixes == NULL)
+        return false;
+    if (dst == src)
+        return true;
+
+    NodeStack stack;
+    nodeStackInit(&stack, &(dst->allocator));
+    char *path = NULL;
+    size_t pathSize = 0;
+    bool result = nodeStackPush(&stack, src->prefixes, NULL, 0, 0);
+
+    // Prefiks numeru jest odtwarzany z głębokości i znaku zapisanych w stosie. Poddrzewo, które struktura
+    // źródłowa współdzieli z docelową, ma w obu te same przekierowania, więc jest pomijane.
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardPrefixes *srcNode = frame.first;
+
+        if (frame.depth > 0) {
+            result = pathSet(&path, &pathSize, frame.depth, frame.sign);
+            if (!result)
+                break;
+        }
+        if (findPrefixesNode(dst->prefixes, (path == NULL) ? "" : path, frame.depth) == srcNode)
+            continue;
+        if (frame.depth > 0)
+            result = mergeDiversion(dst, srcNode, path, policy);
+
+        for (int i = SIGNS_IN_NUMBER - 1; i >= 0 && result; i--) {
+            if ((srcNode->children)[i] != NULL)
+                result = nodeStackPush(&stack, (srcNode->children)[i], NULL, frame.depth + 1, i);
+        }
+    }
+
+    result = journalGroupCommit(dst->journal) && result;
+
+    nodeStackFree(&stack);
+    free(path);
+    return result;
+}
@@ -0,0 +1,497 @@
+/** @file
+ * Implementacja replikacji przekierowań na węzły NUMA.
+ *
+ * Każda kopia ma własny wątek przypisany do procesorów swojego węzła. Wątek tworzy kopię drzew i wykonuje w niej
+ * wszystkie zmiany, więc każdą stronę pamięci kopii pierwszy zapisuje procesor jej węzła i system przydziela ją
+ * z pamięci tego węzła. Alokator glibc daje każdemu wątkowi osobny obszar, więc węzły kopii nie mieszają się
+ * z pamięcią innych wątków. Zmiana jest wykonywana w dwóch rundach: w pierwszej każdy wątek rezerwuje pamięć
+ * potrzebną w swojej kopii, a w drugiej wszystkie wątki wykonują zmianę albo, jeśli któraś rezerwacja się nie
+ * powiodła, wszystkie ją porzucają. Każdą kopię chroni osobna blokada czytelników i pisarzy.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "phone_forward_numa.h"
+#include "phone_forward_clone.h"
+#include "phone_forward_transaction.h"
+
+/**
+ * Katalog, w którym jądro opisuje węzły NUMA.
+ */
+#define NODE_DIRECTORY "/sys/devices/system/node"
+
+/**
+ * Największa liczba węzłów, które zostaną usunięte z listy pojedynczym wywołaniem phfwdReclaim po zmianie kopii.
+ */
+#define RECLAIM_STEP 64
+
+/**
+ * Polecenia wykonywane przez wątki kopii.
+ */
+enum ReplicaCommand {
+    CMD_START, ///< Utworzenie kopii.
+    CMD_PREPARE, ///< Zarezerwowanie pamięci na zmianę.
+    CMD_APPLY, ///< Wykonanie przygotowanej zmiany.
+    CMD_ABORT, ///< Porzucenie przygotowanej zmiany.
+    CMD_STOP ///< Usunięcie kopii i zakończenie wątku.
+};
+typedef enum ReplicaCommand ReplicaCommand;
+
+/**
+ * @struct Replica
+ * @brief Replica jest kopią przekierowań jednego węzła NUMA razem z jej wątkiem.
+ */
+struct Replica {
+    _Alignas(64) pthread_rwlock_t lock; ///< Blokada chroniąca kopię przed zmianą w trakcie zapytań.
+    PhoneForward *pf; ///< Kopia przekierowań.
+    PhfwdTransaction *tx; ///< Przygotowywana zmiana lub NULL.
+    bool ok; ///< Czy ostatnie polecenie zostało wykonane.
+    cpu_set_t cpus; ///< Procesory węzła.
+    bool hasCpus; ///< Czy węzeł ma jakiś procesor.
+    pthread_t thread; ///< Wątek kopii.
+    struct PhfwdReplicas *owner; ///< Zbiór kopii, do którego należy kopia.
+};
+typedef struct Replica Replica;
+
+struct PhfwdReplicas {
+    Replica *replicas; ///< Kopie, po jednej dla każdego węzła.
+    size_t count; ///< Liczba węzłów.
+    size_t threads; ///< Liczba uruchomionych wątków kopii.
+    size_t *cpuNode; ///< Węzeł każdego procesora.
+    size_t cpuCount; ///< Liczba procesorów.
+    pthread_mutex_t update; ///< Blokada, która sprawia, że zmiany są wykonywane po kolei.
+    pthread_mutex_t mutex; ///< Blokada chroniąca pola opisujące rundę.
+    pthread_cond_t wake; ///< Zmienna, na której wątki kopii czekają na kolejną rundę.
+    pthread_cond_t done; ///< Zmienna, na której zlecający czeka na zakończenie rundy.
+    ReplicaCommand command; ///< Polecenie bieżącej rundy.
+    uint64_t round; ///< Numer bieżącej rundy.
+    size_t finished; ///< Liczba wątków, które wykonały polecenie bieżącej rundy.
+    char const *num1; ///< Prefiks numerów, których dotyczy zmiana.
+    char const *num2; ///< Przekierowanie prefiksu @p num1 lub NULL, jeśli zmiana usuwa przekierowania.
+};
+
+/**
+ * Odczytuje listę procesorów węzła w formacie jądra, np. "0-3,8-11", i przypisuje je do węzła.
+ * @param file - plik z listą procesorów.
+ * @param cpuNode - węzły procesorów.
+ * @param cpuCount - liczba procesorów.
+ * @param node - numer węzła.
+ */
+static void readCpuList(FILE *file, size_t *cpuNode, size_t cpuCount, size_t node) {
+    unsigned long first;
+    unsigned long last;
+
+    while (fscanf(file, "%lu", &first) == 1) {
+        last = first;
+        int next = fgetc(file);
+
+        if (next == '-') {
+            if (fscanf(file, "%lu", &last) != 1)
+                return;
+            next = fgetc(file);
+        }
+
+        for (unsigned long cpu = first; cpu <= last && cpu < cpuCount; cpu++)
+            cpuNode[cpu] = node;
+
+        if (next != ',')
+            return;
+    }
+}
+
+/**
+ * Odczytuje topologię z katalogu NODE_DIRECTORY. Węzły są numerowane od zera w kolejności ich identyfikatorów,
+ * bo identyfikatory nie muszą być kolejnymi liczbami.
+ * @param cpuNode - węzły procesorów, na początku wszystkie równe 0.
+ * @param cpuCount - liczba procesorów.
+ * @return - liczba węzłów lub 1, jeśli nie udało się odczytać topologii.
+ */
+static size_t readTopology(size_t *cpuNode, size_t cpuCount) {
+    DIR *directory = opendir(NODE_DIRECTORY);
+    if (directory == NULL)
+        return 1;
+
+    unsigned long maxId = 0;
+    bool found = false;
+    struct dirent *entry;
+
+    while ((entry = readdir(directory)) != NULL) {
+        unsigned long id;
+        char rest;
+        if (sscanf(entry->d_name, "node%lu%c", &id, &rest) == 1) {
+            maxId = (!found || id > maxId) ? id : maxId;
+            found = true;
+        }
+    }
+    closedir(directory);
+
+    size_t count = 0;
+    for (unsigned long id = 0; found && id <= maxId; id++) {
+        char path[sizeof(NODE_DIRECTORY) + 64];
+        snprintf(path, sizeof(path), NODE_DIRECTORY "/node%lu/cpulist", id);
+
+        FILE *file = fopen(path, "r");
+        if (file != NULL) {
+            readCpuList(file, cpuNode, cpuCount, count++);
+            fclose(file);
+        }
+    }
+    return (count == 0) ? 1 : count;
+}
+
+/**
+ * Wyznacza węzeł każdego procesora, z rzeczywistej lub symulowanej topologii.
+ * @param replicas - wskaźnik na tworzone kopie.
+ * @param nodes - liczba symulowanych węzłów lub 0.
+ * @return true - jeśli udało się wyznaczyć topologię.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool findTopology(PhfwdReplicas *replicas, size_t nodes) {
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    replicas->cpuCount = (cpus < 1) ? 1 : (size_t) cpus;
+    replicas->cpuNode = (size_t *) calloc(replicas->cpuCount, sizeof(size_t));
+
+    if (replicas->cpuNode == NULL)
+        return false;
+
+    if (nodes == 0) {
+        replicas->count = readTopology(replicas->cpuNode, replicas->cpuCount);
+        return true;
+    }
+
+    // Symulowane węzły dostają spójne przedziały procesorów, tak jak zwykle w rzeczywistych maszynach.
+    // Jeśli węzłów jest więcej niż procesorów, niektóre węzły nie mają procesorów i ich kopie nie są czytane.
+    replicas->count = nodes;
+    for (size_t cpu = 0; cpu < replicas->cpuCount; cpu++)
+        replicas->cpuNode[cpu] = cpu * nodes / replicas->cpuCount;
+    return true;
+}
+
+/**
+ * Przygotowuje zmianę kopii: zapisuje ją w transakcji i wykonuje na prywatnej wersji drzew. Zapytania do kopii
+ * mogą być w tym czasie obsługiwane, bo jej drzewa się nie zmieniają.
+ * @param replica - wskaźnik na kopię.
+ * @param num1 - prefiks numerów, których dotyczy zmiana.
+ * @param num2 - przekierowanie lub NULL, jeśli zmiana usuwa przekierowania.
+ */
+static void replicaPrepare(Replica *replica, char const *num1, char const *num2) {
+    replica->tx = phfwdTransactionBegin(replica->pf);
+
+    if (replica->tx == NULL) {
+        replica->ok = false;
+        return;
+    }
+
+    replica->ok = (num2 == NULL) ? phfwdTransactionRemove(replica->tx, num1)
+                                 : phfwdTransactionAdd(replica->tx, num1, num2);
+    replica->ok = replica->ok && transactionPrepare(replica->tx);
+}
+
+/**
+ * Wykonuje polecenie w wątku kopii.
+ * @param replica - wskaźnik na kopię.
+ * @param command - polecenie.
+ */
+static void replicaExecute(Replica *replica, ReplicaCommand command) {
+    PhfwdReplicas *owner = replica->owner;
+
+    switch (command) {
+        case CMD_START:
+            // Kopia struktury źródłowej współdzieli jeszcze jej drzewa, więc trzeba je skopiować w tym wątku,
+            // żeby trafiły do pamięci jego węzła.
+            if (replica->pf == NULL)
+                replica->ok = (replica->pf = phfwdNew()) != NULL;
+            else
+                replica->ok = phfwdUnshare(replica->pf);
+            break;
+        case CMD_PREPARE:
+            replicaPrepare(replica, owner->num1, owner->num2);
+            break;
+        case CMD_APPLY:
+            pthread_rwlock_wrlock(&(replica->lock));
+            transactionApply(replica->tx);
+            phfwdReclaim(replica->pf, RECLAIM_STEP);
+            pthread_rwlock_unlock(&(replica->lock));
+            replica->tx = NULL;
+            break;
+        case CMD_ABORT:
+            phfwdTransactionAbort(replica->tx);
+            replica->tx = NULL;
+            break;
+        case CMD_STOP:
+            phfwdDelete(replica->pf);
+            replica->pf = NULL;
+            break;
+    }
+}
+
+/**
+ * Funkcja wątku kopii: czeka na kolejne rundy i wykonuje ich polecenia.
+ * @param arg - wskaźnik na kopię.
+ * @return NULL.
+ */
+static void *replicaWorker(void *arg) {
+    Replica *replica = (Replica *) arg;
+    PhfwdReplicas *owner = replica->owner;
+    uint64_t seen = 0;
+    ReplicaCommand command = CMD_START;
+
+    while (command != CMD_STOP) {
+        pthread_mutex_lock(&(owner->mutex));
+        while (owner->round == seen)
+            pthread_cond_wait(&(owner->wake), &(owner->mutex));
+        seen = owner->round;
+        command = owner->command;
+        pthread_mutex_unlock(&(owner->mutex));
+
+        replicaExecute(replica, command);
+
+        pthread_mutex_lock(&(owner->mutex));
+        if (++(owner->finished) == owner->threads)
+            pthread_cond_signal(&(owner->done));
+        pthread_mutex_unlock(&(owner->mutex));
+    }
+    return NULL;
+}
+
+/**
+ * Zleca polecenie wątkom wszystkich kopii i czeka, aż wszystkie je wykonają.
+ * @param replicas - wskaźnik na kopie.
+ * @param command - polecenie.
+ * @return true - jeśli wszystkie wątki wykonały polecenie.
+ *         false - w przeciwnym przypadku.
+ */
+static bool runRound(PhfwdReplicas *replicas, ReplicaCommand command) {
+    pthread_mutex_lock(&(replicas->mutex));
+    replicas->command = command;
+    replicas->finished = 0;
+    (replicas->round)++;
+    pthread_cond_broadcast(&(replicas->wake));
+
+    while (replicas->finished < replicas->threads)
+        pthread_cond_wait(&(replicas->done), &(replicas->mutex));
+    pthread_mutex_unlock(&(replicas->mutex));
+
+    bool ok = true;
+    for (size_t i = 0; i < replicas->threads; i++)
+        ok = ok && (replicas->replicas)[i].ok;
+    return ok;
+}
+
+/**
+ * Uruchamia wątek kopii na procesorach jej węzła. Jeśli nie da się go przypisać do tych procesorów, na przykład
+ * z powodu ograniczeń cpuset, wątek jest uruchamiany bez przypisania.
+ * @param replica - wskaźnik na kopię.
+ * @return true - jeśli udało się uruchomić wątek.
+ *         false - w przeciwnym przypadku.
+ */
+static bool startWorker(Replica *replica) {
+    pthread_attr_t attr;
+
+    if (replica->hasCpus && pthread_attr_init(&attr) == 0) {
+        bool started = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &(replica->cpus)) == 0 &&
+                       pthread_create(&(replica->thread), &attr, replicaWorker, replica) == 0;
+        pthread_attr_destroy(&attr);
+        if (started)
+            return true;
+    }
+    return pthread_create(&(replica->thread), NULL, replicaWorker, replica) == 0;
+}
+
+/**
+ * Inicjalizuje kopie: przypisuje im procesory, tworzy blokady i kopie struktury źródłowej, które współdzielą
+ * jeszcze jej drzewa.
+ * @param replicas - wskaźnik na kopie.
+ * @param pf - struktura źródłowa lub NULL.
+ * @return true - jeśli udało się zainicjalizować wszystkie kopie.
+ *         false - jeśli nie powiodła się alokacja pamięci. Wtedy kopie zainicjalizowane do tego miejsca są
+ *         zapisane w tablicy, a pozostałe mają pole pf równe NULL.
+ */
+static bool initReplicas(PhfwdReplicas *replicas, PhoneForward *pf) {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    // Domyślnie glibc przepuszcza kolejnych czytelników przed czekającym pisarzem, więc przy ciągłych
+    // zapytaniach zmiana mogłaby nigdy się nie wykonać.
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+
+    bool ok = true;
+    for (size_t i = 0; i < replicas->count; i++) {
+        Replica *replica = &(replicas->replicas)[i];
+        pthread_rwlock_init(&(replica->lock), &attr);
+        replica->pf = NULL;
+        replica->tx = NULL;
+        replica->ok = true;
+        replica->hasCpus = false;
+        replica->owner = replicas;
+        CPU_ZERO(&(replica->cpus));
+
+        if (ok && pf != NULL)
+            ok = (replica->pf = phfwdClone(pf)) != NULL;
+    }
+    pthread_rwlockattr_destroy(&attr);
+
+    for (size_t cpu = 0; cpu < replicas->cpuCount && cpu < CPU_SETSIZE; cpu++) {
+        Replica *replica = &(replicas->replicas)[(replicas->cpuNode)[cpu]];
+        CPU_SET(cpu, &(replica->cpus));
+        replica->hasCpus = true;
+    }
+    return ok;
+}
+
+/**
+ * Kończy uruchomione wątki i zwalnia kopie.
+ * @param replicas - wskaźnik na kopie.
+ */
+static void replicasFree(PhfwdReplicas *replicas) {
+    if (replicas->threads > 0) {
+        runRound(replicas, CMD_STOP);
+        for (size_t i = 0; i < replicas->threads; i++)
+            pthread_join((replicas->replicas)[i].thread, NULL);
+    }
+
+    for (size_t i = 0; replicas->replicas != NULL && i < replicas->count; i++) {
+        // Kopie bez wątku nie zostały usunięte przez polecenie CMD_STOP.
+        phfwdDelete((replicas->replicas)[i].pf);
+        pthread_rwlock_destroy(&((replicas->replicas)[i].lock));
+    }
+
+    pthread_mutex_destroy(&(replicas->update));
+    pthread_mutex_destroy(&(replicas->mutex));
+    pthread_cond_destroy(&(replicas->wake));
+    pthread_cond_destroy(&(replicas->done));
+    free(replicas->replicas);
+    free(replicas->cpuNode);
+    free(replicas);
+}
+
+PhfwdReplicas *phfwdReplicasNew(PhoneForward *pf, size_t nodes) {
+    PhfwdReplicas *replicas = (PhfwdReplicas *) malloc(sizeof(PhfwdReplicas));
+    if (replicas == NULL)
+        return NULL;
+
+    replicas->replicas = NULL;
+    replicas->count = 0;
+    replicas->threads = 0;
+    replicas->cpuNode = NULL;
+    replicas->round = 0;
+    replicas->finished = 0;
+    replicas->command = CMD_START;
+    pthread_mutex_init(&(replicas->update), NULL);
+    pthread_mutex_init(&(replicas->mutex), NULL);
+    pthread_cond_init(&(replicas->wake), NULL);
+    pthread_cond_init(&(replicas->done), NULL);
+
+    if (!findTopology(replicas, nodes)) {
+        replicasFree(replicas);
+        return NULL;
+    }
+
+    replicas->replicas = (Replica *) aligned_alloc(_Alignof(Replica), sizeof(Replica) * replicas->count);
+    if (replicas->replicas == NULL) {
+        replicas->count = 0;
+        replicasFree(replicas);
+        return NULL;
+    }
+
+    bool ok = initReplicas(replicas, pf);
+    while (ok && replicas->threads < replicas->count && startWorker(&(replicas->replicas)[replicas->threads]))
+        (replicas->threads)++;
+
+    if (!ok || replicas->threads < replicas->count || !runRound(replicas, CMD_START)) {
+        replicasFree(replicas);
+        return NULL;
+    }
+    return replicas;
+}
+
+void phfwdReplicasDelete(PhfwdReplicas *replicas) {
+    if (replicas == NULL)
+        return;
+
+    replicasFree(replicas);
+}
+
+size_t phfwdReplicasCount(PhfwdReplicas const *replicas) {
+    return (replicas == NULL) ? 0 : replicas->count;
+}
+
+/**
+ * Wykonuje zmianę we wszystkich kopiach albo w żadnej.
+ * @param replicas - wskaźnik na kopie.
+ * @param num1 - prefiks numerów, których dotyczy zmiana.
+ * @param num2 - przekierowanie lub NULL, jeśli zmiana usuwa przekierowania.
+ * @return true - jeśli zmiana została wykonana.
+ *         false - jeśli któraś kopia nie mogła jej przygotować.
+ */
+static bool replicasUpdate(PhfwdReplicas *replicas, char const *num1, char const *num2) {
+    pthread_mutex_lock(&(replicas->update));
+    replicas->num1 = num1;
+    replicas->num2 = num2;
+
+    bool prepared = runRound(replicas, CMD_PREPARE);
+    runRound(replicas, prepared ? CMD_APPLY : CMD_ABORT);
+    pthread_mutex_unlock(&(replicas->update));
+    return prepared;
+}
+
+bool phfwdReplicasAdd(PhfwdReplicas *replicas, char const *num1, char const *num2) {
+    // Zmiana bez przekierowania usuwa przekierowania, więc brak numeru trzeba odrzucić przed nią.
+    if (replicas == NULL || num2 == NULL)
+        return false;
+
+    return replicasUpdate(replicas, num1, num2);
+}
+
+bool phfwdReplicasRemove(PhfwdReplicas *replicas, char const *num) {
+    if (replicas == NULL)
+        return false;
+
+    return replicasUpdate(replicas, num, NULL);
+}
+
+/**
+ * Wyznacza kopię węzła, na którym działa wywołujący wątek.
+ * @param replicas - wskaźnik na kopie.
+ * @return - wskaźnik na kopię lokalną lub na pierwszą kopię, jeśli nie da się ustalić procesora.
+ */
+static Replica *localReplica(PhfwdReplicas *replicas) {
+    int cpu = sched_getcpu();
+
+    if (cpu < 0 || (size_t) cpu >= replicas->cpuCount)
+        return &(replicas->replicas)[0];
+    return &(replicas->replicas)[(replicas->cpuNode)[cpu]];
+}
+
+PhoneNumbers *phfwdReplicasGet(PhfwdReplicas *replicas, char const *num) {
+    if (replicas == NULL)
+        return NULL;
+
+    Replica *replica = localReplica(replicas);
+    pthread_rwlock_rdlock(&(replica->lock));
+    PhoneNumbers *result = phfwdGet(replica->pf, num);
+    pthread_rwlock_unlock(&(replica->lock));
+    return result;
+}
+
+PhoneNumbers *phfwdReplicasReverse(PhfwdReplicas *replicas, char const *num) {
+    if (replicas == NULL)
+        return NULL;
+
+    Replica *replica = localReplica(replicas);
+    pthread_rwlock_rdlock(&(replica->lock));
+    PhoneNumbers *result = phfwdReverse(replica->pf, num);
+    pthread_rwlock_unlock(&(replica->lock));
+    return result;
+}
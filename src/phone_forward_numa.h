@@ -0,0 +1,108 @@
+/** @file
+ * Interfejs replikacji przekierowań na węzły NUMA.
+ *
+ * Każdy węzeł NUMA dostaje własną kopię drzew, zaalokowaną w pamięci tego węzła. Zapytania są kierowane do kopii
+ * węzła, na którym działa wywołujący wątek, więc przechodzenie drzew nie sięga do pamięci innego procesora.
+ * Zmiany są wykonywane we wszystkich kopiach.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_NUMA_H
+#define PHONE_FORWARD_NUMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "phone_forward.h"
+
+/**
+ * To jest zbiór kopii przekierowań, po jednej dla każdego węzła NUMA.
+ */
+struct PhfwdReplicas;
+typedef struct PhfwdReplicas PhfwdReplicas; ///< @ref PhfwdReplicas
+
+/** @brief Tworzy kopie przekierowań dla węzłów NUMA.
+ * Dla każdego węzła uruchamia wątek przypisany do procesorów tego węzła,
+ * który tworzy kopię przekierowań struktury @p pf i wykonuje w niej zmiany.
+ * Pamięć kopii jest alokowana przez ten wątek, więc przy domyślnej w Linuksie
+ * polityce alokacji stron trafia do pamięci jego węzła.
+ * Topologia jest odczytywana z katalogu /sys/devices/system/node. Jeśli
+ * @p nodes jest większe od zera, topologia jest symulowana: procesory są
+ * dzielone na @p nodes równych, spójnych przedziałów.
+ * @param[in,out] pf – wskaźnik na strukturę, której przekierowania zostaną
+ *                     skopiowane, lub NULL, jeśli kopie mają być puste;
+ *                     struktura nie jest zmieniana i można ją potem usunąć;
+ * @param[in] nodes  – liczba symulowanych węzłów lub 0, jeśli ma być użyta
+ *                     rzeczywista topologia.
+ * @return Wskaźnik na utworzone kopie lub NULL, gdy nie udało się alokować
+ *         pamięci lub uruchomić wątków.
+ */
+PhfwdReplicas *phfwdReplicasNew(PhoneForward *pf, size_t nodes);
+
+/** @brief Usuwa kopie przekierowań.
+ * Kończy wątki węzłów i usuwa wszystkie kopie. Nic nie robi, jeśli wskaźnik
+ * ma wartość NULL. W tym czasie nie może trwać żadne zapytanie.
+ * @param[in] replicas – wskaźnik na usuwane kopie.
+ */
+void phfwdReplicasDelete(PhfwdReplicas *replicas);
+
+/** @brief Podaje liczbę kopii.
+ * @param[in] replicas – wskaźnik na kopie.
+ * @return Liczba węzłów NUMA, a więc kopii, lub 0, jeśli wskaźnik ma
+ *         wartość NULL.
+ */
+size_t phfwdReplicasCount(PhfwdReplicas const *replicas);
+
+/** @brief Dodaje przekierowanie we wszystkich kopiach.
+ * Działa jak @ref phfwdAdd. Pamięć jest najpierw rezerwowana we wszystkich
+ * kopiach, więc przekierowanie zostaje dodane albo do wszystkich kopii, albo
+ * do żadnej. Zmiany są wykonywane przez wątki węzłów równolegle. Zapytania
+ * do kopii są wstrzymywane tylko na czas zmiany tej kopii. Funkcję może
+ * naraz wywoływać wiele wątków.
+ * @param[in,out] replicas – wskaźnik na kopie;
+ * @param[in] num1         – wskaźnik na napis reprezentujący prefiks numerów
+ *                           przekierowywanych;
+ * @param[in] num2         – wskaźnik na napis reprezentujący prefiks numerów,
+ *                           na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
+ *         się alokować pamięci; kopie pozostają wtedy bez zmian.
+ */
+bool phfwdReplicasAdd(PhfwdReplicas *replicas, char const *num1, char const *num2);
+
+/** @brief Usuwa przekierowania ze wszystkich kopii.
+ * Działa jak @ref phfwdRemove, z takimi samymi gwarancjami jak
+ * @ref phfwdReplicasAdd.
+ * @param[in,out] replicas – wskaźnik na kopie;
+ * @param[in] num          – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli operacja została wykonana.
+ *         Wartość @p false, jeśli podany napis nie reprezentuje numeru lub nie
+ *         udało się alokować pamięci; kopie pozostają wtedy bez zmian.
+ */
+bool phfwdReplicasRemove(PhfwdReplicas *replicas, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru w kopii lokalnej.
+ * Działa jak @ref phfwdGet dla kopii węzła NUMA, na którym działa wywołujący
+ * wątek. Wątek powinien być przypisany do procesorów jednego węzła, bo inaczej
+ * system może go przenieść na inny węzeł w trakcie zapytania.
+ * @param[in] replicas – wskaźnik na kopie;
+ * @param[in] num      – wskaźnik na napis reprezentujący numer.
+ * @return Wynik taki jak @ref phfwdGet lub NULL, gdy @p replicas ma wartość
+ *         NULL.
+ */
+PhoneNumbers *phfwdReplicasGet(PhfwdReplicas *replicas, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w kopii lokalnej.
+ * Działa jak @ref phfwdReverse dla kopii węzła NUMA, na którym działa
+ * wywołujący wątek.
+ * @param[in] replicas – wskaźnik na kopie;
+ * @param[in] num      – wskaźnik na napis reprezentujący numer.
+ * @return Wynik taki jak @ref phfwdReverse lub NULL, gdy @p replicas ma
+ *         wartość NULL.
+ */
+PhoneNumbers *phfwdReplicasReverse(PhfwdReplicas *replicas, char const *num);
+
+#endif //PHONE_FORWARD_NUMA_H
@@ -0,0 +1,129 @@
+/** @file
+ * Implementacja ramek protokołu serwera przekierowań.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "phone_forward_protocol.h"
+
+/**
+ * Zapisuje liczbę w kolejności little-endian.
+ * @param data - wskaźnik na cztery bajty.
+ * @param value - liczba.
+ */
+static void putNumber(char *data, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        data[i] = (char) ((value >> (8 * i)) & 0xff);
+}
+
+uint32_t frameNumber(char const *data) {
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t) (unsigned char) data[i] << (8 * i);
+    return value;
+}
+
+void frameInit(FrameBuffer *buffer) {
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->used = 0;
+}
+
+void frameFree(FrameBuffer *buffer) {
+    free(buffer->data);
+    frameInit(buffer);
+}
+
+bool frameReserve(FrameBuffer *buffer, size_t extra) {
+    if (extra <= buffer->size - buffer->used)
+        return true;
+
+    size_t newSize = (buffer->size == 0) ? 4096 : buffer->size;
+    while (newSize - buffer->used < extra)
+        newSize *= 2;
+
+    char *data = (char *) realloc(buffer->data, newSize);
+    if (data == NULL)
+        return false;
+
+    buffer->data = data;
+    buffer->size = newSize;
+    return true;
+}
+
+void frameConsume(FrameBuffer *buffer, size_t count) {
+    memmove(buffer->data, buffer->data + count, buffer->used - count);
+    buffer->used -= count;
+}
+
+bool frameBegin(FrameBuffer *buffer, uint32_t id, uint8_t code, size_t *start) {
+    if (!frameReserve(buffer, PROTOCOL_HEADER))
+        return false;
+
+    *start = buffer->used;
+    putNumber(buffer->data + buffer->used + 4, id);
+    buffer->data[buffer->used + 8] = (char) code;
+    buffer->used += PROTOCOL_HEADER;
+    return true;
+}
+
+bool frameAppendNumber(FrameBuffer *buffer, uint32_t value) {
+    if (!frameReserve(buffer, 4))
+        return false;
+
+    putNumber(buffer->data + buffer->used, value);
+    buffer->used += 4;
+    return true;
+}
+
+bool frameAppendString(FrameBuffer *buffer, char const *string) {
+    size_t length = strlen(string) + 1;
+
+    if (!frameReserve(buffer, length))
+        return false;
+
+    memcpy(buffer->data + buffer->used, string, length);
+    buffer->used += length;
+    return true;
+}
+
+bool frameEnd(FrameBuffer *buffer, size_t start, bool complete) {
+    size_t length = buffer->used - start - 4;
+
+    if (!complete || length > PROTOCOL_MAX_FRAME) {
+        buffer->used = start;
+        return false;
+    }
+
+    putNumber(buffer->data + start, (uint32_t) length);
+    return true;
+}
+
+int frameComplete(char const *data, size_t used, size_t *length) {
+    if (used < 4)
+        return 0;
+
+    uint32_t frameLength = frameNumber(data);
+
+    if (frameLength < PROTOCOL_HEADER - 4 || frameLength > PROTOCOL_MAX_FRAME)
+        return -1;
+
+    *length = (size_t) frameLength + 4;
+    return (used >= *length) ? 1 : 0;
+}
+
+char const *frameString(char const **data, char const *end) {
+    char const *string = *data;
+    char const *stop = (string < end) ? (char const *) memchr(string, '\0', (size_t) (end - string)) : NULL;
+
+    if (stop == NULL)
+        return NULL;
+
+    *data = stop + 1;
+    return string;
+}
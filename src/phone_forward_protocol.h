@@ -0,0 +1,151 @@
+/** @file
+ * Interfejs ramek protokołu, którym serwer przekierowań (tools/phfwd_server) rozmawia z klientami.
+ *
+ * Każda ramka zaczyna się nagłówkiem: długością reszty ramki, numerem żądania i kodem, wszystkie liczby zapisane
+ * w kolejności little-endian. W żądaniu kodem jest rodzaj żądania, a dalej są jego numery zakończone znakiem
+ * '\0'. W odpowiedzi kodem jest jeden ze stanów PROTOCOL_*, a odpowiedź na zapytanie zawiera liczbę numerów
+ * wyniku i kolejne numery zakończone znakiem '\0'. Klient może wysłać wiele żądań, nie czekając na odpowiedzi;
+ * odpowiedzi przychodzą w kolejności żądań.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_PROTOCOL_H
+#define PHONE_FORWARD_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Rozmiar nagłówka ramki: długość, numer żądania i kod.
+ */
+#define PROTOCOL_HEADER 9
+
+/**
+ * Największa dopuszczalna długość ramki bez pola długości.
+ */
+#define PROTOCOL_MAX_FRAME (1u << 20)
+
+/**
+ * Stan odpowiedzi: żądanie zostało wykonane, a dla phfwdAdd – przekierowanie zostało dodane.
+ */
+#define PROTOCOL_OK 0
+
+/**
+ * Stan odpowiedzi: phfwdAdd lub phfwdRemove zwróciło błąd, np. numer jest niepoprawny.
+ */
+#define PROTOCOL_FALSE 1
+
+/**
+ * Stan odpowiedzi: żądanie jest niepoprawne lub serwerowi zabrakło pamięci.
+ */
+#define PROTOCOL_ERROR 2
+
+/**
+ * @struct FrameBuffer
+ * @brief FrameBuffer jest buforem bajtów, do którego dopisywane są ramki lub w którym gromadzone są odebrane dane.
+ */
+struct FrameBuffer {
+    char *data; ///< Zawartość bufora.
+    size_t size; ///< Rozmiar tablicy data.
+    size_t used; ///< Liczba zajętych bajtów.
+};
+typedef struct FrameBuffer FrameBuffer;
+
+/**
+ * Inicjalizuje pusty bufor.
+ * @param buffer - wskaźnik na bufor.
+ */
+void frameInit(FrameBuffer *buffer);
+
+/**
+ * Zwalnia pamięć bufora.
+ * @param buffer - wskaźnik na bufor.
+ */
+void frameFree(FrameBuffer *buffer);
+
+/**
+ * Zapewnia miejsce na co najmniej @p extra kolejnych bajtów.
+ * @param buffer - wskaźnik na bufor.
+ * @param extra - liczba bajtów.
+ * @return true - jeśli w buforze jest miejsce.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool frameReserve(FrameBuffer *buffer, size_t extra);
+
+/**
+ * Usuwa z początku bufora @p count bajtów.
+ * @param buffer - wskaźnik na bufor.
+ * @param count - liczba usuwanych bajtów, nie większa niż liczba zajętych bajtów.
+ */
+void frameConsume(FrameBuffer *buffer, size_t count);
+
+/**
+ * Zaczyna nową ramkę na końcu bufora. Długość ramki jest uzupełniana przez frameEnd.
+ * @param buffer - wskaźnik na bufor.
+ * @param id - numer żądania.
+ * @param code - rodzaj żądania lub stan odpowiedzi.
+ * @param start - wskaźnik, pod którym zostanie zapisany początek ramki.
+ * @return true - jeśli udało się zacząć ramkę.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool frameBegin(FrameBuffer *buffer, uint32_t id, uint8_t code, size_t *start);
+
+/**
+ * Dopisuje do ramki liczbę.
+ * @param buffer - wskaźnik na bufor.
+ * @param value - liczba.
+ * @return true - jeśli udało się dopisać liczbę.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool frameAppendNumber(FrameBuffer *buffer, uint32_t value);
+
+/**
+ * Dopisuje do ramki napis razem z kończącym go znakiem '\0'.
+ * @param buffer - wskaźnik na bufor.
+ * @param string - napis.
+ * @return true - jeśli udało się dopisać napis.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool frameAppendString(FrameBuffer *buffer, char const *string);
+
+/**
+ * Kończy ramkę, zapisując jej długość, lub ją wycofuje.
+ * @param buffer - wskaźnik na bufor.
+ * @param start - początek ramki zwrócony przez frameBegin.
+ * @param complete - czy ramka została w całości zapisana. Jeśli nie, bufor wraca do stanu sprzed frameBegin.
+ * @return true - jeśli ramka została zakończona.
+ *         false - jeśli została wycofana lub jest dłuższa niż PROTOCOL_MAX_FRAME.
+ */
+bool frameEnd(FrameBuffer *buffer, size_t start, bool complete);
+
+/**
+ * Sprawdza, czy na początku danych jest cała ramka.
+ * @param data - dane.
+ * @param used - liczba bajtów danych.
+ * @param length - wskaźnik, pod którym zostanie zapisana długość ramki razem z nagłówkiem.
+ * @return 1 - jeśli na początku danych jest cała ramka.
+ *         0 - jeśli ramka nie została jeszcze w całości odebrana.
+ *         -1 - jeśli ramka jest za długa lub za krótka.
+ */
+int frameComplete(char const *data, size_t used, size_t *length);
+
+/**
+ * Odczytuje liczbę zapisaną w kolejności little-endian.
+ * @param data - wskaźnik na cztery bajty liczby.
+ * @return - liczba.
+ */
+uint32_t frameNumber(char const *data);
+
+/**
+ * Odczytuje napis z treści ramki.
+ * @param data - wskaźnik na wskaźnik na początek napisu, przesuwany za jego koniec.
+ * @param end - koniec treści ramki.
+ * @return - napis lub NULL, jeśli nie kończy się przed końcem treści.
+ */
+char const *frameString(char const **data, char const *end);
+
+#endif //PHONE_FORWARD_PROTOCOL_H
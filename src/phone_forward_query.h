@@ -0,0 +1,90 @@
+/** @file
+ * Wewnętrzny interfejs struktury przechowującej przekierowania: zapytania, których wyniki są umieszczane
+ * w podanym obszarze pamięci, tworzenie wyników zapytań oraz numery wersji struktury.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_QUERY_H
+#define PHONE_FORWARD_QUERY_H
+
+#include "phone_forward.h"
+#include "arena.h"
+
+/**
+ * Działa jak phfwdGet, ale pamięć na wynik jest przydzielana z obszaru @p arena.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @param num - wskaźnik na napis reprezentujący numer.
+ * @param arena - obszar, z którego zostanie przydzielona pamięć, lub NULL, jeśli ma być użyta funkcja malloc.
+ * @return - wynik taki jak phfwdGet. Wyniku przydzielonego z obszaru nie usuwa się funkcją phnumDelete.
+ */
+PhoneNumbers *phfwdGetInArena(PhoneForward const *pf, char const *num, Arena *arena);
+
+/**
+ * Działa jak phfwdReverse, ale pamięć na wynik jest przydzielana z obszaru @p arena.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @param num - wskaźnik na napis reprezentujący numer.
+ * @param arena - obszar, z którego zostanie przydzielona pamięć, lub NULL, jeśli ma być użyta funkcja malloc.
+ * @return - wynik taki jak phfwdReverse. Wyniku przydzielonego z obszaru nie usuwa się funkcją phnumDelete.
+ */
+PhoneNumbers *phfwdReverseInArena(PhoneForward const *pf, char const *num, Arena *arena);
+
+/**
+ * Działa jak phfwdGetReverse, ale pamięć na wynik jest przydzielana z obszaru @p arena.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @param num - wskaźnik na napis reprezentujący numer.
+ * @param arena - obszar, z którego zostanie przydzielona pamięć, lub NULL, jeśli ma być użyta funkcja malloc.
+ * @return - wynik taki jak phfwdGetReverse. Wyniku przydzielonego z obszaru nie usuwa się funkcją phnumDelete.
+ */
+PhoneNumbers *phfwdGetReverseInArena(PhoneForward const *pf, char const *num, Arena *arena);
+
+/**
+ * Tworzy wynik zapytania zawierający kopię jednego numeru.
+ * @param allocator - alokator, którym zostanie zaalokowany wynik, lub NULL, jeśli ma być użyta funkcja malloc.
+ * @param num - numer telefonu lub NULL, jeśli wynik ma być pusty.
+ * @return - utworzona struktura lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+PhoneNumbers *phnumSingle(PhfwdAllocator const *allocator, char const *num);
+
+/**
+ * Dodaje do wyniku zapytania numer będący złączeniem napisów @p prefix i @p rest.
+ * @param pnum - wynik zapytania.
+ * @param prefix - początek numeru.
+ * @param rest - koniec numeru.
+ * @return true - jeśli udało się dodać numer.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool phnumAppend(PhoneNumbers *pnum, char const *prefix, char const *rest);
+
+/**
+ * Dodaje do wyniku funkcji phfwdReverse sam numer @p num, sortuje wynik i usuwa z niego powtórzenia.
+ * @param result - numery zebrane z węzłów drzewa PhoneForwardReverse.
+ * @param num - numer telefonu.
+ * @return - uporządkowany wynik,
+ *         - NULL, jeśli nie powiodła się alokacja pamięci. Wtedy @p result jest usuwany.
+ */
+PhoneNumbers *reverseFinish(PhoneNumbers *result, char const *num);
+
+/**
+ * Nadaje strukturze nowy numer wersji. Musi być wywołana po każdej zmianie przekierowań.
+ * @param pf - wskaźnik na strukturę.
+ */
+void phfwdTouch(PhoneForward *pf);
+
+/**
+ * Dodaje poprawne przekierowanie prefiksu @p num1 na @p num2 i dopisuje je do dziennika. Cała pamięć jest
+ * rezerwowana przed pierwszą zmianą drzew. Przekierowanie, które już jest w strukturze, nie trafia do dziennika.
+ * @param pf - wskaźnik na strukturę.
+ * @param num1 - prefiks numerów przekierowywanych.
+ * @param num2 - prefiks numerów, na które jest wykonywane przekierowanie, różny od @p num1.
+ * @param commit - czy zatwierdzić grupę wpisów dziennika przed zmianą drzew. Bez zatwierdzenia wywołujący musi
+ *                 zatwierdzić ją sam funkcją journalGroupCommit.
+ * @return true - jeśli przekierowanie zostało dodane.
+ *         false - jeśli nie powiodła się alokacja pamięci, zostałby przekroczony limit lub wystąpił błąd zapisu
+ *                 dziennika. Struktura się wtedy nie zmienia.
+ */
+bool phfwdAddRule(PhoneForward *pf, char const *num1, char const *num2, bool commit);
+
+#endif //PHONE_FORWARD_QUERY_H
@@ -1,51 +0,0 @@
-/** @file
- * Interfejs stosu, zawierającego wskaźniki na elementy struktury PhoneForwardReverse.
- *
- * @author Agnieszka Klempis
- * @copyright Uniwersytet Warszawski
- * @date 2022
- */
-
-#ifndef PHONE_FORWARD_REVERSE_STACK_H
-#define PHONE_FORWARD_REVERSE_STACK_H
-
-#include <stdbool.h>
-
-/**
- * @struct PhfwdReverseStack
- * @brief PhfwdReverseStack jest strukturą, przechowującą stos wskaźników na elementy struktury PhoneForwardReverse. * node - wskaźnik na węzeł.
- */
-struct PhfwdReverseStack;
-typedef struct PhfwdReverseStack PhfwdReverseStack;
-
-/**
- * Sprawdza, czy stos s jest pusty.
- * @param s - wskaźnik na stos.
- * @return - true, jeśli stos jest pusty,
- *           false w przeciwnym wypadku.
- */
-bool reverseEmpty(PhfwdReverseStack *s);
-
-/**
- * Inicjalizuje stos na NULL.
- * @param s - wskaźnik na wskaźnik na stos.
- */
-void reverseInit(PhfwdReverseStack **s);
-
-/**
- * Wstawia nowy element do stosu.
- * @param s - wskaźnik na wskaźnik na stos.
- * @param node - wskaźnik na element, który jest wstawiany do stosu.
- * @return - false, jeśli nie powiodła się alokacja pamięci,
- *           true, w pozostałych przypadkach.
- */
-bool reverseInsert(PhfwdReverseStack **s, PhoneForwardReverse *node);
-
-/**
- * Zwraca pierwszy element zdjęty ze stosu.
- * @param *s - wskaźnik na wskaźnik na stos.
- * @return - wskaźnik na element struktury PhoneForwardReverse zdjęty ze stosu.
- */
-PhoneForwardReverse *reversePop(PhfwdReverseStack **s);
-
-#endif //PHONE_FORWARD_REVERSE_STACK_H
\ No newline at end of file
@@ -0,0 +1,354 @@
+/** @file
+ * Implementacja udostępniania przekierowań wielu procesom przez pamięć dzieloną POSIX.
+ *
+ * Segment składa się z nagłówka i dwóch miejsc na tablicę przekierowań. Piszący zapisuje nową tablicę
+ * w miejscu, które nie jest aktywne, i dopiero potem je aktywuje. Licznik sequence jest zwiększany przed
+ * rozpoczęciem i po zakończeniu każdej publikacji, więc jest nieparzysty, gdy trwa zapis. Czytający zapamiętuje
+ * licznik przed zapytaniem i sprawdza go po zapytaniu. Czytane miejsce mogło zostać nadpisane tylko wtedy, gdy
+ * od tego czasu zaczęła się druga z kolei publikacja, bo pierwsza zapisuje drugie miejsce – wtedy zapytanie
+ * jest powtarzane. Zapytania o stałą tablicę sprawdzają wszystkie indeksy, a na końcu każdego miejsca jest
+ * znak '\0', którego piszący nigdy nie nadpisuje, więc czytanie zmienianej tablicy nie wychodzi poza miejsce.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "phone_forward_shm.h"
+#include "phone_forward_static.h"
+
+/**
+ * Napis na początku nagłówka segmentu.
+ */
+#define SHM_MAGIC "PHFWDSHM"
+
+/**
+ * Długość napisu SHM_MAGIC.
+ */
+#define SHM_MAGIC_LENGTH 8
+
+/**
+ * Wyrównanie nagłówka i miejsc na tablicę.
+ */
+#define SHM_ALIGNMENT 64
+
+/**
+ * @struct ShmHeader
+ * @brief ShmHeader jest nagłówkiem segmentu.
+ */
+struct ShmHeader {
+    char magic[SHM_MAGIC_LENGTH]; ///< Napis SHM_MAGIC, zapisywany po zainicjowaniu segmentu.
+    uint64_t slotSize; ///< Rozmiar jednego miejsca na tablicę.
+    _Alignas(SHM_ALIGNMENT) _Atomic uint64_t sequence; ///< Dwukrotność liczby zakończonych publikacji, plus jeden
+    ///< w trakcie publikacji.
+    _Atomic uint32_t active; ///< Numer miejsca z ostatnio opublikowaną tablicą.
+};
+typedef struct ShmHeader ShmHeader;
+
+/**
+ * Rozmiar nagłówka segmentu zaokrąglony w górę do wielokrotności SHM_ALIGNMENT.
+ */
+#define SHM_HEADER_SIZE ((sizeof(ShmHeader) + SHM_ALIGNMENT - 1) / SHM_ALIGNMENT * SHM_ALIGNMENT)
+
+/**
+ * @struct ShmSlot
+ * @brief ShmSlot jest początkiem miejsca na tablicę: położeniem jej części względem początku miejsca.
+ */
+struct ShmSlot {
+    uint64_t prefixes; ///< Położenie węzłów drzewa prefiksów.
+    uint64_t prefixCount; ///< Liczba węzłów drzewa prefiksów.
+    uint64_t reverse; ///< Położenie węzłów drzewa przekierowań.
+    uint64_t reverseCount; ///< Liczba węzłów drzewa przekierowań.
+    uint64_t lists; ///< Położenie tablicy list.
+    uint64_t listCount; ///< Liczba elementów tablicy list.
+    uint64_t strings; ///< Położenie tablicy znaków.
+    uint64_t stringsSize; ///< Rozmiar tablicy znaków.
+};
+typedef struct ShmSlot ShmSlot;
+
+/**
+ * @struct PhfwdShm
+ * @brief PhfwdShm jest segmentem zamapowanym w bieżącym procesie.
+ */
+struct PhfwdShm {
+    unsigned char *base; ///< Początek zamapowanego segmentu.
+    size_t size; ///< Rozmiar segmentu.
+    bool writer; ///< Czy segment jest zamapowany do zapisu.
+};
+
+/**
+ * Wyznacza nagłówek segmentu.
+ * @param shm - wskaźnik na segment.
+ * @return - wskaźnik na nagłówek.
+ */
+static ShmHeader *shmHeader(PhfwdShm const *shm) {
+    return (ShmHeader *) shm->base;
+}
+
+/**
+ * Wyznacza początek miejsca na tablicę.
+ * @param shm - wskaźnik na segment.
+ * @param slot - numer miejsca.
+ * @return - wskaźnik na początek miejsca.
+ */
+static unsigned char *shmSlot(PhfwdShm const *shm, uint32_t slot) {
+    return shm->base + SHM_HEADER_SIZE + (size_t) slot * shmHeader(shm)->slotSize;
+}
+
+/**
+ * Mapuje segment.
+ * @param fd - deskryptor segmentu.
+ * @param size - rozmiar segmentu.
+ * @param writer - czy segment ma być zamapowany do zapisu.
+ * @return - wskaźnik na segment lub NULL, jeśli nie powiodła się alokacja pamięci lub mapowanie.
+ */
+static PhfwdShm *shmMap(int fd, size_t size, bool writer) {
+    PhfwdShm *shm = (PhfwdShm *) malloc(sizeof(PhfwdShm));
+    if (shm == NULL)
+        return NULL;
+
+    void *base = mmap(NULL, size, writer ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        free(shm);
+        return NULL;
+    }
+
+    shm->base = (unsigned char *) base;
+    shm->size = size;
+    shm->writer = writer;
+    return shm;
+}
+
+PhfwdShm *phfwdShmCreate(char const *name, size_t slotSize) {
+    if (name == NULL || slotSize > (SIZE_MAX - SHM_HEADER_SIZE) / 2 - SHM_ALIGNMENT)
+        return NULL;
+
+    slotSize = (slotSize + sizeof(ShmSlot) + SHM_ALIGNMENT) / SHM_ALIGNMENT * SHM_ALIGNMENT;
+    size_t size = SHM_HEADER_SIZE + 2 * slotSize;
+
+    // Procesy, które zamapowały poprzedni segment o tej nazwie, nadal go używają, zamiast widzieć jego skracanie.
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0)
+        return NULL;
+
+    PhfwdShm *shm = (ftruncate(fd, (off_t) size) == 0) ? shmMap(fd, size, true) : NULL;
+    close(fd);
+    if (shm == NULL)
+        return NULL;
+
+    ShmHeader *header = shmHeader(shm);
+    header->slotSize = slotSize;
+    atomic_init(&header->sequence, 0);
+    atomic_init(&header->active, 1);
+
+    PhoneForward *empty = phfwdNew();
+    bool published = empty != NULL && phfwdShmPublish(shm, empty);
+    phfwdDelete(empty);
+
+    if (!published) {
+        phfwdShmClose(shm);
+        return NULL;
+    }
+
+    // Czytający, który zobaczy napis, zobaczy też zainicjowany segment.
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, SHM_MAGIC, SHM_MAGIC_LENGTH);
+    return shm;
+}
+
+PhfwdShm *phfwdShmOpen(char const *name) {
+    if (name == NULL)
+        return NULL;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    PhfwdShm *shm = NULL;
+
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= SHM_HEADER_SIZE)
+        shm = shmMap(fd, (size_t) st.st_size, false);
+    close(fd);
+    if (shm == NULL)
+        return NULL;
+
+    ShmHeader const *header = shmHeader(shm);
+    bool valid = memcmp(header->magic, SHM_MAGIC, SHM_MAGIC_LENGTH) == 0;
+    atomic_thread_fence(memory_order_acquire);
+
+    if (!valid || header->slotSize < sizeof(ShmSlot) + 1 ||
+        header->slotSize > (shm->size - SHM_HEADER_SIZE) / 2) {
+        phfwdShmClose(shm);
+        return NULL;
+    }
+    return shm;
+}
+
+/**
+ * Kopiuje część tablicy do miejsca i zapisuje jej położenie.
+ * @param slot - początek miejsca.
+ * @param end - wskaźnik na położenie końca zapisanej części miejsca.
+ * @param data - kopiowana część tablicy.
+ * @param size - rozmiar kopiowanej części w bajtach.
+ * @return - położenie skopiowanej części względem początku miejsca.
+ */
+static uint64_t slotWrite(unsigned char *slot, size_t *end, void const *data, size_t size) {
+    uint64_t offset = *end;
+
+    memcpy(slot + offset, data, size);
+    *end += (size + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    return offset;
+}
+
+bool phfwdShmPublish(PhfwdShm *shm, PhoneForward const *pf) {
+    if (shm == NULL || pf == NULL || !shm->writer)
+        return false;
+
+    PhfwdStaticTable *table = phfwdStaticBuild(pf);
+    if (table == NULL)
+        return false;
+
+    ShmHeader *header = shmHeader(shm);
+    size_t nodesSize = sizeof(PhfwdStaticNode) * (table->prefixCount + table->reverseCount);
+    size_t needed = sizeof(ShmSlot) + nodesSize + sizeof(uint32_t) * table->listCount + table->stringsSize +
+                    4 * sizeof(uint64_t);
+
+    // Ostatni bajt miejsca jest znakiem '\0', który kończy każdy czytany napis.
+    if (needed > header->slotSize - 1) {
+        phfwdStaticDelete(table);
+        return false;
+    }
+
+    uint32_t slot = 1 - atomic_load_explicit(&header->active, memory_order_relaxed);
+    unsigned char *base = shmSlot(shm, slot);
+
+    atomic_fetch_add_explicit(&header->sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    ShmSlot layout;
+    size_t end = sizeof(ShmSlot);
+    layout.prefixes = slotWrite(base, &end, table->prefixes, sizeof(PhfwdStaticNode) * table->prefixCount);
+    layout.prefixCount = table->prefixCount;
+    layout.reverse = slotWrite(base, &end, table->reverse, sizeof(PhfwdStaticNode) * table->reverseCount);
+    layout.reverseCount = table->reverseCount;
+    layout.lists = slotWrite(base, &end, table->lists, sizeof(uint32_t) * table->listCount);
+    layout.listCount = table->listCount;
+    layout.strings = slotWrite(base, &end, table->strings, table->stringsSize);
+    layout.stringsSize = table->stringsSize;
+    memcpy(base, &layout, sizeof(ShmSlot));
+    base[header->slotSize - 1] = '\0';
+
+    atomic_store_explicit(&header->active, slot, memory_order_release);
+    atomic_fetch_add_explicit(&header->sequence, 1, memory_order_release);
+
+    phfwdStaticDelete(table);
+    return true;
+}
+
+/**
+ * Sprawdza, czy część tablicy leży w miejscu, przed jego ostatnim bajtem, i jest wyrównana tak, jak wyrównuje
+ * ją piszący.
+ * @param offset - położenie części względem początku miejsca.
+ * @param count - liczba elementów części.
+ * @param size - rozmiar elementu.
+ * @param slotSize - rozmiar miejsca.
+ * @return true - jeśli część leży w miejscu.
+ *         false - w przeciwnym przypadku.
+ */
+static bool slotContains(uint64_t offset, uint64_t count, size_t size, uint64_t slotSize) {
+    return offset >= sizeof(ShmSlot) && offset % sizeof(uint64_t) == 0 && offset < slotSize &&
+           count <= (slotSize - 1 - offset) / size;
+}
+
+/**
+ * Odczytuje tablicę zapisaną w miejscu. Piszący może w tym czasie zmieniać miejsce, więc położenie każdej części
+ * jest sprawdzane.
+ * @param shm - wskaźnik na segment.
+ * @param slot - numer miejsca.
+ * @param table - wskaźnik na tablicę, która zostanie wypełniona.
+ * @return true - jeśli części tablicy leżą w miejscu.
+ *         false - w przeciwnym przypadku.
+ */
+static bool slotRead(PhfwdShm const *shm, uint32_t slot, PhfwdStaticTable *table) {
+    unsigned char const *base = shmSlot(shm, slot);
+    uint64_t slotSize = shmHeader(shm)->slotSize;
+    ShmSlot layout;
+
+    memcpy(&layout, base, sizeof(ShmSlot));
+
+    if (!slotContains(layout.prefixes, layout.prefixCount, sizeof(PhfwdStaticNode), slotSize) ||
+        !slotContains(layout.reverse, layout.reverseCount, sizeof(PhfwdStaticNode), slotSize) ||
+        !slotContains(layout.lists, layout.listCount, sizeof(uint32_t), slotSize) ||
+        !slotContains(layout.strings, layout.stringsSize, sizeof(char), slotSize))
+        return false;
+
+    table->prefixes = (PhfwdStaticNode const *) (base + layout.prefixes);
+    table->prefixCount = layout.prefixCount;
+    table->reverse = (PhfwdStaticNode const *) (base + layout.reverse);
+    table->reverseCount = layout.reverseCount;
+    table->lists = (uint32_t const *) (base + layout.lists);
+    table->listCount = layout.listCount;
+    table->strings = (char const *) (base + layout.strings);
+    table->stringsSize = layout.stringsSize;
+    return true;
+}
+
+/**
+ * Wykonuje zapytanie o ostatnio opublikowaną tablicę, powtarzając je, jeśli piszący zaczął nadpisywać czytane
+ * miejsce.
+ * @param shm - wskaźnik na segment.
+ * @param num - numer, którego dotyczy zapytanie.
+ * @param query - zapytanie o stałą tablicę.
+ * @return - wynik zapytania.
+ */
+static PhoneNumbers *shmQuery(PhfwdShm const *shm, char const *num,
+                              PhoneNumbers *(*query)(PhfwdStaticTable const *, char const *)) {
+    if (shm == NULL)
+        return NULL;
+
+    ShmHeader *header = shmHeader(shm);
+
+    while (true) {
+        uint64_t before = atomic_load_explicit(&header->sequence, memory_order_acquire);
+        uint32_t slot = atomic_load_explicit(&header->active, memory_order_acquire) & 1;
+        PhfwdStaticTable table;
+        PhoneNumbers *result = slotRead(shm, slot, &table) ? query(&table, num) : NULL;
+
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t after = atomic_load_explicit(&header->sequence, memory_order_relaxed);
+
+        // Jeśli przed zapytaniem trwała publikacja, miejsce slot mogło być już przez nią zapisywane.
+        if (after <= (before | 1) + 1)
+            return result;
+
+        phnumDelete(result);
+    }
+}
+
+PhoneNumbers *phfwdShmGet(PhfwdShm const *shm, char const *num) {
+    return shmQuery(shm, num, phfwdStaticGet);
+}
+
+PhoneNumbers *phfwdShmReverse(PhfwdShm const *shm, char const *num) {
+    return shmQuery(shm, num, phfwdStaticReverse);
+}
+
+void phfwdShmClose(PhfwdShm *shm) {
+    if (shm == NULL)
+        return;
+
+    munmap(shm->base, shm->size);
+    free(shm);
+}
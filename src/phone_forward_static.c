@@ -0,0 +1,889 @@
+/** @file
+ * Implementacja zapytań o przekierowania zapisane w stałej tablicy.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "trie.h"
+#include "phone_forward_static.h"
+#include "phone_forward_query.h"
+
+/**
+ * Indeks oznaczający brak węzła.
+ */
+#define NO_NODE UINT32_MAX
+
+/**
+ * Co który numer listy drzewa przekierowań jest zapisany w całości.
+ */
+#define RESTART_INTERVAL 16
+
+/**
+ * Największa długość wspólnego początku z poprzednim numerem, jaką można zapisać w jednym znaku.
+ */
+#define MAX_SHARED 254
+
+/**
+ * @struct StaticOrder
+ * @brief StaticOrder jest tablicą węzłów drzewa w kolejności przeszukiwania wszerz.
+ */
+struct StaticOrder {
+    void **nodes; ///< Węzły drzewa.
+    size_t count; ///< Liczba węzłów.
+    size_t size; ///< Rozmiar tablicy nodes.
+};
+typedef struct StaticOrder StaticOrder;
+
+/**
+ * Liczy zapalone bity liczby.
+ * @param mask - liczba.
+ * @return - liczba zapalonych bitów.
+ */
+static uint32_t countBits(uint32_t mask) {
+    uint32_t result = 0;
+
+    while (mask != 0) {
+        mask &= mask - 1;
+        result++;
+    }
+    return result;
+}
+
+/**
+ * Powiększa tablicę tak, żeby zmieściła co najmniej @p needed elementów.
+ * @param array - wskaźnik na tablicę.
+ * @param size - wskaźnik na rozmiar tablicy.
+ * @param needed - potrzebna liczba elementów.
+ * @param element - rozmiar elementu.
+ * @return true - jeśli tablica mieści @p needed elementów.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool growArray(void **array, size_t *size, size_t needed, size_t element) {
+    if (needed <= *size)
+        return true;
+
+    size_t newSize = (*size == 0) ? 64 : *size;
+    while (newSize < needed)
+        newSize *= 2;
+
+    void *grown = realloc(*array, element * newSize);
+    if (grown == NULL)
+        return false;
+    *array = grown;
+    *size = newSize;
+    return true;
+}
+
+/**
+ * Wyznacza dziecko węzła odpowiadające znakowi o kodzie @p sign.
+ * @param nodes - tablica węzłów drzewa.
+ * @param count - liczba węzłów drzewa.
+ * @param idx - indeks węzła.
+ * @param sign - kod znaku.
+ * @return - indeks dziecka lub NO_NODE, jeśli go nie ma lub indeks wykracza poza tablicę.
+ */
+static uint32_t staticChild(PhfwdStaticNode const *nodes, size_t count, uint32_t idx, int sign) {
+    uint16_t children = nodes[idx].children;
+
+    if ((children & (1u << sign)) == 0)
+        return NO_NODE;
+
+    uint64_t child = (uint64_t) nodes[idx].firstChild + countBits(children & ((1u << sign) - 1));
+    return (child < count) ? (uint32_t) child : NO_NODE;
+}
+
+/**
+ * Wyznacza numer zapisany w liście węzła.
+ * @param table - wskaźnik na stałą tablicę przekierowań.
+ * @param node - węzeł drzewa.
+ * @param k - numer elementu listy.
+ * @return - wskaźnik na numer lub NULL, jeśli indeks lub przesunięcie wykracza poza tablicę.
+ */
+static char const *staticString(PhfwdStaticTable const *table, PhfwdStaticNode const *node, uint32_t k) {
+    uint64_t position = (uint64_t) node->first + k;
+
+    if (position >= table->listCount)
+        return NULL;
+
+    // Przesunięcie jest odczytywane raz, bo tablica może być w tym czasie zmieniana (phone_forward_shm.c).
+    uint32_t offset = table->lists[position];
+    return (offset < table->stringsSize) ? table->strings + offset : NULL;
+}
+
+/**
+ * Sprawdza, czy tablica ma korzenie obu drzew, a ostatni numer jest zakończony, więc żaden numer nie wykracza
+ * poza tablicę znaków.
+ * @param table - wskaźnik na stałą tablicę przekierowań.
+ * @return true - jeśli tablica jest poprawna.
+ *         false - w przeciwnym przypadku.
+ */
+static bool staticValid(PhfwdStaticTable const *table) {
+    return table != NULL && table->prefixCount > 0 && table->reverseCount > 0 && table->stringsSize > 0 &&
+           table->strings[table->stringsSize - 1] == '\0';
+}
+
+PhoneNumbers *phfwdStaticGet(PhfwdStaticTable const *table, char const *num) {
+    if (!staticValid(table))
+        return NULL;
+    if (!isStringAPhoneNumber(num))
+        return phnumSingle(NULL, NULL);
+
+    char const *diversion = "";
+    size_t length = 0;
+    uint32_t idx = 0;
+
+    for (size_t i = 0; num[i] != '\0'; i++) {
+        idx = staticChild(table->prefixes, table->prefixCount, idx, charToNum(num[i]));
+        if (idx == NO_NODE)
+            break;
+
+        if (table->prefixes[idx].count > 0) {
+            diversion = staticString(table, &table->prefixes[idx], 0);
+            if (diversion == NULL)
+                return NULL;
+            length = i + 1;
+        }
+    }
+
+    PhoneNumbers *result = phnumSingle(NULL, NULL);
+
+    if (result != NULL && !phnumAppend(result, diversion, num + length)) {
+        phnumDelete(result);
+        return NULL;
+    }
+    return result;
+}
+
+/**
+ * Dekoduje listę numerów węzła drzewa przekierowań i dopisuje do wyniku każdy numer z dołączoną końcówką
+ * @p suffix. Długości wspólnych początków i końce numerów są sprawdzane, więc uszkodzona lista nie powoduje
+ * odczytu spoza tablicy.
+ * @param table - wskaźnik na stałą tablicę przekierowań.
+ * @param node - węzeł drzewa przekierowań z niepustą listą.
+ * @param suffix - końcówka numeru z zapytania.
+ * @param result - wynik zapytania.
+ * @param prefix - wskaźnik na bufor na dekodowany numer.
+ * @param size - wskaźnik na rozmiar bufora.
+ * @return true - jeśli udało się dopisać numery.
+ *         false - jeśli lista jest uszkodzona lub nie powiodła się alokacja pamięci.
+ */
+static bool decodeList(PhfwdStaticTable const *table, PhfwdStaticNode const *node, char const *suffix,
+                       PhoneNumbers *result, char **prefix, size_t *size) {
+    char const *p = staticString(table, node, 0);
+    char const *end = table->strings + table->stringsSize;
+    size_t length = 0;
+
+    if (p == NULL)
+        return false;
+
+    for (uint32_t k = 0; k < node->count; k++) {
+        if (p >= end || *p == '\0')
+            return false;
+
+        size_t shared = (size_t) (unsigned char) *p - 1;
+        p++;
+        char const *stop = (char const *) memchr(p, '\0', (size_t) (end - p));
+
+        if (stop == NULL || shared > length ||
+            !growArray((void **) prefix, size, shared + (size_t) (stop - p) + 1, sizeof(char)))
+            return false;
+
+        memcpy(*prefix + shared, p, (size_t) (stop - p) + 1);
+        length = shared + (size_t) (stop - p);
+
+        if (!phnumAppend(result, *prefix, suffix))
+            return false;
+        p = stop + 1;
+    }
+    return true;
+}
+
+PhoneNumbers *phfwdStaticReverse(PhfwdStaticTable const *table, char const *num) {
+    if (!staticValid(table))
+        return NULL;
+    if (!isStringAPhoneNumber(num))
+        return phnumSingle(NULL, NULL);
+
+    PhoneNumbers *result = phnumSingle(NULL, NULL);
+    if (result == NULL)
+        return NULL;
+
+    char *prefix = NULL;
+    size_t size = 0;
+    bool decoded = true;
+    uint32_t idx = 0;
+
+    for (size_t i = 0; idx != NO_NODE && decoded; i++) {
+        PhfwdStaticNode const *node = &table->reverse[idx];
+
+        if (node->count > 0)
+            decoded = decodeList(table, node, num + i, result, &prefix, &size);
+
+        if (num[i] == '\0')
+            break;
+        idx = staticChild(table->reverse, table->reverseCount, idx, charToNum(num[i]));
+    }
+
+    free(prefix);
+
+    if (!decoded) {
+        phnumDelete(result);
+        return NULL;
+    }
+    return reverseFinish(result, num);
+}
+
+/**
+ * Dopisuje węzeł na koniec tablicy węzłów.
+ * @param order - wskaźnik na tablicę węzłów.
+ * @param node - węzeł.
+ * @return true - jeśli udało się dopisać węzeł.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool orderPush(StaticOrder *order, void *node) {
+    if (order->count == order->size) {
+        size_t newSize = (order->size == 0) ? 64 : 2 * order->size;
+        void **nodes = (void **) realloc(order->nodes, sizeof(void *) * newSize);
+        if (nodes == NULL)
+            return false;
+        order->nodes = nodes;
+        order->size = newSize;
+    }
+    order->nodes[order->count++] = node;
+    return true;
+}
+
+/**
+ * Ustawia węzły drzewa PhoneForwardPrefixes w kolejności przeszukiwania wszerz, więc dzieci każdego węzła
+ * zajmują kolejne miejsca.
+ * @param root - korzeń drzewa.
+ * @param order - wskaźnik na pustą tablicę węzłów.
+ * @return true - jeśli udało się ustawić węzły.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool orderPrefixes(PhoneForwardPrefixes *root, StaticOrder *order) {
+    if (!orderPush(order, root))
+        return false;
+
+    for (size_t i = 0; i < order->count; i++) {
+        PhoneForwardPrefixes *node = (PhoneForwardPrefixes *) order->nodes[i];
+
+        for (int s = 0; s < SIGNS_IN_NUMBER; s++) {
+            if ((node->children)[s] != NULL && !orderPush(order, (node->children)[s]))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Ustawia węzły drzewa PhoneForwardReverse w kolejności przeszukiwania wszerz, więc dzieci każdego węzła
+ * zajmują kolejne miejsca.
+ * @param root - korzeń drzewa.
+ * @param order - wskaźnik na pustą tablicę węzłów.
+ * @return true - jeśli udało się ustawić węzły.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool orderReverse(PhoneForwardReverse *root, StaticOrder *order) {
+    if (!orderPush(order, root))
+        return false;
+
+    for (size_t i = 0; i < order->count; i++) {
+        PhoneForwardReverse *node = (PhoneForwardReverse *) order->nodes[i];
+
+        for (int s = 0; s < SIGNS_IN_NUMBER; s++) {
+            if ((node->children)[s] != NULL && !orderPush(order, (node->children)[s]))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Wyznacza maskę dzieci węzła drzewa PhoneForwardPrefixes.
+ * @param node - węzeł drzewa.
+ * @return - maska bitowa znaków, dla których węzeł ma dziecko.
+ */
+static uint16_t prefixesMask(PhoneForwardPrefixes const *node) {
+    uint16_t mask = 0;
+
+    for (int s = 0; s < SIGNS_IN_NUMBER; s++) {
+        if ((node->children)[s] != NULL)
+            mask |= (uint16_t) (1u << s);
+    }
+    return mask;
+}
+
+/**
+ * Wyznacza maskę dzieci węzła drzewa PhoneForwardReverse.
+ * @param node - węzeł drzewa.
+ * @return - maska bitowa znaków, dla których węzeł ma dziecko.
+ */
+static uint16_t reverseMask(PhoneForwardReverse const *node) {
+    uint16_t mask = 0;
+
+    for (int s = 0; s < SIGNS_IN_NUMBER; s++) {
+        if ((node->children)[s] != NULL)
+            mask |= (uint16_t) (1u << s);
+    }
+    return mask;
+}
+
+/**
+ * Ustawia dzieci węzła tablicy. Dzieci dostają kolejne indeksy od @p *next.
+ * @param node - wypełniany węzeł tablicy.
+ * @param mask - maska bitowa znaków, dla których węzeł ma dziecko.
+ * @param next - wskaźnik na indeks, który dostanie kolejne dziecko w kolejności przeszukiwania wszerz.
+ */
+static void fillChildren(PhfwdStaticNode *node, uint16_t mask, uint32_t *next) {
+    node->firstChild = *next;
+    node->children = mask;
+    *next += countBits(mask);
+}
+
+/**
+ * Oznaczenie wolnego miejsca w tablicy z haszowaniem.
+ */
+#define FREE_SLOT UINT32_MAX
+
+/**
+ * Początkowa wartość skrótu FNV-1a.
+ */
+#define HASH_SEED 0xcbf29ce484222325ull
+
+/**
+ * @struct InternSlot
+ * @brief InternSlot jest miejscem tablicy z haszowaniem, które zapamiętuje fragment budowanej tablicy: numer,
+ * listę numerów lub blok dzieci.
+ */
+struct InternSlot {
+    uint64_t hash; ///< Skrót fragmentu.
+    uint32_t first; ///< Indeks początku fragmentu.
+    uint32_t count; ///< Długość fragmentu lub FREE_SLOT, jeśli miejsce jest wolne.
+};
+typedef struct InternSlot InternSlot;
+
+/**
+ * @struct InternTable
+ * @brief InternTable jest tablicą z haszowaniem o adresowaniu otwartym, która pozwala znaleźć zapisany już
+ * identyczny fragment.
+ */
+struct InternTable {
+    InternSlot *slots; ///< Miejsca tablicy.
+    size_t size; ///< Liczba miejsc, potęga dwójki.
+    size_t used; ///< Liczba zajętych miejsc.
+};
+typedef struct InternTable InternTable;
+
+/**
+ * Rodzaj fragmentów zapamiętanych w tablicy z haszowaniem.
+ */
+enum InternKind {
+    INTERN_STRING, ///< Napisy w tablicy znaków.
+    INTERN_LIST, ///< Listy numerów w tablicy list.
+    INTERN_BLOCK ///< Bloki dzieci w tablicy węzłów.
+};
+typedef enum InternKind InternKind;
+
+/**
+ * @struct StaticBuilder
+ * @brief StaticBuilder przechowuje budowane tablice. Identyczne napisy, listy i bloki dzieci są zapisywane
+ * tylko raz, więc identyczne poddrzewa zajmują w tablicy węzłów jedno miejsce.
+ */
+struct StaticBuilder {
+    PhfwdStaticNode *nodes; ///< Węzły budowanego drzewa.
+    size_t nodeCount; ///< Liczba węzłów.
+    size_t nodeSize; ///< Rozmiar tablicy nodes.
+    uint32_t *lists; ///< Przesunięcia numerów w tablicy strings.
+    size_t listCount; ///< Liczba elementów tablicy lists.
+    size_t listSize; ///< Rozmiar tablicy lists.
+    char *strings; ///< Numery zakończone znakiem '\0'.
+    size_t stringsSize; ///< Liczba zajętych znaków.
+    size_t stringsCapacity; ///< Rozmiar tablicy strings.
+    uint32_t *scratch; ///< Lista numerów węzła przed zapisaniem jej w tablicy lists.
+    size_t scratchSize; ///< Rozmiar tablicy scratch.
+    char const **sorted; ///< Posortowane numery węzła drzewa przekierowań.
+    size_t sortedSize; ///< Rozmiar tablicy sorted.
+    char *encoded; ///< Zakodowana lista numerów węzła drzewa przekierowań.
+    size_t encodedSize; ///< Rozmiar tablicy encoded.
+    InternTable stringTable; ///< Zapisane numery.
+    InternTable listTable; ///< Zapisane listy.
+    InternTable blockTable; ///< Zapisane bloki dzieci budowanego drzewa.
+};
+typedef struct StaticBuilder StaticBuilder;
+
+/**
+ * Dołącza słowo do skrótu FNV-1a.
+ * @param hash - dotychczasowy skrót.
+ * @param word - dołączane słowo.
+ * @return - nowy skrót.
+ */
+static uint64_t hashWord(uint64_t hash, uint32_t word) {
+    return (hash ^ word) * 0x100000001b3ull;
+}
+
+/**
+ * Porównuje dwa węzły tablicy.
+ * @param a - pierwszy węzeł.
+ * @param b - drugi węzeł.
+ * @return true - jeśli węzły mają te same dzieci i tę samą listę.
+ *         false - w przeciwnym przypadku.
+ */
+static bool nodesEqual(PhfwdStaticNode const *a, PhfwdStaticNode const *b) {
+    return a->firstChild == b->firstChild && a->first == b->first && a->count == b->count &&
+           a->children == b->children;
+}
+
+/**
+ * Sprawdza, czy miejsce tablicy z haszowaniem zapamiętuje podany fragment.
+ * @param kind - rodzaj fragmentu.
+ * @param data - tablica, w której zapisane są fragmenty tego rodzaju.
+ * @param slot - zajęte miejsce.
+ * @param key - szukany fragment.
+ * @param count - długość szukanego fragmentu.
+ * @return true - jeśli fragmenty są identyczne.
+ *         false - w przeciwnym przypadku.
+ */
+static bool internMatches(InternKind kind, void const *data, InternSlot const *slot, void const *key,
+                          uint32_t count) {
+    if (slot->count != count)
+        return false;
+
+    if (kind == INTERN_STRING)
+        return memcmp((char const *) data + slot->first, key, count) == 0;
+    if (kind == INTERN_LIST)
+        return memcmp((uint32_t const *) data + slot->first, key, sizeof(uint32_t) * count) == 0;
+
+    PhfwdStaticNode const *block = (PhfwdStaticNode const *) data + slot->first;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!nodesEqual(&block[i], (PhfwdStaticNode const *) key + i))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Szuka fragmentu w tablicy z haszowaniem.
+ * @param table - tablica z haszowaniem z co najmniej jednym wolnym miejscem.
+ * @param kind - rodzaj fragmentu.
+ * @param data - tablica, w której zapisane są fragmenty tego rodzaju.
+ * @param hash - skrót szukanego fragmentu.
+ * @param key - szukany fragment.
+ * @param count - długość szukanego fragmentu.
+ * @return - miejsce, które zapamiętuje identyczny fragment, lub wolne miejsce, w którym należy go zapamiętać.
+ */
+static InternSlot *internFind(InternTable const *table, InternKind kind, void const *data, uint64_t hash,
+                              void const *key, uint32_t count) {
+    size_t i = (size_t) hash & (table->size - 1);
+
+    while (table->slots[i].count != FREE_SLOT &&
+           (table->slots[i].hash != hash || !internMatches(kind, data, &table->slots[i], key, count)))
+        i = (i + 1) & (table->size - 1);
+    return &table->slots[i];
+}
+
+/**
+ * Powiększa tablicę z haszowaniem, jeśli po dodaniu fragmentu byłaby zapełniona w ponad połowie.
+ * @param table - wskaźnik na tablicę z haszowaniem.
+ * @return true - jeśli w tablicy jest miejsce na kolejny fragment.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool internReserve(InternTable *table) {
+    if (2 * (table->used + 1) <= table->size)
+        return true;
+
+    size_t newSize = (table->size == 0) ? 64 : 2 * table->size;
+    InternSlot *slots = (InternSlot *) malloc(sizeof(InternSlot) * newSize);
+    if (slots == NULL)
+        return false;
+
+    for (size_t i = 0; i < newSize; i++)
+        slots[i].count = FREE_SLOT;
+
+    // Zapamiętane fragmenty są różne, więc wystarczy je rozmieścić według skrótów.
+    for (size_t i = 0; i < table->size; i++) {
+        if (table->slots[i].count == FREE_SLOT)
+            continue;
+
+        size_t j = (size_t) table->slots[i].hash & (newSize - 1);
+        while (slots[j].count != FREE_SLOT)
+            j = (j + 1) & (newSize - 1);
+        slots[j] = table->slots[i];
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->size = newSize;
+    return true;
+}
+
+/**
+ * Zapamiętuje fragment w wolnym miejscu tablicy z haszowaniem.
+ * @param table - wskaźnik na tablicę z haszowaniem.
+ * @param slot - wolne miejsce znalezione przez internFind.
+ * @param hash - skrót fragmentu.
+ * @param first - indeks początku fragmentu.
+ * @param count - długość fragmentu.
+ */
+static void internAdd(InternTable *table, InternSlot *slot, uint64_t hash, uint32_t first, uint32_t count) {
+    slot->hash = hash;
+    slot->first = first;
+    slot->count = count;
+    table->used++;
+}
+
+/**
+ * Zapisuje napis w tablicy znaków, jeśli nie ma w niej jeszcze identycznego napisu.
+ * @param b - wskaźnik na budowane tablice.
+ * @param data - napis, np. numer lub zakodowana lista numerów.
+ * @param size - długość napisu razem z kończącym go znakiem '\0'.
+ * @param offset - wskaźnik, pod którym zostanie zapisane przesunięcie napisu.
+ * @return true - jeśli udało się zapisać napis.
+ *         false - jeśli tablica znaków byłaby za duża lub nie powiodła się alokacja pamięci.
+ */
+static bool internBytes(StaticBuilder *b, char const *data, size_t size, uint32_t *offset) {
+    uint64_t hash = HASH_SEED;
+
+    for (size_t i = 0; i < size; i++)
+        hash = hashWord(hash, (unsigned char) data[i]);
+
+    if (size >= UINT32_MAX - b->stringsSize || !internReserve(&b->stringTable))
+        return false;
+
+    InternSlot *slot = internFind(&b->stringTable, INTERN_STRING, b->strings, hash, data, (uint32_t) size);
+
+    if (slot->count == FREE_SLOT) {
+        if (!growArray((void **) &b->strings, &b->stringsCapacity, b->stringsSize + size, sizeof(char)))
+            return false;
+
+        memcpy(b->strings + b->stringsSize, data, size);
+        internAdd(&b->stringTable, slot, hash, (uint32_t) b->stringsSize, (uint32_t) size);
+        b->stringsSize += size;
+    }
+
+    *offset = slot->first;
+    return true;
+}
+
+/**
+ * Zapisuje listę numerów z tablicy scratch w tablicy list, jeśli nie ma w niej jeszcze identycznej listy.
+ * @param b - wskaźnik na budowane tablice.
+ * @param count - długość listy.
+ * @param node - węzeł tablicy, w którym zostanie zapisany początek i długość listy.
+ * @return true - jeśli udało się zapisać listę.
+ *         false - jeśli tablica list byłaby za duża lub nie powiodła się alokacja pamięci.
+ */
+static bool internList(StaticBuilder *b, uint32_t count, PhfwdStaticNode *node) {
+    node->count = count;
+    node->first = 0;
+
+    if (count == 0)
+        return true;
+
+    uint64_t hash = HASH_SEED;
+    for (uint32_t i = 0; i < count; i++)
+        hash = hashWord(hash, b->scratch[i]);
+
+    if (count >= UINT32_MAX - b->listCount || !internReserve(&b->listTable))
+        return false;
+
+    InternSlot *slot = internFind(&b->listTable, INTERN_LIST, b->lists, hash, b->scratch, count);
+
+    if (slot->count == FREE_SLOT) {
+        if (!growArray((void **) &b->lists, &b->listSize, b->listCount + count, sizeof(uint32_t)))
+            return false;
+
+        memcpy(b->lists + b->listCount, b->scratch, sizeof(uint32_t) * count);
+        internAdd(&b->listTable, slot, hash, (uint32_t) b->listCount, count);
+        b->listCount += count;
+    }
+
+    node->first = slot->first;
+    return true;
+}
+
+/**
+ * Zapisuje blok dzieci w tablicy węzłów, jeśli nie ma w niej jeszcze identycznego bloku.
+ * @param b - wskaźnik na budowane tablice.
+ * @param block - węzły dzieci, już z indeksami swoich bloków.
+ * @param count - liczba dzieci.
+ * @param first - wskaźnik, pod którym zostanie zapisany indeks początku bloku.
+ * @return true - jeśli udało się zapisać blok.
+ *         false - jeśli tablica węzłów byłaby za duża lub nie powiodła się alokacja pamięci.
+ */
+static bool internBlock(StaticBuilder *b, PhfwdStaticNode const *block, uint32_t count, uint32_t *first) {
+    *first = 0;
+
+    if (count == 0)
+        return true;
+
+    uint64_t hash = HASH_SEED;
+    for (uint32_t i = 0; i < count; i++) {
+        hash = hashWord(hash, block[i].firstChild);
+        hash = hashWord(hash, block[i].first);
+        hash = hashWord(hash, block[i].count);
+        hash = hashWord(hash, block[i].children);
+    }
+
+    if (count >= UINT32_MAX - b->nodeCount || !internReserve(&b->blockTable))
+        return false;
+
+    InternSlot *slot = internFind(&b->blockTable, INTERN_BLOCK, b->nodes, hash, block, count);
+
+    if (slot->count == FREE_SLOT) {
+        if (!growArray((void **) &b->nodes, &b->nodeSize, b->nodeCount + count, sizeof(PhfwdStaticNode)))
+            return false;
+
+        memcpy(b->nodes + b->nodeCount, block, sizeof(PhfwdStaticNode) * count);
+        internAdd(&b->blockTable, slot, hash, (uint32_t) b->nodeCount, count);
+        b->nodeCount += count;
+    }
+
+    *first = slot->first;
+    return true;
+}
+
+/**
+ * Ustawia listę i maskę dzieci węzła tablicy odpowiadającego węzłowi drzewa PhoneForwardPrefixes.
+ * @param b - wskaźnik na budowane tablice.
+ * @param node - węzeł drzewa.
+ * @param record - wypełniany węzeł tablicy.
+ * @return true - jeśli udało się zapisać przekierowanie węzła.
+ *         false - jeśli tablice byłyby za duże lub nie powiodła się alokacja pamięci.
+ */
+static bool prefixesRecord(StaticBuilder *b, PhoneForwardPrefixes const *node, PhfwdStaticNode *record) {
+    uint32_t count = 0;
+
+    if (node->diversion != NULL) {
+        if (!growArray((void **) &b->scratch, &b->scratchSize, 1, sizeof(uint32_t)) ||
+            !internBytes(b, node->diversion, strlen(node->diversion) + 1, &b->scratch[0]))
+            return false;
+        count = 1;
+    }
+
+    record->children = prefixesMask(node);
+    return internList(b, count, record);
+}
+
+/**
+ * Porównuje dwa numery.
+ * @param a - wskaźnik na pierwszy numer.
+ * @param b - wskaźnik na drugi numer.
+ * @return - wynik funkcji strcmp dla numerów.
+ */
+static int compareNumbers(const void *a, const void *b) {
+    return strcmp(*(char const *const *) a, *(char const *const *) b);
+}
+
+/**
+ * Koduje posortowane numery węzła w tablicy encoded. Każdy numer jest zapisany jako znak o kodzie równym długości
+ * wspólnego początku z poprzednim numerem powiększonej o 1, reszta numeru i znak '\0'. Co RESTART_INTERVAL-ty
+ * numer jest zapisany w całości.
+ * @param b - wskaźnik na budowane tablice.
+ * @param count - liczba posortowanych numerów.
+ * @param size - wskaźnik, pod którym zostanie zapisana długość zakodowanej listy.
+ * @return true - jeśli udało się zakodować numery.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool encodeList(StaticBuilder *b, size_t count, size_t *size) {
+    *size = 0;
+
+    for (size_t k = 0; k < count; k++) {
+        char const *num = b->sorted[k];
+        size_t shared = 0;
+
+        if (k % RESTART_INTERVAL != 0) {
+            char const *prev = b->sorted[k - 1];
+            while (shared < MAX_SHARED && num[shared] != '\0' && num[shared] == prev[shared])
+                shared++;
+        }
+
+        size_t rest = strlen(num + shared) + 1;
+        if (!growArray((void **) &b->encoded, &b->encodedSize, *size + rest + 1, sizeof(char)))
+            return false;
+
+        b->encoded[(*size)++] = (char) (shared + 1);
+        memcpy(b->encoded + *size, num + shared, rest);
+        *size += rest;
+    }
+    return true;
+}
+
+/**
+ * Ustawia listę i maskę dzieci węzła tablicy odpowiadającego węzłowi drzewa PhoneForwardReverse. Numery węzła
+ * są sortowane i zapisywane jako jeden napis, w którym każdy numer pamięta tylko różnicę względem poprzedniego.
+ * @param b - wskaźnik na budowane tablice.
+ * @param node - węzeł drzewa.
+ * @param record - wypełniany węzeł tablicy.
+ * @return true - jeśli udało się zapisać prefiksy węzła.
+ *         false - jeśli tablice byłyby za duże lub nie powiodła się alokacja pamięci.
+ */
+static bool reverseRecord(StaticBuilder *b, PhoneForwardReverse const *node, PhfwdStaticNode *record) {
+    size_t count = (node->prefixes == NULL) ? 0 : node->prefixes->count;
+
+    // Tablica węzła jest uporządkowana według funkcji numCompare, a format wymaga porządku funkcji strcmp.
+    if (count > UINT32_MAX || !growArray((void **) &b->sorted, &b->sortedSize, count, sizeof(char const *)))
+        return false;
+    for (size_t i = 0; i < count; i++)
+        b->sorted[i] = (node->prefixes->nums)[i];
+
+    record->children = reverseMask(node);
+
+    if (count == 0)
+        return internList(b, 0, record);
+
+    qsort(b->sorted, count, sizeof(char const *), compareNumbers);
+    size_t size = 0;
+
+    if (!encodeList(b, count, &size) ||
+        !growArray((void **) &b->scratch, &b->scratchSize, 1, sizeof(uint32_t)) ||
+        !internBytes(b, b->encoded, size, &b->scratch[0]) || !internList(b, 1, record))
+        return false;
+
+    record->count = (uint32_t) count;
+    return true;
+}
+
+/**
+ * Zapisuje drzewo w tablicy węzłów budowanych tablic. Węzły są przetwarzane od ostatniego w kolejności
+ * przeszukiwania wszerz, więc dzieci węzła są gotowe przed nim, a identyczne poddrzewa dają identyczne bloki
+ * dzieci, zapisywane tylko raz. Korzeń zajmuje miejsce 0.
+ * @param b - wskaźnik na budowane tablice z pustą tablicą węzłów.
+ * @param order - węzły drzewa w kolejności przeszukiwania wszerz.
+ * @param reverse - czy drzewo jest drzewem PhoneForwardReverse.
+ * @return true - jeśli udało się zapisać drzewo.
+ *         false - jeśli tablice byłyby za duże lub nie powiodła się alokacja pamięci.
+ */
+static bool buildTree(StaticBuilder *b, StaticOrder const *order, bool reverse) {
+    if (order->count > UINT32_MAX)
+        return false;
+
+    PhfwdStaticNode *records = (PhfwdStaticNode *) calloc(order->count, sizeof(PhfwdStaticNode));
+    bool result = records != NULL && growArray((void **) &b->nodes, &b->nodeSize, 1, sizeof(PhfwdStaticNode));
+    uint32_t next = 1;
+    b->nodeCount = 1;
+
+    // Najpierw firstChild wskazuje pierwsze dziecko w kolejności przeszukiwania wszerz.
+    for (size_t i = 0; i < order->count && result; i++) {
+        if (reverse)
+            result = reverseRecord(b, (PhoneForwardReverse const *) order->nodes[i], &records[i]);
+        else
+            result = prefixesRecord(b, (PhoneForwardPrefixes const *) order->nodes[i], &records[i]);
+        fillChildren(&records[i], records[i].children, &next);
+    }
+
+    for (size_t i = order->count; i > 0 && result; i--) {
+        PhfwdStaticNode *record = &records[i - 1];
+        result = internBlock(b, records + record->firstChild, countBits(record->children), &(record->firstChild));
+    }
+
+    if (result)
+        b->nodes[0] = records[0];
+
+    free(records);
+    free(b->blockTable.slots);
+    b->blockTable.slots = NULL;
+    b->blockTable.size = 0;
+    b->blockTable.used = 0;
+    return result;
+}
+
+/**
+ * Przenosi węzły budowanego drzewa do osobnej tablicy, żeby można było budować kolejne drzewo.
+ * @param b - wskaźnik na budowane tablice.
+ * @param count - wskaźnik, pod którym zostanie zapisana liczba węzłów.
+ * @return - tablica węzłów, którą trzeba zwolnić funkcją free.
+ */
+static PhfwdStaticNode *takeNodes(StaticBuilder *b, size_t *count) {
+    PhfwdStaticNode *nodes = b->nodes;
+
+    *count = b->nodeCount;
+    b->nodes = NULL;
+    b->nodeCount = 0;
+    b->nodeSize = 0;
+    return nodes;
+}
+
+/**
+ * Składa stałą tablicę z gotowych tablic węzłów, list i znaków.
+ * @param b - wskaźnik na budowane tablice z oboma drzewami.
+ * @param prefixNodes - węzły drzewa PhoneForwardPrefixes.
+ * @param prefixCount - liczba węzłów drzewa PhoneForwardPrefixes.
+ * @param reverseNodes - węzły drzewa PhoneForwardReverse.
+ * @param reverseCount - liczba węzłów drzewa PhoneForwardReverse.
+ * @return - wskaźnik na utworzoną tablicę lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+static PhfwdStaticTable *buildTable(StaticBuilder const *b, PhfwdStaticNode const *prefixNodes,
+                                    size_t prefixCount, PhfwdStaticNode const *reverseNodes,
+                                    size_t reverseCount) {
+    // Tablica i jej zawartość zajmują jeden blok pamięci. Pusty napis na końcu gwarantuje, że tablica znaków nie
+    // jest pusta i kończy się znakiem '\0'.
+    size_t size = sizeof(PhfwdStaticTable) + sizeof(PhfwdStaticNode) * (prefixCount + reverseCount) +
+                  sizeof(uint32_t) * b->listCount + b->stringsSize + 1;
+    PhfwdStaticTable *table = (PhfwdStaticTable *) malloc(size);
+    if (table == NULL)
+        return NULL;
+
+    PhfwdStaticNode *nodes = (PhfwdStaticNode *) (table + 1);
+    memcpy(nodes, prefixNodes, sizeof(PhfwdStaticNode) * prefixCount);
+    memcpy(nodes + prefixCount, reverseNodes, sizeof(PhfwdStaticNode) * reverseCount);
+    table->prefixes = nodes;
+    table->prefixCount = prefixCount;
+    table->reverse = nodes + prefixCount;
+    table->reverseCount = reverseCount;
+
+    uint32_t *lists = (uint32_t *) (nodes + prefixCount + reverseCount);
+    if (b->listCount > 0)
+        memcpy(lists, b->lists, sizeof(uint32_t) * b->listCount);
+    table->lists = lists;
+    table->listCount = b->listCount;
+
+    char *strings = (char *) (lists + b->listCount);
+    if (b->stringsSize > 0)
+        memcpy(strings, b->strings, b->stringsSize);
+    strings[b->stringsSize] = '\0';
+    table->strings = strings;
+    table->stringsSize = b->stringsSize + 1;
+    return table;
+}
+
+PhfwdStaticTable *phfwdStaticBuild(PhoneForward const *pf) {
+    if (pf == NULL || pf->prefixes == NULL || pf->reverse == NULL)
+        return NULL;
+
+    StaticOrder prefixes = {NULL, 0, 0};
+    StaticOrder reverse = {NULL, 0, 0};
+    StaticBuilder b;
+    memset(&b, 0, sizeof(StaticBuilder));
+    PhfwdStaticNode *prefixNodes = NULL;
+    size_t prefixCount = 0;
+    PhfwdStaticTable *table = NULL;
+
+    if (orderPrefixes(pf->prefixes, &prefixes) && buildTree(&b, &prefixes, false)) {
+        prefixNodes = takeNodes(&b, &prefixCount);
+
+        if (orderReverse(pf->reverse, &reverse) && buildTree(&b, &reverse, true))
+            table = buildTable(&b, prefixNodes, prefixCount, b.nodes, b.nodeCount);
+    }
+
+    free(prefixes.nodes);
+    free(reverse.nodes);
+    free(prefixNodes);
+    free(b.nodes);
+    free(b.lists);
+    free(b.strings);
+    free(b.scratch);
+    free(b.sorted);
+    free(b.encoded);
+    free(b.stringTable.slots);
+    free(b.listTable.slots);
+    return table;
+}
+
+void phfwdStaticDelete(PhfwdStaticTable *table) {
+    free(table);
+}
@@ -0,0 +1,100 @@
+/** @file
+ * Interfejs zapytań o przekierowania zapisane w stałej tablicy, wygenerowanej przez tools/rule_compiler.
+ *
+ * Tablica nie zawiera wskaźników między węzłami: dzieci węzła zajmują kolejne miejsca w tablicy węzłów, a numery
+ * są przesunięciami w jednej tablicy znaków. Dzięki temu cała tablica może być stałą umieszczoną w sekcji danych
+ * tylko do odczytu i nie wymaga tworzenia przy starcie programu.
+ *
+ * Tablica może być grafem: identyczne poddrzewa, np. ten sam wzór przekierowań numerów wewnętrznych powtórzony pod
+ * wieloma numerami kierunkowymi, mają jeden wspólny blok dzieci, a identyczne numery i listy numerów są zapisane
+ * raz. Wynik zapytania jest składany z przekierowania i końcówki numeru z zapytania, więc współdzielenie węzłów
+ * nie zmienia wyników.
+ *
+ * Numery węzła drzewa przekierowań są posortowane i zakodowane przyrostowo w jednym napisie: każdy numer zaczyna
+ * się znakiem o kodzie równym długości wspólnego początku z poprzednim numerem powiększonej o 1, po którym
+ * następuje reszta numeru i znak '\0'. Co szesnasty numer jest zapisany w całości. Sąsiednie numery zwykle mają
+ * długi wspólny początek, więc lista zajmuje dużo mniej miejsca niż osobne numery, a zapytanie dekoduje ją po kolei.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_STATIC_H
+#define PHONE_FORWARD_STATIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "phone_forward.h"
+
+/**
+ * To jest węzeł drzewa zapisanego w stałej tablicy. W drzewie prefiksów węzeł
+ * wskazuje co najwyżej jedno przekierowanie, a w drzewie przekierowań – listę
+ * przekierowywanych prefiksów, zakodowaną w jednym napisie.
+ */
+typedef struct PhfwdStaticNode {
+    uint32_t firstChild; ///< Indeks pierwszego dziecka w tablicy węzłów.
+    uint32_t first;      ///< Indeks elementu tablicy list, który wskazuje
+                         ///< przekierowanie lub zakodowaną listę węzła.
+    uint32_t count;      ///< Liczba numerów węzła.
+    uint16_t children;   ///< Maska bitowa znaków, dla których węzeł ma
+                         ///< dziecko; bit i odpowiada znakowi o kodzie i.
+} PhfwdStaticNode;
+
+/**
+ * To jest stała tablica przekierowań. Korzeniem każdego drzewa jest węzeł
+ * o indeksie 0.
+ */
+typedef struct PhfwdStaticTable {
+    PhfwdStaticNode const *prefixes; ///< Węzły drzewa prefiksów.
+    size_t prefixCount;              ///< Liczba węzłów drzewa prefiksów.
+    PhfwdStaticNode const *reverse;  ///< Węzły drzewa przekierowań.
+    size_t reverseCount;             ///< Liczba węzłów drzewa przekierowań.
+    uint32_t const *lists;           ///< Przesunięcia napisów w tablicy
+                                     ///< @p strings.
+    size_t listCount;                ///< Liczba elementów tablicy @p lists.
+    char const *strings;             ///< Numery i zakodowane listy numerów
+                                     ///< zakończone znakiem '\0'.
+    size_t stringsSize;              ///< Rozmiar tablicy @p strings.
+} PhfwdStaticTable;
+
+/** @brief Wyznacza przekierowanie numeru w stałej tablicy.
+ * Działa jak @ref phfwdGet. Indeksy i przesunięcia zapisane w tablicy są
+ * sprawdzane, więc uszkodzona tablica nie powoduje odczytu spoza niej.
+ * @param[in] table – wskaźnik na stałą tablicę przekierowań;
+ * @param[in] num   – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         @p table ma wartość NULL, tablica jest uszkodzona lub nie udało się
+ *         alokować pamięci.
+ */
+PhoneNumbers *phfwdStaticGet(PhfwdStaticTable const *table, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w stałej tablicy.
+ * Działa jak @ref phfwdReverse. Indeksy i przesunięcia zapisane w tablicy są
+ * sprawdzane, więc uszkodzona tablica nie powoduje odczytu spoza niej.
+ * @param[in] table – wskaźnik na stałą tablicę przekierowań;
+ * @param[in] num   – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         @p table ma wartość NULL, tablica jest uszkodzona lub nie udało się
+ *         alokować pamięci.
+ */
+PhoneNumbers *phfwdStaticReverse(PhfwdStaticTable const *table, char const *num);
+
+/** @brief Tworzy stałą tablicę z przekierowań struktury.
+ * Tablica i cała jej zawartość zajmują jeden blok pamięci, który nie zawiera
+ * wskaźników poza samym nagłówkiem @ref PhfwdStaticTable, więc można go
+ * skopiować lub zapisać do pliku. Identyczne poddrzewa obu drzew oraz
+ * identyczne numery i listy numerów są zapisywane tylko raz.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wskaźnik na utworzoną tablicę lub NULL, gdy @p pf ma wartość NULL,
+ *         przekierowań jest za dużo albo nie udało się alokować pamięci.
+ */
+PhfwdStaticTable *phfwdStaticBuild(PhoneForward const *pf);
+
+/** @brief Usuwa tablicę utworzoną przez @ref phfwdStaticBuild.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] table – wskaźnik na usuwaną tablicę.
+ */
+void phfwdStaticDelete(PhfwdStaticTable *table);
+
+#endif //PHONE_FORWARD_STATIC_H
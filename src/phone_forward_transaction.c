@@ -0,0 +1,249 @@
+/** @file
+ * Implementacja transakcji, które grupują dodawanie i usuwanie przekierowań numerów telefonu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "trie.h"
+#include "memory_context.h"
+#include "phone_forward_journal.h"
+#include "phone_forward_query.h"
+#include "phone_forward_transaction.h"
+#include "phone_forward_lookup.h"
+
+/**
+ * @struct TransactionEntry
+ * @brief TransactionEntry jest pojedynczą operacją zapisaną w transakcji.
+ */
+struct TransactionEntry {
+    PhfwdOperation operation; ///< Rodzaj operacji.
+    char *num1; ///< Prefiks numerów, których dotyczy operacja.
+    char *num2; ///< Przekierowanie prefiksu @p num1 lub NULL, jeśli operacja usuwa przekierowania.
+};
+typedef struct TransactionEntry TransactionEntry;
+
+struct PhfwdTransaction {
+    PhoneForward *pf; ///< Struktura, do której zostaną zastosowane operacje.
+    TransactionEntry *entries; ///< Tablica operacji w kolejności ich zapisania.
+    size_t count; ///< Liczba zapisanych operacji.
+    size_t size; ///< Rozmiar tablicy entries.
+    PhoneForwardPrefixes *prefixes; ///< Korzeń prywatnej wersji drzewa PhoneForwardPrefixes z wykonanymi
+    ///< operacjami lub NULL, jeśli transakcja nie była przygotowywana.
+    PhoneForwardReverse *reverse; ///< Korzeń prywatnej wersji drzewa PhoneForwardReverse lub NULL.
+    PhfwdTeardown *pending; ///< Poddrzewa odłączone przez operacje transakcji, które nie zostały jeszcze usunięte.
+};
+typedef struct PhfwdTransaction PhfwdTransaction;
+
+/**
+ * Zwalnia transakcję razem z prywatną wersją drzew, która nie trafiła do struktury.
+ * @param tx - wskaźnik na transakcję.
+ */
+static void transactionFree(PhfwdTransaction *tx) {
+    PhfwdAllocator const *allocator = &(tx->pf->allocator);
+
+    if (tx->prefixes != NULL)
+        releaseTries(&(tx->pf->account->allocator), tx->prefixes, tx->reverse, tx->pending);
+
+    for (size_t i = 0; i < tx->count; i++) {
+        allocatorFreeString(allocator, (tx->entries)[i].num1);
+        allocatorFreeString(allocator, (tx->entries)[i].num2);
+    }
+    allocatorFree(allocator, tx->entries, sizeof(TransactionEntry) * tx->size);
+    allocatorFree(allocator, tx, sizeof(PhfwdTransaction));
+}
+
+/**
+ * Dopisuje operację na koniec transakcji.
+ * @param tx - wskaźnik na transakcję.
+ * @param operation - rodzaj operacji.
+ * @param num1 - prefiks numerów, których dotyczy operacja.
+ * @param num2 - przekierowanie lub NULL, jeśli operacja usuwa przekierowania.
+ * @return true - jeśli udało się zapisać operację.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool transactionAppend(PhfwdTransaction *tx, PhfwdOperation operation, char const *num1, char const *num2) {
+    PhfwdAllocator const *allocator = &(tx->pf->allocator);
+
+    if (tx->count == tx->size) {
+        size_t newSize = (tx->size == 0) ? 16 : 2 * tx->size;
+        TransactionEntry *entries = (TransactionEntry *) allocatorRealloc(allocator, tx->entries,
+                                                                          sizeof(TransactionEntry) * tx->size,
+                                                                          sizeof(TransactionEntry) * newSize);
+        if (entries == NULL)
+            return false;
+        tx->entries = entries;
+        tx->size = newSize;
+    }
+
+    TransactionEntry *entry = &(tx->entries)[tx->count];
+    entry->operation = operation;
+    entry->num1 = allocatorStrdup(allocator, num1);
+    entry->num2 = (num2 == NULL) ? NULL : allocatorStrdup(allocator, num2);
+
+    if (entry->num1 == NULL || (num2 != NULL && entry->num2 == NULL)) {
+        allocatorFreeString(allocator, entry->num1);
+        allocatorFreeString(allocator, entry->num2);
+        return false;
+    }
+
+    (tx->count)++;
+    return true;
+}
+
+/**
+ * Wykonuje jedną operację transakcji na jej prywatnej wersji drzew. Pamięć operacji jest rezerwowana przed
+ * pierwszą zmianą, tak jak w funkcjach phfwdAdd i phfwdRemove.
+ * @param tx - wskaźnik na transakcję.
+ * @param entry - wskaźnik na operację.
+ * @return true - jeśli udało się wykonać operację.
+ *         false - jeśli nie powiodła się alokacja pamięci lub zostałby przekroczony limit pamięci.
+ */
+static bool transactionRun(PhfwdTransaction *tx, TransactionEntry const *entry) {
+    PhfwdMemory mem;
+    bool result;
+    memInit(&mem, tx->pf->account);
+
+    if (entry->operation != PHFWD_OPERATION_ADD) {
+        PhfwdRemoval removal;
+        bool subtree = entry->operation == PHFWD_OPERATION_REMOVE;
+        result = removalPrepare(&mem, &(tx->prefixes), &(tx->reverse), entry->num1, subtree, &removal);
+        if (result)
+            removalApply(&mem, &(tx->reverse), &(tx->pending), &removal);
+    } else {
+        PhfwdAddition addition;
+        result = additionPrepare(&mem, tx->prefixes, tx->reverse, entry->num1, entry->num2, &addition);
+        if (result)
+            additionApply(&mem, &(tx->prefixes), &(tx->reverse), &addition);
+    }
+
+    memRelease(&mem);
+    return result;
+}
+
+PhfwdTransaction *phfwdTransactionBegin(PhoneForward *pf) {
+    if (pf == NULL)
+        return NULL;
+
+    PhfwdTransaction *tx = (PhfwdTransaction *) allocatorAlloc(&(pf->allocator), sizeof(PhfwdTransaction));
+    if (tx == NULL)
+        return NULL;
+
+    tx->pf = pf;
+    tx->entries = NULL;
+    tx->count = 0;
+    tx->size = 0;
+    tx->prefixes = NULL;
+    tx->reverse = NULL;
+    tx->pending = NULL;
+    return tx;
+}
+
+bool phfwdTransactionAdd(PhfwdTransaction *tx, char const *num1, char const *num2) {
+    if (tx == NULL || !isStringAPhoneNumber(num1) || !isStringAPhoneNumber(num2) || !strcmp(num1, num2))
+        return false;
+
+    return transactionAppend(tx, PHFWD_OPERATION_ADD, num1, num2);
+}
+
+bool phfwdTransactionRemove(PhfwdTransaction *tx, char const *num) {
+    if (tx == NULL || !isStringAPhoneNumber(num))
+        return false;
+
+    return transactionAppend(tx, PHFWD_OPERATION_REMOVE, num, NULL);
+}
+
+bool phfwdTransactionRemoveOne(PhfwdTransaction *tx, char const *num) {
+    if (tx == NULL || !isStringAPhoneNumber(num))
+        return false;
+
+    return transactionAppend(tx, PHFWD_OPERATION_REMOVE_ONE, num, NULL);
+}
+
+bool transactionPrepare(PhfwdTransaction *tx) {
+    PhoneForward *pf = tx->pf;
+
+    // Prywatna wersja zaczyna od odwołań do drzew struktury, więc każda zmiana kopiuje tylko swoją ścieżkę,
+    // a struktura do zatwierdzenia widzi stare przekierowania.
+    atomic_fetch_add_explicit(&(pf->prefixes->references), 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&(pf->reverse->references), 1, memory_order_relaxed);
+    tx->prefixes = pf->prefixes;
+    tx->reverse = pf->reverse;
+
+    for (size_t i = 0; i < tx->count; i++) {
+        if (!transactionRun(tx, &(tx->entries)[i]))
+            return false;
+    }
+    return true;
+}
+
+void transactionApply(PhfwdTransaction *tx) {
+    PhoneForward *pf = tx->pf;
+    PhfwdAllocator const *allocator = &(pf->account->allocator);
+
+    // Stara wersja dzieli z nową wszystkie niezmienione węzły, więc jej zwolnienie usuwa tylko skopiowane ścieżki.
+    phfwdPrefixesRelease(allocator, pf->prefixes);
+    phfwdReverseRelease(allocator, pf->reverse);
+    pf->prefixes = tx->prefixes;
+    pf->reverse = tx->reverse;
+    tx->prefixes = NULL;
+    tx->reverse = NULL;
+
+    if (tx->pending != NULL) {
+        PhfwdTeardown *last = tx->pending;
+        while (last->next != NULL)
+            last = last->next;
+        last->next = pf->pending;
+        pf->pending = tx->pending;
+        tx->pending = NULL;
+    }
+
+    phfwdTouch(pf);
+    lookupRebuild(pf);
+    transactionFree(tx);
+}
+
+/**
+ * Dopisuje wszystkie operacje transakcji do dziennika struktury, zanim zostaną wykonane. Jeśli nie uda się
+ * dopisać wszystkich, dopisane są wycofywane.
+ * @param tx - wskaźnik na transakcję.
+ * @return true - jeśli operacje zostały dopisane lub struktura nie ma dziennika.
+ *         false - jeśli nie powiodła się alokacja pamięci lub wystąpił błąd zapisu dziennika.
+ */
+static bool transactionLog(PhfwdTransaction *tx) {
+    PhfwdJournal *journal = tx->pf->journal;
+    JournalMark mark = journalMark(journal);
+
+    for (size_t i = 0; i < tx->count; i++) {
+        TransactionEntry const *entry = &(tx->entries)[i];
+        if (!journalRecord(journal, entry->operation, entry->num1, entry->num2)) {
+            journalRewind(journal, mark);
+            return false;
+        }
+    }
+    return journalGroupCommit(journal);
+}
+
+bool phfwdTransactionCommit(PhfwdTransaction *tx) {
+    if (tx == NULL)
+        return false;
+
+    if (!transactionPrepare(tx) || !transactionLog(tx)) {
+        transactionFree(tx);
+        return false;
+    }
+
+    transactionApply(tx);
+    return true;
+}
+
+void phfwdTransactionAbort(PhfwdTransaction *tx) {
+    if (tx == NULL)
+        return;
+
+    transactionFree(tx);
+}
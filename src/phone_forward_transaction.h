@@ -0,0 +1,33 @@
+/** @file
+ * Wewnętrzny interfejs transakcji: zatwierdzanie transakcji w dwóch krokach, tak żeby można było wykonać
+ * tę samą zmianę w kilku strukturach albo w żadnej.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_TRANSACTION_H
+#define PHONE_FORWARD_TRANSACTION_H
+
+#include <stdbool.h>
+#include "phone_forward.h"
+
+/**
+ * Przygotowuje zatwierdzenie transakcji: wykonuje jej operacje na prywatnej wersji drzew struktury, która
+ * współdzieli z nimi niezmienione węzły. Nie zmienia przekierowań struktury.
+ * @param tx - wskaźnik na transakcję.
+ * @return true - jeśli transakcję można zatwierdzić funkcją transactionApply.
+ *         false - jeśli nie powiodła się alokacja pamięci lub zostałby przekroczony limit pamięci. Wtedy transakcję
+ *         trzeba usunąć funkcją phfwdTransactionAbort.
+ */
+bool transactionPrepare(PhfwdTransaction *tx);
+
+/**
+ * Zastępuje drzewa struktury wersją przygotowaną funkcją transactionPrepare, a potem usuwa transakcję. Nie może
+ * się nie powieść. Między przygotowaniem a zatwierdzeniem struktura nie może być modyfikowana.
+ * @param tx - wskaźnik na transakcję.
+ */
+void transactionApply(PhfwdTransaction *tx);
+
+#endif //PHONE_FORWARD_TRANSACTION_H
@@ -6,79 +6,114 @@
  * @date 2022
  */
 
-#include <stdlib.h>
 #include <string.h>
-#include "structures.h"
+#include "prefix.h"
+#include "trie.h"
 
-Prefix *prefixNew() {
-    Prefix *start = (Prefix *) malloc(sizeof(Prefix));
-    if (start == NULL)
-        return NULL;
-    start->nodeInPrefixes = NULL;
-    start->num = NULL;
-    start->next = NULL;
-    return start;
+size_t prefixBytes(size_t size) {
+    return offsetof(Prefix, nums) + sizeof(char *) * size;
 }
 
-Prefix *prefixAdd(PhoneForwardReverse *node, char const prefixNum[]) {
-    Prefix *new = prefixNew();
-    if (new == NULL)
-        return NULL;
-    char *prefixNumCopy = (char *) malloc(sizeof(char) * (strlen(prefixNum) + 1));
-    if (prefixNumCopy == NULL) {
-        free(new);
+Prefix *prefixNew(PhfwdAllocator const *allocator, size_t size) {
+    Prefix *prefix = (Prefix *) allocatorAlloc(allocator, prefixBytes(size));
+    if (prefix == NULL)
         return NULL;
+    atomic_init(&(prefix->references), 1);
+    prefix->count = 0;
+    prefix->size = size;
+    return prefix;
+}
+
+size_t prefixGrowth(Prefix const *prefix) {
+    if (prefix == NULL)
+        return 1;
+    return (prefix->count < prefix->size) ? prefix->size : 2 * prefix->size;
+}
+
+void prefixRelease(PhfwdAllocator const *allocator, Prefix *prefix) {
+    if (prefix == NULL || atomic_fetch_sub_explicit(&(prefix->references), 1, memory_order_acq_rel) != 1)
+        return;
+
+    for (size_t i = 0; i < prefix->count; i++)
+        stringRelease(allocator, (prefix->nums)[i]);
+    allocatorFree(allocator, prefix, prefixBytes(prefix->size));
+}
+
+Prefix *prefixTake(PhfwdAllocator const *allocator, Prefix *prefix, Prefix *spare) {
+    if (spare == NULL)
+        return prefix;
+
+    if (prefix != NULL) {
+        for (size_t i = 0; i < prefix->count; i++)
+            (spare->nums)[i] = stringRetain((prefix->nums)[i]);
+        spare->count = prefix->count;
+        prefixRelease(allocator, prefix);
     }
-    strcpy(prefixNumCopy, prefixNum);
-    prefixNumCopy[strlen(prefixNum)] = '\0';
-    new->num = prefixNumCopy;
-
-    if (node->prefixes == NULL) {
-        Prefix *newPrev = prefixNew();
-        if (newPrev == NULL) {
-            free(prefixNumCopy);
-            free(new);
-            return NULL;
+    return spare;
+}
+
+size_t prefixFind(Prefix const *prefix, char const *num, bool *found) {
+    size_t low = 0;
+    size_t high = prefix->count;
+    *found = false;
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int order = numCompare((prefix->nums)[mid], num);
+
+        if (order == 0) {
+            *found = true;
+            return mid;
         }
-        newPrev->next = new;
-        node->prefixes = newPrev;
-        return node->prefixes;
+        if (order < 0)
+            low = mid + 1;
+        else
+            high = mid;
     }
-    Prefix *prev = node->prefixes;
-    while (prev->next != NULL)
-        prev = prev->next;
+    return low;
+}
 
-    new->next = prev->next;
-    prev->next = new;
-    return prev;
+void prefixInsert(Prefix *prefix, size_t pos, char *num) {
+    memmove(prefix->nums + pos + 1, prefix->nums + pos, sizeof(char *) * (prefix->count - pos));
+    (prefix->nums)[pos] = num;
+    (prefix->count)++;
 }
 
-void PrefixDelete(Prefix *prefix) {
-    while (prefix != NULL) {
-        Prefix *tmp = prefix;
-        prefix = prefix->next;
+void prefixErase(PhfwdAllocator const *allocator, Prefix *prefix, size_t pos) {
+    stringRelease(allocator, (prefix->nums)[pos]);
+    (prefix->count)--;
+    memmove(prefix->nums + pos, prefix->nums + pos + 1, sizeof(char *) * (prefix->count - pos));
+}
 
-        if (tmp->num != NULL)
-            free(tmp->num);
+bool prefixAppend(PhfwdAllocator const *allocator, Prefix **prefix, char *num) {
+    if (*prefix == NULL || (*prefix)->count == (*prefix)->size) {
+        Prefix *grown = prefixNew(allocator, prefixGrowth(*prefix));
+        if (grown == NULL)
+            return false;
 
-        free(tmp);
+        // Tablica nie jest współdzielona, więc napisy są przenoszone bez zmiany liczników odwołań.
+        if (*prefix != NULL) {
+            memcpy(grown->nums, (*prefix)->nums, sizeof(char *) * (*prefix)->count);
+            grown->count = (*prefix)->count;
+            allocatorFree(allocator, *prefix, prefixBytes((*prefix)->size));
+        }
+        *prefix = grown;
     }
-}
 
-void PrefixDeleteOneElement(Prefix *prev) {
-    Prefix *tmp = prev->next;
-    prev->next = tmp->next;
-    if (tmp->next != NULL) {
-        PhoneForwardPrefixes *node = tmp->next->nodeInPrefixes;
-        node->pointersToReverse->prevInList = prev;
-    }
-    free(tmp->num);
-    free(tmp);
+    ((*prefix)->nums)[((*prefix)->count)++] = num;
+    return true;
 }
 
+/**
+ * Porównuje dwa prefiksy w tablicy.
+ * @param a - wskaźnik na pierwszy prefiks.
+ * @param b - wskaźnik na drugi prefiks.
+ * @return - wynik funkcji numCompare dla prefiksów.
+ */
+static int compareEntries(const void *a, const void *b) {
+    return numCompare(*(char *const *) a, *(char *const *) b);
+}
 
-void addPointerToPrefixesNode(PhoneForwardPrefixes *node, Prefix *prevInList) {
-    Prefix *p = prevInList->next;
-    if (p != NULL)
-        p->nodeInPrefixes = node;
-}
\ No newline at end of file
+void prefixSort(Prefix *prefix) {
+    qsort(prefix->nums, prefix->count, sizeof(char *), compareEntries);
+}
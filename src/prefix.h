@@ -12,42 +12,90 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "structures.h"
-#include "structures.h"
+#include "memory_context.h"
+
+/**
+ * Podaje, ile bajtów zajmuje tablica Prefix o @p size miejscach.
+ * @param size - liczba miejsc w tablicy.
+ * @return - liczba bajtów.
+ */
+size_t prefixBytes(size_t size);
+
+/**
+ * Tworzy nową, pustą tablicę Prefix z licznikiem odwołań równym 1.
+ * @param allocator - alokator drzew lub NULL.
+ * @param size - liczba miejsc w tablicy, co najmniej 1.
+ * @return wskaźnik na utworzoną tablicę lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+Prefix *prefixNew(PhfwdAllocator const *allocator, size_t size);
+
+/**
+ * Podaje liczbę miejsc tablicy, do której można dodać jeden prefiks więcej niż do @p prefix.
+ * @param prefix - wskaźnik na tablicę lub NULL.
+ * @return - liczba miejsc.
+ */
+size_t prefixGrowth(Prefix const *prefix);
+
+/**
+ * Zmniejsza licznik odwołań tablicy i, jeśli spadł on do zera, zwalnia tablicę razem z odwołaniami do
+ * przechowywanych w niej napisów. Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param allocator - alokator, którym przydzielono tablicę i napisy, lub NULL.
+ * @param prefix - wskaźnik na tablicę.
+ */
+void prefixRelease(PhfwdAllocator const *allocator, Prefix *prefix);
+
+/**
+ * Daje tablicę, którą można zmieniać. Jeśli @p spare ma wartość NULL, zwraca @p prefix, który nie może być
+ * wtedy współdzielony. W przeciwnym przypadku przepisuje do @p spare prefiksy z @p prefix, zwiększając ich
+ * liczniki odwołań, i zwalnia odwołanie do @p prefix.
+ * @param allocator - alokator, którym przydzielono tablice, lub NULL.
+ * @param prefix - wskaźnik na tablicę lub NULL.
+ * @param spare - pusta tablica o liczbie miejsc nie mniejszej niż liczba prefiksów w @p prefix lub NULL.
+ * @return - tablica, którą można zmieniać, lub NULL, jeśli obie tablice mają wartość NULL.
+ */
+Prefix *prefixTake(PhfwdAllocator const *allocator, Prefix *prefix, Prefix *spare);
 
 /**
- * Tworzy nowy, pusty element struktury Prefix.
- * @return wskaźnik na utworzoną strukturę lub NULL, jeśli nie powiodła się alokacja pamięci.
+ * Szuka binarnie prefiksu @p num w tablicy.
+ * @param prefix - wskaźnik na tablicę.
+ * @param num - prefiks numeru telefonu.
+ * @param found - wskaźnik, pod którym zostanie zapisane, czy prefiks jest w tablicy.
+ * @return - pozycja prefiksu lub pozycja, na którą należy go wstawić.
  */
-Prefix *prefixNew();
+size_t prefixFind(Prefix const *prefix, char const *num, bool *found);
 
 /**
- * Dodaje nowy element na końcu listy.
- * Jeśli węzeł @p node nie zawiera listy prefiksów, to tworzy nową listę. Nowa lista zawiera pierwszy pusty element
- * i dopiero następny przechowuje @p prefixNum.
- * @param node - wskaźnik na węzeł PhoneForwardReverse, który przechowuje listę prefiksów numerów telefonu.
- * @param prefixNum - prefiks numeru telefonu.
- * @return - element poprzedzający w liście Prefix ten zawierający nowo dodany numer lub
- *           NULL, jeśli nie powiodła alokacja pamięci.
+ * Wstawia napis na podaną pozycję tablicy, przesuwając dalsze prefiksy. Tablica musi mieć wolne miejsce
+ * i nie może być współdzielona.
+ * @param prefix - wskaźnik na tablicę.
+ * @param pos - pozycja zwrócona przez prefixFind.
+ * @param num - napis z licznikiem odwołań, przekazywany tablicy.
  */
-Prefix *prefixAdd(PhoneForwardReverse *node, char const prefixNum[]);
+void prefixInsert(Prefix *prefix, size_t pos, char *num);
 
 /**
- * Usuwa listę i przechowywane przez nią numery (nie zwalnia żadnych węzłów PhoneForwardPrefixes).
- * @param prefix - wskaźnik na listę.
+ * Usuwa prefiks z podanej pozycji tablicy i zwalnia odwołanie do jego napisu. Tablica nie może być współdzielona.
+ * @param allocator - alokator, którym przydzielono napisy, lub NULL.
+ * @param prefix - wskaźnik na tablicę.
+ * @param pos - pozycja usuwanego prefiksu.
  */
-void PrefixDelete(Prefix *prefix);
+void prefixErase(PhfwdAllocator const *allocator, Prefix *prefix, size_t pos);
 
 /**
- * Usuwa jeden element z listy.
- * @param prev - wskaźnik na element poprzedzający usuwany element listy.
+ * Dopisuje napis na końcu tablicy, tworząc ją lub powiększając w razie potrzeby. Tablica nie może być
+ * współdzielona. Służy do budowania tablicy, którą trzeba potem posortować funkcją prefixSort.
+ * @param allocator - alokator, którym przydzielono tablicę, lub NULL.
+ * @param prefix - wskaźnik na tablicę lub na NULL.
+ * @param num - napis z licznikiem odwołań, przekazywany tablicy, jeśli udało się go dopisać.
+ * @return true - jeśli udało się dopisać napis.
+ *         false - jeśli nie powiodła się alokacja pamięci.
  */
-void PrefixDeleteOneElement(Prefix *prev);
+bool prefixAppend(PhfwdAllocator const *allocator, Prefix **prefix, char *num);
 
 /**
- * Dodaje do elementu listy wskaźnik na odpowiadający mu węzeł drzewa PhoneForwardPrefixes.
- * @param node - węzeł drzewa PhoneForwardPrefixes.
- * @param prevInList - element listy poprzedzający ten, do którego dodany zostanie wskaźnik.
+ * Porządkuje prefiksy w tablicy tak, jak robi to funkcja prefixInsert.
+ * @param prefix - wskaźnik na tablicę.
  */
-void addPointerToPrefixesNode(PhoneForwardPrefixes *node, Prefix *prevInList);
+void prefixSort(Prefix *prefix);
 
 #endif //PHONE_NUMBERS_PREFIX_H
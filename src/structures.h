@@ -9,6 +9,11 @@
 #ifndef STRUCTURES_H
 #define STRUCTURES_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "phone_forward.h"
+
 /**
  * Ilość wszystkich możliwych znaków, które mogą wystąpić w numerze telefonu.
  */
@@ -16,26 +21,36 @@
 
 /**
  * @struct PhoneForwardPrefixes
- * @brief PhoneForwardPrefixes jest strukturą przechowującą wskaźniki na elementy drzewa PhoneForwardReverse.
+ * @brief PhoneForwardPrefixes jest strukturą przechowującą przekierowania prefiksów numerów telefonu.
  * Drzewo PhoneForwardPrefixes jest drzewem typu trie, gdzie każda gałąź oznacza kolejną cyfrę w prefiksie numeru telefonu.
+ * Węzły mogą być współdzielone przez kilka wersji drzewa, a po phfwdDeduplicate także przez kilka miejsc tego
+ * samego drzewa; węzeł o liczniku odwołań większym niż 1 nie może być zmieniany, tylko zastępowany kopią.
  */
 struct PhoneForwardPrefixes {
-    struct PhfwdPointers *pointersToReverse; ///< Struktura przechowująca informacje o lokalizacji numeru telefonu
-    ///< oraz jego przekierowania w drzewie PhoneForwardReverse.
+    char *diversion; ///< Przekierowanie prefiksu lub NULL, jeśli prefiks nie jest przekierowany. Jest to ten sam
+    ///< napis z licznikiem odwołań, co pole diversion węzła drzewa PhoneForwardReverse odpowiadającego przekierowaniu.
     struct PhoneForwardPrefixes *children[SIGNS_IN_NUMBER]; ///< Tablica wskaźników na dzieci węzła PhoneForwardPrefixes.
+    atomic_uint references; ///< Liczba rodziców i korzeni wskazujących na węzeł.
+    atomic_uint hits; ///< Liczba próbkowanych zapytań, które przeszły przez węzeł.
 };
 typedef struct PhoneForwardPrefixes PhoneForwardPrefixes;
 
 /**
  * @struct Prefix
- * @brief Prefix jest strukturą będącą listą jednokierunkową.
+ * @brief Prefix jest posortowaną tablicą prefiksów numerów telefonu z licznikiem odwołań. Prefiksy są napisami
+ * z licznikiem odwołań, uporządkowanymi tak jak wyniki funkcji phfwdReverse.
+ * Tablica nie jest kodowana przyrostowo, jak listy PhfwdStaticTable. Dla 500 tys. prefiksów jednego przekierowania
+ * tablica z napisami zajmuje 24 B na prefiks, a kodowanie przyrostowe 6 B, ale cała struktura zajmuje ok. 390 B
+ * na prefiks, bo każdy ma też własną ścieżkę w drzewie PhoneForwardPrefixes. Kodowanie wymagałoby przy
+ * każdym dodaniu i usunięciu ponownego zakodowania bloku, a napisy nie mogłyby być współdzielone z regułami
+ * usuwania. Po phfwdRelayout napisy leżą kolejno w pamięci i phfwdReverse potrzebuje na wynik 38–45 ns, a
+ * dekodowanie w phfwdStaticReverse 51–63 ns.
  */
 struct Prefix {
-    char *num; ///< Prefiks numeru telefonu.
-    PhoneForwardPrefixes *nodeInPrefixes; ///< Jest ustawiony na NULL, chyba, że lista przechowuje więcej niż jeden prefiks.
-    ///< Wtedy każdy następny element listy zawiera także wskaźnik na odpowiadający
-    ///< mu węzeł w drzewie phoneForwardPrefixes.
-    struct Prefix *next; ///< Wskaźnik na kolejny element listy.
+    atomic_uint references; ///< Liczba węzłów drzewa PhoneForwardReverse wskazujących na tablicę.
+    size_t count; ///< Liczba prefiksów w tablicy.
+    size_t size; ///< Liczba miejsc w tablicy.
+    char *nums[]; ///< Prefiksy numerów telefonu.
 };
 typedef struct Prefix Prefix;
 
@@ -43,23 +58,51 @@ typedef struct Prefix Prefix;
  * @struct PhoneForwardReverse
  * @brief PhoneForwardReverse jest strukturą przechowującą przekierowania numerów telefonu.
  * Drzewo PhoneForwardReverse jest drzewem trie, w którym kolejne gałęzie są oznaczone cyframi numeru będącego
- * przekierowaniem prefiksu numeru telefonu.
+ * przekierowaniem prefiksu numeru telefonu. Węzły są współdzielone tak samo jak węzły drzewa PhoneForwardPrefixes.
  */
 struct PhoneForwardReverse {
-    char *diversion; ///< Przekierowaniu prefiksu numeru telefonu.
-    Prefix *prefixes; ///< Lista przechowująca prefiksy numerów telefonu, których diversion jest przekierowaniem.
+    char *diversion; ///< Przekierowanie prefiksów numerów telefonu lub NULL, jeśli żaden prefiks nie jest tu przekierowany.
+    Prefix *prefixes; ///< Tablica prefiksów numerów telefonu, których diversion jest przekierowaniem, lub NULL.
     struct PhoneForwardReverse *children[SIGNS_IN_NUMBER]; ///< Tablica wskaźników na dzieci węzła PhoneForwardReverse.
+    atomic_uint references; ///< Liczba rodziców i korzeni wskazujących na węzeł.
+    atomic_uint hits; ///< Liczba próbkowanych zapytań, które przeszły przez węzeł.
 };
 typedef struct PhoneForwardReverse PhoneForwardReverse;
 
 /**
- * @struct PhfwdPointers
- * @brief PhfwdPointers jest strukturą przechowującą wskaźniki na węzeł drzewa PhoneForwardReverse oraz element listy Prefix.
+ * @struct PhfwdTeardown
+ * @brief PhfwdTeardown przechowuje stan usuwania poddrzewa PhoneForwardPrefixes, które można przerwać i wznowić.
+ * Odłączone, jeszcze nieusunięte poddrzewa tworzą listę jednokierunkową.
+ */
+struct PhfwdTeardown {
+    PhoneForwardPrefixes *root; ///< Korzeń usuwanego poddrzewa.
+    PhoneForwardPrefixes *node; ///< Węzeł, od którego zostanie wznowione usuwanie lub NULL, jeśli poddrzewo usunięto.
+    PhoneForwardPrefixes *parent; ///< Rodzic węzła @p node lub NULL, jeśli @p node jest korzeniem.
+    struct PhfwdTeardown *next; ///< Wskaźnik na kolejne poddrzewo oczekujące na usunięcie.
+};
+typedef struct PhfwdTeardown PhfwdTeardown;
+
+/**
+ * @struct PhoneForward
+ * @brief PhoneForward jest strukturą przechowującą przekierowania numerów telefonu.
  */
-struct PhfwdPointers {
-    PhoneForwardReverse *node; ///< Węzeł drzewa PhoneForwardReverse, zawierający przekierowanie numeru telefonu.
-    Prefix *prevInList; ///< Element w liście poprzedzający element, w którym zapisany jest prefiks numeru telefonu.
+struct PhoneForward {
+    PhoneForwardReverse *reverse; ///< Wskaźnik na drzewo trie przechowujące przekierowania numerów telefonów.
+    ///< Gałęzie drzewa reverse oznaczają kolejne cyfry przekierowania numeru.
+    PhoneForwardPrefixes *prefixes; ///< Wskaźnik na drzewo trie przechowujące wskaźniki na przekierowania numerów telefonu.
+    ///< Gałęzie drzewa prefixes oznaczają kolejne cyfry prefiksu numeru telefonu.
+    PhfwdTeardown *pending; ///< Lista poddrzew odłączonych przez phfwdRemove, które nie zostały jeszcze usunięte.
+    struct PhfwdJournal *journal; ///< Dziennik, do którego dopisywane są operacje modyfikujące lub NULL.
+    struct PhfwdLookup *lookup; ///< Tablice z haszowaniem używane do wyszukiwania prefiksów lub NULL, jeśli
+    ///< prefiksy są wyszukiwane w drzewie prefixes.
+    uint64_t version; ///< Numer nadawany na nowo po każdej modyfikacji przekierowań, niepowtarzalny między
+    ///< wszystkimi strukturami.
+    PhfwdAllocator allocator; ///< Alokator, którym przydzielana jest cała pamięć struktury i wyników zapytań o nią.
+    ///< Wyzerowany, jeśli używana jest funkcja malloc.
+    struct MemoryAccount *account; ///< Konto, na które liczona jest pamięć drzew. Pamięć drzew jest przydzielana
+    ///< jego alokatorem. Kopie współdzielące węzły drzew współdzielą też konto.
+    size_t budget; ///< Limit pamięci drzew ustawiony dla tej struktury lub SIZE_MAX, jeśli nie ma limitu.
+    unsigned samplePeriod; ///< Co które zapytanie wątku zlicza trafienia w węzłach lub 0, jeśli żadne.
 };
-typedef struct PhfwdPointers PhfwdPointers;
 
 #endif //STRUCTURES_H
@@ -7,11 +7,24 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 #include "prefix.h"
-#include "phone_forward_reverse_stack.h"
-#include "phone_forward_prefixes_stack.h"
+#include "trie.h"
+#include "node_stack.h"
+
+bool isStringAPhoneNumber(char const *string) {
+    if (string == NULL)
+        return false;
+    int i = 0;
+    while (isdigit(string[i]) || string[i] == '*' || string[i] == '#') i++;
+    if (string[i] != '\0' || i == 0)
+        return false;
+    return true;
+}
 
 int charToNum(char c) {
     if (c == '*') return 10;
@@ -19,30 +32,59 @@ int charToNum(char c) {
     else return c - '0';
 }
 
-PhfwdPointers *PhfwdPointersNew(PhoneForwardReverse *node, Prefix *prevInList) {
-    PhfwdPointers *new = (PhfwdPointers *) malloc(sizeof(PhfwdPointers));
-    if (new == NULL)
-        return NULL;
-    new->node = node;
-    new->prevInList = prevInList;
-    return new;
+char numToChar(int num) {
+    return "0123456789*#"[num];
+}
+
+int numCompare(char const *a, char const *b) {
+    size_t i = 0;
+    while (a[i] != '\0' && a[i] == b[i])
+        i++;
+    if (a[i] == '\0' || b[i] == '\0')
+        return (a[i] != '\0') - (b[i] != '\0');
+    return charToNum(a[i]) - charToNum(b[i]);
 }
 
-PhoneForwardPrefixes *phfwdPrefixesNew() {
-    PhoneForwardPrefixes *root = (PhoneForwardPrefixes *) malloc(sizeof(PhoneForwardPrefixes));
+bool pathSet(char **path, size_t *size, size_t depth, int sign) {
+    if (depth + 1 > *size) {
+        size_t newSize = (*size == 0) ? 32 : 2 * (*size);
+        char *tmp = (char *) realloc(*path, sizeof(char) * newSize);
+        if (tmp == NULL)
+            return false;
+        *path = tmp;
+        *size = newSize;
+    }
+
+    (*path)[depth - 1] = numToChar(sign);
+    (*path)[depth] = '\0';
+    return true;
+}
+
+
+PhoneForwardPrefixes *phfwdPrefixesNew(PhfwdMemory *mem) {
+    PhoneForwardPrefixes *root = (PhoneForwardPrefixes *) memAlloc(mem, MEM_PREFIXES_NODE);
 
     if (root == NULL)
         return NULL;
 
-    root->pointersToReverse = NULL;
+    root->diversion = NULL;
     for (int i = 0; i < SIGNS_IN_NUMBER; i++)
         (root->children)[i] = NULL;
+    atomic_init(&(root->references), 1);
+    atomic_init(&(root->hits), 0);
 
     return root;
 }
 
-PhoneForwardReverse *phfwdReverseNew() {
-    PhoneForwardReverse *root = (PhoneForwardReverse *) malloc(sizeof(PhoneForwardReverse));
+void teardownInit(PhfwdTeardown *t, PhoneForwardPrefixes *root) {
+    t->root = root;
+    t->node = root;
+    t->parent = NULL;
+    t->next = NULL;
+}
+
+PhoneForwardReverse *phfwdReverseNew(PhfwdMemory *mem) {
+    PhoneForwardReverse *root = (PhoneForwardReverse *) memAlloc(mem, MEM_REVERSE_NODE);
 
     if (root == NULL)
         return NULL;
@@ -52,174 +94,677 @@ PhoneForwardReverse *phfwdReverseNew() {
 
     for (int i = 0; i < SIGNS_IN_NUMBER; i++)
         (root->children)[i] = NULL;
+    atomic_init(&(root->references), 1);
+    atomic_init(&(root->hits), 0);
     return root;
 }
 
+/**
+ * Sprawdza, czy węzeł lub tablica ma więcej niż jedno odwołanie, czyli należy do kilku wersji drzewa.
+ * @param references - licznik odwołań.
+ * @return true - jeśli odwołań jest więcej niż jedno.
+ *         false - w przeciwnym przypadku.
+ */
+static bool isShared(atomic_uint *references) {
+    return atomic_load_explicit(references, memory_order_acquire) > 1;
+}
+
+/**
+ * Dodaje odwołanie do węzła lub tablicy.
+ * @param references - licznik odwołań.
+ */
+static void retain(atomic_uint *references) {
+    atomic_fetch_add_explicit(references, 1, memory_order_relaxed);
+}
+
+/**
+ * Zwalnia jedno odwołanie do węzła.
+ * @param references - licznik odwołań węzła.
+ * @return true - jeśli było to ostatnie odwołanie i węzeł trzeba usunąć.
+ *         false - w przeciwnym przypadku.
+ */
+static bool dropReference(atomic_uint *references) {
+    return atomic_fetch_sub_explicit(references, 1, memory_order_acq_rel) == 1;
+}
+
 /**
  * Zwalnia pamięć zajmowaną przez pojedynczy węzeł drzewa PhoneForwardReverse.
- * @param node - liść drzewa PhoneForwardReverse.
+ * @param allocator - alokator, którym przydzielono drzewo, lub NULL.
+ * @param node - węzeł bez dzieci, do którego nie ma już odwołań.
  */
-static void freeReverseNode(PhoneForwardReverse *node) {
-    if (node == NULL)
-        return;
+static void freeReverseNode(PhfwdAllocator const *allocator, PhoneForwardReverse *node) {
+    stringRelease(allocator, node->diversion);
+    prefixRelease(allocator, node->prefixes);
+    memFree(allocator, node, MEM_REVERSE_NODE);
+}
 
-    if (node->diversion != NULL) {
-        free(node->diversion);
+/**
+ * Szuka pierwszego dziecka węzła drzewa PhoneForwardReverse, do którego węzeł miał ostatnie odwołanie.
+ * Dzieci współdzielone z innymi wersjami drzewa, które tylko straciły odwołanie, są usuwane z tablicy dzieci.
+ * @param node - węzeł, do którego nie ma już odwołań.
+ * @return - indeks dziecka do usunięcia lub SIGNS_IN_NUMBER, jeśli go nie ma.
+ */
+static int reverseChildToFree(PhoneForwardReverse *node) {
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        PhoneForwardReverse *child = (node->children)[i];
+
+        if (child == NULL)
+            continue;
+        if (dropReference(&(child->references)))
+            return i;
+        (node->children)[i] = NULL;
     }
-    PrefixDelete(node->prefixes);
-    free(node);
+    return SIGNS_IN_NUMBER;
 }
 
 /**
- * Usuwa strukturę PhoneForwardReverse, nie wykorzystując przy tym dodatkowej pamięci.
- * @param rev - korzeń drzewa PhoneForwardReverse.
+ * Usuwa węzły drzewa PhoneForwardReverse, do których nie ma już odwołań, w czasie liniowym względem ich liczby,
+ * nie alokując dodatkowej pamięci. Schodząc do dziecka, węzeł zapamiętuje swojego rodzica w miejscu po tym
+ * dziecku. Wcześniejsze miejsca w tablicy dzieci są już puste, więc jest to pierwsze niepuste miejsce i po
+ * powrocie do węzła można je od razu odnaleźć.
+ * @param allocator - alokator, którym przydzielono drzewo, lub NULL.
+ * @param rev - korzeń, do którego zwolniono już ostatnie odwołanie.
  */
-static void phfwdReverseDeleteWithLackOfMemory(PhoneForwardReverse *rev) {
-    PhoneForwardReverse *now = NULL;
-    PhoneForwardReverse *parent = rev;
-    int parentsIndex;
-    int j = 0;
-
-    while (j < SIGNS_IN_NUMBER) {
-        if ((parent->children)[j] != NULL) {
-            now = (parent->children)[j];
-            parentsIndex = j;
+static void reverseTeardown(PhfwdAllocator const *allocator, PhoneForwardReverse *rev) {
+    PhoneForwardReverse *parent = NULL;
+    PhoneForwardReverse *node = rev;
+
+    while (node != NULL) {
+        int i = reverseChildToFree(node);
+
+        if (i < SIGNS_IN_NUMBER) {
+            PhoneForwardReverse *child = (node->children)[i];
+            (node->children)[i] = parent;
+            parent = node;
+            node = child;
+            continue;
+        }
 
-            int i = 0;
-            for (; i < SIGNS_IN_NUMBER; i++) {
-                if ((now->children)[i] != NULL) {
-                    parent = now;
-                    now = (parent->children)[i];
-                    parentsIndex = i;
-                    i = 0;
-                }
-            }
-            if (i == SIGNS_IN_NUMBER) {
-                freeReverseNode(now);
-                (parent->children[parentsIndex]) = NULL;
-                parent = rev;
-                now = (rev->children)[j];
-            }
+        freeReverseNode(allocator, node);
+        node = parent;
+
+        if (node != NULL && node != rev) {
+            i = 0;
+            while ((node->children)[i] == NULL)
+                i++;
+            parent = (node->children)[i];
+            (node->children)[i] = NULL;
+        } else {
+            parent = NULL;
         }
-        if ((rev->children)[j] == NULL)
-            j++;
     }
+}
+
+void phfwdReverseRelease(PhfwdAllocator const *allocator, PhoneForwardReverse *rev) {
+    if (rev != NULL && dropReference(&(rev->references)))
+        reverseTeardown(allocator, rev);
+}
+
+/**
+ * Usuwa pojedynczy węzeł drzewa PhoneForwardPrefixes.
+ * @param allocator - alokator, którym przydzielono drzewo, lub NULL.
+ * @param node - węzeł bez dzieci, do którego nie ma już odwołań.
+ */
+static void freePrefixNode(PhfwdAllocator const *allocator, PhoneForwardPrefixes *node) {
+    stringRelease(allocator, node->diversion);
+    memFree(allocator, node, MEM_PREFIXES_NODE);
+}
+
+/**
+ * Szuka pierwszego dziecka węzła drzewa PhoneForwardPrefixes tak jak reverseChildToFree.
+ * @param node - węzeł, do którego nie ma już odwołań.
+ * @return - indeks dziecka do usunięcia lub SIGNS_IN_NUMBER, jeśli go nie ma.
+ */
+static int prefixesChildToFree(PhoneForwardPrefixes *node) {
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        PhoneForwardPrefixes *child = (node->children)[i];
+
+        if (child == NULL)
+            continue;
+        if (dropReference(&(child->references)))
+            return i;
+        (node->children)[i] = NULL;
+    }
+    return SIGNS_IN_NUMBER;
+}
+
+size_t teardownStep(PhfwdAllocator const *allocator, PhfwdTeardown *t, size_t budget) {
+    size_t freed = 0;
 
-    freeReverseNode(rev);
+    // Ścieżka powrotu do korzenia jest zapisywana w samych węzłach, tak jak w funkcji reverseTeardown,
+    // dzięki czemu usuwanie można przerwać i wznowić później z tego samego stanu t.
+    while (t->node != NULL && freed < budget) {
+        PhoneForwardPrefixes *node = t->node;
+        int i = prefixesChildToFree(node);
+
+        if (i < SIGNS_IN_NUMBER) {
+            t->node = (node->children)[i];
+            (node->children)[i] = t->parent;
+            t->parent = node;
+            continue;
+        }
+
+        freePrefixNode(allocator, node);
+        freed++;
+        t->node = t->parent;
+
+        if (t->node != NULL && t->node != t->root) {
+            i = 0;
+            while ((t->node->children)[i] == NULL)
+                i++;
+            t->parent = (t->node->children)[i];
+            (t->node->children)[i] = NULL;
+        } else {
+            t->parent = NULL;
+        }
+    }
+    return freed;
 }
 
-void phfwdReverseDelete(PhoneForwardReverse *rev) {
-    if (rev == NULL)
+void phfwdPrefixesRelease(PhfwdAllocator const *allocator, PhoneForwardPrefixes *pref) {
+    if (pref == NULL || !dropReference(&(pref->references)))
         return;
 
-    PhfwdReverseStack *stack;
-    reverseInit(&stack);
+    PhfwdTeardown t;
+    teardownInit(&t, pref);
+    teardownStep(allocator, &t, SIZE_MAX);
+}
 
-    if (!reverseInsert(&stack, rev)) {
-        phfwdReverseDeleteWithLackOfMemory(rev);
-        return;
+/**
+ * Podaje liczbę dzieci węzła drzewa PhoneForwardPrefixes.
+ * @param node - węzeł drzewa.
+ * @return - liczba dzieci.
+ */
+static int prefixesChildren(PhoneForwardPrefixes const *node) {
+    int count = 0;
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++)
+        count += (node->children)[i] != NULL;
+    return count;
+}
+
+/**
+ * Podaje liczbę dzieci węzła drzewa PhoneForwardReverse.
+ * @param node - węzeł drzewa.
+ * @return - liczba dzieci.
+ */
+static int reverseChildren(PhoneForwardReverse const *node) {
+    int count = 0;
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++)
+        count += (node->children)[i] != NULL;
+    return count;
+}
+
+/**
+ * Daje na wyłączność węzeł drzewa PhoneForwardPrefixes wskazywany przez @p slot. Węzeł współdzielony z innymi
+ * wersjami drzewa jest zastępowany kopią, która dzieli z nim dzieci i napis przekierowania.
+ * @param mem - kontekst alokacji drzew.
+ * @param slot - miejsce w rodzicu, który jest już na wyłączność, lub korzeń drzewa.
+ * @return - węzeł, który można zmieniać, lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+static PhoneForwardPrefixes *ownPrefixes(PhfwdMemory *mem, PhoneForwardPrefixes **slot) {
+    PhoneForwardPrefixes *node = *slot;
+
+    if (!isShared(&(node->references)))
+        return node;
+
+    PhoneForwardPrefixes *copy = phfwdPrefixesNew(mem);
+    if (copy == NULL)
+        return NULL;
+
+    copy->diversion = (node->diversion == NULL) ? NULL : stringRetain(node->diversion);
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        if ((node->children)[i] != NULL)
+            retain(&((node->children)[i]->references));
+        (copy->children)[i] = (node->children)[i];
     }
+    atomic_store_explicit(&(copy->hits), atomic_load_explicit(&(node->hits), memory_order_relaxed),
+                          memory_order_relaxed);
 
-    while (!reverseEmpty(stack)) {
-        PhoneForwardReverse *node = reversePop(&stack);
-        for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
-            if ((node->children)[i] != NULL)
-                if (!reverseInsert(&stack, (node->children)[i]))
-                    phfwdReverseDeleteWithLackOfMemory((node->children)[i]);
-        }
-        freeReverseNode(node);
+    *slot = copy;
+    phfwdPrefixesRelease(memAllocator(mem), node);
+    return copy;
+}
+
+/**
+ * Daje na wyłączność węzeł drzewa PhoneForwardReverse tak jak ownPrefixes. Kopia dzieli z węzłem także tablicę
+ * prefiksów.
+ * @param mem - kontekst alokacji drzew.
+ * @param slot - miejsce w rodzicu, który jest już na wyłączność, lub korzeń drzewa.
+ * @return - węzeł, który można zmieniać, lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+static PhoneForwardReverse *ownReverse(PhfwdMemory *mem, PhoneForwardReverse **slot) {
+    PhoneForwardReverse *node = *slot;
+
+    if (!isShared(&(node->references)))
+        return node;
+
+    PhoneForwardReverse *copy = phfwdReverseNew(mem);
+    if (copy == NULL)
+        return NULL;
+
+    copy->diversion = (node->diversion == NULL) ? NULL : stringRetain(node->diversion);
+    copy->prefixes = node->prefixes;
+    if (copy->prefixes != NULL)
+        retain(&(copy->prefixes->references));
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        if ((node->children)[i] != NULL)
+            retain(&((node->children)[i]->references));
+        (copy->children)[i] = (node->children)[i];
     }
+    atomic_store_explicit(&(copy->hits), atomic_load_explicit(&(node->hits), memory_order_relaxed),
+                          memory_order_relaxed);
+
+    *slot = copy;
+    phfwdReverseRelease(memAllocator(mem), node);
+    return copy;
 }
 
 /**
- * Usuwa pojedynczy węzeł drzewa PhoneForwardPrefixes.
- * @param node - liść drzewa PhoneForwardPrefixes.
+ * Daje na wyłączność węzły drzewa PhoneForwardPrefixes na ścieżce z korzenia do węzła pierwszych @p length znaków
+ * numeru @p num i tworzy brakujące węzły tej ścieżki.
+ * @param mem - kontekst alokacji drzew.
+ * @param root - wskaźnik na korzeń drzewa.
+ * @param num - prefiks numeru telefonu.
+ * @param length - długość ścieżki, nie większa niż długość @p num.
+ * @return - ostatni węzeł ścieżki lub NULL, jeśli nie powiodła się alokacja pamięci.
  */
-static void freePrefixNode(PhoneForwardPrefixes *node) {
-    if (node->pointersToReverse != NULL)
-        free(node->pointersToReverse);
-    free(node);
+static PhoneForwardPrefixes *ownPrefixesPath(PhfwdMemory *mem, PhoneForwardPrefixes **root, char const *num,
+                                             size_t length) {
+    PhoneForwardPrefixes *node = ownPrefixes(mem, root);
+
+    for (size_t idx = 0; idx < length && node != NULL; idx++) {
+        PhoneForwardPrefixes **slot = &(node->children)[charToNum(num[idx])];
+
+        if (*slot == NULL && (*slot = phfwdPrefixesNew(mem)) == NULL)
+            return NULL;
+        node = ownPrefixes(mem, slot);
+    }
+    return node;
 }
 
 /**
- * Usuwa strukturę PhoneForwardPrefixes, nie wykorzystując przy tym dodatkowej pamięci.
- * @param pref - korzeń drzewa PhoneForwardPrefixes.
+ * Daje na wyłączność węzły drzewa PhoneForwardReverse na ścieżce numeru @p num tak jak ownPrefixesPath.
+ * @param mem - kontekst alokacji drzew.
+ * @param root - wskaźnik na korzeń drzewa.
+ * @param num - numer telefonu.
+ * @return - węzeł numeru @p num lub NULL, jeśli nie powiodła się alokacja pamięci.
  */
-static void phfwdPrefixesDeleteWithLackOfMemory(PhoneForwardPrefixes *pref) {
-    PhoneForwardPrefixes *now = NULL;
-    PhoneForwardPrefixes *parent = pref;
-    int parentsIndex;
-    int j = 0;
+static PhoneForwardReverse *ownReversePath(PhfwdMemory *mem, PhoneForwardReverse **root, char const *num) {
+    PhoneForwardReverse *node = ownReverse(mem, root);
 
-    while (j < SIGNS_IN_NUMBER) {
-        if ((parent->children)[j] != NULL) {
-            now = (parent->children)[j];
-            parentsIndex = j;
+    for (size_t idx = 0; num[idx] != '\0' && node != NULL; idx++) {
+        PhoneForwardReverse **slot = &(node->children)[charToNum(num[idx])];
 
-            int i = 0;
-            for (; i < SIGNS_IN_NUMBER; i++) {
-                if ((now->children)[i] != NULL) {
-                    parent = now;
-                    now = (parent->children)[i];
-                    parentsIndex = i;
-                    i = -1;
-                }
-            }
-            if (i == SIGNS_IN_NUMBER) {
-                freePrefixNode(now);
-                (parent->children[parentsIndex]) = NULL;
-                parent = pref;
-                now = (pref->children)[j];
-            }
-        }
-        if ((pref->children)[j] == NULL)
-            j++;
+        if (*slot == NULL && (*slot = phfwdReverseNew(mem)) == NULL)
+            return NULL;
+        node = ownReverse(mem, slot);
     }
+    return node;
+}
 
-    freePrefixNode(pref);
+/**
+ * Przechodzi drzewo PhoneForwardPrefixes po ścieżce numeru @p num i liczy węzły, które funkcja ownPrefixesPath
+ * skopiuje: współdzielone i leżące pod współdzielonymi, bo kopia rodzica dodaje odwołanie do dzieci.
+ * @param tree - korzeń drzewa.
+ * @param num - prefiks numeru telefonu.
+ * @param reached - wskaźnik, pod którym zostanie zapisana długość istniejącej części ścieżki.
+ * @param copies - wskaźnik, pod którym zostanie zapisana liczba węzłów do skopiowania.
+ * @return - ostatni istniejący węzeł ścieżki.
+ */
+static PhoneForwardPrefixes *walkPrefixes(PhoneForwardPrefixes *tree, char const *num, size_t *reached,
+                                          size_t *copies) {
+    bool shared = isShared(&(tree->references));
+    *copies = shared ? 1 : 0;
+    *reached = 0;
+
+    while (num[*reached] != '\0' && (tree->children)[charToNum(num[*reached])] != NULL) {
+        tree = (tree->children)[charToNum(num[*reached])];
+        (*reached)++;
+        shared = shared || isShared(&(tree->references));
+        *copies += shared ? 1 : 0;
+    }
+    return tree;
 }
 
-void phfwdPrefixesDelete(PhoneForwardPrefixes *pref) {
-    if (pref == NULL)
-        return;
+/**
+ * Przechodzi drzewo PhoneForwardReverse po ścieżce numeru @p num tak jak walkPrefixes, ale liczy tylko węzły
+ * na głębokości co najmniej @p from, żeby węzły wspólne z inną ścieżką nie były liczone dwa razy.
+ * @param tree - korzeń drzewa.
+ * @param num - numer telefonu.
+ * @param from - najmniejsza głębokość liczonych węzłów.
+ * @param reached - wskaźnik, pod którym zostanie zapisana długość istniejącej części ścieżki.
+ * @param copies - wskaźnik, pod którym zostanie zapisana liczba węzłów do skopiowania.
+ * @param shared - wskaźnik, pod którym zostanie zapisane, czy ostatni istniejący węzeł zostanie skopiowany.
+ * @return - ostatni istniejący węzeł ścieżki.
+ */
+static PhoneForwardReverse *walkReverse(PhoneForwardReverse *tree, char const *num, size_t from, size_t *reached,
+                                        size_t *copies, bool *shared) {
+    *shared = isShared(&(tree->references));
+    *copies = (*shared && from == 0) ? 1 : 0;
+    *reached = 0;
+
+    while (num[*reached] != '\0' && (tree->children)[charToNum(num[*reached])] != NULL) {
+        tree = (tree->children)[charToNum(num[*reached])];
+        (*reached)++;
+        *shared = *shared || isShared(&(tree->references));
+        *copies += (*shared && *reached >= from) ? 1 : 0;
+    }
+    return tree;
+}
 
-    PhfwdPrefixesStack *stack;
-    prefixesInit(&stack);
-    if (!prefixesInsert(&stack, pref)) {
-        phfwdPrefixesDeleteWithLackOfMemory(pref);
+/**
+ * Usuwa prefiks @p num z tablicy węzła przekierowania @p diversion. Jeśli tablica stała się pusta, usuwa
+ * przekierowanie z węzła, a węzeł bez dzieci odcina razem z przodkami, którzy bez niego nie mieliby
+ * przekierowania ani innych dzieci. Współdzielone węzły na ścieżce są najpierw zastępowane kopiami.
+ * @param mem - kontekst alokacji drzew z zarezerwowanymi kopiami węzłów.
+ * @param root - wskaźnik na korzeń drzewa PhoneForwardReverse.
+ * @param diversion - przekierowanie zapisane w drzewie.
+ * @param num - prefiks numeru telefonu z tablicy węzła @p diversion.
+ * @param spare - pusta tablica na prefiksy węzła, jeśli jego tablica jest współdzielona, lub NULL.
+ */
+static void reverseErase(PhfwdMemory *mem, PhoneForwardReverse **root, char const *diversion, char const *num,
+                         Prefix *spare) {
+    PhfwdAllocator const *allocator = memAllocator(mem);
+    PhoneForwardReverse *node = ownReverse(mem, root);
+    PhoneForwardReverse **cut = NULL;
+
+    for (size_t idx = 0; diversion[idx] != '\0'; idx++) {
+        PhoneForwardReverse **slot = &(node->children)[charToNum(diversion[idx])];
+
+        // Ścieżkę można odciąć tylko poniżej najgłębszego przodka, który zostaje w drzewie.
+        if (idx == 0 || node->diversion != NULL || reverseChildren(node) > 1)
+            cut = slot;
+        node = ownReverse(mem, slot);
+    }
+
+    if (node->prefixes->count > 1) {
+        bool found;
+        node->prefixes = prefixTake(allocator, node->prefixes, spare);
+        prefixErase(allocator, node->prefixes, prefixFind(node->prefixes, num, &found));
         return;
     }
 
-    while (!prefixesEmpty(stack)) {
-        PhoneForwardPrefixes *node = prefixesPop(&stack);
-        for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
-            if ((node->children)[i] != NULL)
-                if (!prefixesInsert(&stack, (node->children)[i]))
-                    phfwdPrefixesDeleteWithLackOfMemory((node->children)[i]);
+    prefixRelease(allocator, node->prefixes);
+    node->prefixes = NULL;
+    stringRelease(allocator, node->diversion);
+    node->diversion = NULL;
+
+    if (reverseChildren(node) == 0) {
+        PhoneForwardReverse *chain = *cut;
+        *cut = NULL;
+        phfwdReverseRelease(allocator, chain);
+    }
+}
+
+bool additionPrepare(PhfwdMemory *mem, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                     char const *num1, char const *num2, PhfwdAddition *addition) {
+    PhfwdAllocator const *allocator = memAllocator(mem);
+    size_t reached, copies;
+    bool shared;
+    *addition = (PhfwdAddition) {num1, num2, NULL, NULL, NULL, NULL, false};
+
+    PhoneForwardPrefixes *node1 = walkPrefixes(prefixes, num1, &reached, &copies);
+    char const *old = (num1[reached] == '\0') ? node1->diversion : NULL;
+    size_t prefixesNodes = copies + strlen(num1 + reached);
+
+    if (old != NULL && strcmp(old, num2) == 0) {
+        addition->unchanged = true;
+        return true;
+    }
+
+    // Rezerwa jest dokładna, żeby przekierowanie mieszczące się w limicie zawsze dało się dodać.
+    PhoneForwardReverse *node2 = walkReverse(reverse, num2, 0, &reached, &copies, &shared);
+    size_t reverseNodes = copies + strlen(num2 + reached);
+    if (num2[reached] != '\0')
+        node2 = NULL;
+
+    bool newDiversion = node2 == NULL || node2->diversion == NULL;
+    bool newPrefixes = node2 == NULL || node2->prefixes == NULL || shared ||
+                       isShared(&(node2->prefixes->references)) || node2->prefixes->count == node2->prefixes->size;
+
+    if (newDiversion)
+        addition->diversion = stringNew(allocator, num2);
+    if (newPrefixes)
+        addition->prefixes = prefixNew(allocator, prefixGrowth((node2 == NULL) ? NULL : node2->prefixes));
+
+    bool result = (!newDiversion || addition->diversion != NULL) && (!newPrefixes || addition->prefixes != NULL);
+
+    if (old != NULL) {
+        // Węzły wspólne z przodkami węzła num2 są już policzone.
+        size_t common = 0;
+        while (old[common] != '\0' && old[common] == num2[common])
+            common++;
+
+        PhoneForwardReverse *node = walkReverse(reverse, old, common + 1, &reached, &copies, &shared);
+        reverseNodes += copies;
+
+        if (node->prefixes->count > 1 && (shared || isShared(&(node->prefixes->references)))) {
+            addition->spare = prefixNew(allocator, node->prefixes->size);
+            result = result && addition->spare != NULL;
         }
+    }
+
+    addition->prefix = stringNew(allocator, num1);
+    result = result && addition->prefix != NULL && memReserve(mem, MEM_PREFIXES_NODE, prefixesNodes) && memReserve(mem, MEM_REVERSE_NODE, reverseNodes);
+
+    if (!result)
+        additionCancel(allocator, addition);
+    return result;
+}
+
+void additionApply(PhfwdMemory *mem, PhoneForwardPrefixes **prefixes, PhoneForwardReverse **reverse,
+                   PhfwdAddition *addition) {
+    PhfwdAllocator const *allocator = memAllocator(mem);
+
+    if (addition->unchanged)
+        return;
+
+    // Od tego miejsca żadna alokacja nie może się nie powieść, bo wszystko jest wzięte z rezerwy.
+    PhoneForwardReverse *node2 = ownReversePath(mem, reverse, addition->num2);
+
+    if (node2->diversion == NULL) {
+        node2->diversion = addition->diversion;
+        addition->diversion = NULL;
+    }
+
+    bool found;
+    node2->prefixes = prefixTake(allocator, node2->prefixes, addition->prefixes);
+    addition->prefixes = NULL;
+    prefixInsert(node2->prefixes, prefixFind(node2->prefixes, addition->num1, &found), addition->prefix);
+    addition->prefix = NULL;
+
+    PhoneForwardPrefixes *node1 = ownPrefixesPath(mem, prefixes, addition->num1, strlen(addition->num1));
+    char *old = node1->diversion;
+    node1->diversion = stringRetain(node2->diversion);
+
+    if (old != NULL) {
+        reverseErase(mem, reverse, old, addition->num1, addition->spare);
+        addition->spare = NULL;
+        stringRelease(allocator, old);
+    }
+}
+
+void additionCancel(PhfwdAllocator const *allocator, PhfwdAddition *addition) {
+    stringRelease(allocator, addition->prefix);
+    stringRelease(allocator, addition->diversion);
+    prefixRelease(allocator, addition->prefixes);
+    prefixRelease(allocator, addition->spare);
+    addition->prefix = NULL;
+    addition->diversion = NULL;
+    addition->prefixes = NULL;
+    addition->spare = NULL;
+}
+
+/**
+ * Zapisuje w usunięciu przekierowanie prefiksu @p num. Daje na wyłączność ścieżkę jego przekierowania w drzewie
+ * PhoneForwardReverse i tablicę węzła, z której zostanie usunięty prefiks.
+ * @param mem - kontekst alokacji drzew.
+ * @param reverse - wskaźnik na korzeń drzewa PhoneForwardReverse.
+ * @param num - prefiks numeru telefonu.
+ * @param diversion - przekierowanie prefiksu.
+ * @param removal - wskaźnik na przygotowywane usunięcie.
+ * @return true - jeśli udało się zapisać przekierowanie.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool removalAddRule(PhfwdMemory *mem, PhoneForwardReverse **reverse, char const *num, char const *diversion,
+                           PhfwdRemoval *removal) {
+    PhfwdAllocator const *allocator = memAllocator(mem);
+    PhoneForwardReverse *node = ownReversePath(mem, reverse, diversion);
+    if (node == NULL)
+        return false;
+
+    if (node->prefixes->count > 1 && isShared(&(node->prefixes->references))) {
+        Prefix *copy = prefixNew(allocator, node->prefixes->size);
+        if (copy == NULL)
+            return false;
+        node->prefixes = prefixTake(allocator, node->prefixes, copy);
+    }
 
-        freePrefixNode(node);
+    if (removal->count == removal->size) {
+        size_t newSize = (removal->size == 0) ? 4 : 2 * removal->size;
+        PhfwdRemovalRule *rules = (PhfwdRemovalRule *) allocatorRealloc(memBaseAllocator(mem), removal->rules,
+                                                                        sizeof(PhfwdRemovalRule) * removal->size,
+                                                                        sizeof(PhfwdRemovalRule) * newSize);
+        if (rules == NULL)
+            return false;
+        removal->rules = rules;
+        removal->size = newSize;
     }
+
+    // Prefiks jest zapamiętywany jako napis z tablicy, więc nie trzeba go kopiować.
+    bool found;
+    size_t pos = prefixFind(node->prefixes, num, &found);
+    (removal->rules)[removal->count].num = (node->prefixes->nums)[pos];
+    (removal->rules)[removal->count].diversion = diversion;
+    (removal->count)++;
+    return true;
 }
 
 /**
- * Usuwa pojedyncze przekierowanie numeru.
- * @param pointers - wskaźnik na strukturę przechowującą wskaźniki węzeł drzewa PhoneForwardReverse
- *                   i element w liście poprzedzający element zawierający prefiks numeru telefonu.
+ * Przygotowuje usunięcie samego przekierowania z węzła, który ma dzieci, więc zostaje w drzewie.
+ * @param mem - kontekst alokacji drzew.
+ * @param prefixes - wskaźnik na korzeń drzewa PhoneForwardPrefixes.
+ * @param reverse - wskaźnik na korzeń drzewa PhoneForwardReverse.
+ * @param num - prefiks numeru telefonu, którego węzeł ma przekierowanie.
+ * @param removal - wskaźnik na przygotowywane usunięcie.
+ * @return true - jeśli usunięcie można wykonać funkcją removalApply.
+ *         false - jeśli nie powiodła się alokacja pamięci. Wtedy usunięcie jest już zwolnione.
  */
-static void deleteDiversion(PhfwdPointers *pointers) {
-    PrefixDeleteOneElement(pointers->prevInList);
+static bool removalPrepareOne(PhfwdMemory *mem, PhoneForwardPrefixes **prefixes, PhoneForwardReverse **reverse,
+                              char const *num, PhfwdRemoval *removal) {
+    PhoneForwardPrefixes *node = ownPrefixesPath(mem, prefixes, num, strlen(num));
+    bool result = node != NULL && removalAddRule(mem, reverse, num, node->diversion, removal);
+
+    if (result)
+        removal->node = node;
+    else
+        removalCancel(mem, removal);
+    return result;
+}
 
-    if (pointers->node->prefixes->next == NULL) {
-        Prefix *tmp = pointers->node->prefixes;
-        pointers->node->prefixes = NULL;
-        free(tmp);
+bool removalPrepare(PhfwdMemory *mem, PhoneForwardPrefixes **prefixes, PhoneForwardReverse **reverse,
+                    char const *num, bool subtree, PhfwdRemoval *removal) {
+    size_t length = strlen(num);
+    size_t keep = 0;
+    PhoneForwardPrefixes *node = *prefixes;
+    *removal = (PhfwdRemoval) {NULL, NULL, NULL, 0, 0, NULL};
+
+    // Odłączane są też przodkowie prefiksu, którzy bez niego nie mieliby przekierowania ani innych dzieci.
+    for (size_t idx = 0; idx < length; idx++) {
+        if (node->diversion != NULL || prefixesChildren(node) > 1)
+            keep = idx;
+        node = (node->children)[charToNum(num[idx])];
+        if (node == NULL)
+            return true;
+    }
 
-        char *tmp2 = pointers->node->diversion;
-        pointers->node->diversion = NULL;
-        free(tmp2);
+    // Węzeł bez dzieci ma tylko swoje przekierowanie, więc można go odłączyć tak jak całe poddrzewo.
+    if (!subtree && node->diversion == NULL)
+        return true;
+    if (!subtree && prefixesChildren(node) > 0)
+        return removalPrepareOne(mem, prefixes, reverse, num, removal);
+
+    PhoneForwardPrefixes *parent = ownPrefixesPath(mem, prefixes, num, keep);
+    if (parent == NULL)
+        return false;
+    removal->slot = &(parent->children)[charToNum(num[keep])];
+
+    NodeStack stack;
+    nodeStackInit(&stack, memBaseAllocator(mem));
+    char *path = NULL;
+    size_t pathSize = 0;
+    bool result = nodeStackPush(&stack, *(removal->slot), NULL, keep + 1, charToNum(num[keep]));
+
+    for (size_t idx = 0; idx < keep && result; idx++)
+        result = pathSet(&path, &pathSize, idx + 1, charToNum(num[idx]));
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        node = frame.first;
+        result = pathSet(&path, &pathSize, frame.depth, frame.sign) &&
+                 (node->diversion == NULL || removalAddRule(mem, reverse, path, node->diversion, removal));
+
+        for (int i = 0; i < SIGNS_IN_NUMBER && result; i++) {
+            if ((node->children)[i] != NULL)
+                result = nodeStackPush(&stack, (node->children)[i], NULL, frame.depth + 1, i);
+        }
     }
 
+    nodeStackFree(&stack);
+    free(path);
+
+    // Bez stanu usuwania poddrzewo zostanie po prostu usunięte od razu.
+    removal->teardown = (PhfwdTeardown *) memAlloc(mem, MEM_TEARDOWN);
+
+    if (!result)
+        removalCancel(mem, removal);
+    return result;
+}
+
+void removalApply(PhfwdMemory *mem, PhoneForwardReverse **reverse, PhfwdTeardown **pending, PhfwdRemoval *removal) {
+    PhfwdAllocator const *allocator = memAllocator(mem);
+
+    // Przekierowania poddrzewa są usuwane od razu, a samo poddrzewo stopniowo przez kolejne operacje.
+    for (size_t i = 0; i < removal->count; i++)
+        reverseErase(mem, reverse, (removal->rules)[i].diversion, (removal->rules)[i].num, NULL);
+
+    if (removal->node != NULL) {
+        stringRelease(allocator, removal->node->diversion);
+        removal->node->diversion = NULL;
+        removal->node = NULL;
+    }
+
+    if (removal->slot == NULL) {
+        removalCancel(mem, removal);
+        return;
+    }
+
+    PhoneForwardPrefixes *subtree = *(removal->slot);
+    *(removal->slot) = NULL;
+    removal->slot = NULL;
+
+    if (dropReference(&(subtree->references))) {
+        if (removal->teardown == NULL) {
+            PhfwdTeardown t;
+            teardownInit(&t, subtree);
+            teardownStep(allocator, &t, SIZE_MAX);
+        } else {
+            teardownInit(removal->teardown, subtree);
+            removal->teardown->next = *pending;
+            *pending = removal->teardown;
+            removal->teardown = NULL;
+        }
+    }
+    removalCancel(mem, removal);
+}
+
+void removalCancel(PhfwdMemory *mem, PhfwdRemoval *removal) {
+    allocatorFree(memBaseAllocator(mem), removal->rules, sizeof(PhfwdRemovalRule) * removal->size);
+    memFree(memAllocator(mem), removal->teardown, MEM_TEARDOWN);
+    removal->rules = NULL;
+    removal->count = 0;
+    removal->size = 0;
+    removal->teardown = NULL;
 }
 
 /**
@@ -242,164 +787,613 @@ static PhoneForwardReverse *findNodeInReverse(PhoneForwardReverse *tree, char co
     return tree;
 }
 
-/**
- * Szuka węzła, przechowującego prefiks numeru telefonu @p num. Zmienia wartość wskazywaną przez @p idxInNum tak, żeby
- * oznaczała indeks w @p num odpowiadający ostatnio odwiedzonej gałęzi w drzewie trie.
- * @param tree - wskaźnik na korzeń drzewa PhoneForwardPrefixes.
- * @param num - prefiks numeru telefonu.
- * @param idxInNum - wskaźnik, który w wyniku działania funkcji zostanie ustawiony na indeks
- *                   w @p num odpowiadający ostatnio odwiedzonej gałęzi w drzewie.
- * @return - węzeł, przechowujący wskaźniki na prefiks numeru telefonu lub ostatni odwiedzony węzeł, jeśli szukanego elementu nie ma drzewie.
- */
-static PhoneForwardPrefixes *findNodeInPrefixes(PhoneForwardPrefixes *tree, char const num[], size_t *idxInNum) {
-    size_t diversionLength = strlen(num);
-    *idxInNum = 0;
+const char *findOnePrefix(PhoneForwardPrefixes *tree, char const *num, size_t *length) {
+    size_t prefixLength = strlen(num);
+    size_t idx = 0;
+    char *diversion = NULL;
 
-    while (*idxInNum < diversionLength && (tree->children)[charToNum(num[*idxInNum])] != NULL) {
-        tree = (tree->children)[charToNum(num[*idxInNum])];
-        (*idxInNum)++;
+    while (idx < prefixLength && (tree->children)[charToNum(num[idx])] != NULL) {
+        tree = (tree->children)[charToNum(num[idx])];
+        idx++;
+        if (tree->diversion != NULL) {
+            *length = idx;
+            diversion = tree->diversion;
+        }
+    }
+    if (diversion == NULL) {
+        *length = 0;
     }
+    return diversion;
+}
+
+PhoneForwardPrefixes *findPrefixesNode(PhoneForwardPrefixes *tree, char const *num, size_t length) {
+    for (size_t i = 0; i < length && tree != NULL; i++)
+        tree = (tree->children)[charToNum(num[i])];
     return tree;
 }
 
+PhoneForwardReverse *findReverseNode(PhoneForwardReverse *tree, char const *num) {
+    size_t idx = 0;
+    tree = findNodeInReverse(tree, num, &idx);
+    return (num[idx] == '\0') ? tree : NULL;
+}
+
+void releaseTries(PhfwdAllocator const *allocator, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                  PhfwdTeardown *pending) {
+    while (pending != NULL) {
+        PhfwdTeardown *tmp = pending;
+        pending = tmp->next;
+        teardownStep(allocator, tmp, SIZE_MAX);
+        memFree(allocator, tmp, MEM_TEARDOWN);
+    }
+
+    phfwdReverseRelease(allocator, reverse);
+    phfwdPrefixesRelease(allocator, prefixes);
+}
+
 /**
- * Dodaje przekierowanie do węzła @p node w drzewie PhoneForwardReverse.
- * @param node - węzeł, który będzie przechowywał przekierowanie numeru.
- * @param num1 - prefiks numeru telefonu.
- * @param num2 - numer będący przekierowaniem prefiks numeru telefonu.
- * @return - element struktury PhfwdPointers, przechowujący wskaźniki na @p node oraz
- *          element listy Prefix, poprzedzający element przechowujący prefiks numeru telefonu.
- *         - NULL, jeśli nie udało sie alokować pamięci.
+ * Kopiuje węzły drzewa PhoneForwardPrefixes, bez zapisanych w nich przekierowań.
+ * @param mem - kontekst alokacji kopii.
+ * @param tree - korzeń kopiowanego drzewa.
+ * @param copy - korzeń pustego drzewa, do którego zostaną skopiowane węzły.
+ * @return true - jeśli udało się skopiować drzewo.
+ *         false - jeśli nie powiodła się alokacja pamięci.
  */
-static PhfwdPointers *addDiversion(PhoneForwardReverse *node, char const *num1, char const *num2) {
-    char *diversionCopy = NULL;
-    size_t diversionLength = strlen(num2);
+static bool copyPrefixesNodes(PhfwdMemory *mem, PhoneForwardPrefixes *tree, PhoneForwardPrefixes *copy) {
+    NodeStack stack;
+    nodeStackInit(&stack, memBaseAllocator(mem));
+    bool result = nodeStackPush(&stack, tree, copy, 0, 0);
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardPrefixes *node = frame.first;
+        PhoneForwardPrefixes *nodeCopy = frame.second;
+
+        for (int i = 0; i < SIGNS_IN_NUMBER && result; i++) {
+            if ((node->children)[i] == NULL)
+                continue;
+
+            PhoneForwardPrefixes *child = phfwdPrefixesNew(mem);
+            (nodeCopy->children)[i] = child;
+            result = child != NULL && nodeStackPush(&stack, (node->children)[i], child, 0, i);
+        }
+    }
 
-    if (node->diversion == NULL) {
-        diversionCopy = (char *) malloc(sizeof(char) * (diversionLength + 1));
+    nodeStackFree(&stack);
+    return result;
+}
 
-        if (diversionCopy == NULL)
-            return NULL;
+/**
+ * Kopiuje przekierowanie i tablicę prefiksów jednego węzła drzewa PhoneForwardReverse i zapisuje przekierowanie
+ * w odpowiednich węzłach skopiowanego już drzewa PhoneForwardPrefixes.
+ * @param mem - kontekst alokacji kopii.
+ * @param node - kopiowany węzeł drzewa PhoneForwardReverse.
+ * @param prefixesCopy - korzeń kopii drzewa PhoneForwardPrefixes lub NULL, jeśli przekierowania nie mają być w niej
+ *                       zapisywane.
+ * @param nodeCopy - węzeł kopii drzewa PhoneForwardReverse.
+ * @return true - jeśli udało się skopiować przekierowania.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool copyDiversions(PhfwdMemory *mem, PhoneForwardReverse *node, PhoneForwardPrefixes *prefixesCopy,
+                           PhoneForwardReverse *nodeCopy) {
+    PhfwdAllocator const *allocator = memAllocator(mem);
+
+    if (node->prefixes == NULL)
+        return true;
+
+    nodeCopy->diversion = stringNew(allocator, node->diversion);
+    nodeCopy->prefixes = prefixNew(allocator, node->prefixes->count);
+    if (nodeCopy->diversion == NULL || nodeCopy->prefixes == NULL)
+        return false;
+
+    // Tablica jest już uporządkowana, więc napisy są dopisywane na koniec.
+    for (size_t i = 0; i < node->prefixes->count; i++) {
+        char *num = stringNew(allocator, (node->prefixes->nums)[i]);
+        if (num == NULL)
+            return false;
+        prefixInsert(nodeCopy->prefixes, i, num);
+        if (prefixesCopy == NULL)
+            continue;
 
-        strcpy(diversionCopy, num2);
+        PhoneForwardPrefixes *target = findPrefixesNode(prefixesCopy, num, strlen(num));
+        target->diversion = stringRetain(nodeCopy->diversion);
+    }
+    return true;
+}
 
-        node->diversion = diversionCopy;
+/**
+ * Kopiuje drzewo PhoneForwardReverse razem z przekierowaniami.
+ * @param mem - kontekst alokacji kopii.
+ * @param tree - korzeń kopiowanego drzewa.
+ * @param prefixesCopy - korzeń kopii drzewa PhoneForwardPrefixes, w której zostaną zapisane przekierowania, lub NULL.
+ * @param copy - korzeń pustego drzewa, do którego zostaną skopiowane węzły.
+ * @return true - jeśli udało się skopiować drzewo.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool copyReverse(PhfwdMemory *mem, PhoneForwardReverse *tree, PhoneForwardPrefixes *prefixesCopy,
+                        PhoneForwardReverse *copy) {
+    NodeStack stack;
+    nodeStackInit(&stack, &(mem->account->base));
+    bool result = nodeStackPush(&stack, tree, copy, 0, 0);
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardReverse *node = frame.first;
+        PhoneForwardReverse *nodeCopy = frame.second;
+
+        result = copyDiversions(mem, node, prefixesCopy, nodeCopy);
+
+        for (int i = 0; i < SIGNS_IN_NUMBER && result; i++) {
+            if ((node->children)[i] == NULL)
+                continue;
+
+            PhoneForwardReverse *child = phfwdReverseNew(mem);
+            (nodeCopy->children)[i] = child;
+            result = child != NULL && nodeStackPush(&stack, (node->children)[i], child, 0, i);
+        }
     }
 
-    Prefix *prev = prefixAdd(node, num1);
+    nodeStackFree(&stack);
+    return result;
+}
 
-    if (prev == NULL) {
-        if (diversionCopy != NULL) {
-            free(diversionCopy);
-            node->diversion = NULL;
-        }
-        return NULL;
+bool copyTries(MemoryAccount *account, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+               PhoneForwardPrefixes **prefixesCopy, PhoneForwardReverse **reverseCopy) {
+    PhfwdMemory mem;
+    memInit(&mem, account);
+    *prefixesCopy = phfwdPrefixesNew(&mem);
+    *reverseCopy = phfwdReverseNew(&mem);
+
+    bool result = *prefixesCopy != NULL && *reverseCopy != NULL &&
+                  copyPrefixesNodes(&mem, prefixes, *prefixesCopy) &&
+                  copyReverse(&mem, reverse, *prefixesCopy, *reverseCopy);
+
+    if (!result) {
+        phfwdReverseRelease(memAllocator(&mem), *reverseCopy);
+        phfwdPrefixesRelease(memAllocator(&mem), *prefixesCopy);
     }
+    return result;
+}
 
-    PhfwdPointers *pointers = PhfwdPointersNew(node, prev);
+/**
+ * @struct SharedNodes
+ * @brief SharedNodes jest tablicą z haszowaniem o adresowaniu otwartym, w której są zapamiętane różne węzły
+ * budowanej kopii drzewa PhoneForwardPrefixes. Węzły są porównywane po przekierowaniu i wskaźnikach na dzieci.
+ */
+struct SharedNodes {
+    PhoneForwardPrefixes **slots; ///< Miejsca tablicy, NULL oznacza wolne miejsce.
+    size_t size; ///< Liczba miejsc, potęga dwójki.
+    size_t used; ///< Liczba zajętych miejsc.
+    PhfwdAllocator const *allocator; ///< Alokator tablicy.
+};
+typedef struct SharedNodes SharedNodes;
 
-    if (pointers == NULL) {
-        PrefixDeleteOneElement(prev);
-        if (diversionCopy != NULL) {
-            free(diversionCopy);
-            node->diversion = NULL;
-        }
-        return NULL;
+/**
+ * Podaje skrót węzła o podanym przekierowaniu i dzieciach.
+ * @param diversion - napis przekierowania lub NULL.
+ * @param children - dzieci węzła.
+ * @return - skrót.
+ */
+static uint64_t sharedHash(char const *diversion, PhoneForwardPrefixes *const children[]) {
+    uint64_t hash = (uint64_t) (uintptr_t) diversion * 0x9E3779B97F4A7C15u;
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++)
+        hash = (hash ^ (uint64_t) (uintptr_t) children[i]) * 0x100000001b3u;
+    return hash ^ (hash >> 29);
+}
+
+/**
+ * Szuka w tablicy węzła o podanym przekierowaniu i dzieciach.
+ * @param shared - tablica z co najmniej jednym wolnym miejscem.
+ * @param hash - skrót węzła.
+ * @param diversion - napis przekierowania lub NULL.
+ * @param children - dzieci węzła.
+ * @return - miejsce z identycznym węzłem lub wolne miejsce, w którym należy go zapamiętać.
+ */
+static PhoneForwardPrefixes **sharedFind(SharedNodes const *shared, uint64_t hash, char const *diversion,
+                                         PhoneForwardPrefixes *const children[]) {
+    size_t i = (size_t) hash & (shared->size - 1);
+
+    while ((shared->slots)[i] != NULL &&
+           ((shared->slots)[i]->diversion != diversion ||
+            memcmp((shared->slots)[i]->children, children, sizeof(PhoneForwardPrefixes *) * SIGNS_IN_NUMBER) != 0))
+        i = (i + 1) & (shared->size - 1);
+    return &(shared->slots)[i];
+}
+
+/**
+ * Powiększa tablicę, jeśli po dodaniu węzła byłaby zapełniona w ponad połowie.
+ * @param shared - wskaźnik na tablicę.
+ * @return true - jeśli w tablicy jest miejsce na kolejny węzeł.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool sharedReserve(SharedNodes *shared) {
+    if (2 * (shared->used + 1) <= shared->size)
+        return true;
+
+    size_t newSize = (shared->size == 0) ? 64 : 2 * shared->size;
+    PhoneForwardPrefixes **slots = (PhoneForwardPrefixes **) allocatorAlloc(shared->allocator,
+                                                                            sizeof(PhoneForwardPrefixes *) * newSize);
+    if (slots == NULL)
+        return false;
+
+    for (size_t i = 0; i < newSize; i++)
+        slots[i] = NULL;
+
+    // Zapamiętane węzły są różne, więc wystarczy je rozmieścić według skrótów.
+    for (size_t i = 0; i < shared->size; i++) {
+        PhoneForwardPrefixes *node = (shared->slots)[i];
+        if (node == NULL)
+            continue;
+
+        size_t j = (size_t) sharedHash(node->diversion, node->children) & (newSize - 1);
+        while (slots[j] != NULL)
+            j = (j + 1) & (newSize - 1);
+        slots[j] = node;
     }
 
-    return pointers;
+    allocatorFree(shared->allocator, shared->slots, sizeof(PhoneForwardPrefixes *) * shared->size);
+    shared->slots = slots;
+    shared->size = newSize;
+    return true;
 }
 
-PhfwdPointers *addToReverse(PhoneForwardReverse *tree, char const *num1, char const *num2) {
+/**
+ * Daje węzeł kopii o podanym przekierowaniu i dzieciach: zapamiętany już identyczny węzeł albo nowy.
+ * Odwołania do dzieci z tablicy @p children przechodzą na nowy węzeł albo są zwalniane, bo identyczny węzeł
+ * ma już własne, a tablica jest potem zerowana.
+ * @param mem - kontekst alokacji kopii.
+ * @param shared - wskaźnik na tablicę zapamiętanych węzłów.
+ * @param diversion - napis przekierowania z kopii drzewa PhoneForwardReverse lub NULL.
+ * @param children - dzieci węzła, do których węzeł dostaje po jednym odwołaniu.
+ * @param hits - liczba trafień kopiowanego węzła.
+ * @return - węzeł z nowym odwołaniem lub NULL, jeśli nie powiodła się alokacja pamięci.
+ */
+static PhoneForwardPrefixes *sharedNode(PhfwdMemory *mem, SharedNodes *shared, char *diversion,
+                                        PhoneForwardPrefixes *children[], unsigned hits) {
+    if (!sharedReserve(shared))
+        return NULL;
 
-    size_t diversionLength = strlen(num2);
-    size_t idx = 0;
+    uint64_t hash = sharedHash(diversion, children);
+    PhoneForwardPrefixes **slot = sharedFind(shared, hash, diversion, children);
+    PhoneForwardPrefixes *node = *slot;
+
+    if (node != NULL) {
+        retain(&(node->references));
+        for (int i = 0; i < SIGNS_IN_NUMBER; i++)
+            phfwdPrefixesRelease(memAllocator(mem), children[i]);
+    } else {
+        node = phfwdPrefixesNew(mem);
+        if (node == NULL)
+            return NULL;
 
-    tree = findNodeInReverse(tree, num2, &idx);
+        node->diversion = (diversion == NULL) ? NULL : stringRetain(diversion);
+        memcpy(node->children, children, sizeof(PhoneForwardPrefixes *) * SIGNS_IN_NUMBER);
+        atomic_init(&(node->hits), hits);
+        *slot = node;
+        (shared->used)++;
+    }
 
-    size_t safetyIdx = idx;
-    PhoneForwardReverse *safetyNode = tree;
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++)
+        children[i] = NULL;
+    return node;
+}
 
-    while (idx < diversionLength) {
-        PhoneForwardReverse *newNode = phfwdReverseNew();
+/**
+ * Kopiuje drzewo PhoneForwardPrefixes od liści do korzenia tak, że identyczne poddrzewa kopii są jednym węzłem.
+ * Dzieci węzła są gotowe przed nim, więc węzeł jest identyczny z zapamiętanym, jeśli ma to samo przekierowanie
+ * i te same wskaźniki na dzieci. Węzeł jest zdejmowany ze stosu dwa razy: przy wejściu, kiedy na stos trafiają
+ * jego dzieci, i przy wyjściu, oznaczonym wskaźnikiem na węzeł w polu second.
+ * @param mem - kontekst alokacji kopii.
+ * @param tree - korzeń kopiowanego drzewa.
+ * @param reverseCopy - korzeń kopii drzewa PhoneForwardReverse, z której są brane napisy przekierowań.
+ * @param copy - wskaźnik, pod którym zostanie zapisany korzeń kopii.
+ * @return true - jeśli udało się skopiować drzewo.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool copyPrefixesShared(PhfwdMemory *mem, PhoneForwardPrefixes *tree, PhoneForwardReverse *reverseCopy,
+                               PhoneForwardPrefixes **copy) {
+    PhfwdAllocator const *base = &(mem->account->base);
+    SharedNodes shared = {NULL, 0, 0, base};
+    // levels[d] zbiera kopie dzieci węzła na głębokości d, który jest teraz na ścieżce z korzenia.
+    PhoneForwardPrefixes *(*levels)[SIGNS_IN_NUMBER] = NULL;
+    size_t levelsSize = 0;
+
+    NodeStack stack;
+    nodeStackInit(&stack, base);
+    bool result = nodeStackPush(&stack, tree, NULL, 0, 0);
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardPrefixes *node = frame.first;
+
+        if (frame.depth + 2 > levelsSize) {
+            size_t newSize = 2 * (frame.depth + 2);
+            void *grown = allocatorRealloc(base, levels, sizeof(*levels) * levelsSize, sizeof(*levels) * newSize);
+            if (grown == NULL) {
+                result = false;
+                break;
+            }
+            levels = grown;
+            for (size_t d = levelsSize; d < newSize; d++) {
+                for (int i = 0; i < SIGNS_IN_NUMBER; i++)
+                    levels[d][i] = NULL;
+            }
+            levelsSize = newSize;
+        }
 
-        if (newNode == NULL) {
-            phfwdReverseDelete((safetyNode->children)[charToNum(num2[safetyIdx])]);
-            (safetyNode->children)[charToNum(num2[safetyIdx])] = NULL;
-            return NULL;
+        if (frame.second == NULL) {
+            result = nodeStackPush(&stack, node, node, frame.depth, frame.sign);
+            for (int i = 0; i < SIGNS_IN_NUMBER && result; i++) {
+                if ((node->children)[i] != NULL)
+                    result = nodeStackPush(&stack, (node->children)[i], NULL, frame.depth + 1, i);
+            }
+            continue;
         }
 
-        (tree->children)[charToNum(num2[idx])] = newNode;
-        tree = newNode;
-        idx++;
+        char *diversion = (node->diversion == NULL) ? NULL : findReverseNode(reverseCopy, node->diversion)->diversion;
+        levels[frame.depth][frame.sign] = sharedNode(mem, &shared, diversion, levels[frame.depth + 1],
+                                                     atomic_load_explicit(&(node->hits), memory_order_relaxed));
+        result = levels[frame.depth][frame.sign] != NULL;
     }
 
-    PhfwdPointers *pointers = addDiversion(tree, num1, num2);
+    nodeStackFree(&stack);
+    allocatorFree(base, shared.slots, sizeof(PhoneForwardPrefixes *) * shared.size);
 
-    if (pointers == NULL) {
-        if (safetyIdx < diversionLength) {
-            phfwdReverseDelete((safetyNode->children)[charToNum(num2[safetyIdx])]);
-            (safetyNode->children)[charToNum(num2[safetyIdx])] = NULL;
+    *copy = result ? levels[0][0] : NULL;
+    if (!result) {
+        for (size_t d = 0; d < levelsSize; d++) {
+            for (int i = 0; i < SIGNS_IN_NUMBER; i++)
+                phfwdPrefixesRelease(memAllocator(mem), levels[d][i]);
         }
-        return NULL;
     }
+    allocatorFree(base, levels, sizeof(*levels) * levelsSize);
+    return result;
+}
 
-    return pointers;
+bool copyTriesShared(MemoryAccount *account, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                     PhoneForwardPrefixes **prefixesCopy, PhoneForwardReverse **reverseCopy) {
+    PhfwdMemory mem;
+    memInit(&mem, account);
+    *prefixesCopy = NULL;
+    *reverseCopy = phfwdReverseNew(&mem);
+
+    // Węzły drzewa PhoneForwardPrefixes wskazują napisy przekierowań z kopii drzewa PhoneForwardReverse.
+    bool result = *reverseCopy != NULL &&
+                  copyReverse(&mem, reverse, NULL, *reverseCopy) &&
+                  copyPrefixesShared(&mem, prefixes, *reverseCopy, prefixesCopy);
+
+    if (!result)
+        phfwdReverseRelease(memAllocator(&mem), *reverseCopy);
+    return result;
 }
 
-bool addToPrefixes(PhoneForwardPrefixes *tree, char const *num1, PhfwdPointers *pointers) {
-    size_t prefixLength = strlen(num1);
-    size_t idx = 0;
+bool triesSlabSize(PhfwdAllocator const *allocator, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                   size_t *size) {
+    NodeStack stack;
+    nodeStackInit(&stack, allocator);
+    bool result = nodeStackPush(&stack, prefixes, NULL, 0, 0);
+    *size = 0;
 
-    tree = findNodeInPrefixes(tree, num1, &idx);
+    while (result && !nodeStackEmpty(&stack)) {
+        PhoneForwardPrefixes *node = nodeStackPop(&stack).first;
+        *size += accountSlabSpace(sizeof(PhoneForwardPrefixes));
 
-    size_t safetyIdx = idx;
-    PhoneForwardPrefixes *safetyNode = tree;
+        for (int i = 0; i < SIGNS_IN_NUMBER && result; i++) {
+            if ((node->children)[i] != NULL)
+                result = nodeStackPush(&stack, (node->children)[i], NULL, 0, i);
+        }
+    }
 
-    while (idx < prefixLength) {
-        PhoneForwardPrefixes *newNode = phfwdPrefixesNew();
+    result = result && nodeStackPush(&stack, reverse, NULL, 0, 0);
 
-        if (newNode == NULL) {
-            phfwdPrefixesDelete((safetyNode->children)[charToNum(num1[safetyIdx])]);
-            (safetyNode->children)[charToNum(num1[safetyIdx])] = NULL;
-            return false;
+    while (result && !nodeStackEmpty(&stack)) {
+        PhoneForwardReverse *node = nodeStackPop(&stack).first;
+        *size += accountSlabSpace(sizeof(PhoneForwardReverse));
+
+        // Kopia tablicy ma dokładnie tyle miejsc, ile jest w niej prefiksów.
+        if (node->prefixes != NULL) {
+            *size += accountSlabSpace(prefixBytes(node->prefixes->count)) +
+                     accountSlabSpace(stringSize(strlen(node->diversion)));
+            for (size_t i = 0; i < node->prefixes->count; i++)
+                *size += accountSlabSpace(stringSize(strlen((node->prefixes->nums)[i])));
         }
 
-        (tree->children)[charToNum(num1[idx])] = newNode;
-        tree = newNode;
-        idx++;
+        for (int i = 0; i < SIGNS_IN_NUMBER && result; i++) {
+            if ((node->children)[i] != NULL)
+                result = nodeStackPush(&stack, (node->children)[i], NULL, 0, i);
+        }
     }
 
-    if (pointers->prevInList->num != NULL)
-        addPointerToPrefixesNode(tree, pointers->prevInList);
+    nodeStackFree(&stack);
+    return result;
+}
 
-    if (safetyIdx == prefixLength && safetyNode->pointersToReverse != NULL) {
-        deleteDiversion(safetyNode->pointersToReverse);
-        PhfwdPointers *tmp = safetyNode->pointersToReverse;
-        safetyNode->pointersToReverse = NULL;
-        free(tmp);
+/**
+ * Ustawia w tablicy @p order indeksy dzieci węzła w kolejności rosnącej liczby trafień, a przy równej liczbie
+ * trafień malejących indeksów. Dzieci wstawione do stosu w tej kolejności są zdejmowane od najczęściej używanego.
+ * @param hits - liczby trafień kolejnych dzieci.
+ * @param order - tablica, w której zostaną zapisane indeksy.
+ */
+static void orderByHits(unsigned const hits[], int order[]) {
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        int j = i;
+        while (j > 0 && hits[order[j - 1]] >= hits[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
     }
+}
 
-    tree->pointersToReverse = pointers;
+/**
+ * Wstawia do stosu dzieci węzła drzewa PhoneForwardPrefixes w kolejności ustalonej przez orderByHits.
+ * @param stack - wskaźnik na stos.
+ * @param node - węzeł kopiowanego drzewa.
+ * @param nodeCopy - kopia węzła @p node.
+ * @param hotOnly - czy pominąć dzieci bez trafień.
+ * @return true - jeśli udało się wstawić dzieci do stosu.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool pushPrefixesByHits(NodeStack *stack, PhoneForwardPrefixes *node, PhoneForwardPrefixes *nodeCopy,
+                               bool hotOnly) {
+    unsigned hits[SIGNS_IN_NUMBER];
+    int order[SIGNS_IN_NUMBER];
+
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        PhoneForwardPrefixes *child = (node->children)[i];
+        hits[i] = (child == NULL) ? 0 : atomic_load_explicit(&(child->hits), memory_order_relaxed);
+    }
+    orderByHits(hits, order);
 
+    for (int k = 0; k < SIGNS_IN_NUMBER; k++) {
+        int i = order[k];
+        if ((node->children)[i] == NULL || (hotOnly && hits[i] == 0))
+            continue;
+        if (!nodeStackPush(stack, (node->children)[i], nodeCopy, 0, i))
+            return false;
+    }
     return true;
 }
 
-void deleteSubtree(PhoneForwardPrefixes *tree) {
-    PhfwdPrefixesStack *stack;
-    prefixesInit(&stack);
-    prefixesInsert(&stack, tree);
+/**
+ * Wstawia do stosu dzieci węzła drzewa PhoneForwardReverse w kolejności ustalonej przez orderByHits.
+ * @param stack - wskaźnik na stos.
+ * @param node - węzeł kopiowanego drzewa.
+ * @param nodeCopy - kopia węzła @p node.
+ * @param hotOnly - czy pominąć dzieci bez trafień.
+ * @return true - jeśli udało się wstawić dzieci do stosu.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool pushReverseByHits(NodeStack *stack, PhoneForwardReverse *node, PhoneForwardReverse *nodeCopy,
+                              bool hotOnly) {
+    unsigned hits[SIGNS_IN_NUMBER];
+    int order[SIGNS_IN_NUMBER];
+
+    for (int i = 0; i < SIGNS_IN_NUMBER; i++) {
+        PhoneForwardReverse *child = (node->children)[i];
+        hits[i] = (child == NULL) ? 0 : atomic_load_explicit(&(child->hits), memory_order_relaxed);
+    }
+    orderByHits(hits, order);
 
-    while (!prefixesEmpty(stack)) {
-        PhoneForwardPrefixes *node = prefixesPop(&stack);
-        for (int i = 0; i <= 11; i++) {
-            if ((node->children)[i] != NULL)
-                prefixesInsert(&stack, (node->children)[i]);
+    for (int k = 0; k < SIGNS_IN_NUMBER; k++) {
+        int i = order[k];
+        if ((node->children)[i] == NULL || (hotOnly && hits[i] == 0))
+            continue;
+        if (!nodeStackPush(stack, (node->children)[i], nodeCopy, 0, i))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Kopiuje węzły drzewa PhoneForwardPrefixes w porządku przeszukiwania w głąb, w którym dzieci są odwiedzane
+ * od najczęściej używanego. Węzeł jest przydzielany dopiero przy odwiedzeniu, więc najczęściej używana ścieżka
+ * od każdego węzła leży w pamięci zaraz za nim.
+ * @param mem - kontekst alokacji kopii.
+ * @param tree - korzeń kopiowanego drzewa.
+ * @param copy - korzeń kopii.
+ * @param hotOnly - czy kopiować tylko węzły z trafieniami. Przy kolejnym wywołaniu bez tego ograniczenia
+ *                  dokopiowywane są pozostałe węzły.
+ * @return true - jeśli udało się skopiować węzły.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool copyPrefixesByHits(PhfwdMemory *mem, PhoneForwardPrefixes *tree, PhoneForwardPrefixes *copy,
+                               bool hotOnly) {
+    NodeStack stack;
+    nodeStackInit(&stack, &(mem->account->base));
+    bool result = pushPrefixesByHits(&stack, tree, copy, hotOnly);
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardPrefixes *node = frame.first;
+        PhoneForwardPrefixes *parentCopy = frame.second;
+        PhoneForwardPrefixes *nodeCopy = (parentCopy->children)[frame.sign];
+
+        if (nodeCopy == NULL) {
+            nodeCopy = phfwdPrefixesNew(mem);
+            if (nodeCopy == NULL) {
+                result = false;
+                break;
+            }
+            // Stare trafienia tracą na znaczeniu, żeby kolejne przestawienie nadążało za zmianą ruchu.
+            atomic_init(&(nodeCopy->hits), atomic_load_explicit(&(node->hits), memory_order_relaxed) / 2);
+            (parentCopy->children)[frame.sign] = nodeCopy;
         }
-        if (node->pointersToReverse != NULL) {
-            deleteDiversion(node->pointersToReverse);
-            free(node->pointersToReverse);
+
+        result = pushPrefixesByHits(&stack, node, nodeCopy, hotOnly);
+    }
+
+    nodeStackFree(&stack);
+    return result;
+}
+
+/**
+ * Kopiuje drzewo PhoneForwardReverse razem z przekierowaniami tak jak copyPrefixesByHits. Przekierowania węzła
+ * są kopiowane zaraz po nim.
+ * @param mem - kontekst alokacji kopii.
+ * @param tree - korzeń kopiowanego drzewa PhoneForwardReverse.
+ * @param prefixesCopy - korzeń pełnej kopii drzewa PhoneForwardPrefixes.
+ * @param copy - korzeń kopii drzewa PhoneForwardReverse.
+ * @param hotOnly - czy kopiować tylko węzły z trafieniami.
+ * @return true - jeśli udało się skopiować węzły.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool copyReverseByHits(PhfwdMemory *mem, PhoneForwardReverse *tree, PhoneForwardPrefixes *prefixesCopy,
+                              PhoneForwardReverse *copy, bool hotOnly) {
+    NodeStack stack;
+    nodeStackInit(&stack, &(mem->account->base));
+    bool result = pushReverseByHits(&stack, tree, copy, hotOnly);
+
+    while (result && !nodeStackEmpty(&stack)) {
+        NodeFrame frame = nodeStackPop(&stack);
+        PhoneForwardReverse *node = frame.first;
+        PhoneForwardReverse *parentCopy = frame.second;
+        PhoneForwardReverse *nodeCopy = (parentCopy->children)[frame.sign];
+
+        if (nodeCopy == NULL) {
+            nodeCopy = phfwdReverseNew(mem);
+            if (nodeCopy == NULL) {
+                result = false;
+                break;
+            }
+            atomic_init(&(nodeCopy->hits), atomic_load_explicit(&(node->hits), memory_order_relaxed) / 2);
+            (parentCopy->children)[frame.sign] = nodeCopy;
+
+            if (!copyDiversions(mem, node, prefixesCopy, nodeCopy)) {
+                result = false;
+                break;
+            }
         }
-        free(node);
+
+        result = pushReverseByHits(&stack, node, nodeCopy, hotOnly);
     }
-}
\ No newline at end of file
+
+    nodeStackFree(&stack);
+    return result;
+}
+
+bool copyTriesByHits(MemoryAccount *account, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                     PhoneForwardPrefixes **prefixesCopy, PhoneForwardReverse **reverseCopy) {
+    PhfwdMemory mem;
+    memInit(&mem, account);
+    *prefixesCopy = phfwdPrefixesNew(&mem);
+    *reverseCopy = NULL;
+
+    // Drzewo PhoneForwardPrefixes musi być skopiowane w całości, zanim zostaną do niego podpięte przekierowania.
+    bool result = *prefixesCopy != NULL &&
+                  copyPrefixesByHits(&mem, prefixes, *prefixesCopy, true) &&
+                  copyPrefixesByHits(&mem, prefixes, *prefixesCopy, false) &&
+                  (*reverseCopy = phfwdReverseNew(&mem)) != NULL &&
+                  copyDiversions(&mem, reverse, *prefixesCopy, *reverseCopy) &&
+                  copyReverseByHits(&mem, reverse, *prefixesCopy, *reverseCopy, true) &&
+                  copyReverseByHits(&mem, reverse, *prefixesCopy, *reverseCopy, false);
+
+    if (result) {
+        atomic_init(&((*prefixesCopy)->hits), atomic_load_explicit(&(prefixes->hits), memory_order_relaxed) / 2);
+        atomic_init(&((*reverseCopy)->hits), atomic_load_explicit(&(reverse->hits), memory_order_relaxed) / 2);
+    } else {
+        phfwdReverseRelease(memAllocator(&mem), *reverseCopy);
+        phfwdPrefixesRelease(memAllocator(&mem), *prefixesCopy);
+    }
+    return result;
+}
@@ -10,39 +10,93 @@
 #define PHONE_NUMBERS_TRIE_H
 
 #include "structures.h"
+#include "memory_context.h"
 #include "phone_forward.h"
 
 /**
- * Tworzy nową strukturę typu PhfwdPointers.
- * @param parentNode - węzeł drzewa Revers, zawierający przekierowanie prefiksu numeru.
- * @param prevInList - element poprzedzający w liście element z prefiksem numeru telefonu.
- * @return - wskaźnik na utworzoną strukturę lub NULL, jeśli alokacja pamięci się nie powiodła.
+ * @struct PhfwdAddition
+ * @brief PhfwdAddition przechowuje pamięć przygotowaną do dodania jednego przekierowania funkcją additionApply.
+ */
+struct PhfwdAddition {
+    char const *num1; ///< Prefiks numerów przekierowywanych.
+    char const *num2; ///< Prefiks numerów, na które jest wykonywane przekierowanie.
+    char *prefix; ///< Napis z prefiksem @p num1, który trafi do tablicy węzła @p num2.
+    char *diversion; ///< Napis z przekierowaniem @p num2 lub NULL, jeśli węzeł @p num2 już go ma.
+    Prefix *prefixes; ///< Nowa tablica dla węzła @p num2 lub NULL, jeśli jego tablicę można zmienić.
+    Prefix *spare; ///< Nowa tablica dla węzła poprzedniego przekierowania @p num1 lub NULL, jeśli nie jest potrzebna.
+    bool unchanged; ///< Czy @p num1 jest już przekierowany na @p num2.
+};
+typedef struct PhfwdAddition PhfwdAddition;
+
+/**
+ * @struct PhfwdRemovalRule
+ * @brief PhfwdRemovalRule jest przekierowaniem usuwanym razem z poddrzewem.
  */
-PhfwdPointers *PhfwdPointersNew(PhoneForwardReverse *parentNode, Prefix *prevInList);
+struct PhfwdRemovalRule {
+    char const *num; ///< Prefiks numerów przekierowywanych.
+    char const *diversion; ///< Przekierowanie prefiksu.
+};
+typedef struct PhfwdRemovalRule PhfwdRemovalRule;
 
 /**
- * Tworzy nową, pustą strukturę typu PhoneForwardPrefixes.
+ * @struct PhfwdRemoval
+ * @brief PhfwdRemoval przechowuje stan usuwania poddrzewa drzewa PhoneForwardPrefixes albo jednego
+ * przekierowania, przygotowany funkcją removalPrepare.
+ */
+struct PhfwdRemoval {
+    PhoneForwardPrefixes **slot; ///< Miejsce w węźle, z którego zostanie odłączone poddrzewo, lub NULL, jeśli nie
+    ///< ma czego odłączać.
+    PhoneForwardPrefixes *node; ///< Węzeł, z którego zostanie usunięte tylko przekierowanie, lub NULL.
+    PhfwdRemovalRule *rules; ///< Przekierowania z odłączanego poddrzewa.
+    size_t count; ///< Liczba przekierowań w tablicy rules.
+    size_t size; ///< Rozmiar tablicy rules.
+    PhfwdTeardown *teardown; ///< Stan usuwania poddrzewa lub NULL, jeśli poddrzewo trzeba będzie usunąć od razu.
+};
+typedef struct PhfwdRemoval PhfwdRemoval;
+
+/**
+ * Tworzy nową, pustą strukturę typu PhoneForwardPrefixes z licznikiem odwołań równym 1.
+ * @param mem - kontekst alokacji pamięci lub NULL.
  * @return - wskaźnik na utworzoną strukturę lub NULL, jeśli alokacja pamięci się nie powiodła.
  */
-PhoneForwardPrefixes *phfwdPrefixesNew();
+PhoneForwardPrefixes *phfwdPrefixesNew(PhfwdMemory *mem);
+
+/**
+ * Przygotowuje stan usuwania poddrzewa zaczynającego się od węzła @p root.
+ * @param t - wskaźnik na inicjalizowany stan.
+ * @param root - korzeń usuwanego poddrzewa, do którego zwolniono już ostatnie odwołanie.
+ */
+void teardownInit(PhfwdTeardown *t, PhoneForwardPrefixes *root);
 
 /**
- * Tworzy nową, pustą strukturę typu PhoneForwardReverse.
+ * Tworzy nową, pustą strukturę typu PhoneForwardReverse z licznikiem odwołań równym 1.
+ * @param mem - kontekst alokacji pamięci lub NULL.
  * @return - wskaźnik na utworzoną strukturę lub NULL, jeśli alokacja pamięci się nie powiodła.
  */
-PhoneForwardReverse *phfwdReverseNew();
+PhoneForwardReverse *phfwdReverseNew(PhfwdMemory *mem);
 
 /**
- * Usuwa drzewo PhoneForwardReverse.
+ * Zwalnia odwołanie do drzewa PhoneForwardReverse. Węzły, do których nie ma już odwołań, są usuwane.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param allocator - alokator, którym przydzielono drzewo, lub NULL.
  * @param rev - wskaźnik na korzeń drzewa.
  */
-void phfwdReverseDelete(PhoneForwardReverse *rev);
+void phfwdReverseRelease(PhfwdAllocator const *allocator, PhoneForwardReverse *rev);
 
 /**
- * Usuwa drzewo PhoneForwardPrefixes.
+ * Zwalnia odwołanie do drzewa PhoneForwardPrefixes tak jak phfwdReverseRelease.
+ * @param allocator - alokator, którym przydzielono drzewo, lub NULL.
  * @param pref - wskaźnik na korzeń drzewa.
  */
-void phfwdPrefixesDelete(PhoneForwardPrefixes *pref);
+void phfwdPrefixesRelease(PhfwdAllocator const *allocator, PhoneForwardPrefixes *pref);
+
+/**
+ * Sprawdza, czy napis jest numerem telefonu.
+ * @param string - wskaźnik na napis.
+ * @return true, jeśli napis jest numerem telefonu.
+ *         false, jeśli wskaźnik na napis ma wartość NULL lub napis nie jest numerem telefonu.
+ */
+bool isStringAPhoneNumber(char const *string);
 
 /**
  * @param c - znak będący cyfrą lub '#' lub '*'.
@@ -51,32 +105,207 @@ void phfwdPrefixesDelete(PhoneForwardPrefixes *pref);
 int charToNum(char c);
 
 /**
- * Dodaje przekierowanie w drzewie PhoneForwardReverse.
- * @param tree - korzeń drzewa PhoneForwardReverse.
- * @param num1 - prefiks numeru telefonu.
- * @param num2 - numer będący przekierowaniem prefiks numeru telefonu.
- * @return - element struktury PhfwdPointers, przechowujący wskaźniki na węzeł z przekierowaniem oraz
- *          element listy Prefix, poprzedzający element przechowujący prefiks numeru telefonu.
- *         - NULL, jeśli nie udało sie alokować pamięci.
+ * @param num - liczba od 0 do 11.
+ * @return - znak numeru telefonu, któremu odpowiada liczba @p num (odwrotność funkcji charToNum).
+ */
+char numToChar(int num);
+
+/**
+ * Porównuje numery telefonu leksykograficznie według wartości funkcji charToNum, tak że prefiks numeru jest
+ * mniejszy od numeru.
+ * @param a - pierwszy numer telefonu.
+ * @param b - drugi numer telefonu.
+ * @return - ujemna liczba, 0 lub dodatnia liczba, jeśli @p a jest odpowiednio mniejszy, równy lub większy od @p b.
+ */
+int numCompare(char const *a, char const *b);
+
+/**
+ * Ustawia znak numeru na pozycji odpowiadającej głębokości @p depth i skraca numer do tej długości. Służy do
+ * budowania prefiksu węzła podczas przeglądania drzewa w głąb.
+ * @param path - wskaźnik na tablicę z numerem, powiększaną funkcją realloc.
+ * @param size - wskaźnik na rozmiar tablicy.
+ * @param depth - długość numeru, co najmniej 1.
+ * @param sign - liczba odpowiadająca ostatniemu znakowi numeru.
+ * @return true - jeśli udało się ustawić znak.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool pathSet(char **path, size_t *size, size_t depth, int sign);
+
+/**
+ * Przygotowuje dodanie przekierowania prefiksu @p num1 na @p num2: rezerwuje w kontekście dokładnie tyle węzłów,
+ * ile trzeba skopiować i utworzyć, i tworzy potrzebne napisy i tablice. Nie zmienia drzew. Współdzielone węzły
+ * na ścieżkach są kopiowane dopiero przez additionApply.
+ * @param mem - kontekst alokacji drzew.
+ * @param prefixes - korzeń drzewa PhoneForwardPrefixes.
+ * @param reverse - korzeń drzewa PhoneForwardReverse.
+ * @param num1 - prefiks numerów przekierowywanych. Musi istnieć do wywołania additionApply.
+ * @param num2 - prefiks numerów, na które jest wykonywane przekierowanie. Musi istnieć do wywołania additionApply.
+ * @param addition - wskaźnik na przygotowywane dodanie.
+ * @return true - jeśli przekierowanie można dodać funkcją additionApply.
+ *         false - jeśli nie powiodła się alokacja pamięci lub zostałby przekroczony limit. Przygotowane napisy
+ *                 i tablice są wtedy zwalniane, a kontekst trzeba zwolnić funkcją memRelease.
+ */
+bool additionPrepare(PhfwdMemory *mem, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                     char const *num1, char const *num2, PhfwdAddition *addition);
+
+/**
+ * Dodaje przekierowanie przygotowane funkcją additionPrepare. Nie może się nie powieść. Między przygotowaniem
+ * a dodaniem drzewa nie mogą być zmieniane.
+ * @param mem - kontekst, w którym przygotowano dodanie.
+ * @param prefixes - wskaźnik na korzeń drzewa PhoneForwardPrefixes, który może zostać zastąpiony kopią.
+ * @param reverse - wskaźnik na korzeń drzewa PhoneForwardReverse, który może zostać zastąpiony kopią.
+ * @param addition - wskaźnik na przygotowane dodanie.
+ */
+void additionApply(PhfwdMemory *mem, PhoneForwardPrefixes **prefixes, PhoneForwardReverse **reverse,
+                   PhfwdAddition *addition);
+
+/**
+ * Zwalnia napisy i tablice przygotowane funkcją additionPrepare, które nie zostały użyte.
+ * @param allocator - alokator drzew lub NULL.
+ * @param addition - wskaźnik na przygotowane dodanie.
+ */
+void additionCancel(PhfwdAllocator const *allocator, PhfwdAddition *addition);
+
+/**
+ * Przygotowuje usunięcie przekierowań wszystkich prefiksów zaczynających się od @p num albo, jeśli @p subtree ma
+ * wartość false, tylko przekierowania prefiksu @p num: kopiuje współdzielone węzły na ścieżkach, które zostaną
+ * zmienione, i zbiera usuwane przekierowania. Odłączane jest poddrzewo prefiksu @p num razem z przodkami, którzy
+ * bez niego nie mieliby przekierowania ani innych dzieci; przy usuwaniu jednego przekierowania dzieje się tak
+ * tylko wtedy, gdy węzeł @p num nie ma dzieci. Jeśli przygotowanie się nie powiedzie, część węzłów może już być
+ * zastąpiona kopiami, co nie zmienia przekierowań.
+ * @param mem - kontekst alokacji drzew.
+ * @param prefixes - wskaźnik na korzeń drzewa PhoneForwardPrefixes.
+ * @param reverse - wskaźnik na korzeń drzewa PhoneForwardReverse.
+ * @param num - prefiks numeru telefonu.
+ * @param subtree - czy usuwane są przekierowania wszystkich prefiksów zaczynających się od @p num.
+ * @param removal - wskaźnik na przygotowywane usunięcie. Pola slot i node mają wartość NULL, jeśli nie ma czego
+ *                  usuwać.
+ * @return true - jeśli usunięcie można wykonać funkcją removalApply.
+ *         false - jeśli nie powiodła się alokacja pamięci. Wtedy usunięcie jest już zwolnione.
+ */
+bool removalPrepare(PhfwdMemory *mem, PhoneForwardPrefixes **prefixes, PhoneForwardReverse **reverse,
+                    char const *num, bool subtree, PhfwdRemoval *removal);
+
+/**
+ * Odłącza poddrzewo albo usuwa przekierowanie przygotowane funkcją removalPrepare i usuwa usunięte przekierowania
+ * z drzewa PhoneForwardReverse. Poddrzewo, do którego nie ma już odwołań, jest dopisywane do listy @p pending poddrzew
+ * oczekujących na usunięcie albo, jeśli zabrakło pamięci na stan usuwania, usuwane od razu. Nie może się nie
+ * powieść.
+ * @param mem - kontekst alokacji drzew.
+ * @param reverse - wskaźnik na korzeń drzewa PhoneForwardReverse.
+ * @param pending - wskaźnik na listę poddrzew oczekujących na usunięcie.
+ * @param removal - wskaźnik na przygotowane usunięcie.
+ */
+void removalApply(PhfwdMemory *mem, PhoneForwardReverse **reverse, PhfwdTeardown **pending, PhfwdRemoval *removal);
+
+/**
+ * Zwalnia usunięcie przygotowane funkcją removalPrepare, które nie zostanie wykonane.
+ * @param mem - kontekst alokacji drzew.
+ * @param removal - wskaźnik na przygotowane usunięcie.
+ */
+void removalCancel(PhfwdMemory *mem, PhfwdRemoval *removal);
+
+/**
+ * Kontynuuje usuwanie odłączonego poddrzewa, zwalniając co najwyżej @p budget węzłów. Węzły współdzielone
+ * z innymi wersjami drzewa tracą tylko jedno odwołanie.
+ * @param allocator - alokator, którym przydzielono drzewa, lub NULL.
+ * @param t - stan usuwania poddrzewa.
+ * @param budget - maksymalna liczba węzłów do usunięcia.
+ * @return - liczbę usuniętych węzłów. Poddrzewo jest całkowicie usunięte, gdy @p t->node ma wartość NULL.
+ */
+size_t teardownStep(PhfwdAllocator const *allocator, PhfwdTeardown *t, size_t budget);
+
+/**
+ * Znajduje najdłuższy możliwy prefiks, do którego istnieje przekierowanie, przechowywane w drzewie @p tree.
+ * @p *length przyjmuje wartość długości znalezionego prefiksu.
+ * @param tree  – wskaźnik na korzeń drzewa PhoneForwardPrefixes;
+ * @param num – wskaźnik na napis reprezentujący numer.
+ * @param length - wskaźnik na zmienną, która będzie przechowywać długość odnalezionego prefiksu.
+ * @return - wskaźnik na napis reprezentujący przekierowanie numeru.
+ *         - NULL, jeśli w drzewie @p tree nie ma żadnego pasującego prefiksu.
  */
-PhfwdPointers *addToReverse(PhoneForwardReverse *tree, char const *num1, char const *num2);
+const char *findOnePrefix(PhoneForwardPrefixes *tree, char const *num, size_t *length);
 
 /**
- * Dodaje przekierowanie w drzewie PhoneForwardPrefixes.
+ * Szuka węzła drzewa PhoneForwardPrefixes odpowiadającego pierwszym @p length znakom numeru @p num.
  * @param tree - korzeń drzewa PhoneForwardPrefixes.
- * @param num1 - prefiks numeru telefonu.
- * @param pointers - element struktury PhfwdPointers, przechowujący wskaźniki na węzeł z drzewa PhoneForwardReverse
- *                   z przekierowaniem oraz element listy Prefix, poprzedzający element przechowujący prefiks numeru telefonu.
- * @return true - jeśli udało się dodać przekierowanie.
+ * @param num - numer telefonu.
+ * @param length - długość szukanego prefiksu, nie większa niż długość @p num.
+ * @return - szukany węzeł lub NULL, jeśli go nie ma w drzewie.
+ */
+PhoneForwardPrefixes *findPrefixesNode(PhoneForwardPrefixes *tree, char const *num, size_t length);
+
+/**
+ * Szuka węzła drzewa PhoneForwardReverse odpowiadającego numerowi @p num.
+ * @param tree - korzeń drzewa PhoneForwardReverse.
+ * @param num - przekierowanie numeru telefonu.
+ * @return - węzeł odpowiadający @p num lub NULL, jeśli nie ma go w drzewie.
+ */
+PhoneForwardReverse *findReverseNode(PhoneForwardReverse *tree, char const *num);
+
+/**
+ * Zwalnia odwołania do obu drzew struktury przechowującej przekierowania i usuwa poddrzewa oczekujące na usunięcie.
+ * @param allocator - alokator, którym przydzielono drzewa, lub NULL.
+ * @param prefixes - korzeń drzewa PhoneForwardPrefixes.
+ * @param reverse - korzeń drzewa PhoneForwardReverse.
+ * @param pending - lista poddrzew oczekujących na usunięcie.
+ */
+void releaseTries(PhfwdAllocator const *allocator, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                  PhfwdTeardown *pending);
+
+/**
+ * Tworzy kopię obu drzew struktury przechowującej przekierowania, która nie współdzieli z nimi żadnej pamięci.
+ * @param account - konto, na które zostanie policzona kopia.
+ * @param prefixes - korzeń drzewa PhoneForwardPrefixes.
+ * @param reverse - korzeń drzewa PhoneForwardReverse.
+ * @param prefixesCopy - wskaźnik, pod którym zostanie zapisany korzeń kopii drzewa PhoneForwardPrefixes.
+ * @param reverseCopy - wskaźnik, pod którym zostanie zapisany korzeń kopii drzewa PhoneForwardReverse.
+ * @return true - jeśli udało się skopiować drzewa.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool copyTries(MemoryAccount *account, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+               PhoneForwardPrefixes **prefixesCopy, PhoneForwardReverse **reverseCopy);
+
+/**
+ * Podaje rozmiar bloku, w którym zmieści się kopia drzew wykonana funkcją copyTriesByHits.
+ * @param allocator - alokator pamięci pomocniczej.
+ * @param prefixes - korzeń drzewa PhoneForwardPrefixes.
+ * @param reverse - korzeń drzewa PhoneForwardReverse.
+ * @param size - wskaźnik, pod którym zostanie zapisany rozmiar.
+ * @return true - jeśli udało się obliczyć rozmiar.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+bool triesSlabSize(PhfwdAllocator const *allocator, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                   size_t *size);
+
+/**
+ * Kopiuje drzewa tak jak copyTries, ale przydziela węzły w kolejności przeszukiwania w głąb, w której dzieci są
+ * odwiedzane od najczęściej używanego, a najpierw kopiowane są węzły z trafieniami. Jeśli konto ma blok pamięci,
+ * często używane ścieżki leżą w nim obok siebie. Liczniki trafień kopii są równe połowie liczników oryginału.
+ * @param account - konto, na które zostanie przydzielona kopia.
+ * @param prefixes - korzeń kopiowanego drzewa PhoneForwardPrefixes.
+ * @param reverse - korzeń kopiowanego drzewa PhoneForwardReverse.
+ * @param prefixesCopy - wskaźnik, pod którym zostanie zapisany korzeń kopii drzewa PhoneForwardPrefixes.
+ * @param reverseCopy - wskaźnik, pod którym zostanie zapisany korzeń kopii drzewa PhoneForwardReverse.
+ * @return true - jeśli udało się skopiować drzewa.
  *         false - jeśli nie powiodła się alokacja pamięci.
  */
-bool addToPrefixes(PhoneForwardPrefixes *tree, char const *num1, PhfwdPointers *pointers);
+bool copyTriesByHits(MemoryAccount *account, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                     PhoneForwardPrefixes **prefixesCopy, PhoneForwardReverse **reverseCopy);
 
 /**
- * Usuwa poddrzewo drzewa PhoneForwardPrefixes zaczynające się od węzła @p tree.
- * Usuwa także odpowiednie przekierowania i prefiksy numerów telefonów z drzewa PhoneForwardReverse.
- * @param tree - korzeń poddrzewa.
+ * Kopiuje drzewa tak jak copyTries, ale identyczne poddrzewa kopii drzewa PhoneForwardPrefixes są jednym
+ * węzłem z licznikiem odwołań równym liczbie rodziców. Kopia drzewa PhoneForwardReverse nie jest tak
+ * zmniejszana, bo każdy prefiks jest w jednej tablicy, więc jej poddrzewa z tablicami są różne.
+ * @param account - konto, na które zostanie policzona kopia.
+ * @param prefixes - korzeń drzewa PhoneForwardPrefixes.
+ * @param reverse - korzeń drzewa PhoneForwardReverse.
+ * @param prefixesCopy - wskaźnik, pod którym zostanie zapisany korzeń kopii drzewa PhoneForwardPrefixes.
+ * @param reverseCopy - wskaźnik, pod którym zostanie zapisany korzeń kopii drzewa PhoneForwardReverse.
+ * @return true - jeśli udało się skopiować drzewa.
+ *         false - jeśli nie powiodła się alokacja pamięci.
  */
-void deleteSubtree(PhoneForwardPrefixes *tree);
+bool copyTriesShared(MemoryAccount *account, PhoneForwardPrefixes *prefixes, PhoneForwardReverse *reverse,
+                     PhoneForwardPrefixes **prefixesCopy, PhoneForwardReverse **reverseCopy);
 
 #endif //PHONE_NUMBERS_TRIE_H
@@ -0,0 +1,197 @@
+/** @file
+ * Testy interfejsu C++ z phone_forward.hpp: zgodność wyników z modelem dla
+ * wyników zwracanych jako @ref phfwd::Numbers i przekazywanych do różnych
+ * odbiorców, numery podane jako widoki bez znaku '\0', przenoszenie
+ * i kopiowanie struktur.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "phone_forward.hpp"
+#include "phone_forward_model.h"
+
+#define SEEDS 100      ///< Liczba przebiegów z różnymi ziarnami.
+#define OPERATIONS 100 ///< Liczba operacji w jednym przebiegu.
+
+namespace {
+
+/** @brief Sprawdza, czy numery są równe wynikowi modelu.
+ * @param nums - numery;
+ * @param expected - wynik modelu.
+ * @return - true, jeśli ciągi są równe.
+ */
+bool sameNumbers(std::vector<std::string> const &nums, ModelNumbers const &expected) {
+    if (nums.size() != expected.count)
+        return false;
+    for (size_t i = 0; i < expected.count; i++)
+        if (nums[i] != expected.nums[i])
+            return false;
+    return true;
+}
+
+/** @brief Sprawdza wszystkie rodzaje zapytań o numer, z wynikiem
+ * zwracanym i przekazywanym do odbiorców.
+ * @param forwards - struktura;
+ * @param model - model;
+ * @param num - numer.
+ */
+void checkQueries(phfwd::Forwards const &forwards, Model const &model, std::string_view num) {
+    std::string terminated(num);
+    char forwarded[2 * MODEL_MAX_LENGTH];
+    ModelNumbers expected;
+
+    modelGet(&model, terminated.c_str(), forwarded);
+    phfwd::Numbers result = forwards.get(num);
+    CHECK(result && result.size() == 1 && result[0] == forwarded && result[1].empty());
+
+    std::vector<std::string> nums;
+    CHECK(forwards.get(num, [&nums](std::string_view n) { nums.emplace_back(n); }));
+    CHECK(nums.size() == 1 && nums[0] == forwarded);
+
+    modelReverse(&model, terminated.c_str(), &expected);
+    CHECK(modelEqual(forwards.reverse(num).get(), &expected));
+    nums.clear();
+    CHECK(forwards.reverse(num, std::back_inserter(nums)));
+    CHECK(sameNumbers(nums, expected));
+
+    modelGetReverse(&model, terminated.c_str(), &expected);
+    CHECK(modelEqual(forwards.getReverse(num).get(), &expected));
+    nums.clear();
+    CHECK(forwards.getReverse(num, [&nums](std::string_view n) {
+        nums.emplace_back(n);
+        return true;
+    }));
+    CHECK(sameNumbers(nums, expected));
+}
+
+/** @brief Sprawdza zgodność struktury z modelem dla losowych operacji.
+ * Numery są podawane jako widoki na początek dłuższego napisu, więc nie są
+ * zakończone znakiem '\0'.
+ * @param seed - ziarno generatora.
+ */
+void testRandomOperations(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {};
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH], num[MODEL_MAX_LENGTH];
+    phfwd::Forwards forwards;
+    CHECK(forwards);
+
+    for (int i = 0; i < OPERATIONS; i++) {
+        modelRandomNumber(&state, num1, 4);
+        modelRandomNumber(&state, num2, 4);
+        std::string padded1 = std::string(num1) + "123";
+        std::string_view view1(padded1.data(), std::strlen(num1));
+        uint64_t choice = modelRandom(&state) % 10;
+
+        if (choice < 7) {
+            std::string padded2 = std::string(num2) + "#";
+            CHECK(forwards.add(view1, std::string_view(padded2.data(), std::strlen(num2))) ==
+                  modelAdd(&model, num1, num2));
+        }
+        else if (choice < 9) {
+            forwards.remove(view1);
+            modelRemove(&model, num1);
+        }
+        else {
+            forwards.removeOne(view1);
+            modelRemoveOne(&model, num1);
+        }
+
+        modelRandomNumber(&state, num, 6);
+        std::string padded = std::string(num) + "0";
+        checkQueries(forwards, model, std::string_view(padded.data(), std::strlen(num)));
+    }
+    CHECK(modelSameRules(forwards.get(), &model));
+}
+
+/** @brief Sprawdza odbiorcę @ref phfwd::BufferSink: wynik, który się nie
+ * mieści, przerywa zapytanie, a po wyczyszczeniu bufory można użyć ponownie.
+ */
+void testBufferSink() {
+    phfwd::Forwards forwards;
+    CHECK(forwards);
+    CHECK(forwards.add("1", "9") && forwards.add("2", "9") && forwards.add("3", "9"));
+
+    char chars[8];
+    std::string_view views[2];
+    phfwd::BufferSink sink(chars, sizeof(chars), views, 2);
+
+    // Wynik 14, 24, 34, 94 nie mieści się w dwóch widokach.
+    CHECK(!forwards.reverse("94", sink));
+    CHECK(sink.truncated() && sink.size() == 2 && views[0] == "14" && views[1] == "24");
+
+    sink.clear();
+    CHECK(forwards.get("1234", sink));
+    CHECK(!sink.truncated() && sink.size() == 1 && views[0] == "9234");
+
+    // Numer dłuższy niż bufor znaków nie jest zapisywany.
+    sink.clear();
+    CHECK(!forwards.get("123456789", sink));
+    CHECK(sink.truncated() && sink.size() == 0);
+}
+
+/** @brief Sprawdza numery, które nie mieszczą się w buforze na krótkie
+ * numery, oraz napisy z bajtem zerowym, które nie reprezentują numeru.
+ */
+void testUnusualNumbers() {
+    phfwd::Forwards forwards;
+    CHECK(forwards);
+
+    std::string longNum(200, '7');
+    CHECK(forwards.add(longNum, "8"));
+    phfwd::Numbers result = forwards.get(longNum + "12");
+    CHECK(result && result[0] == "812");
+    CHECK(forwards.reverse("8").size() == 2);
+
+    std::string withZero("12\0" "3", 4);
+    CHECK(!forwards.add(withZero, "5"));
+    CHECK(!forwards.add("5", withZero));
+    result = forwards.get(withZero);
+    CHECK(result && result.size() == 0);
+    CHECK(!forwards.add("", "5"));
+    CHECK(!forwards.add("5", "5"));
+}
+
+/** @brief Sprawdza przenoszenie obiektów i niezależność kopii.
+ */
+void testOwnership() {
+    phfwd::Forwards forwards;
+    CHECK(forwards && forwards.add("12", "34"));
+
+    phfwd::Forwards copy = forwards.clone();
+    CHECK(copy && copy.add("12", "56"));
+    CHECK(forwards.get("123")[0] == "343" && copy.get("123")[0] == "563");
+
+    phfwd::Forwards moved(std::move(forwards));
+    CHECK(!forwards && moved && moved.get("12")[0] == "34");
+    forwards = std::move(copy);
+    CHECK(!copy && forwards.get("12")[0] == "56");
+    moved = std::move(forwards);
+    CHECK(!forwards && moved.get("12")[0] == "56");
+
+    phfwd::Numbers numbers = moved.get("1");
+    phfwd::Numbers other(std::move(numbers));
+    CHECK(!numbers && other && other[0] == "1" && numbers.size() == 0);
+    CHECK(numbers[0].empty() && numbers.get() == nullptr);
+
+    phfwd::Forwards none(nullptr);
+    CHECK(!none && !none.add("1", "2") && !none.get("1") && !none.get("1", [](std::string_view) {}));
+}
+
+} // namespace
+
+int main() {
+    testBufferSink();
+    testUnusualNumbers();
+    testOwnership();
+    for (uint64_t seed = 1; seed <= SEEDS; seed++)
+        testRandomOperations(seed * 0x9E3779B97F4A7C15u);
+    return 0;
+}
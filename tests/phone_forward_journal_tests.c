@@ -0,0 +1,210 @@
+/** @file
+ * Testy dziennika operacji: odtwarzanie zapisanych operacji, naprawa pliku
+ * kończącego się niedokończonym wpisem i zgłaszanie błędów zapisu.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "phone_forward.h"
+#include "phone_forward_model.h"
+
+#define SEEDS 40       ///< Liczba przebiegów z różnymi ziarnami.
+#define OPERATIONS 200 ///< Liczba operacji w jednym przebiegu.
+
+/** @brief Tworzy pusty plik tymczasowy.
+ * @param path - bufor na ścieżkę, zainicjalizowany wzorcem dla mkstemp.
+ */
+static void temporaryFile(char *path) {
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+}
+
+/** @brief Podaje rozmiar pliku.
+ * @param path - ścieżka do pliku.
+ * @return - rozmiar w bajtach.
+ */
+static off_t fileSize(char const *path) {
+    struct stat st;
+    CHECK(stat(path, &st) == 0);
+    return st.st_size;
+}
+
+/** @brief Wykonuje losowe operacje na strukturze z dziennikiem.
+ * Operacje są wykonywane pojedynczo, w transakcjach i przez scalanie.
+ * @param pf - struktura;
+ * @param model - model;
+ * @param state - stan generatora;
+ * @param count - liczba operacji.
+ */
+static void journaledOperations(PhoneForward *pf, Model *model, uint64_t *state, int count) {
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH];
+
+    for (int i = 0; i < count; i++) {
+        uint64_t choice = modelRandom(state) % 10;
+        modelRandomNumber(state, num1, 4);
+        modelRandomNumber(state, num2, 4);
+
+        if (choice < 6) {
+            CHECK(phfwdAdd(pf, num1, num2) == modelAdd(model, num1, num2));
+        }
+        else if (choice < 7) {
+            phfwdRemove(pf, num1);
+            modelRemove(model, num1);
+        }
+        else if (choice < 8) {
+            phfwdRemoveOne(pf, num1);
+            modelRemoveOne(model, num1);
+        }
+        else if (choice < 9) {
+            PhfwdTransaction *tx = phfwdTransactionBegin(pf);
+            CHECK(tx != NULL);
+            CHECK(phfwdTransactionRemove(tx, num2));
+            CHECK(phfwdTransactionRemoveOne(tx, num1));
+            CHECK(phfwdTransactionAdd(tx, num2, num1) == (strcmp(num1, num2) != 0));
+            CHECK(phfwdTransactionCommit(tx));
+            modelRemove(model, num2);
+            modelRemoveOne(model, num1);
+            modelAdd(model, num2, num1);
+        }
+        else {
+            PhoneForward *src = phfwdNew();
+            CHECK(src != NULL);
+            if (phfwdAdd(src, num1, num2))
+                CHECK(phfwdAdd(src, num2, num1));
+            CHECK(phfwdMerge(pf, src, PHFWD_MERGE_SRC_WINS));
+            modelAdd(model, num1, num2);
+            modelAdd(model, num2, num1);
+            phfwdDelete(src);
+        }
+    }
+}
+
+/** @brief Sprawdza, że odtworzenie dziennika daje te same przekierowania.
+ * @param seed - ziarno generatora.
+ */
+static void testReplay(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char path[] = "/tmp/phfwd_journal_XXXXXX";
+    temporaryFile(path);
+
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdJournalOpen(pf, path, 1 + modelRandom(&state) % 16));
+    journaledOperations(pf, &model, &state, OPERATIONS);
+    CHECK(phfwdJournalClose(pf));
+    CHECK(modelSameRules(pf, &model));
+    phfwdDelete(pf);
+
+    PhoneForward *replayed = phfwdNew();
+    CHECK(replayed != NULL);
+    CHECK(phfwdJournalReplay(replayed, path));
+    CHECK(modelSameRules(replayed, &model));
+    phfwdDelete(replayed);
+    unlink(path);
+}
+
+/** @brief Sprawdza naprawę dziennika kończącego się niedokończonym wpisem.
+ * @param seed - ziarno generatora.
+ */
+static void testTornTail(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char path[] = "/tmp/phfwd_journal_XXXXXX";
+    temporaryFile(path);
+
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdJournalOpen(pf, path, 1));
+    journaledOperations(pf, &model, &state, OPERATIONS / 2);
+    off_t complete = fileSize(path);
+    CHECK(phfwdAdd(pf, "123456789012345", "987654321098765"));
+    CHECK(phfwdJournalClose(pf));
+    phfwdDelete(pf);
+
+    // Obcięcie ostatniego wpisu w dowolnym miejscu symuluje awarię w czasie zapisu.
+    off_t torn = complete + 1 + (off_t) (modelRandom(&state) % (uint64_t) (fileSize(path) - complete - 1));
+    CHECK(truncate(path, torn) == 0);
+
+    PhoneForward *replayed = phfwdNew();
+    CHECK(replayed != NULL);
+    CHECK(!phfwdJournalReplay(replayed, path));
+    CHECK(modelSameRules(replayed, &model));
+
+    // Otwarcie dziennika usuwa niedokończony wpis, więc nowe wpisy można potem odtworzyć.
+    CHECK(phfwdJournalOpen(replayed, path, 1));
+    CHECK(fileSize(path) == complete);
+    journaledOperations(replayed, &model, &state, OPERATIONS / 2);
+    CHECK(phfwdJournalClose(replayed));
+    phfwdDelete(replayed);
+
+    PhoneForward *again = phfwdNew();
+    CHECK(again != NULL);
+    CHECK(phfwdJournalReplay(again, path));
+    CHECK(modelSameRules(again, &model));
+    phfwdDelete(again);
+    unlink(path);
+}
+
+/** @brief Sprawdza, że błąd zapisu dziennika jest zgłaszany przez operacje
+ * modyfikujące, które wtedy nie zmieniają struktury.
+ */
+static void testWriteError(void) {
+    Model model = {.count = 0};
+    char path[] = "/tmp/phfwd_journal_XXXXXX";
+    temporaryFile(path);
+
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdJournalOpen(pf, path, 1));
+    CHECK(phfwdAdd(pf, "12", "34") && modelAdd(&model, "12", "34"));
+
+    // Ograniczenie rozmiaru pliku sprawia, że kolejny zapis kończy się błędem EFBIG.
+    struct rlimit old, limit;
+    CHECK(getrlimit(RLIMIT_FSIZE, &old) == 0);
+    limit = old;
+    limit.rlim_cur = (rlim_t) fileSize(path);
+    signal(SIGXFSZ, SIG_IGN);
+    CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+    CHECK(!phfwdAdd(pf, "5", "6"));
+    CHECK(modelSameRules(pf, &model));
+    CHECK(setrlimit(RLIMIT_FSIZE, &old) == 0);
+
+    // Po błędzie dziennik nie przyjmuje wpisów, więc struktura się nie zmienia.
+    CHECK(!phfwdAdd(pf, "5", "6"));
+    phfwdRemove(pf, "1");
+    PhfwdTransaction *tx = phfwdTransactionBegin(pf);
+    CHECK(tx != NULL && phfwdTransactionAdd(tx, "7", "8"));
+    CHECK(!phfwdTransactionCommit(tx));
+    CHECK(modelSameRules(pf, &model));
+    CHECK(!phfwdJournalSync(pf));
+    CHECK(!phfwdJournalClose(pf));
+
+    CHECK(phfwdAdd(pf, "5", "6") && modelAdd(&model, "5", "6"));
+    CHECK(modelSameRules(pf, &model));
+    phfwdDelete(pf);
+    unlink(path);
+}
+
+int main(void) {
+    testWriteError();
+    for (uint64_t seed = 1; seed <= SEEDS; seed++) {
+        testReplay(seed * 0x9E3779B97F4A7C15u);
+        testTornTail(seed * 0xBF58476D1CE4E5B9u);
+    }
+    return 0;
+}
@@ -0,0 +1,258 @@
+/** @file
+ * Testy limitu pamięci ustawianego przez @ref phfwdSetMemoryBudget
+ * i zachowania struktury, gdy alokator przestaje przydzielać pamięć.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phone_forward.h"
+#include "phone_forward_model.h"
+
+#define SEEDS 100      ///< Liczba przebiegów z różnymi ziarnami.
+#define OPERATIONS 150 ///< Liczba operacji w jednym przebiegu.
+
+/**
+ * To jest stan alokatora testowego.
+ */
+typedef struct TestAllocator {
+    size_t live;     ///< Liczba bajtów przydzielonych i jeszcze niezwolnionych.
+    size_t calls;    ///< Liczba udanych alokacji.
+    size_t failures; ///< Liczba odmówionych alokacji.
+    uint64_t state;  ///< Stan generatora decydującego o odmowie.
+    unsigned period; ///< Co ile alokacji średnio jest odmawiana jedna; 0 wyłącza odmowy.
+} TestAllocator;
+
+/** @brief Przydziela pamięć, czasem odmawiając.
+ * @param context - wskaźnik na @ref TestAllocator;
+ * @param size - rozmiar w bajtach.
+ * @return - wskaźnik na pamięć lub NULL.
+ */
+static void *testAlloc(void *context, size_t size) {
+    TestAllocator *allocator = (TestAllocator *) context;
+    if (allocator->period != 0 && modelRandom(&(allocator->state)) % allocator->period == 0) {
+        allocator->failures++;
+        return NULL;
+    }
+    void *ptr = malloc(size);
+    if (ptr != NULL) {
+        allocator->live += size;
+        allocator->calls++;
+    }
+    return ptr;
+}
+
+/** @brief Zwalnia pamięć przydzieloną funkcją @ref testAlloc.
+ * @param context - wskaźnik na @ref TestAllocator;
+ * @param ptr - wskaźnik na pamięć;
+ * @param size - rozmiar podany przy przydzieleniu.
+ */
+static void testFree(void *context, void *ptr, size_t size) {
+    TestAllocator *allocator = (TestAllocator *) context;
+    if (ptr == NULL)
+        return;
+    CHECK(allocator->live >= size);
+    allocator->live -= size;
+    free(ptr);
+}
+
+/** @brief Sprawdza, że nieudane dodania nie zmieniają zużycia pamięci.
+ */
+static void testBudgetFailureKeepsUsage(void) {
+    PhoneForward *pf = phfwdNew();
+    PhoneForward *probe = phfwdNew();
+    CHECK(pf != NULL && probe != NULL);
+    CHECK(phfwdAdd(pf, "123", "9") && phfwdAdd(probe, "123", "9"));
+    CHECK(phfwdAdd(pf, "45", "9") && phfwdAdd(probe, "45", "9"));
+
+    // Limit pozwala dodać dokładnie jedno krótkie przekierowanie na nowy węzeł drzewa przekierowań.
+    size_t usage = phfwdMemoryUsage(pf);
+    CHECK(phfwdAdd(probe, "7", "95"));
+    CHECK(phfwdSetMemoryBudget(pf, phfwdMemoryUsage(probe)));
+    phfwdDelete(probe);
+
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH];
+    for (int i = 0; i < 200; i++) {
+        snprintf(num1, sizeof(num1), "%d0000000000000%d", i % 10, i);
+        snprintf(num2, sizeof(num2), "9%d", i % 5);
+        CHECK(!phfwdAdd(pf, num1, num2));
+        CHECK(phfwdMemoryUsage(pf) == usage);
+    }
+
+    // Zmieścić się musi dokładnie to, co zmieściłoby się przed nieudanymi próbami.
+    CHECK(phfwdAdd(pf, "7", "95"));
+    PhoneNumbers *pnum = phfwdGet(pf, "71");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "951") == 0);
+    phnumDelete(pnum);
+    pnum = phfwdReverse(pf, "951");
+    CHECK(pnum != NULL && phnumGet(pnum, 3) != NULL && phnumGet(pnum, 4) == NULL);
+    phnumDelete(pnum);
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza, że po usunięciu przekierowań i dokończeniu usuwania
+ * odłączonych poddrzew zużycie pamięci wraca do wartości początkowej.
+ */
+static void testRemoveRestoresUsage(void) {
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdAdd(pf, "1", "2"));
+    size_t baseline = phfwdMemoryUsage(pf);
+
+    CHECK(phfwdAdd(pf, "3456", "789") && phfwdAdd(pf, "34", "78") && phfwdAdd(pf, "5", "789"));
+    phfwdRemove(pf, "3");
+    phfwdRemove(pf, "5");
+    CHECK(phfwdReclaim(pf, SIZE_MAX));
+    CHECK(phfwdMemoryUsage(pf) == baseline);
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza, że zmiana kopii utworzonej przez @ref phfwdClone kopiuje
+ * tylko zmienianą ścieżkę, a obie struktury widzą swoje przekierowania.
+ */
+static void testCloneCopiesPath(void) {
+    TestAllocator state = {.live = 0, .calls = 0, .failures = 0, .state = 1, .period = 0};
+    PhfwdAllocator allocator = {testAlloc, testFree, &state};
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH];
+
+    PhoneForward *pf = phfwdNewWithAllocator(&allocator);
+    CHECK(pf != NULL);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(num1, sizeof(num1), "%d", 100000 + i);
+        snprintf(num2, sizeof(num2), "%d", 900000 + i % 50);
+        CHECK(phfwdAdd(pf, num1, num2));
+    }
+
+    size_t usage = phfwdMemoryUsage(pf);
+    PhoneForward *clone = phfwdClone(pf);
+    CHECK(clone != NULL && phfwdMemoryUsage(clone) == usage);
+    CHECK(phfwdAdd(clone, "100057", "5") && phfwdAdd(clone, "2", "900001"));
+    phfwdRemove(clone, "10000");
+
+    // Kopie mają wspólne konto, a skopiowane ścieżki są małą częścią drzew.
+    CHECK(phfwdMemoryUsage(pf) < usage + usage / 10);
+
+    PhoneNumbers *pnum = phfwdGet(pf, "100007");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "900007") == 0);
+    phnumDelete(pnum);
+    pnum = phfwdGet(clone, "100007");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "100007") == 0);
+    phnumDelete(pnum);
+    pnum = phfwdGet(clone, "1000571");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "51") == 0);
+    phnumDelete(pnum);
+    pnum = phfwdReverse(pf, "900001");
+    CHECK(pnum != NULL && phnumGet(pnum, 20) != NULL && phnumGet(pnum, 21) == NULL);
+    phnumDelete(pnum);
+    pnum = phfwdReverse(clone, "900001");
+    CHECK(pnum != NULL && phnumGet(pnum, 20) != NULL && phnumGet(pnum, 21) == NULL);
+    phnumDelete(pnum);
+
+    phfwdDelete(pf);
+    pnum = phfwdGet(clone, "100107");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "900007") == 0);
+    phnumDelete(pnum);
+    phfwdDelete(clone);
+    CHECK(state.live == 0);
+}
+
+/** @brief Sprawdza, że struktura jest poprawna i nie traci pamięci, gdy
+ * alokator losowo odmawia przydzielenia pamięci.
+ * @param seed - ziarno generatora.
+ */
+static void testAllocationFailures(uint64_t seed) {
+    TestAllocator state = {.live = 0, .calls = 0, .failures = 0, .state = seed, .period = 0};
+    PhfwdAllocator allocator = {testAlloc, testFree, &state};
+    Model model = {.count = 0};
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH];
+
+    PhoneForward *pf = phfwdNewWithAllocator(&allocator);
+    CHECK(pf != NULL);
+    state.period = 8;
+
+    for (int i = 0; i < OPERATIONS; i++) {
+        modelRandomNumber(&state.state, num1, 4);
+        if (modelRandom(&state.state) % 5 == 0) {
+            PhoneForward *clone = phfwdClone(pf);
+            phfwdRemove(pf, num1);
+            // Nieudane usunięcie ze współdzielonej struktury nic nie zmienia, a udane usuwa wszystko.
+            state.period = 0;
+            PhfwdIterator *it = phfwdIteratorNew(pf, num1);
+            char const *rest1, *rest2;
+            CHECK(it != NULL);
+            if (!phfwdIteratorNext(it, &rest1, &rest2))
+                modelRemove(&model, num1);
+            phfwdIteratorDelete(it);
+            phfwdDelete(clone);
+            state.period = 8;
+        }
+        else {
+            modelRandomNumber(&state.state, num2, 4);
+            if (phfwdAdd(pf, num1, num2))
+                modelAdd(&model, num1, num2);
+        }
+        // Nieudane łączenie poddrzew zostawia strukturę bez zmian.
+        if (i % 50 == 49)
+            phfwdDeduplicate(pf);
+    }
+
+    state.period = 0;
+    CHECK(state.failures > 0);
+    CHECK(modelSameRules(pf, &model));
+    for (int i = 0; i < 20; i++) {
+        ModelNumbers expected;
+        modelRandomNumber(&state.state, num1, 5);
+        modelReverse(&model, num1, &expected);
+        PhoneNumbers *pnum = phfwdReverse(pf, num1);
+        CHECK(modelEqual(pnum, &expected));
+        phnumDelete(pnum);
+    }
+    phfwdDelete(pf);
+    CHECK(state.live == 0);
+}
+
+/** @brief Sprawdza, że węzły są przydzielane blokami i używane ponownie
+ * po usunięciu przekierowań.
+ */
+static void testNodesComeFromPool(void) {
+    TestAllocator state = {.live = 0, .calls = 0, .failures = 0, .state = 1, .period = 0};
+    PhfwdAllocator allocator = {testAlloc, testFree, &state};
+    PhoneForward *pf = phfwdNewWithAllocator(&allocator);
+    CHECK(pf != NULL);
+
+    // Czterdzieści nowych węzłów ścieżki wymaga jednego bloku, a nie osobnej alokacji każdego węzła.
+    char const *deep = "1234567890123456789012345678901234567890";
+    size_t calls = state.calls;
+    CHECK(phfwdAdd(pf, deep, "9"));
+    CHECK(state.calls - calls <= 5);
+
+    phfwdRemove(pf, "1");
+    CHECK(phfwdReclaim(pf, SIZE_MAX));
+    size_t live = state.live;
+    calls = state.calls;
+    CHECK(phfwdAdd(pf, deep, "9"));
+    CHECK(state.calls - calls <= 3);
+    phfwdRemove(pf, "1");
+    CHECK(phfwdReclaim(pf, SIZE_MAX));
+    CHECK(state.live == live);
+
+    phfwdDelete(pf);
+    CHECK(state.live == 0);
+}
+
+int main(void) {
+    testBudgetFailureKeepsUsage();
+    testRemoveRestoresUsage();
+    testCloneCopiesPath();
+    testNodesComeFromPool();
+    for (uint64_t seed = 1; seed <= SEEDS; seed++) {
+        testAllocationFailures(seed * 0xBF58476D1CE4E5B9u);
+    }
+    return 0;
+}
@@ -0,0 +1,292 @@
+/** @file
+ * Wzorcowa implementacja przekierowań dla testów. Przekierowania są
+ * przechowywane w zwykłej tablicy, a wyniki zapytań są wyznaczane wprost
+ * z definicji, więc można z nimi porównywać wyniki @ref PhoneForward.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_FORWARD_MODEL_H
+#define PHONE_FORWARD_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phone_forward.h"
+
+#define MODEL_MAX_RULES 256   ///< Największa liczba przekierowań w modelu.
+#define MODEL_MAX_LENGTH 32   ///< Największa długość numeru w modelu.
+#define MODEL_MAX_RESULTS 512 ///< Największa liczba numerów w wyniku zapytania.
+
+/**
+ * Przerywa test z komunikatem, jeśli warunek nie jest spełniony.
+ */
+#define CHECK(condition)                                                                      \
+    do {                                                                                      \
+        if (!(condition)) {                                                                   \
+            fprintf(stderr, "%s:%d: nie jest spełnione: %s\n", __FILE__, __LINE__, #condition); \
+            abort();                                                                          \
+        }                                                                                     \
+    } while (0)
+
+/**
+ * To jest przekierowanie w modelu.
+ */
+typedef struct ModelRule {
+    char num1[MODEL_MAX_LENGTH]; ///< Prefiks numerów przekierowywanych.
+    char num2[MODEL_MAX_LENGTH]; ///< Prefiks numerów, na które przekierowujemy.
+} ModelRule;
+
+/**
+ * To jest model struktury przechowującej przekierowania.
+ */
+typedef struct Model {
+    ModelRule rules[MODEL_MAX_RULES]; ///< Przekierowania.
+    size_t count;                     ///< Liczba przekierowań.
+} Model;
+
+/**
+ * To jest ciąg numerów wyznaczony przez model.
+ */
+typedef struct ModelNumbers {
+    char nums[MODEL_MAX_RESULTS][2 * MODEL_MAX_LENGTH]; ///< Numery.
+    size_t count;                                       ///< Liczba numerów.
+} ModelNumbers;
+
+/** @brief Losuje liczbę.
+ * @param state - stan generatora (xorshift64).
+ * @return - kolejna liczba pseudolosowa.
+ */
+static inline uint64_t modelRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/** @brief Losuje numer.
+ * Numery są krótkie i składają się z kilku znaków, żeby przekierowania często
+ * miały wspólne prefiksy.
+ * @param state - stan generatora;
+ * @param num - bufor na numer;
+ * @param maxLength - największa długość numeru.
+ */
+static inline void modelRandomNumber(uint64_t *state, char *num, size_t maxLength) {
+    static char const signs[] = "012#";
+    size_t length = 1 + modelRandom(state) % maxLength;
+    for (size_t i = 0; i < length; i++)
+        num[i] = signs[modelRandom(state) % (sizeof(signs) - 1)];
+    num[length] = '\0';
+}
+
+/** @brief Porządek znaków numeru: cyfry, '*', '#'.
+ * @param c - znak numeru.
+ * @return - pozycja znaku w porządku.
+ */
+static inline int modelRank(char c) {
+    return (c == '*') ? 10 : (c == '#') ? 11 : c - '0';
+}
+
+/** @brief Porównuje numery leksykograficznie.
+ * @param a - wskaźnik na pierwszy numer;
+ * @param b - wskaźnik na drugi numer.
+ * @return - wynik porównania jak w funkcji strcmp.
+ */
+static inline int modelCompare(void const *a, void const *b) {
+    char const *x = (char const *) a;
+    char const *y = (char const *) b;
+    while (*x != '\0' && *x == *y) {
+        x++;
+        y++;
+    }
+    if (*x == '\0' || *y == '\0')
+        return (*x != '\0') - (*y != '\0');
+    return modelRank(*x) - modelRank(*y);
+}
+
+/** @brief Sprawdza, czy napis jest prefiksem numeru.
+ * @param prefix - prefiks;
+ * @param num - numer.
+ * @return - true, jeśli @p prefix jest prefiksem @p num.
+ */
+static inline bool modelIsPrefix(char const *prefix, char const *num) {
+    return strncmp(prefix, num, strlen(prefix)) == 0;
+}
+
+/** @brief Dodaje przekierowanie do modelu.
+ * @param model - model;
+ * @param num1 - prefiks numerów przekierowywanych;
+ * @param num2 - prefiks numerów, na które przekierowujemy.
+ * @return - true, jeśli przekierowanie jest poprawne i zostało dodane.
+ */
+static inline bool modelAdd(Model *model, char const *num1, char const *num2) {
+    if (strcmp(num1, num2) == 0)
+        return false;
+    for (size_t i = 0; i < model->count; i++) {
+        if (strcmp(model->rules[i].num1, num1) == 0) {
+            strcpy(model->rules[i].num2, num2);
+            return true;
+        }
+    }
+    CHECK(model->count < MODEL_MAX_RULES);
+    strcpy(model->rules[model->count].num1, num1);
+    strcpy(model->rules[model->count].num2, num2);
+    model->count++;
+    return true;
+}
+
+/** @brief Usuwa z modelu przekierowania prefiksów zaczynających się od @p num.
+ * @param model - model;
+ * @param num - prefiks.
+ */
+static inline void modelRemove(Model *model, char const *num) {
+    size_t kept = 0;
+    for (size_t i = 0; i < model->count; i++)
+        if (!modelIsPrefix(num, model->rules[i].num1))
+            model->rules[kept++] = model->rules[i];
+    model->count = kept;
+}
+
+/** @brief Usuwa z modelu przekierowanie prefiksu @p num.
+ * @param model - model;
+ * @param num - prefiks.
+ */
+static inline void modelRemoveOne(Model *model, char const *num) {
+    size_t kept = 0;
+    for (size_t i = 0; i < model->count; i++)
+        if (strcmp(num, model->rules[i].num1) != 0)
+            model->rules[kept++] = model->rules[i];
+    model->count = kept;
+}
+
+/** @brief Wyznacza przekierowanie numeru.
+ * @param model - model;
+ * @param num - numer;
+ * @param result - bufor na wynik.
+ */
+static inline void modelGet(Model const *model, char const *num, char *result) {
+    ModelRule const *best = NULL;
+    for (size_t i = 0; i < model->count; i++)
+        if (modelIsPrefix(model->rules[i].num1, num) &&
+            (best == NULL || strlen(best->num1) < strlen(model->rules[i].num1)))
+            best = &(model->rules[i]);
+    if (best == NULL) {
+        strcpy(result, num);
+        return;
+    }
+    strcpy(result, best->num2);
+    strcat(result, num + strlen(best->num1));
+}
+
+/** @brief Sortuje numery i usuwa powtórzenia.
+ * @param numbers - ciąg numerów.
+ */
+static inline void modelSort(ModelNumbers *numbers) {
+    qsort(numbers->nums, numbers->count, sizeof(numbers->nums[0]), modelCompare);
+    size_t kept = 0;
+    for (size_t i = 0; i < numbers->count; i++)
+        if (kept == 0 || strcmp(numbers->nums[kept - 1], numbers->nums[i]) != 0)
+            memmove(numbers->nums[kept++], numbers->nums[i], sizeof(numbers->nums[0]));
+    numbers->count = kept;
+}
+
+/** @brief Wyznacza wynik @ref phfwdReverse.
+ * @param model - model;
+ * @param num - numer;
+ * @param result - wynik.
+ */
+static inline void modelReverse(Model const *model, char const *num, ModelNumbers *result) {
+    result->count = 0;
+    strcpy(result->nums[result->count++], num);
+    for (size_t i = 0; i < model->count; i++) {
+        if (modelIsPrefix(model->rules[i].num2, num)) {
+            CHECK(result->count < MODEL_MAX_RESULTS);
+            strcpy(result->nums[result->count], model->rules[i].num1);
+            strcat(result->nums[result->count++], num + strlen(model->rules[i].num2));
+        }
+    }
+    modelSort(result);
+}
+
+/** @brief Wyznacza wynik @ref phfwdGetReverse.
+ * Wynik zawiera numery z wyniku @ref phfwdReverse, które są przekierowywane
+ * na @p num; sam numer @p num tylko wtedy, gdy nie jest przekierowywany.
+ * @param model - model;
+ * @param num - numer;
+ * @param result - wynik.
+ */
+static inline void modelGetReverse(Model const *model, char const *num, ModelNumbers *result) {
+    ModelNumbers candidates;
+    char forwarded[2 * MODEL_MAX_LENGTH];
+    modelReverse(model, num, &candidates);
+    result->count = 0;
+    for (size_t i = 0; i < candidates.count; i++) {
+        modelGet(model, candidates.nums[i], forwarded);
+        if (strcmp(forwarded, num) == 0)
+            strcpy(result->nums[result->count++], candidates.nums[i]);
+    }
+}
+
+/** @brief Sprawdza, czy wynik zapytania jest równy wynikowi modelu.
+ * @param pnum - wynik zapytania;
+ * @param expected - wynik modelu.
+ * @return - true, jeśli ciągi są równe.
+ */
+static inline bool modelEqual(PhoneNumbers const *pnum, ModelNumbers const *expected) {
+    if (pnum == NULL)
+        return false;
+    for (size_t i = 0; i < expected->count; i++) {
+        char const *num = phnumGet(pnum, i);
+        if (num == NULL || strcmp(num, expected->nums[i]) != 0)
+            return false;
+    }
+    return phnumGet(pnum, expected->count) == NULL;
+}
+
+/** @brief Sprawdza, czy struktura ma dokładnie przekierowania z modelu.
+ * Przekierowania są odczytywane iteratorem, więc sprawdzana jest też ich
+ * kolejność.
+ * @param pf - struktura;
+ * @param model - model.
+ * @return - true, jeśli przekierowania są takie same.
+ */
+static inline bool modelSameRules(PhoneForward const *pf, Model const *model) {
+    Model sorted = *model;
+    qsort(sorted.rules, sorted.count, sizeof(ModelRule), modelCompare);
+    PhfwdIterator *it = phfwdIteratorNew(pf, NULL);
+    CHECK(it != NULL);
+    char const *num1, *num2;
+    size_t i = 0;
+    bool same = true;
+    while (same && phfwdIteratorNext(it, &num1, &num2)) {
+        same = i < sorted.count && strcmp(num1, sorted.rules[i].num1) == 0 && strcmp(num2, sorted.rules[i].num2) == 0;
+        i++;
+    }
+    same = same && !phfwdIteratorFailed(it) && i == sorted.count;
+    phfwdIteratorDelete(it);
+    return same;
+}
+
+/** @brief Odczytuje przekierowania struktury do modelu.
+ * @param pf - struktura;
+ * @param model - model, który zostanie wypełniony.
+ */
+static inline void modelLoad(PhoneForward const *pf, Model *model) {
+    PhfwdIterator *it = phfwdIteratorNew(pf, NULL);
+    CHECK(it != NULL);
+    char const *num1, *num2;
+    model->count = 0;
+    while (phfwdIteratorNext(it, &num1, &num2))
+        CHECK(modelAdd(model, num1, num2));
+    CHECK(!phfwdIteratorFailed(it));
+    phfwdIteratorDelete(it);
+}
+
+#endif /* PHONE_FORWARD_MODEL_H */
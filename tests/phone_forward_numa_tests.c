@@ -0,0 +1,219 @@
+/** @file
+ * Testy kopii przekierowań dla węzłów NUMA: zgodność zapytań z modelem
+ * w kopii każdego węzła, zmiany wykonywane przez wiele wątków naraz
+ * i zapytania w trakcie zmian.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phone_forward.h"
+#include "phone_forward_model.h"
+#include "phone_forward_numa.h"
+
+#define SEEDS 30       ///< Liczba przebiegów z różnymi ziarnami.
+#define OPERATIONS 100 ///< Liczba operacji w jednym przebiegu.
+#define WRITERS 4      ///< Liczba wątków zmieniających kopie naraz.
+#define WRITES 40      ///< Liczba przekierowań dodawanych przez jeden wątek.
+
+/** @brief Sprawdza zapytania o kopię węzła wywołującego wątku.
+ * @param replicas - kopie;
+ * @param model - model;
+ * @param num - numer.
+ */
+static void checkQueries(PhfwdReplicas *replicas, Model const *model, char const *num) {
+    char forwarded[2 * MODEL_MAX_LENGTH];
+    ModelNumbers expected;
+
+    modelGet(model, num, forwarded);
+    PhoneNumbers *pnum = phfwdReplicasGet(replicas, num);
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), forwarded) == 0 && phnumGet(pnum, 1) == NULL);
+    phnumDelete(pnum);
+
+    modelReverse(model, num, &expected);
+    pnum = phfwdReplicasReverse(replicas, num);
+    CHECK(modelEqual(pnum, &expected));
+    phnumDelete(pnum);
+}
+
+/** @brief Sprawdza przekierowania wszystkich przekierowywanych prefiksów
+ * w kopii węzła każdego procesora, na którym może działać test.
+ * @param replicas - kopie;
+ * @param model - model.
+ */
+static void checkEveryNode(PhfwdReplicas *replicas, Model const *model) {
+    cpu_set_t allowed, one;
+    CHECK(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        CHECK(sched_setaffinity(0, sizeof(one), &one) == 0);
+
+        for (size_t i = 0; i < model->count; i++) {
+            checkQueries(replicas, model, model->rules[i].num1);
+            checkQueries(replicas, model, model->rules[i].num2);
+        }
+    }
+    CHECK(sched_setaffinity(0, sizeof(allowed), &allowed) == 0);
+}
+
+/** @brief Sprawdza kopie utworzone ze struktury z losowymi przekierowaniami
+ * i zmieniane losowymi operacjami.
+ * @param seed - ziarno generatora;
+ * @param nodes - liczba symulowanych węzłów.
+ */
+static void testMatchesModel(uint64_t seed, size_t nodes) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH];
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+
+    for (int i = 0; i < OPERATIONS / 2; i++) {
+        modelRandomNumber(&state, num1, 4);
+        modelRandomNumber(&state, num2, 4);
+        CHECK(phfwdAdd(pf, num1, num2) == modelAdd(&model, num1, num2));
+    }
+
+    // Kopie nie zależą od struktury, z której powstały.
+    PhfwdReplicas *replicas = phfwdReplicasNew(pf, nodes);
+    CHECK(replicas != NULL && phfwdReplicasCount(replicas) == nodes);
+    phfwdDelete(pf);
+    checkEveryNode(replicas, &model);
+
+    for (int i = 0; i < OPERATIONS; i++) {
+        modelRandomNumber(&state, num1, 4);
+        modelRandomNumber(&state, num2, 4);
+
+        if (modelRandom(&state) % 4 == 0) {
+            CHECK(phfwdReplicasRemove(replicas, num1));
+            modelRemove(&model, num1);
+        }
+        else if (model.count < MODEL_MAX_RULES) {
+            CHECK(phfwdReplicasAdd(replicas, num1, num2) == modelAdd(&model, num1, num2));
+        }
+        modelRandomNumber(&state, num1, 6);
+        checkQueries(replicas, &model, num1);
+    }
+
+    CHECK(!phfwdReplicasAdd(replicas, "12a", "3"));
+    CHECK(!phfwdReplicasAdd(replicas, "12", NULL));
+    CHECK(!phfwdReplicasRemove(replicas, ""));
+    checkEveryNode(replicas, &model);
+    phfwdReplicasDelete(replicas);
+}
+
+/**
+ * To jest stan wątku zmieniającego kopie.
+ */
+typedef struct Writer {
+    PhfwdReplicas *replicas; ///< Kopie.
+    int id;                  ///< Numer wątku, od którego zaczynają się jego prefiksy.
+} Writer;
+
+/** @brief Dodaje przekierowania prefiksów zaczynających się numerem wątku.
+ * @param arg - wskaźnik na @ref Writer.
+ * @return - NULL.
+ */
+static void *writeRules(void *arg) {
+    Writer *writer = (Writer *) arg;
+    char num1[MODEL_MAX_LENGTH];
+
+    for (int i = 0; i < WRITES; i++) {
+        snprintf(num1, sizeof(num1), "%d%d", writer->id, i);
+        CHECK(phfwdReplicasAdd(writer->replicas, num1, "9"));
+    }
+    return NULL;
+}
+
+/**
+ * To jest stan wątku wykonującego zapytania w trakcie zmian.
+ */
+typedef struct Reader {
+    PhfwdReplicas *replicas; ///< Kopie.
+    atomic_bool stop;        ///< Czy wątek ma zakończyć zapytania.
+} Reader;
+
+/** @brief Wykonuje zapytania, których wynik nie zależy od zmian.
+ * @param arg - wskaźnik na @ref Reader.
+ * @return - NULL.
+ */
+static void *readRules(void *arg) {
+    Reader *reader = (Reader *) arg;
+
+    while (!atomic_load(&(reader->stop))) {
+        PhoneNumbers *pnum = phfwdReplicasGet(reader->replicas, "77");
+        CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "87") == 0);
+        phnumDelete(pnum);
+    }
+    return NULL;
+}
+
+/** @brief Sprawdza, że przekierowania dodawane przez wiele wątków naraz
+ * trafiają do wszystkich kopii, a zapytania w tym czasie dają poprawne
+ * wyniki.
+ * @param nodes - liczba symulowanych węzłów.
+ */
+static void testConcurrentWriters(size_t nodes) {
+    Model model = {.count = 0};
+    char num1[MODEL_MAX_LENGTH];
+    PhfwdReplicas *replicas = phfwdReplicasNew(NULL, nodes);
+    CHECK(replicas != NULL);
+    CHECK(phfwdReplicasAdd(replicas, "7", "8") && modelAdd(&model, "7", "8"));
+
+    Reader reader = {.replicas = replicas};
+    atomic_init(&(reader.stop), false);
+    pthread_t readerThread, writerThreads[WRITERS];
+    Writer writers[WRITERS];
+    CHECK(pthread_create(&readerThread, NULL, readRules, &reader) == 0);
+
+    for (int w = 0; w < WRITERS; w++) {
+        writers[w] = (Writer) {.replicas = replicas, .id = w};
+        CHECK(pthread_create(&writerThreads[w], NULL, writeRules, &writers[w]) == 0);
+    }
+    for (int w = 0; w < WRITERS; w++)
+        CHECK(pthread_join(writerThreads[w], NULL) == 0);
+    atomic_store(&(reader.stop), true);
+    CHECK(pthread_join(readerThread, NULL) == 0);
+
+    for (int w = 0; w < WRITERS; w++) {
+        for (int i = 0; i < WRITES; i++) {
+            snprintf(num1, sizeof(num1), "%d%d", w, i);
+            CHECK(modelAdd(&model, num1, "9"));
+        }
+    }
+    checkEveryNode(replicas, &model);
+    phfwdReplicasDelete(replicas);
+}
+
+int main(void) {
+    CHECK(phfwdReplicasCount(NULL) == 0);
+    CHECK(phfwdReplicasGet(NULL, "1") == NULL);
+    CHECK(phfwdReplicasReverse(NULL, "1") == NULL);
+    CHECK(!phfwdReplicasAdd(NULL, "1", "2"));
+    CHECK(!phfwdReplicasRemove(NULL, "1"));
+    phfwdReplicasDelete(NULL);
+
+    // Rzeczywista topologia ma co najmniej jeden węzeł.
+    PhfwdReplicas *replicas = phfwdReplicasNew(NULL, 0);
+    CHECK(replicas != NULL && phfwdReplicasCount(replicas) >= 1);
+    phfwdReplicasDelete(replicas);
+
+    for (uint64_t seed = 1; seed <= SEEDS; seed++)
+        testMatchesModel(seed * 0x9E3779B97F4A7C15u, 1 + seed % 3);
+    testConcurrentWriters(2);
+    testConcurrentWriters(3);
+    return 0;
+}
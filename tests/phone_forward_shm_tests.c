@@ -0,0 +1,188 @@
+/** @file
+ * Testy udostępniania przekierowań przez pamięć dzieloną: zgodność zapytań
+ * o segment z modelem, publikowanie kolejnych wersji i zapytania innego
+ * procesu w trakcie publikacji.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "phone_forward.h"
+#include "phone_forward_model.h"
+#include "phone_forward_shm.h"
+
+#define SEEDS 20        ///< Liczba przebiegów z różnymi ziarnami.
+#define RULES 100       ///< Liczba przekierowań w jednej wersji.
+#define QUERIES 50      ///< Liczba zapytań o jedną wersję.
+#define SLOT_SIZE 65536 ///< Rozmiar miejsca na tablicę w segmencie.
+#define PUBLISHES 400   ///< Liczba publikacji w teście z drugim procesem.
+
+/** @brief Tworzy nazwę segmentu niepowtarzalną dla procesu.
+ * @param name - bufor na nazwę.
+ * @param size - rozmiar bufora.
+ */
+static void segmentName(char *name, size_t size) {
+    snprintf(name, size, "/phfwd_shm_test_%ld", (long) getpid());
+}
+
+/** @brief Wypełnia strukturę i model losowymi przekierowaniami.
+ * @param pf - struktura;
+ * @param model - model;
+ * @param state - stan generatora.
+ */
+static void randomRules(PhoneForward *pf, Model *model, uint64_t *state) {
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH];
+
+    for (int i = 0; i < RULES; i++) {
+        modelRandomNumber(state, num1, 4);
+        modelRandomNumber(state, num2, 4);
+        CHECK(phfwdAdd(pf, num1, num2) == modelAdd(model, num1, num2));
+    }
+}
+
+/** @brief Sprawdza zapytania o segment.
+ * @param shm - segment;
+ * @param model - model ostatnio opublikowanej wersji;
+ * @param num - numer.
+ */
+static void checkQueries(PhfwdShm const *shm, Model const *model, char const *num) {
+    char forwarded[2 * MODEL_MAX_LENGTH];
+    ModelNumbers expected;
+
+    modelGet(model, num, forwarded);
+    PhoneNumbers *pnum = phfwdShmGet(shm, num);
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), forwarded) == 0 && phnumGet(pnum, 1) == NULL);
+    phnumDelete(pnum);
+
+    modelReverse(model, num, &expected);
+    pnum = phfwdShmReverse(shm, num);
+    CHECK(modelEqual(pnum, &expected));
+    phnumDelete(pnum);
+}
+
+/** @brief Sprawdza, że czytający widzi kolejne opublikowane wersje, a nieudana
+ * publikacja zostawia poprzednią.
+ * @param seed - ziarno generatora.
+ */
+static void testPublish(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char name[64], num[MODEL_MAX_LENGTH];
+    segmentName(name, sizeof(name));
+
+    PhfwdShm *writer = phfwdShmCreate(name, SLOT_SIZE);
+    CHECK(writer != NULL);
+    PhfwdShm *reader = phfwdShmOpen(name);
+    CHECK(reader != NULL);
+    CHECK(!phfwdShmPublish(reader, NULL));
+
+    // Pusty segment przekierowuje każdy numer na niego samego.
+    modelRandomNumber(&state, num, 6);
+    checkQueries(reader, &model, num);
+
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+
+    for (int version = 0; version < 3; version++) {
+        randomRules(pf, &model, &state);
+        CHECK(phfwdShmPublish(writer, pf));
+
+        for (int i = 0; i < QUERIES; i++) {
+            modelRandomNumber(&state, num, 6);
+            checkQueries(reader, &model, num);
+        }
+    }
+    phfwdDelete(pf);
+    phfwdShmClose(writer);
+    phfwdShmClose(reader);
+
+    // Tablica, która nie mieści się w miejscu, nie jest publikowana.
+    writer = phfwdShmCreate(name, 64);
+    CHECK(writer != NULL);
+    pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdAdd(pf, "1234567890", "0987654321") && phfwdAdd(pf, "5555", "6666"));
+    CHECK(!phfwdShmPublish(writer, pf));
+    PhoneNumbers *pnum = phfwdShmGet(writer, "1234567890");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "1234567890") == 0);
+    phnumDelete(pnum);
+    phfwdDelete(pf);
+    phfwdShmClose(writer);
+
+    CHECK(shm_unlink(name) == 0);
+    CHECK(phfwdShmOpen(name) == NULL);
+}
+
+/** @brief Sprawdza, że zapytania innego procesu w trakcie publikacji dają
+ * wynik jednej z dwóch publikowanych na zmianę wersji.
+ */
+static void testConcurrentReader(void) {
+    uint64_t state = 0x6A09E667F3BCC909u;
+    Model models[2] = {{.count = 0}, {.count = 0}};
+    PhoneForward *pfs[2];
+    char name[64];
+    char nums[QUERIES][MODEL_MAX_LENGTH];
+    char expected[2][QUERIES][2 * MODEL_MAX_LENGTH];
+    segmentName(name, sizeof(name));
+
+    for (int v = 0; v < 2; v++) {
+        pfs[v] = phfwdNew();
+        CHECK(pfs[v] != NULL);
+        randomRules(pfs[v], &models[v], &state);
+    }
+    for (int i = 0; i < QUERIES; i++) {
+        modelRandomNumber(&state, nums[i], 6);
+        modelGet(&models[0], nums[i], expected[0][i]);
+        modelGet(&models[1], nums[i], expected[1][i]);
+    }
+
+    PhfwdShm *writer = phfwdShmCreate(name, SLOT_SIZE);
+    CHECK(writer != NULL && phfwdShmPublish(writer, pfs[0]));
+
+    pid_t child = fork();
+    CHECK(child >= 0);
+
+    if (child == 0) {
+        PhfwdShm *reader = phfwdShmOpen(name);
+        bool valid = reader != NULL;
+
+        for (int round = 0; round < 20 * PUBLISHES && valid; round++) {
+            int i = round % QUERIES;
+            PhoneNumbers *pnum = phfwdShmGet(reader, nums[i]);
+            char const *result = phnumGet(pnum, 0);
+            valid = result != NULL && (strcmp(result, expected[0][i]) == 0 || strcmp(result, expected[1][i]) == 0);
+            phnumDelete(pnum);
+        }
+        phfwdShmClose(reader);
+        _exit(valid ? 0 : 1);
+    }
+
+    for (int i = 0; i < PUBLISHES; i++)
+        CHECK(phfwdShmPublish(writer, pfs[i % 2]));
+
+    int status;
+    CHECK(waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    phfwdShmClose(writer);
+    CHECK(shm_unlink(name) == 0);
+    phfwdDelete(pfs[0]);
+    phfwdDelete(pfs[1]);
+}
+
+int main(void) {
+    for (uint64_t seed = 1; seed <= SEEDS; seed++)
+        testPublish(seed * 0x9E3779B97F4A7C15u);
+    testConcurrentReader();
+    return 0;
+}
@@ -0,0 +1,163 @@
+/** @file
+ * Testy stałej tablicy przekierowań tworzonej przez @ref phfwdStaticBuild:
+ * zgodność zapytań z modelem, listy numerów dłuższe niż odstęp między
+ * numerami zapisanymi w całości, współdzielone poddrzewa i uszkodzone
+ * tablice.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "phone_forward.h"
+#include "phone_forward_model.h"
+#include "phone_forward_static.h"
+
+#define SEEDS 100  ///< Liczba przebiegów z różnymi ziarnami.
+#define RULES 200  ///< Największa liczba przekierowań w jednym przebiegu.
+#define QUERIES 50 ///< Liczba zapytań o jedną tablicę.
+
+/** @brief Sprawdza zapytania o stałą tablicę.
+ * @param table - tablica;
+ * @param model - model;
+ * @param num - numer.
+ */
+static void checkQueries(PhfwdStaticTable const *table, Model const *model, char const *num) {
+    char forwarded[2 * MODEL_MAX_LENGTH];
+    ModelNumbers expected;
+
+    modelGet(model, num, forwarded);
+    PhoneNumbers *pnum = phfwdStaticGet(table, num);
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), forwarded) == 0 && phnumGet(pnum, 1) == NULL);
+    phnumDelete(pnum);
+
+    modelReverse(model, num, &expected);
+    pnum = phfwdStaticReverse(table, num);
+    CHECK(modelEqual(pnum, &expected));
+    phnumDelete(pnum);
+}
+
+/** @brief Sprawdza tablicę utworzoną z losowych przekierowań. Część
+ * przekierowań to ten sam wzór pod różnymi numerami kierunkowymi, więc
+ * tablica ma współdzielone poddrzewa, a część prowadzi na jeden numer, więc
+ * jego lista jest dłuższa niż odstęp między numerami zapisanymi w całości.
+ * @param seed - ziarno generatora.
+ */
+static void testMatchesModel(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char area[MODEL_MAX_LENGTH], num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH], num[MODEL_MAX_LENGTH];
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+
+    for (int i = 0; i < 8; i++) {
+        modelRandomNumber(&state, area, 3);
+        strcat(area, "*");
+        for (int j = 0; j < 6; j++) {
+            char const *diversion = (j % 2 == 0) ? "9" : "99";
+            strcpy(num1, area);
+            strcat(num1, (char const *[]) {"0", "1", "2", "00", "01", "#"}[j]);
+            CHECK(phfwdAdd(pf, num1, diversion) && modelAdd(&model, num1, diversion));
+        }
+    }
+    while (model.count < RULES) {
+        modelRandomNumber(&state, num1, 6);
+        modelRandomNumber(&state, num2, 4);
+        if (modelRandom(&state) % 4 == 0)
+            strcpy(num2, "12");
+        CHECK(phfwdAdd(pf, num1, num2) == modelAdd(&model, num1, num2));
+    }
+
+    PhfwdStaticTable *table = phfwdStaticBuild(pf);
+    CHECK(table != NULL);
+    phfwdDelete(pf);
+
+    for (size_t i = 0; i < model.count; i++) {
+        checkQueries(table, &model, model.rules[i].num1);
+        checkQueries(table, &model, model.rules[i].num2);
+    }
+    for (int i = 0; i < QUERIES; i++) {
+        modelRandomNumber(&state, num, 8);
+        checkQueries(table, &model, num);
+    }
+
+    PhoneNumbers *pnum = phfwdStaticGet(table, "12a");
+    CHECK(pnum != NULL && phnumGet(pnum, 0) == NULL);
+    phnumDelete(pnum);
+    pnum = phfwdStaticReverse(table, "");
+    CHECK(pnum != NULL && phnumGet(pnum, 0) == NULL);
+    phnumDelete(pnum);
+    phfwdStaticDelete(table);
+}
+
+/** @brief Sprawdza tablicę pustej struktury i argumenty NULL.
+ */
+static void testEmpty(void) {
+    Model model = {.count = 0};
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    PhfwdStaticTable *table = phfwdStaticBuild(pf);
+    CHECK(table != NULL);
+    phfwdDelete(pf);
+
+    checkQueries(table, &model, "123");
+    CHECK(phfwdStaticGet(NULL, "123") == NULL);
+    CHECK(phfwdStaticReverse(NULL, "123") == NULL);
+    CHECK(phfwdStaticBuild(NULL) == NULL);
+    phfwdStaticDelete(table);
+    phfwdStaticDelete(NULL);
+}
+
+/** @brief Sprawdza, że zapytania o tablicę z indeksami spoza niej dają
+ * wyniki lub NULL zamiast odczytu spoza tablicy.
+ */
+static void testCorrupted(void) {
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdAdd(pf, "12", "34") && phfwdAdd(pf, "125", "34") && phfwdAdd(pf, "7", "345"));
+    PhfwdStaticTable *table = phfwdStaticBuild(pf);
+    CHECK(table != NULL);
+    phfwdDelete(pf);
+
+    PhfwdStaticNode prefixes[table->prefixCount], reverse[table->reverseCount];
+    memcpy(prefixes, table->prefixes, sizeof(prefixes));
+    memcpy(reverse, table->reverse, sizeof(reverse));
+    PhfwdStaticTable broken = *table;
+    broken.prefixes = prefixes;
+    broken.reverse = reverse;
+
+    // Dziecko spoza tablicy węzłów jest traktowane jak brak dziecka.
+    prefixes[0].firstChild = (uint32_t) table->prefixCount;
+    PhoneNumbers *pnum = phfwdStaticGet(&broken, "1255");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "1255") == 0);
+    phnumDelete(pnum);
+    prefixes[0] = table->prefixes[0];
+
+    reverse[0].firstChild = UINT32_MAX;
+    pnum = phfwdStaticReverse(&broken, "345");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "345") == 0 && phnumGet(pnum, 1) == NULL);
+    phnumDelete(pnum);
+    reverse[0] = table->reverse[0];
+
+    // Numery spoza tablicy numerów dają NULL.
+    broken.listCount = 0;
+    CHECK(phfwdStaticGet(&broken, "1255") == NULL);
+    CHECK(phfwdStaticReverse(&broken, "345") == NULL);
+    broken.listCount = table->listCount;
+
+    broken.stringsSize = 1;
+    CHECK(phfwdStaticGet(&broken, "1255") == NULL);
+    CHECK(phfwdStaticReverse(&broken, "345") == NULL);
+    phfwdStaticDelete(table);
+}
+
+int main(void) {
+    testEmpty();
+    testCorrupted();
+    for (uint64_t seed = 1; seed <= SEEDS; seed++)
+        testMatchesModel(seed * 0x9E3779B97F4A7C15u);
+    return 0;
+}
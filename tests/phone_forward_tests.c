@@ -0,0 +1,791 @@
+/** @file
+ * Testy losowe struktury przechowującej przekierowania. Po każdej operacji
+ * wyniki zapytań są porównywane z modelem z phone_forward_model.h.
+ * Sprawdzane są też kopie tworzone przez @ref phfwdClone, różnice
+ * wyznaczane przez @ref phfwdDiff, scalanie przez @ref phfwdMerge,
+ * układanie przez @ref phfwdRelayout, łączenie poddrzew przez
+ * @ref phfwdDeduplicate, tworzenie struktury przez
+ * @ref phfwdBuildParallel, przeglądanie przekierowań iteratorem,
+ * wyznaczanie końca łańcucha przez @ref phfwdResolveChain i zapytania
+ * wykonywane przez @ref phfwdBatchRun.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "phone_forward.h"
+#include "phone_forward_model.h"
+
+#define SEEDS 300      ///< Liczba przebiegów z różnymi ziarnami.
+#define OPERATIONS 200 ///< Liczba operacji w jednym przebiegu.
+#define QUERIES 4      ///< Liczba zapytań po każdej operacji.
+
+/** @brief Sprawdza wszystkie rodzaje zapytań o numer.
+ * @param pf - struktura;
+ * @param model - model;
+ * @param num - numer.
+ */
+static void checkQueries(PhoneForward const *pf, Model const *model, char const *num) {
+    char forwarded[2 * MODEL_MAX_LENGTH];
+    ModelNumbers expected;
+
+    modelGet(model, num, forwarded);
+    PhoneNumbers *pnum = phfwdGet(pf, num);
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), forwarded) == 0 && phnumGet(pnum, 1) == NULL);
+    phnumDelete(pnum);
+
+    modelReverse(model, num, &expected);
+    pnum = phfwdReverse(pf, num);
+    CHECK(modelEqual(pnum, &expected));
+    phnumDelete(pnum);
+    CHECK(phfwdReverseCount(pf, num) == expected.count);
+
+    PhoneNumbers *batch[1];
+    char const *nums[1] = {num};
+    CHECK(phfwdReverseBatch(pf, nums, 1, batch));
+    CHECK(modelEqual(batch[0], &expected));
+    phnumDelete(batch[0]);
+
+    modelGetReverse(model, num, &expected);
+    pnum = phfwdGetReverse(pf, num);
+    CHECK(modelEqual(pnum, &expected));
+    phnumDelete(pnum);
+    CHECK(phfwdGetReverseCount(pf, num) == expected.count);
+}
+
+/** @brief Wykonuje losową operację na strukturze i modelu.
+ * @param pf - struktura;
+ * @param model - model;
+ * @param state - stan generatora.
+ */
+static void randomOperation(PhoneForward *pf, Model *model, uint64_t *state) {
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH];
+    uint64_t choice = modelRandom(state) % 10;
+
+    if (choice < 7 || model->count == 0) {
+        modelRandomNumber(state, num1, 4);
+        modelRandomNumber(state, num2, 4);
+        CHECK(phfwdAdd(pf, num1, num2) == modelAdd(model, num1, num2));
+    }
+    else if (choice < 8) {
+        modelRandomNumber(state, num1, 3);
+        phfwdRemove(pf, num1);
+        modelRemove(model, num1);
+    }
+    else if (choice < 9) {
+        strcpy(num1, model->rules[modelRandom(state) % model->count].num1);
+        phfwdRemoveOne(pf, num1);
+        modelRemoveOne(model, num1);
+    }
+    else {
+        phfwdReclaim(pf, modelRandom(state) % 4);
+    }
+}
+
+/** @brief Sprawdza zgodność struktury z modelem dla losowych operacji.
+ * @param seed - ziarno generatora;
+ * @param engine - sposób wyszukiwania prefiksów, wybrany przed pierwszą
+ *                 operacją.
+ */
+static void testRandomOperations(uint64_t seed, PhfwdLookupEngine engine) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char num[MODEL_MAX_LENGTH];
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL && phfwdSetLookupEngine(pf, engine));
+
+    for (int i = 0; i < OPERATIONS; i++) {
+        randomOperation(pf, &model, &state);
+        for (int j = 0; j < QUERIES; j++) {
+            modelRandomNumber(&state, num, 6);
+            checkQueries(pf, &model, num);
+        }
+    }
+    CHECK(modelSameRules(pf, &model));
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza, że zmiany kopii i oryginału są od siebie niezależne.
+ * @param seed - ziarno generatora.
+ */
+static void testCloneIsolation(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0}, cloneModel;
+    char num[MODEL_MAX_LENGTH];
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+
+    for (int i = 0; i < OPERATIONS / 4; i++)
+        randomOperation(pf, &model, &state);
+    PhoneForward *clone = phfwdClone(pf);
+    CHECK(clone != NULL);
+    cloneModel = model;
+    for (int i = 0; i < OPERATIONS / 4; i++) {
+        if (modelRandom(&state) % 2 == 0)
+            randomOperation(pf, &model, &state);
+        else
+            randomOperation(clone, &cloneModel, &state);
+        modelRandomNumber(&state, num, 6);
+        checkQueries(pf, &model, num);
+        checkQueries(clone, &cloneModel, num);
+    }
+    CHECK(modelSameRules(pf, &model));
+    CHECK(modelSameRules(clone, &cloneModel));
+
+    if (modelRandom(&state) % 2 == 0) {
+        phfwdDelete(pf);
+        pf = clone;
+        model = cloneModel;
+    }
+    else {
+        phfwdDelete(clone);
+    }
+    for (int i = 0; i < OPERATIONS / 4; i++)
+        randomOperation(pf, &model, &state);
+    CHECK(modelSameRules(pf, &model));
+    phfwdDelete(pf);
+}
+
+/**
+ * To jest stan przekazywany do funkcji odbierającej różnice.
+ */
+typedef struct DiffContext {
+    PhoneForward *pf;         ///< Struktura, na której są wykonywane operacje.
+    size_t count;             ///< Liczba otrzymanych operacji.
+    PhfwdOperation operation; ///< Rodzaj ostatniej operacji.
+} DiffContext;
+
+/** @brief Wykonuje operację wyznaczoną przez @ref phfwdDiff.
+ * @param context - wskaźnik na @ref DiffContext;
+ * @param operation - rodzaj operacji;
+ * @param num1 - prefiks numerów;
+ * @param num2 - przekierowanie lub NULL dla usunięcia.
+ * @return - true, jeśli operacja się powiodła.
+ */
+static bool applyDiff(void *context, PhfwdOperation operation, char const *num1, char const *num2) {
+    DiffContext *diff = (DiffContext *) context;
+    diff->count++;
+    diff->operation = operation;
+    if (operation == PHFWD_OPERATION_REMOVE) {
+        phfwdRemove(diff->pf, num1);
+        return true;
+    }
+    if (operation == PHFWD_OPERATION_REMOVE_ONE) {
+        phfwdRemoveOne(diff->pf, num1);
+        return true;
+    }
+    return phfwdAdd(diff->pf, num1, num2);
+}
+
+/** @brief Sprawdza, że operacje z @ref phfwdDiff przekształcają starą
+ * strukturę w nową.
+ * @param seed - ziarno generatora.
+ */
+static void testDiffRoundTrip(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0}, newModel;
+    PhoneForward *oldPf = phfwdNew();
+    CHECK(oldPf != NULL);
+
+    for (int i = 0; i < OPERATIONS / 4; i++)
+        randomOperation(oldPf, &model, &state);
+    PhoneForward *newPf = phfwdClone(oldPf);
+    CHECK(newPf != NULL);
+
+    DiffContext diff = {.pf = oldPf, .count = 0};
+    CHECK(phfwdDiff(oldPf, newPf, applyDiff, &diff));
+    CHECK(diff.count == 0);
+
+    newModel = model;
+    for (int i = 0; i < OPERATIONS / 8; i++)
+        randomOperation(newPf, &newModel, &state);
+
+    PhoneForward *target = phfwdClone(oldPf);
+    CHECK(target != NULL);
+    diff.pf = target;
+    CHECK(phfwdDiff(oldPf, newPf, applyDiff, &diff));
+    CHECK(modelSameRules(target, &newModel));
+    CHECK(modelSameRules(oldPf, &model));
+
+    phfwdDelete(target);
+    phfwdDelete(newPf);
+    phfwdDelete(oldPf);
+}
+
+/** @brief Sprawdza, że pojedyncza zmiana kopii daje jedną operację
+ * @ref phfwdDiff.
+ */
+static void testDiffMinimal(void) {
+    PhoneForward *oldPf = phfwdNew();
+    CHECK(oldPf != NULL);
+    CHECK(phfwdAdd(oldPf, "12", "9") && phfwdAdd(oldPf, "123", "8") && phfwdAdd(oldPf, "1245", "7"));
+    CHECK(phfwdAdd(oldPf, "3", "6"));
+
+    PhoneForward *newPf = phfwdClone(oldPf);
+    CHECK(newPf != NULL);
+    DiffContext diff = {.pf = phfwdClone(oldPf), .count = 0};
+
+    // Usunięcie przekierowania z dłuższymi przekierowywanymi prefiksami nie usuwa całego poddrzewa.
+    phfwdRemoveOne(newPf, "12");
+    CHECK(diff.pf != NULL);
+    CHECK(phfwdDiff(oldPf, newPf, applyDiff, &diff));
+    CHECK(diff.count == 1 && diff.operation == PHFWD_OPERATION_REMOVE_ONE);
+    PhoneNumbers *pnum = phfwdGet(diff.pf, "1299");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "1299") == 0);
+    phnumDelete(pnum);
+    pnum = phfwdGet(diff.pf, "1239");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "89") == 0);
+    phnumDelete(pnum);
+    phfwdDelete(diff.pf);
+
+    // Usunięcie liścia i zmiana przekierowania dają po jednej operacji.
+    phfwdRemoveOne(newPf, "1245");
+    CHECK(phfwdAdd(newPf, "3", "5"));
+    diff.count = 0;
+    diff.pf = phfwdClone(oldPf);
+    CHECK(diff.pf != NULL);
+    CHECK(phfwdDiff(oldPf, newPf, applyDiff, &diff));
+    CHECK(diff.count == 3);
+    pnum = phfwdGet(diff.pf, "12459");
+    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), "12459") == 0);
+    phnumDelete(pnum);
+    phfwdDelete(diff.pf);
+
+    phfwdDelete(newPf);
+    phfwdDelete(oldPf);
+}
+
+/** @brief Sprawdza scalanie struktur z obiema zasadami rozstrzygania konfliktów.
+ * @param seed - ziarno generatora.
+ */
+static void testMerge(uint64_t seed) {
+    uint64_t state = seed;
+    Model dstModel = {.count = 0}, srcModel = {.count = 0};
+    PhoneForward *dst = phfwdNew();
+    PhoneForward *src = phfwdNew();
+    CHECK(dst != NULL && src != NULL);
+
+    for (int i = 0; i < OPERATIONS / 4; i++) {
+        randomOperation(dst, &dstModel, &state);
+        randomOperation(src, &srcModel, &state);
+    }
+    PhfwdMergePolicy policy = (modelRandom(&state) % 2 == 0) ? PHFWD_MERGE_SRC_WINS : PHFWD_MERGE_DST_WINS;
+    for (size_t i = 0; i < srcModel.count; i++) {
+        bool present = false;
+        for (size_t j = 0; j < dstModel.count; j++)
+            present = present || strcmp(dstModel.rules[j].num1, srcModel.rules[i].num1) == 0;
+        if (policy == PHFWD_MERGE_SRC_WINS || !present)
+            modelAdd(&dstModel, srcModel.rules[i].num1, srcModel.rules[i].num2);
+    }
+    CHECK(phfwdMerge(dst, src, policy));
+    CHECK(modelSameRules(dst, &dstModel));
+    CHECK(modelSameRules(src, &srcModel));
+
+    char num[MODEL_MAX_LENGTH];
+    for (int j = 0; j < QUERIES; j++) {
+        modelRandomNumber(&state, num, 6);
+        checkQueries(dst, &dstModel, num);
+    }
+    phfwdDelete(src);
+    phfwdDelete(dst);
+}
+
+/** @brief Sprawdza odrzucanie niepoprawnych argumentów.
+ */
+static void testInvalidArguments(void) {
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(!phfwdAdd(pf, "12", "12"));
+    CHECK(!phfwdAdd(pf, "12a", "3"));
+    CHECK(!phfwdAdd(pf, "", "3"));
+    CHECK(!phfwdAdd(NULL, "1", "3"));
+    phfwdRemove(pf, "x");
+    phfwdRemove(NULL, "1");
+    phfwdRemoveOne(pf, "x");
+    phfwdRemoveOne(NULL, "1");
+
+    PhoneNumbers *pnum = phfwdGet(pf, "1a");
+    CHECK(pnum != NULL && phnumGet(pnum, 0) == NULL);
+    phnumDelete(pnum);
+    pnum = phfwdReverse(pf, "");
+    CHECK(pnum != NULL && phnumGet(pnum, 0) == NULL);
+    phnumDelete(pnum);
+    CHECK(phfwdReverseCount(pf, "1a") == 0);
+    CHECK(phfwdGetReverseCount(NULL, "1") == 0);
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza liczenie numerów, które powtarzają się w wyniku
+ * @ref phfwdReverse lub są przesłonięte dłuższym prefiksem.
+ */
+static void testReverseCounts(void) {
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdAdd(pf, "1", "2") && phfwdAdd(pf, "13", "23") && phfwdAdd(pf, "135", "9"));
+
+    // Numer 134 powstaje z przekierowań 1 -> 2 i 13 -> 23.
+    CHECK(phfwdReverseCount(pf, "234") == 2);
+    // Numer 1354 ma najdłuższy przekierowywany prefiks 135.
+    CHECK(phfwdReverseCount(pf, "2354") == 2);
+    CHECK(phfwdGetReverseCount(pf, "2354") == 1);
+    CHECK(phfwdGetReverseCount(pf, "94") == 2);
+    CHECK(phfwdGetReverseCount(pf, "23") == 2);
+
+    phfwdRemoveOne(pf, "13");
+    CHECK(phfwdReverseCount(pf, "234") == 2);
+    CHECK(phfwdGetReverseCount(pf, "234") == 2);
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza wyniki phfwdReverse złożone z wielu uporządkowanych ciągów,
+ * także dłuższe niż bufor na stosie i z prefiksami będącymi początkami
+ * innych prefiksów.
+ * @param seed - ziarno generatora.
+ */
+static void testReverseManyResults(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char num1[MODEL_MAX_LENGTH], num[MODEL_MAX_LENGTH];
+    char const *diversions[] = {"9", "98", "987"};
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+
+    while (model.count < MODEL_MAX_RULES - 1) {
+        modelRandomNumber(&state, num1, 5);
+        char const *num2 = diversions[modelRandom(&state) % 3];
+        CHECK(phfwdAdd(pf, num1, num2) == modelAdd(&model, num1, num2));
+    }
+
+    for (int i = 0; i < QUERIES; i++) {
+        strcpy(num, "987");
+        modelRandomNumber(&state, num + 3, 3);
+        checkQueries(pf, &model, num);
+    }
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza struktury po połączeniu identycznych poddrzew przez
+ * @ref phfwdDeduplicate: ten sam wzór przekierowań powtórzony pod wieloma
+ * numerami kierunkowymi, zapytania i dalsze zmiany wspólnych poddrzew.
+ * @param seed - ziarno generatora.
+ */
+static void testDeduplicate(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0}, cloneModel;
+    char area[MODEL_MAX_LENGTH], num1[MODEL_MAX_LENGTH], num[MODEL_MAX_LENGTH];
+    char extensions[8][MODEL_MAX_LENGTH], diversions[8][MODEL_MAX_LENGTH];
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdSetLookupEngine(pf, (seed % 2 == 0) ? PHFWD_LOOKUP_TRIE : PHFWD_LOOKUP_HASH));
+
+    for (int j = 0; j < 8; j++) {
+        modelRandomNumber(&state, extensions[j], 3);
+        modelRandomNumber(&state, diversions[j], 4);
+    }
+    for (int i = 0; i < 24; i++) {
+        modelRandomNumber(&state, area, 4);
+        for (int j = 0; j < 8; j++) {
+            strcpy(num1, area);
+            strcat(num1, extensions[j]);
+            CHECK(phfwdAdd(pf, num1, diversions[j]) == modelAdd(&model, num1, diversions[j]));
+        }
+    }
+
+    PhoneForward *clone = phfwdClone(pf);
+    CHECK(clone != NULL);
+    cloneModel = model;
+    size_t usage = phfwdMemoryUsage(pf);
+    CHECK(phfwdDeduplicate(pf));
+    CHECK(phfwdMemoryUsage(pf) < usage);
+    CHECK(modelSameRules(pf, &model));
+
+    // Zmiany wspólnych poddrzew nie mogą być widoczne pod innymi numerami kierunkowymi ani w kopii.
+    for (int i = 0; i < OPERATIONS / 4; i++) {
+        if (model.count < MODEL_MAX_RULES - 1)
+            randomOperation(pf, &model, &state);
+        if (model.count > 0) {
+            strcpy(num, model.rules[modelRandom(&state) % model.count].num1);
+            modelRandomNumber(&state, num + strlen(num), 2);
+            checkQueries(pf, &model, num);
+        }
+        modelRandomNumber(&state, num, 6);
+        checkQueries(pf, &model, num);
+    }
+    CHECK(modelSameRules(pf, &model));
+    CHECK(modelSameRules(clone, &cloneModel));
+
+    CHECK(phfwdDeduplicate(pf) && phfwdRelayout(pf));
+    CHECK(modelSameRules(pf, &model));
+    CHECK(!phfwdDeduplicate(NULL));
+    phfwdDelete(clone);
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza tworzenie struktury z tablicy przez
+ * @ref phfwdBuildParallel na jednym i wielu wątkach: numery ze wspólnym
+ * początkiem kraju, krótkie numery, powtórzone prefiksy i niepoprawne
+ * przekierowania.
+ * @param seed - ziarno generatora.
+ */
+static void testBuildParallel(uint64_t seed) {
+    static size_t const threads[] = {1, 2, 8};
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char nums1[OPERATIONS][MODEL_MAX_LENGTH], nums2[OPERATIONS][MODEL_MAX_LENGTH], num[MODEL_MAX_LENGTH];
+    char const *num1[OPERATIONS], *num2[OPERATIONS];
+
+    // Większość numerów zaczyna się od "48", więc podział według pierwszego znaku dałby jedną dużą część.
+    for (size_t i = 0; i < OPERATIONS; i++) {
+        uint64_t choice = modelRandom(&state) % 8;
+        do {
+            if (choice < 5) {
+                strcpy(nums1[i], "48");
+                modelRandomNumber(&state, nums1[i] + 2, 5);
+            }
+            else if (choice < 6 || i == 0) {
+                modelRandomNumber(&state, nums1[i], 3);
+            }
+            else {
+                strcpy(nums1[i], nums1[modelRandom(&state) % i]);
+            }
+            if (modelRandom(&state) % 2 == 0) {
+                strcpy(nums2[i], "48");
+                modelRandomNumber(&state, nums2[i] + 2, 3);
+            }
+            else {
+                modelRandomNumber(&state, nums2[i], 3);
+            }
+        } while (!modelAdd(&model, nums1[i], nums2[i]));
+        num1[i] = nums1[i];
+        num2[i] = nums2[i];
+    }
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        PhoneForward *pf = phfwdBuildParallel(num1, num2, OPERATIONS, threads[t]);
+        CHECK(pf != NULL);
+        CHECK(modelSameRules(pf, &model));
+        for (int i = 0; i < OPERATIONS / 4; i++) {
+            modelRandomNumber(&state, num, 6);
+            checkQueries(pf, &model, num);
+            strcpy(num, "48");
+            modelRandomNumber(&state, num + 2, 6);
+            checkQueries(pf, &model, num);
+        }
+        phfwdDelete(pf);
+    }
+
+    // Jedno niepoprawne przekierowanie, także wśród krótkich numerów, daje NULL.
+    size_t bad = modelRandom(&state) % OPERATIONS;
+    num2[bad] = num1[bad];
+    CHECK(phfwdBuildParallel(num1, num2, OPERATIONS, 8) == NULL);
+    num2[bad] = "48a";
+    CHECK(phfwdBuildParallel(num1, num2, OPERATIONS, 8) == NULL);
+    num2[bad] = "";
+    CHECK(phfwdBuildParallel(num1, num2, OPERATIONS, 8) == NULL);
+    num2[bad] = nums2[bad];
+    num1[bad] = "4";
+    num2[bad] = "4";
+    CHECK(phfwdBuildParallel(num1, num2, OPERATIONS, 2) == NULL);
+    num1[bad] = NULL;
+    CHECK(phfwdBuildParallel(num1, num2, OPERATIONS, 8) == NULL);
+}
+
+/** @brief Sprawdza przeglądanie przekierowań prefiksów zaczynających się
+ * od danego prefiksu iteratorem @ref PhfwdIterator.
+ * @param seed - ziarno generatora.
+ */
+static void testIteratorPrefix(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char prefix[MODEL_MAX_LENGTH];
+    char const *num1, *num2;
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+
+    for (int i = 0; i < OPERATIONS / 2; i++)
+        randomOperation(pf, &model, &state);
+    qsort(model.rules, model.count, sizeof(ModelRule), modelCompare);
+
+    for (int i = 0; i < QUERIES * 4; i++) {
+        if (i % 2 == 0 && model.count > 0) {
+            strcpy(prefix, model.rules[modelRandom(&state) % model.count].num1);
+            prefix[1 + modelRandom(&state) % strlen(prefix)] = '\0';
+        }
+        else {
+            modelRandomNumber(&state, prefix, 3);
+        }
+
+        // Przekierowania z prefiksem są w posortowanym modelu kolejno.
+        size_t k = 0;
+        while (k < model.count && !modelIsPrefix(prefix, model.rules[k].num1))
+            k++;
+        PhfwdIterator *it = phfwdIteratorNew(pf, prefix);
+        CHECK(it != NULL);
+        while (phfwdIteratorNext(it, &num1, &num2)) {
+            CHECK(k < model.count && modelIsPrefix(prefix, model.rules[k].num1));
+            CHECK(strcmp(num1, model.rules[k].num1) == 0 && strcmp(num2, model.rules[k].num2) == 0);
+            k++;
+        }
+        CHECK(!phfwdIteratorFailed(it));
+        CHECK(k == model.count || !modelIsPrefix(prefix, model.rules[k].num1));
+        CHECK(!phfwdIteratorNext(it, &num1, &num2));
+        phfwdIteratorDelete(it);
+    }
+
+    PhfwdIterator *it = phfwdIteratorNew(pf, NULL);
+    CHECK(it != NULL && !phfwdIteratorNext(it, NULL, &num2) && !phfwdIteratorFailed(it));
+    phfwdIteratorDelete(it);
+    CHECK(phfwdIteratorNew(pf, "1a") == NULL);
+    CHECK(phfwdIteratorNew(NULL, NULL) == NULL);
+    phfwdIteratorDelete(NULL);
+    phfwdDelete(pf);
+}
+
+/** @brief Wyznacza koniec łańcucha przekierowań w modelu.
+ * @param model - model;
+ * @param num - numer;
+ * @param maxHops - największa dopuszczalna liczba przekierowań;
+ * @param result - bufor na koniec łańcucha, pusty, jeśli łańcuch zawiera
+ *                 cykl lub jest dłuższy niż @p maxHops.
+ */
+static void modelResolveChain(Model const *model, char const *num, size_t maxHops, char *result) {
+    char seen[MODEL_MAX_RULES + 1][2 * MODEL_MAX_LENGTH];
+    strcpy(seen[0], num);
+
+    for (size_t hops = 0; hops <= MODEL_MAX_RULES; hops++) {
+        modelGet(model, seen[hops], seen[hops + 1]);
+        if (strcmp(seen[hops + 1], seen[hops]) == 0) {
+            strcpy(result, seen[hops]);
+            return;
+        }
+        if (hops == maxHops || strlen(seen[hops + 1]) >= MODEL_MAX_LENGTH)
+            break;
+        for (size_t i = 0; i <= hops; i++) {
+            if (strcmp(seen[i], seen[hops + 1]) == 0) {
+                result[0] = '\0';
+                return;
+            }
+        }
+    }
+    result[0] = '\0';
+}
+
+/** @brief Sprawdza koniec łańcucha przekierowań z zapamiętywaniem wyników
+ * i bez niego.
+ * @param pf - struktura;
+ * @param model - model;
+ * @param memo - struktura zapamiętująca wyniki;
+ * @param num - numer;
+ * @param maxHops - największa dopuszczalna liczba przekierowań.
+ */
+static void checkChain(PhoneForward const *pf, Model const *model, PhfwdChainMemo *memo, char const *num,
+                       size_t maxHops) {
+    char expected[2 * MODEL_MAX_LENGTH];
+    modelResolveChain(model, num, maxHops, expected);
+
+    for (int i = 0; i < 2; i++) {
+        PhoneNumbers *pnum = phfwdResolveChain(pf, num, maxHops, (i == 0) ? NULL : memo);
+        CHECK(pnum != NULL);
+        CHECK((expected[0] == '\0') ? phnumGet(pnum, 0) == NULL : strcmp(phnumGet(pnum, 0), expected) == 0);
+        CHECK(phnumGet(pnum, 1) == NULL);
+        phnumDelete(pnum);
+    }
+}
+
+/** @brief Sprawdza wyznaczanie końca łańcucha przekierowań: łańcuchy
+ * krótsze i dłuższe niż limit, cykle, numery rosnące bez końca i wyniki
+ * zapamiętane przed zmianą struktury.
+ * @param seed - ziarno generatora.
+ */
+static void testResolveChain(uint64_t seed) {
+    static size_t const limits[] = {0, 1, 2, 5, 64};
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char num1[MODEL_MAX_LENGTH], num2[MODEL_MAX_LENGTH], num[MODEL_MAX_LENGTH];
+    PhoneForward *pf = phfwdNew();
+    PhfwdChainMemo *memo = phfwdChainMemoNew(4);
+    CHECK(pf != NULL && memo != NULL);
+
+    // Łańcuch 15 -> 25 -> 35, cykl 4 -> 5 -> 4 i numer 6 rosnący przy każdym przekierowaniu.
+    char const *rules[][2] = {{"1", "2"}, {"2", "3"}, {"4", "5"}, {"5", "4"}, {"6", "66"}};
+    for (size_t i = 0; i < sizeof(rules) / sizeof(rules[0]); i++)
+        CHECK(phfwdAdd(pf, rules[i][0], rules[i][1]) && modelAdd(&model, rules[i][0], rules[i][1]));
+    for (size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+        checkChain(pf, &model, memo, "15", limits[l]);
+        checkChain(pf, &model, memo, "47", limits[l]);
+        checkChain(pf, &model, memo, "6", limits[l]);
+        checkChain(pf, &model, memo, "7", limits[l]);
+    }
+
+    for (int i = 0; i < OPERATIONS / 4; i++) {
+        // Krótkie numery z dwóch znaków często tworzą łańcuchy i cykle.
+        for (int j = 0; j < 2; j++) {
+            num1[j] = "01"[modelRandom(&state) % 2];
+            num2[j] = "01"[modelRandom(&state) % 2];
+        }
+        num1[1 + modelRandom(&state) % 2] = '\0';
+        num2[1 + modelRandom(&state) % 2] = '\0';
+        if (modelRandom(&state) % 4 == 0) {
+            phfwdRemove(pf, num1);
+            modelRemove(&model, num1);
+        }
+        else if (model.count < MODEL_MAX_RULES) {
+            CHECK(phfwdAdd(pf, num1, num2) == modelAdd(&model, num1, num2));
+        }
+
+        // Po zmianie struktury zapamiętane wyniki nie mogą być użyte.
+        for (int j = 0; j < QUERIES; j++) {
+            modelRandomNumber(&state, num, 4);
+            checkChain(pf, &model, memo, num, limits[modelRandom(&state) % 5]);
+        }
+    }
+
+    PhoneNumbers *pnum = phfwdResolveChain(pf, "1a", 5, memo);
+    CHECK(pnum != NULL && phnumGet(pnum, 0) == NULL);
+    phnumDelete(pnum);
+    CHECK(phfwdResolveChain(NULL, "1", 5, memo) == NULL);
+    phfwdChainMemoDelete(memo);
+    phfwdChainMemoDelete(NULL);
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza struktury po ułożeniu przez @ref phfwdRelayout według
+ * zliczonych trafień: zapytania, dalsze zmiany, kolejne ułożenia, kopię
+ * sprzed ułożenia i ułożenie, które nie mieści się w limicie pamięci.
+ * @param seed - ziarno generatora.
+ */
+static void testRelayout(uint64_t seed) {
+    uint64_t state = seed;
+    Model model = {.count = 0}, cloneModel;
+    char num[MODEL_MAX_LENGTH];
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+    CHECK(phfwdSetLookupEngine(pf, (seed % 2 == 0) ? PHFWD_LOOKUP_TRIE : PHFWD_LOOKUP_HASH));
+    CHECK(phfwdSetHitSampling(pf, 1 + (unsigned) (seed % 3)));
+
+    for (int i = 0; i < OPERATIONS / 2; i++)
+        randomOperation(pf, &model, &state);
+    PhoneForward *clone = phfwdClone(pf);
+    CHECK(clone != NULL);
+    cloneModel = model;
+
+    for (int round = 0; round < 3; round++) {
+        // Zapytania o kilka numerów są częstsze, więc ich ścieżki trafią na początek bloku.
+        for (int i = 0; i < OPERATIONS; i++) {
+            modelRandomNumber(&state, num, (i % 4 == 0) ? 6 : 2);
+            checkQueries(pf, &model, num);
+        }
+        CHECK(phfwdRelayout(pf));
+        CHECK(modelSameRules(pf, &model));
+
+        // Zmiany po ułożeniu zwalniają i przydzielają węzły także w bloku.
+        for (int i = 0; i < OPERATIONS / 4; i++) {
+            randomOperation(pf, &model, &state);
+            modelRandomNumber(&state, num, 6);
+            checkQueries(pf, &model, num);
+        }
+        CHECK(modelSameRules(pf, &model));
+    }
+    CHECK(modelSameRules(clone, &cloneModel));
+
+    // Ułożenie, które nie mieści się w limicie, zostawia strukturę bez zmian.
+    CHECK(phfwdSetMemoryBudget(pf, 1));
+    CHECK(!phfwdRelayout(pf));
+    CHECK(modelSameRules(pf, &model));
+    modelRandomNumber(&state, num, 6);
+    checkQueries(pf, &model, num);
+
+    CHECK(!phfwdRelayout(NULL));
+    CHECK(!phfwdSetHitSampling(NULL, 1));
+    phfwdDelete(clone);
+    phfwdDelete(pf);
+}
+
+/** @brief Sprawdza zapytania wykonywane przez @ref phfwdBatchRun na jednym
+ * i wielu wątkach, także o napisy, które nie są numerami.
+ * @param seed - ziarno generatora.
+ */
+static void testBatchRun(uint64_t seed) {
+    static size_t const threads[] = {1, 3};
+    uint64_t state = seed;
+    Model model = {.count = 0};
+    char nums[OPERATIONS][MODEL_MAX_LENGTH], forwarded[2 * MODEL_MAX_LENGTH];
+    char const *queries[OPERATIONS];
+    ModelNumbers expected;
+    PhoneForward *pf = phfwdNew();
+    CHECK(pf != NULL);
+
+    for (int i = 0; i < OPERATIONS / 2; i++)
+        randomOperation(pf, &model, &state);
+    for (size_t i = 0; i < OPERATIONS; i++) {
+        modelRandomNumber(&state, nums[i], 6);
+        queries[i] = nums[i];
+    }
+    queries[0] = "1a";
+    queries[1] = "";
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        for (int query = PHFWD_QUERY_GET; query <= PHFWD_QUERY_GET_REVERSE; query++) {
+            PhfwdBatch *batch = phfwdBatchRun(pf, (PhfwdQuery) query, queries, OPERATIONS, threads[t]);
+            CHECK(batch != NULL);
+
+            for (size_t i = 0; i < OPERATIONS; i++) {
+                PhoneNumbers const *pnum = phfwdBatchResult(batch, i);
+                if (i < 2) {
+                    CHECK(pnum != NULL && phnumGet(pnum, 0) == NULL);
+                }
+                else if (query == PHFWD_QUERY_GET) {
+                    modelGet(&model, queries[i], forwarded);
+                    CHECK(pnum != NULL && strcmp(phnumGet(pnum, 0), forwarded) == 0 && phnumGet(pnum, 1) == NULL);
+                }
+                else {
+                    if (query == PHFWD_QUERY_REVERSE)
+                        modelReverse(&model, queries[i], &expected);
+                    else
+                        modelGetReverse(&model, queries[i], &expected);
+                    CHECK(modelEqual(pnum, &expected));
+                }
+            }
+            CHECK(phfwdBatchResult(batch, OPERATIONS) == NULL);
+            phfwdBatchDelete(batch);
+        }
+    }
+
+    PhfwdBatch *empty = phfwdBatchRun(pf, PHFWD_QUERY_GET, queries, 0, 4);
+    CHECK(empty != NULL && phfwdBatchResult(empty, 0) == NULL);
+    phfwdBatchDelete(empty);
+    CHECK(phfwdBatchRun(NULL, PHFWD_QUERY_GET, queries, OPERATIONS, 1) == NULL);
+    CHECK(phfwdBatchRun(pf, PHFWD_QUERY_GET, NULL, OPERATIONS, 1) == NULL);
+    CHECK(phfwdBatchResult(NULL, 0) == NULL);
+    phfwdBatchDelete(NULL);
+    phfwdDelete(pf);
+}
+
+int main(void) {
+    testInvalidArguments();
+    testDiffMinimal();
+    testReverseCounts();
+    for (uint64_t seed = 1; seed <= SEEDS / 10; seed++)
+        testReverseManyResults(seed * 0x9FB21C651E98DF25u);
+    for (uint64_t seed = 1; seed <= SEEDS; seed++) {
+        testRandomOperations(seed * 0x9E3779B97F4A7C15u, PHFWD_LOOKUP_TRIE);
+        testRandomOperations(seed * 0xD6E8FEB86659FD93u, PHFWD_LOOKUP_HASH);
+        testCloneIsolation(seed * 0xBF58476D1CE4E5B9u);
+        testDiffRoundTrip(seed * 0x94D049BB133111EBu);
+        testMerge(seed * 0x2545F4914F6CDD1Du);
+        testIteratorPrefix(seed * 0x3C79AC492BA7B653u);
+        testResolveChain(seed * 0x1CE4E5B9BF58476Du);
+    }
+    for (uint64_t seed = 1; seed <= SEEDS / 10; seed++) {
+        testDeduplicate(seed * 0x8CB92BA72F3D8DD7u);
+        testRelayout(seed * 0xE7037ED1A0B428DBu);
+        testBatchRun(seed * 0x8EBC6AF09C88C6E3u);
+    }
+    for (uint64_t seed = 1; seed <= SEEDS / 10; seed++)
+        testBuildParallel(seed * 0xA0761D6478BD642Fu);
+    return 0;
+}
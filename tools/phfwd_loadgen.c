@@ -0,0 +1,272 @@
+/** @file
+ * Generator obciążenia serwera przekierowań.
+ *
+ * Użycie: phfwd_loadgen (-u ścieżka | -p port) [-c połączenia] [-d głębokość] [-n żądania] [-a reguły]
+ *         [-r procent]
+ *
+ * Program otwiera podaną liczbę połączeń z serwerem phfwd_server, każde w osobnym wątku. Wątek wysyła naraz
+ * tyle żądań, ile wynosi głębokość potoku, i dopiero potem odbiera odpowiedzi na nie. Żądania są zapytaniami
+ * phfwdGet o losowe numery, a podany procent z nich zapytaniami phfwdReverse. Przed pomiarem program może dodać
+ * podaną liczbę losowych przekierowań. Na koniec wypisuje czas, przepustowość i średni czas oczekiwania na grupę
+ * odpowiedzi.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "phone_forward_client.h"
+
+/**
+ * Długość losowanych numerów.
+ */
+#define NUMBER_LENGTH 12
+
+/**
+ * Liczba cyfr losowanych prefiksów przekierowań.
+ */
+#define PREFIX_LENGTH 4
+
+/**
+ * @struct Load
+ * @brief Load opisuje obciążenie generowane przez jeden wątek i jego wynik.
+ */
+struct Load {
+    char const *path; ///< Ścieżka gniazda serwera lub NULL.
+    uint16_t port; ///< Port serwera, jeśli path ma wartość NULL.
+    size_t depth; ///< Liczba żądań wysyłanych naraz.
+    size_t requests; ///< Liczba żądań do wysłania.
+    unsigned reversePercent; ///< Procent żądań phfwdReverse.
+    unsigned seed; ///< Ziarno generatora liczb losowych.
+    pthread_t thread; ///< Wątek.
+    size_t completed; ///< Liczba żądań, na które przyszła poprawna odpowiedź.
+    double waiting; ///< Łączny czas oczekiwania na odpowiedzi w sekundach.
+    size_t batches; ///< Liczba wysłanych grup żądań.
+};
+typedef struct Load Load;
+
+/**
+ * Podaje bieżący czas monotoniczny.
+ * @return - czas w sekundach.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+/**
+ * Losuje numer.
+ * @param number - bufor o długości co najmniej @p length + 1.
+ * @param length - liczba cyfr.
+ * @param seed - wskaźnik na stan generatora.
+ */
+static void randomNumber(char *number, size_t length, unsigned *seed) {
+    for (size_t i = 0; i < length; i++)
+        number[i] = (char) ('0' + rand_r(seed) % 10);
+    number[length] = '\0';
+}
+
+/**
+ * Łączy się z serwerem.
+ * @param load - wskaźnik na opis obciążenia.
+ * @return - wskaźnik na połączenie lub NULL, jeśli nie udało się połączyć.
+ */
+static PhfwdClient *connectLoad(Load const *load) {
+    if (load->path != NULL)
+        return phfwdClientConnectUnix(load->path);
+    return phfwdClientConnectTcp("127.0.0.1", load->port);
+}
+
+/**
+ * Wysyła żądania wątku grupami po load->depth i odbiera odpowiedzi.
+ * @param arg - wskaźnik na opis obciążenia.
+ * @return - NULL.
+ */
+static void *runLoad(void *arg) {
+    Load *load = (Load *) arg;
+    PhfwdClient *client = connectLoad(load);
+    char number[NUMBER_LENGTH + 1];
+    size_t sent = 0;
+    bool valid = client != NULL;
+
+    while (valid && sent < load->requests) {
+        size_t batch = load->requests - sent;
+        if (batch > load->depth)
+            batch = load->depth;
+
+        for (size_t i = 0; i < batch && valid; i++) {
+            randomNumber(number, NUMBER_LENGTH, &load->seed);
+            PhfwdRequest request = ((unsigned) rand_r(&load->seed) % 100 < load->reversePercent) ?
+                                   PHFWD_REQUEST_REVERSE : PHFWD_REQUEST_GET;
+            valid = phfwdClientSend(client, request, number, NULL, NULL);
+        }
+
+        double start = now();
+        valid = valid && phfwdClientFlush(client);
+
+        for (size_t i = 0; i < batch && valid; i++) {
+            uint32_t id;
+            bool result;
+            valid = phfwdClientReceive(client, &id, &result, NULL) && result;
+            if (valid)
+                load->completed++;
+        }
+
+        load->waiting += now() - start;
+        load->batches++;
+        sent += batch;
+    }
+
+    if (!valid)
+        fprintf(stderr, "phfwd_loadgen: połączenie przerwane po %lu żądaniach\n", (unsigned long) load->completed);
+    phfwdClientClose(client);
+    return NULL;
+}
+
+/**
+ * Dodaje losowe przekierowania przez jedno połączenie.
+ * @param load - wskaźnik na opis serwera.
+ * @param count - liczba przekierowań.
+ * @return true - jeśli wszystkie przekierowania zostały dodane.
+ *         false - w przeciwnym przypadku.
+ */
+static bool populate(Load const *load, size_t count) {
+    PhfwdClient *client = connectLoad(load);
+    char num1[PREFIX_LENGTH + 1];
+    char num2[NUMBER_LENGTH + 1];
+    unsigned seed = 1;
+    bool valid = client != NULL;
+
+    for (size_t i = 0; i < count && valid; i++) {
+        randomNumber(num1, PREFIX_LENGTH, &seed);
+        randomNumber(num2, NUMBER_LENGTH, &seed);
+        valid = phfwdClientSend(client, PHFWD_REQUEST_ADD, num1, num2, NULL);
+    }
+
+    valid = valid && phfwdClientFlush(client);
+
+    // Dwa takie same numery dają odpowiedź false, ale nie są błędem.
+    for (size_t i = 0; i < count && valid; i++) {
+        uint32_t id;
+        bool result;
+        valid = phfwdClientReceive(client, &id, &result, NULL);
+    }
+
+    phfwdClientClose(client);
+    return valid;
+}
+
+/**
+ * Uruchamia wątki obciążenia i wypisuje wyniki.
+ * @param argc - liczba argumentów.
+ * @param argv - opcje.
+ * @return - EXIT_SUCCESS lub EXIT_FAILURE.
+ */
+int main(int argc, char *argv[]) {
+    Load base = {.path = NULL, .port = 0, .depth = 32, .requests = 100000, .reversePercent = 0};
+    long port = -1;
+    long connections = 4;
+    long depth = 32;
+    long requests = 100000;
+    long rules = 0;
+    long reversePercent = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "u:p:c:d:n:a:r:")) != -1) {
+        long *target = NULL;
+
+        switch (option) {
+            case 'u':
+                base.path = optarg;
+                break;
+            case 'p':
+                target = &port;
+                break;
+            case 'c':
+                target = &connections;
+                break;
+            case 'd':
+                target = &depth;
+                break;
+            case 'n':
+                target = &requests;
+                break;
+            case 'a':
+                target = &rules;
+                break;
+            case 'r':
+                target = &reversePercent;
+                break;
+            default:
+                connections = 0;
+                break;
+        }
+
+        if (target != NULL)
+            *target = strtol(optarg, NULL, 10);
+    }
+
+    if ((base.path == NULL) == (port < 0) || port > UINT16_MAX || connections <= 0 || depth <= 0 ||
+        requests < 0 || rules < 0 || reversePercent < 0 || reversePercent > 100 || optind != argc) {
+        fprintf(stderr, "Użycie: %s (-u ścieżka | -p port) [-c połączenia] [-d głębokość] [-n żądania] "
+                        "[-a reguły] [-r procent]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    base.port = (uint16_t) port;
+    base.depth = (size_t) depth;
+    base.reversePercent = (unsigned) reversePercent;
+
+    if (rules > 0 && !populate(&base, (size_t) rules)) {
+        fprintf(stderr, "phfwd_loadgen: nie udało się dodać przekierowań\n");
+        return EXIT_FAILURE;
+    }
+
+    Load *loads = (Load *) calloc((size_t) connections, sizeof(Load));
+    if (loads == NULL)
+        return EXIT_FAILURE;
+
+    double start = now();
+    size_t started = 0;
+
+    for (; started < (size_t) connections; started++) {
+        loads[started] = base;
+        // Żądania są dzielone między połączenia możliwie po równo.
+        loads[started].requests = (size_t) requests / (size_t) connections +
+                                  (started < (size_t) requests % (size_t) connections);
+        loads[started].seed = (unsigned) started + 1;
+        if (pthread_create(&loads[started].thread, NULL, runLoad, &loads[started]) != 0)
+            break;
+    }
+
+    size_t completed = 0;
+    size_t batches = 0;
+    double waiting = 0;
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(loads[i].thread, NULL);
+        completed += loads[i].completed;
+        batches += loads[i].batches;
+        waiting += loads[i].waiting;
+    }
+
+    double elapsed = now() - start;
+    printf("połączenia: %lu, głębokość: %ld, odpowiedzi: %lu/%ld\n", (unsigned long) started, depth,
+           (unsigned long) completed, requests);
+    printf("czas: %.3f s, przepustowość: %.0f żądań/s\n", elapsed, (elapsed > 0) ? (double) completed / elapsed : 0);
+    printf("średni czas grupy: %.1f us, na żądanie: %.2f us\n", (batches > 0) ? waiting / (double) batches * 1e6 : 0,
+           (completed > 0) ? waiting / (double) completed * 1e6 : 0);
+
+    free(loads);
+    return (started == (size_t) connections && completed == (size_t) requests) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,627 @@
+/** @file
+ * Serwer przekierowań numerów telefonu.
+ *
+ * Użycie: phfwd_server [-w wątki] (-u ścieżka | -p port) [plik_reguł]
+ *
+ * Serwer wczytuje reguły w formacie programu rule_compiler i odpowiada na żądania klientów z
+ * phone_forward_client.h, przesyłane przez gniazdo domeny uniksowej o podanej ścieżce albo przez TCP na porcie
+ * adresu 127.0.0.1. Każdy z wątków obsługuje w pętli epoll własne połączenia. Wszystkie żądania odebrane
+ * z połączenia jednym odczytem są wykonywane razem, a odpowiedzi na nie są wysyłane jednym zapisem. Zapytania
+ * wielu wątków są wykonywane równolegle, pod blokadą do odczytu, a phfwdAdd i phfwdRemove pod blokadą do zapisu.
+ * Serwer kończy działanie po otrzymaniu sygnału SIGINT lub SIGTERM.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "trie.h"
+#include "arena.h"
+#include "phone_forward_query.h"
+#include "phone_forward_client.h"
+#include "phone_forward_protocol.h"
+
+/**
+ * Domyślna liczba wątków obsługujących połączenia.
+ */
+#define DEFAULT_WORKERS 4
+
+/**
+ * Największa liczba zdarzeń odbieranych jednym wywołaniem epoll_wait.
+ */
+#define MAX_EVENTS 64
+
+/**
+ * Liczba bajtów odczytywanych naraz z gniazda.
+ */
+#define READ_CHUNK (64 * 1024)
+
+/**
+ * Liczba niewysłanych bajtów odpowiedzi, po której przekroczeniu serwer przestaje czytać żądania połączenia.
+ */
+#define OUTPUT_LIMIT (1024 * 1024)
+
+/**
+ * Czas w milisekundach, po którym epoll_wait wraca, żeby wątek mógł sprawdzić, czy ma się zakończyć.
+ */
+#define POLL_TIMEOUT 100
+
+/**
+ * Blokada przekierowań trzymana przez wątek.
+ */
+enum LockState {
+    LOCK_NONE, ///< Wątek nie trzyma blokady.
+    LOCK_READ, ///< Wątek trzyma blokadę do odczytu.
+    LOCK_WRITE ///< Wątek trzyma blokadę do zapisu.
+};
+typedef enum LockState LockState;
+
+/**
+ * @struct Server
+ * @brief Server przechowuje przekierowania i stan wspólny dla wszystkich wątków.
+ */
+struct Server {
+    PhoneForward *pf; ///< Przekierowania.
+    pthread_rwlock_t lock; ///< Blokada przekierowań.
+    int listener; ///< Gniazdo, na którym serwer przyjmuje połączenia.
+    atomic_bool stop; ///< Czy wątki mają się zakończyć.
+};
+typedef struct Server Server;
+
+/**
+ * @struct Connection
+ * @brief Connection jest połączeniem z klientem, obsługiwanym przez jeden wątek.
+ */
+struct Connection {
+    int fd; ///< Gniazdo połączenia.
+    FrameBuffer in; ///< Odebrane, jeszcze niewykonane żądania.
+    FrameBuffer out; ///< Odpowiedzi, które nie zostały jeszcze wysłane.
+    size_t sent; ///< Liczba wysłanych już bajtów z początku bufora out.
+    uint32_t events; ///< Zdarzenia, na które czeka połączenie.
+    struct Connection *prev; ///< Poprzednie połączenie wątku lub NULL.
+    struct Connection *next; ///< Następne połączenie wątku lub NULL.
+};
+typedef struct Connection Connection;
+
+/**
+ * @struct Worker
+ * @brief Worker jest wątkiem obsługującym własne połączenia w pętli epoll.
+ */
+struct Worker {
+    Server *server; ///< Serwer.
+    pthread_t thread; ///< Wątek.
+    int epoll; ///< Deskryptor epoll wątku.
+    Connection *connections; ///< Lista połączeń wątku.
+    Arena arena; ///< Obszar, z którego przydzielane są wyniki zapytań jednej grupy żądań.
+};
+typedef struct Worker Worker;
+
+/**
+ * Ustawia blokadę przekierowań potrzebną do wykonania żądania.
+ * @param server - wskaźnik na serwer.
+ * @param held - wskaźnik na blokadę trzymaną przez wątek.
+ * @param write - czy żądanie zmienia przekierowania.
+ */
+static void lockFor(Server *server, LockState *held, bool write) {
+    LockState needed = write ? LOCK_WRITE : LOCK_READ;
+
+    if (*held == needed)
+        return;
+    if (*held != LOCK_NONE)
+        pthread_rwlock_unlock(&server->lock);
+
+    if (write)
+        pthread_rwlock_wrlock(&server->lock);
+    else
+        pthread_rwlock_rdlock(&server->lock);
+    *held = needed;
+}
+
+/**
+ * Zapisuje odpowiedź na zapytanie.
+ * @param out - bufor odpowiedzi.
+ * @param id - numer żądania.
+ * @param numbers - wynik zapytania lub NULL, jeśli nie udało się go wyznaczyć.
+ * @return true - jeśli udało się zapisać odpowiedź.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool writeNumbers(FrameBuffer *out, uint32_t id, PhoneNumbers const *numbers) {
+    size_t start;
+
+    if (!frameBegin(out, id, (numbers == NULL) ? PROTOCOL_ERROR : PROTOCOL_OK, &start))
+        return false;
+    if (numbers == NULL)
+        return frameEnd(out, start, true);
+
+    size_t count = 0;
+    while (phnumGet(numbers, count) != NULL)
+        count++;
+
+    bool written = count <= UINT32_MAX && frameAppendNumber(out, (uint32_t) count);
+    for (size_t i = 0; i < count && written; i++)
+        written = frameAppendString(out, phnumGet(numbers, i));
+
+    // Za długi wynik jest zastępowany odpowiedzią o błędzie.
+    if (!frameEnd(out, start, written))
+        return frameBegin(out, id, PROTOCOL_ERROR, &start) && frameEnd(out, start, true);
+    return true;
+}
+
+/**
+ * Wykonuje jedno żądanie i zapisuje na nie odpowiedź.
+ * @param worker - wskaźnik na wątek.
+ * @param connection - wskaźnik na połączenie.
+ * @param frame - ramka żądania.
+ * @param length - długość ramki.
+ * @param held - wskaźnik na blokadę trzymaną przez wątek.
+ * @return true - jeśli udało się zapisać odpowiedź.
+ *         false - jeśli nie powiodła się alokacja pamięci.
+ */
+static bool executeRequest(Worker *worker, Connection *connection, char const *frame, size_t length,
+                           LockState *held) {
+    Server *server = worker->server;
+    uint32_t id = frameNumber(frame + 4);
+    uint8_t request = (uint8_t) frame[PROTOCOL_HEADER - 1];
+    char const *data = frame + PROTOCOL_HEADER;
+    char const *end = frame + length;
+    char const *num1 = frameString(&data, end);
+    char const *num2 = (request == PHFWD_REQUEST_ADD) ? frameString(&data, end) : NULL;
+    size_t start;
+
+    if (num1 == NULL || (request == PHFWD_REQUEST_ADD && num2 == NULL) || data != end ||
+        request < PHFWD_REQUEST_GET || request > PHFWD_REQUEST_REMOVE)
+        return frameBegin(&connection->out, id, PROTOCOL_ERROR, &start) && frameEnd(&connection->out, start, true);
+
+    bool result = true;
+
+    switch (request) {
+        case PHFWD_REQUEST_GET:
+            lockFor(server, held, false);
+            return writeNumbers(&connection->out, id, phfwdGetInArena(server->pf, num1, &worker->arena));
+        case PHFWD_REQUEST_REVERSE:
+            lockFor(server, held, false);
+            return writeNumbers(&connection->out, id, phfwdReverseInArena(server->pf, num1, &worker->arena));
+        case PHFWD_REQUEST_GET_REVERSE:
+            lockFor(server, held, false);
+            return writeNumbers(&connection->out, id, phfwdGetReverseInArena(server->pf, num1, &worker->arena));
+        case PHFWD_REQUEST_ADD:
+            lockFor(server, held, true);
+            result = phfwdAdd(server->pf, num1, num2);
+            break;
+        default:
+            lockFor(server, held, true);
+            result = isStringAPhoneNumber(num1);
+            phfwdRemove(server->pf, num1);
+            break;
+    }
+
+    return frameBegin(&connection->out, id, result ? PROTOCOL_OK : PROTOCOL_FALSE, &start) &&
+           frameEnd(&connection->out, start, true);
+}
+
+/**
+ * Wykonuje wszystkie odebrane żądania połączenia, dopóki bufor odpowiedzi nie przekroczy OUTPUT_LIMIT.
+ * @param worker - wskaźnik na wątek.
+ * @param connection - wskaźnik na połączenie.
+ * @return true - jeśli żądania zostały wykonane.
+ *         false - jeśli ramka jest niepoprawna lub nie powiodła się alokacja pamięci; połączenie trzeba zamknąć.
+ */
+static bool processRequests(Worker *worker, Connection *connection) {
+    LockState held = LOCK_NONE;
+    size_t offset = 0;
+    size_t length;
+    int complete = 0;
+    bool result = true;
+
+    while (result && connection->out.used - connection->sent < OUTPUT_LIMIT &&
+           (complete = frameComplete(connection->in.data + offset, connection->in.used - offset, &length)) == 1) {
+        result = executeRequest(worker, connection, connection->in.data + offset, length, &held);
+        offset += length;
+    }
+
+    if (held != LOCK_NONE)
+        pthread_rwlock_unlock(&worker->server->lock);
+
+    // Wyniki zapytań są już zapisane w odpowiedziach.
+    arenaFree(&worker->arena);
+    arenaInit(&worker->arena, NULL);
+    frameConsume(&connection->in, offset);
+    return result && complete != -1;
+}
+
+/**
+ * Wysyła jak najwięcej odpowiedzi połączenia, nie czekając.
+ * @param connection - wskaźnik na połączenie.
+ * @return true - jeśli połączenie działa.
+ *         false - jeśli zostało przerwane.
+ */
+static bool writeResponses(Connection *connection) {
+    while (connection->sent < connection->out.used) {
+        ssize_t written = send(connection->fd, connection->out.data + connection->sent,
+                               connection->out.used - connection->sent, MSG_NOSIGNAL);
+
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (written <= 0)
+            return false;
+        connection->sent += (size_t) written;
+    }
+
+    connection->out.used = 0;
+    connection->sent = 0;
+    return true;
+}
+
+/**
+ * Odczytuje wszystkie dostępne dane połączenia i wykonuje odebrane żądania.
+ * @param worker - wskaźnik na wątek.
+ * @param connection - wskaźnik na połączenie.
+ * @return true - jeśli połączenie działa.
+ *         false - jeśli zostało zamknięte przez klienta lub trzeba je zamknąć.
+ */
+static bool readRequests(Worker *worker, Connection *connection) {
+    for (;;) {
+        if (!frameReserve(&connection->in, READ_CHUNK))
+            return false;
+
+        ssize_t received = recv(connection->fd, connection->in.data + connection->in.used,
+                                connection->in.size - connection->in.used, 0);
+
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (received <= 0)
+            return false;
+
+        connection->in.used += (size_t) received;
+        if ((size_t) received < READ_CHUNK)
+            break;
+    }
+    return processRequests(worker, connection);
+}
+
+/**
+ * Zamyka połączenie i usuwa je z listy wątku.
+ * @param worker - wskaźnik na wątek.
+ * @param connection - wskaźnik na połączenie.
+ */
+static void closeConnection(Worker *worker, Connection *connection) {
+    if (connection->prev != NULL)
+        connection->prev->next = connection->next;
+    else
+        worker->connections = connection->next;
+    if (connection->next != NULL)
+        connection->next->prev = connection->prev;
+
+    close(connection->fd);
+    frameFree(&connection->in);
+    frameFree(&connection->out);
+    free(connection);
+}
+
+/**
+ * Ustawia zdarzenia, na które czeka połączenie: odczyt, dopóki odpowiedzi nie przekraczają OUTPUT_LIMIT, i zapis,
+ * dopóki są niewysłane odpowiedzi.
+ * @param worker - wskaźnik na wątek.
+ * @param connection - wskaźnik na połączenie.
+ * @return true - jeśli udało się ustawić zdarzenia.
+ *         false - w przeciwnym przypadku.
+ */
+static bool updateEvents(Worker *worker, Connection *connection) {
+    uint32_t events = 0;
+
+    if (connection->out.used - connection->sent < OUTPUT_LIMIT)
+        events |= EPOLLIN;
+    if (connection->sent < connection->out.used)
+        events |= EPOLLOUT;
+
+    if (events == connection->events)
+        return true;
+
+    struct epoll_event event = {.events = events, .data.ptr = connection};
+    connection->events = events;
+    return epoll_ctl(worker->epoll, EPOLL_CTL_MOD, connection->fd, &event) == 0;
+}
+
+/**
+ * Przyjmuje oczekujące połączenia i dodaje je do wątku.
+ * @param worker - wskaźnik na wątek.
+ */
+static void acceptConnections(Worker *worker) {
+    int fd;
+
+    while ((fd = accept4(worker->server->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        Connection *connection = (Connection *) malloc(sizeof(Connection));
+
+        if (connection == NULL) {
+            close(fd);
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        connection->fd = fd;
+        frameInit(&connection->in);
+        frameInit(&connection->out);
+        connection->sent = 0;
+        connection->events = EPOLLIN;
+        connection->prev = NULL;
+        connection->next = worker->connections;
+        if (worker->connections != NULL)
+            worker->connections->prev = connection;
+        worker->connections = connection;
+
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = connection};
+        if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+            closeConnection(worker, connection);
+    }
+}
+
+/**
+ * Obsługuje zdarzenia połączeń wątku, dopóki serwer nie ma się zakończyć.
+ * @param arg - wskaźnik na wątek.
+ * @return - NULL.
+ */
+static void *workerRun(void *arg) {
+    Worker *worker = (Worker *) arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!atomic_load(&worker->server->stop)) {
+        int count = epoll_wait(worker->epoll, events, MAX_EVENTS, POLL_TIMEOUT);
+
+        for (int i = 0; i < count; i++) {
+            Connection *connection = (Connection *) events[i].data.ptr;
+
+            if (connection == NULL) {
+                acceptConnections(worker);
+                continue;
+            }
+
+            bool alive = true;
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+                alive = readRequests(worker, connection);
+            if (alive)
+                alive = writeResponses(connection);
+            // Po wysłaniu odpowiedzi można wykonać żądania wstrzymane przez OUTPUT_LIMIT.
+            if (alive && connection->in.used > 0 && connection->out.used - connection->sent < OUTPUT_LIMIT)
+                alive = processRequests(worker, connection) && writeResponses(connection);
+            if (!alive || !updateEvents(worker, connection))
+                closeConnection(worker, connection);
+        }
+    }
+
+    while (worker->connections != NULL)
+        closeConnection(worker, worker->connections);
+    return NULL;
+}
+
+/**
+ * Tworzy gniazdo, na którym serwer przyjmuje połączenia.
+ * @param path - ścieżka gniazda domeny uniksowej lub NULL.
+ * @param port - port TCP, jeśli @p path ma wartość NULL.
+ * @return - gniazdo lub -1, jeśli nie udało się go utworzyć.
+ */
+static int openListener(char const *path, uint16_t port) {
+    struct sockaddr_un local;
+    struct sockaddr_in inet;
+    struct sockaddr *address;
+    socklen_t size;
+    int fd;
+
+    if (path != NULL) {
+        if (strlen(path) >= sizeof(local.sun_path))
+            return -1;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        strcpy(local.sun_path, path);
+        unlink(path);
+        address = (struct sockaddr *) &local;
+        size = sizeof(local);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    } else {
+        memset(&inet, 0, sizeof(inet));
+        inet.sin_family = AF_INET;
+        inet.sin_port = htons(port);
+        inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address = (struct sockaddr *) &inet;
+        size = sizeof(inet);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd >= 0)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+
+    if (fd < 0)
+        return -1;
+    if (bind(fd, address, size) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Wczytuje reguły z pliku i stosuje je do struktury.
+ * @param in - plik z regułami.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @return true - jeśli wszystkie wiersze są poprawne.
+ *         false - w przeciwnym przypadku.
+ */
+static bool readRules(FILE *in, PhoneForward *pf) {
+    char *line = NULL;
+    size_t size = 0;
+    size_t lineNumber = 0;
+    bool result = true;
+
+    while (result && getline(&line, &size, in) != -1) {
+        lineNumber++;
+        char *num1 = strtok(line, " \t\r\n");
+        char *num2 = strtok(NULL, " \t\r\n");
+
+        if (num1 == NULL)
+            continue;
+
+        if (strtok(NULL, " \t\r\n") != NULL)
+            result = false;
+        else if (num2 != NULL)
+            result = phfwdAdd(pf, num1, num2);
+        else if ((result = isStringAPhoneNumber(num1)))
+            phfwdRemove(pf, num1);
+
+        if (!result)
+            fprintf(stderr, "phfwd_server: niepoprawny wiersz %lu\n", (unsigned long) lineNumber);
+    }
+
+    free(line);
+    return result;
+}
+
+/**
+ * Uruchamia wątki i czeka na sygnał zakończenia.
+ * @param server - wskaźnik na serwer z gniazdem i przekierowaniami.
+ * @param workerCount - liczba wątków.
+ * @return true - jeśli serwer działał do otrzymania sygnału.
+ *         false - jeśli nie udało się uruchomić wątków.
+ */
+static bool runServer(Server *server, size_t workerCount) {
+    Worker *workers = (Worker *) calloc(workerCount, sizeof(Worker));
+    size_t started = 0;
+    bool result = workers != NULL;
+
+    // Wszystkie wątki czekają na połączenia, ale każde przyjmuje tylko jeden z nich.
+    struct epoll_event event = {.events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL};
+
+    for (; result && started < workerCount; started++) {
+        Worker *worker = &workers[started];
+        worker->server = server;
+        worker->connections = NULL;
+        arenaInit(&worker->arena, NULL);
+        worker->epoll = epoll_create1(EPOLL_CLOEXEC);
+
+        result = worker->epoll >= 0 && epoll_ctl(worker->epoll, EPOLL_CTL_ADD, server->listener, &event) == 0 &&
+                 pthread_create(&worker->thread, NULL, workerRun, worker) == 0;
+        if (!result) {
+            if (worker->epoll >= 0)
+                close(worker->epoll);
+            break;
+        }
+    }
+
+    if (result) {
+        sigset_t signals;
+        int signal;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        sigwait(&signals, &signal);
+    }
+
+    atomic_store(&server->stop, true);
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        close(workers[i].epoll);
+        arenaFree(&workers[i].arena);
+    }
+
+    free(workers);
+    return result;
+}
+
+/**
+ * Wczytuje reguły i obsługuje klientów do otrzymania sygnału SIGINT lub SIGTERM.
+ * @param argc - liczba argumentów.
+ * @param argv - argumenty: opcje i opcjonalny plik z regułami.
+ * @return - EXIT_SUCCESS lub EXIT_FAILURE.
+ */
+int main(int argc, char *argv[]) {
+    char const *path = NULL;
+    long port = -1;
+    long workers = DEFAULT_WORKERS;
+    int option;
+
+    while ((option = getopt(argc, argv, "w:u:p:")) != -1) {
+        if (option == 'w')
+            workers = strtol(optarg, NULL, 10);
+        else if (option == 'u')
+            path = optarg;
+        else if (option == 'p')
+            port = strtol(optarg, NULL, 10);
+        else
+            workers = 0;
+    }
+
+    if (workers <= 0 || (path == NULL) == (port < 0) || port > UINT16_MAX || argc - optind > 1) {
+        fprintf(stderr, "Użycie: %s [-w wątki] (-u ścieżka | -p port) [plik_reguł]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Sygnały są odbierane przez sigwait; wątki dziedziczą zablokowaną maskę.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    Server server;
+    server.pf = phfwdNew();
+    atomic_init(&server.stop, false);
+
+    if (server.pf == NULL) {
+        fprintf(stderr, "phfwd_server: brak pamięci\n");
+        return EXIT_FAILURE;
+    }
+
+    if (optind < argc) {
+        FILE *in = fopen(argv[optind], "r");
+        bool valid = in != NULL && readRules(in, server.pf);
+
+        if (in == NULL)
+            perror(argv[optind]);
+        else
+            fclose(in);
+
+        if (!valid) {
+            phfwdDelete(server.pf);
+            return EXIT_FAILURE;
+        }
+    }
+
+    server.listener = openListener(path, (uint16_t) port);
+    if (server.listener < 0) {
+        perror("phfwd_server");
+        phfwdDelete(server.pf);
+        return EXIT_FAILURE;
+    }
+
+    pthread_rwlock_init(&server.lock, NULL);
+    bool result = runServer(&server, (size_t) workers);
+
+    pthread_rwlock_destroy(&server.lock);
+    close(server.listener);
+    if (path != NULL)
+        unlink(path);
+    phfwdDelete(server.pf);
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,240 @@
+/** @file
+ * Program generujący stałą tablicę przekierowań z pliku z regułami.
+ *
+ * Użycie: rule_compiler plik_reguł plik.c plik.h nazwa
+ *
+ * Każdy wiersz pliku z regułami zawiera dwa numery oddzielone białymi znakami, co odpowiada wywołaniu phfwdAdd,
+ * albo jeden numer, co odpowiada wywołaniu phfwdRemove. Puste wiersze są pomijane. Reguły są stosowane
+ * w kolejności wierszy. Program zapisuje w pliku.c stałą typu PhfwdStaticTable o podanej nazwie, a w pliku.h
+ * jej deklarację. Zapytania o tablicę wykonują funkcje z phone_forward_static.h.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "trie.h"
+#include "phone_forward_static.h"
+
+/**
+ * Liczba elementów wypisywanych w jednym wierszu wygenerowanego pliku.
+ */
+#define PER_LINE 8
+
+/**
+ * Przerywa program z komunikatem o braku pamięci.
+ */
+static void outOfMemory(void) {
+    fprintf(stderr, "rule_compiler: brak pamięci\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Zapisuje tablicę węzłów drzewa.
+ * @param out - plik wynikowy.
+ * @param name - nazwa tablicy.
+ * @param suffix - przyrostek nazwy tablicy węzłów.
+ * @param nodes - węzły drzewa.
+ * @param count - liczba węzłów drzewa.
+ */
+static void writeNodes(FILE *out, char const *name, char const *suffix, PhfwdStaticNode const *nodes,
+                       size_t count) {
+    fprintf(out, "static PhfwdStaticNode const %s_%s[] = {\n", name, suffix);
+
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "    {%lu, %lu, %lu, 0x%03x},\n", (unsigned long) nodes[i].firstChild,
+                (unsigned long) nodes[i].first, (unsigned long) nodes[i].count, (unsigned) nodes[i].children);
+    }
+
+    fprintf(out, "};\n\n");
+}
+
+/**
+ * Zapisuje napis tablicy wewnątrz literału. Znaki spoza numerów, czyli długości wspólnych początków
+ * w zakodowanych listach, są zapisywane jako trzycyfrowe sekwencje ósemkowe, więc następna cyfra nie jest częścią
+ * sekwencji.
+ * @param out - plik wynikowy.
+ * @param string - napis.
+ */
+static void writeString(FILE *out, char const *string) {
+    for (; *string != '\0'; string++) {
+        if (isdigit((unsigned char) *string) || *string == '*' || *string == '#')
+            fputc(*string, out);
+        else
+            fprintf(out, "\\%03o", (unsigned) (unsigned char) *string);
+    }
+}
+
+/**
+ * Zapisuje plik źródłowy z tablicą.
+ * @param table - wskaźnik na tablicę.
+ * @param out - plik wynikowy.
+ * @param header - nazwa pliku nagłówkowego.
+ * @param name - nazwa tablicy.
+ */
+static void writeSource(PhfwdStaticTable const *table, FILE *out, char const *header, char const *name) {
+    fprintf(out, "/* Plik wygenerowany przez rule_compiler. Nie należy go modyfikować. */\n\n");
+    // Plik nagłówkowy jest dołączany z katalogu pliku źródłowego.
+    char const *slash = strrchr(header, '/');
+    fprintf(out, "#include \"%s\"\n\n", (slash == NULL) ? header : slash + 1);
+
+    writeNodes(out, name, "prefixes", table->prefixes, table->prefixCount);
+    writeNodes(out, name, "reverse", table->reverse, table->reverseCount);
+
+    // Tablica w języku C nie może być pusta, więc zawsze ma co najmniej jeden element.
+    fprintf(out, "static uint32_t const %s_lists[] = {", name);
+    for (size_t i = 0; i < table->listCount || i == 0; i++) {
+        fprintf(out, "%s%lu,", (i % PER_LINE == 0) ? "\n    " : " ",
+                (unsigned long) (i < table->listCount ? table->lists[i] : 0));
+    }
+    fprintf(out, "\n};\n\n");
+
+    // Każdy napis jest osobnym literałem, więc cyfra po znaku '\0' nie jest częścią sekwencji ósemkowej.
+    // Ostatni, pusty napis tablicy jest końcem literału.
+    fprintf(out, "static char const %s_strings[] =", name);
+    for (size_t i = 0; i + 1 < table->stringsSize; i += strlen(table->strings + i) + 1) {
+        fprintf(out, "\n    \"");
+        writeString(out, table->strings + i);
+        fprintf(out, "\\0\"");
+    }
+    fprintf(out, "\n    \"\";\n\n");
+
+    fprintf(out, "PhfwdStaticTable const %s = {\n", name);
+    fprintf(out, "    %s_prefixes, %lu,\n", name, (unsigned long) table->prefixCount);
+    fprintf(out, "    %s_reverse, %lu,\n", name, (unsigned long) table->reverseCount);
+    fprintf(out, "    %s_lists, %lu,\n", name, (unsigned long) table->listCount);
+    fprintf(out, "    %s_strings, sizeof(%s_strings)\n", name, name);
+    fprintf(out, "};\n");
+}
+
+/**
+ * Zapisuje plik nagłówkowy z deklaracją tablicy.
+ * @param out - plik wynikowy.
+ * @param name - nazwa tablicy.
+ */
+static void writeHeader(FILE *out, char const *name) {
+    fprintf(out, "/* Plik wygenerowany przez rule_compiler. Nie należy go modyfikować. */\n\n");
+    fprintf(out, "#ifndef PHFWD_STATIC_%s_H\n#define PHFWD_STATIC_%s_H\n\n", name, name);
+    fprintf(out, "#include \"phone_forward_static.h\"\n\n");
+    fprintf(out, "extern PhfwdStaticTable const %s;\n\n", name);
+    fprintf(out, "#endif\n");
+}
+
+/**
+ * Wczytuje reguły z pliku i stosuje je do struktury.
+ * @param in - plik z regułami.
+ * @param pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @return true - jeśli wszystkie wiersze są poprawne.
+ *         false - w przeciwnym przypadku.
+ */
+static bool readRules(FILE *in, PhoneForward *pf) {
+    char *line = NULL;
+    size_t size = 0;
+    size_t lineNumber = 0;
+    bool result = true;
+
+    while (result && getline(&line, &size, in) != -1) {
+        lineNumber++;
+        char *num1 = strtok(line, " \t\r\n");
+        char *num2 = strtok(NULL, " \t\r\n");
+
+        if (num1 == NULL)
+            continue;
+
+        if (strtok(NULL, " \t\r\n") != NULL)
+            result = false;
+        else if (num2 != NULL)
+            result = phfwdAdd(pf, num1, num2);
+        else if ((result = isStringAPhoneNumber(num1)))
+            phfwdRemove(pf, num1);
+
+        if (!result)
+            fprintf(stderr, "rule_compiler: niepoprawny wiersz %lu\n", (unsigned long) lineNumber);
+    }
+
+    free(line);
+    return result;
+}
+
+/**
+ * Otwiera plik, kończąc program, jeśli się nie da.
+ * @param path - ścieżka pliku.
+ * @param mode - tryb otwarcia.
+ * @return - otwarty plik.
+ */
+static FILE *openFile(char const *path, char const *mode) {
+    FILE *file = fopen(path, mode);
+    if (file == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+/**
+ * Sprawdza, czy napis jest identyfikatorem języka C.
+ * @param name - napis.
+ * @return true - jeśli napis jest identyfikatorem.
+ *         false - w przeciwnym przypadku.
+ */
+static bool isIdentifier(char const *name) {
+    if (!isalpha((unsigned char) name[0]) && name[0] != '_')
+        return false;
+
+    for (size_t i = 1; name[i] != '\0'; i++) {
+        if (!isalnum((unsigned char) name[i]) && name[i] != '_')
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Wczytuje reguły i zapisuje tablicę.
+ * @param argc - liczba argumentów.
+ * @param argv - argumenty: plik z regułami, plik źródłowy, plik nagłówkowy i nazwa tablicy.
+ * @return - EXIT_SUCCESS lub EXIT_FAILURE.
+ */
+int main(int argc, char *argv[]) {
+    if (argc != 5 || !isIdentifier(argv[4])) {
+        fprintf(stderr, "Użycie: %s plik_reguł plik.c plik.h nazwa\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PhoneForward *pf = phfwdNew();
+    if (pf == NULL)
+        outOfMemory();
+
+    FILE *in = openFile(argv[1], "r");
+    bool valid = readRules(in, pf);
+    fclose(in);
+
+    if (!valid) {
+        phfwdDelete(pf);
+        return EXIT_FAILURE;
+    }
+
+    PhfwdStaticTable *table = phfwdStaticBuild(pf);
+    phfwdDelete(pf);
+
+    if (table == NULL) {
+        fprintf(stderr, "rule_compiler: za dużo reguł lub brak pamięci\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *source = openFile(argv[2], "w");
+    writeSource(table, source, argv[3], argv[4]);
+    FILE *header = openFile(argv[3], "w");
+    writeHeader(header, argv[4]);
+
+    phfwdStaticDelete(table);
+    bool written = fclose(source) == 0;
+    written = fclose(header) == 0 && written;
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,478 @@
+/** @file
+ * Mikrobenchmark operacji na drzewach przekierowań z licznikami sprzętowymi.
+ *
+ * Użycie: trie_bench [-s deep|wide|random] [-n reguły] [-q zapytania] [-l długość] [-r powtórzenia]
+ *
+ * Program osobno mierzy dodawanie przekierowań (phfwdAdd), wyszukiwanie prefiksu w drzewie prefixes
+ * (findOnePrefix), przejście drzewa reverse (phfwdReverseInArena, z wynikami w obszarze, więc bez wywołań malloc)
+ * i usuwanie struktury (phfwdDelete). Kształt drzew wybiera opcja -s:
+ * - deep – długie numery z cyfr 0 i 1, czyli głębokie drzewo z prawie pustymi tablicami dzieci;
+ * - wide – kolejne numery w systemie dwunastkowym, czyli płytkie drzewo z pełnymi tablicami dzieci;
+ * - random – losowe numery o długości od 1 do podanej.
+ *
+ * Dla każdej operacji program wypisuje średnią na jedno wywołanie liczbę cykli, instrukcji, chybień w pamięci
+ * podręcznej L1 danych i ostatniego poziomu, chybień w dTLB i błędnie przewidzianych skoków, odczytaną przez
+ * perf_event_open, oraz czas. Jeśli system nie pozwala na odczyt liczników (np. z powodu ustawienia
+ * /proc/sys/kernel/perf_event_paranoid), wypisywany jest tylko czas.
+ *
+ * @author Agnieszka Klempis
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "trie.h"
+#include "arena.h"
+#include "structures.h"
+#include "phone_forward_query.h"
+
+/**
+ * Liczba mierzonych zdarzeń.
+ */
+#define COUNTER_COUNT 6
+
+/**
+ * Liczba mierzonych operacji.
+ */
+#define OPERATION_COUNT 4
+
+/**
+ * Długość numerów, na które są przekierowywane prefiksy.
+ */
+#define TARGET_LENGTH 8
+
+/**
+ * Liczba losowych cyfr dopisywanych do numerów zapytań.
+ */
+#define QUERY_SUFFIX 4
+
+/**
+ * Największa długość numeru reguły.
+ */
+#define MAX_LENGTH 64
+
+/**
+ * @struct Counter
+ * @brief Counter jest licznikiem jednego zdarzenia sprzętowego.
+ */
+struct Counter {
+    char const *name; ///< Nazwa wypisywana w nagłówku tabeli.
+    uint32_t type; ///< Rodzaj zdarzenia dla perf_event_open.
+    uint64_t config; ///< Zdarzenie dla perf_event_open.
+    int fd; ///< Deskryptor licznika lub -1, jeśli nie udało się go otworzyć.
+};
+typedef struct Counter Counter;
+
+/**
+ * Podaje zdarzenie pamięci podręcznej w formacie perf_event_open.
+ */
+#define CACHE_EVENT(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/**
+ * Mierzone zdarzenia.
+ */
+static Counter counters[COUNTER_COUNT] = {
+    {"cykle", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1},
+    {"instrukcje", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1},
+    {"L1d-chyb", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D), -1},
+    {"LLC-chyb", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_LL), -1},
+    {"dTLB-chyb", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB), -1},
+    {"skoki-chyb", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1},
+};
+
+/**
+ * Nazwy mierzonych operacji.
+ */
+static char const *const operationNames[OPERATION_COUNT] = {"phfwdAdd", "findOnePrefix", "reverse", "phfwdDelete"};
+
+/**
+ * Wynik pomiaru operacji, sumowany po powtórzeniach.
+ */
+struct Measurement {
+    double values[COUNTER_COUNT]; ///< Przeskalowane wartości liczników.
+    double nanoseconds; ///< Czas w nanosekundach.
+    double calls; ///< Liczba wywołań operacji.
+};
+typedef struct Measurement Measurement;
+
+/**
+ * @struct Workload
+ * @brief Workload przechowuje reguły i zapytania jednego pomiaru.
+ */
+struct Workload {
+    char **sources; ///< Prefiksy przekierowywane.
+    char **targets; ///< Prefiksy, na które są przekierowywane.
+    size_t rules; ///< Liczba reguł.
+    char **findQueries; ///< Numery, których prefiksy są wyszukiwane.
+    char **reverseQueries; ///< Numery zapytań phfwdReverse.
+    size_t queries; ///< Liczba zapytań każdego rodzaju.
+};
+typedef struct Workload Workload;
+
+/**
+ * Przerywa program z komunikatem o braku pamięci.
+ */
+static void outOfMemory(void) {
+    fprintf(stderr, "trie_bench: brak pamięci\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Otwiera liczniki zdarzeń dla bieżącego wątku, liczące tylko w przestrzeni użytkownika.
+ * @return - liczba otwartych liczników.
+ */
+static size_t openCounters(void) {
+    size_t opened = 0;
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counters[i].type;
+        attr.config = counters[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // Liczników może być więcej niż rejestrów procesora; wtedy jądro je przełącza, a wynik jest skalowany.
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        counters[i].fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counters[i].fd >= 0)
+            opened++;
+    }
+    return opened;
+}
+
+/**
+ * Zamyka otwarte liczniki.
+ */
+static void closeCounters(void) {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (counters[i].fd >= 0)
+            close(counters[i].fd);
+        counters[i].fd = -1;
+    }
+}
+
+/**
+ * Włącza lub wyłącza otwarte liczniki. Przed włączeniem liczniki są zerowane.
+ * @param enable - czy liczniki mają zostać włączone.
+ */
+static void switchCounters(bool enable) {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (counters[i].fd < 0)
+            continue;
+        if (enable) {
+            ioctl(counters[i].fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+        } else {
+            ioctl(counters[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+}
+
+/**
+ * Podaje bieżący czas monotoniczny.
+ * @return - czas w nanosekundach.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/**
+ * Zaczyna pomiar.
+ * @return - czas rozpoczęcia w nanosekundach.
+ */
+static double startMeasurement(void) {
+    switchCounters(true);
+    return now();
+}
+
+/**
+ * Kończy pomiar i dodaje jego wynik do sumy.
+ * @param measurement - wskaźnik na sumę pomiarów operacji.
+ * @param start - czas rozpoczęcia zwrócony przez startMeasurement.
+ * @param calls - liczba wywołań operacji w tym pomiarze.
+ */
+static void finishMeasurement(Measurement *measurement, double start, size_t calls) {
+    double end = now();
+    switchCounters(false);
+
+    measurement->nanoseconds += end - start;
+    measurement->calls += (double) calls;
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        uint64_t data[3];
+
+        if (counters[i].fd < 0 || read(counters[i].fd, data, sizeof(data)) != (ssize_t) sizeof(data))
+            continue;
+        if (data[2] > 0)
+            measurement->values[i] += (double) data[0] * (double) data[1] / (double) data[2];
+    }
+}
+
+/**
+ * Zapisuje w buforze losowy numer.
+ * @param number - bufor o długości co najmniej @p length + 1.
+ * @param length - liczba cyfr.
+ * @param base - liczba używanych cyfr, od 2 do 12.
+ */
+static void randomNumber(char *number, size_t length, int base) {
+    for (size_t i = 0; i < length; i++)
+        number[i] = numToChar(rand() % base);
+    number[length] = '\0';
+}
+
+/**
+ * Kopiuje napis do nowo zaalokowanej pamięci.
+ * @param string - napis.
+ * @return - wskaźnik na kopię.
+ */
+static char *copyString(char const *string) {
+    char *copy = strdup(string);
+    if (copy == NULL)
+        outOfMemory();
+    return copy;
+}
+
+/**
+ * Tworzy numer zapytania, dopisując do numeru losowe cyfry.
+ * @param number - numer.
+ * @return - wskaźnik na nowy numer.
+ */
+static char *extendNumber(char const *number) {
+    char buffer[MAX_LENGTH + QUERY_SUFFIX + 1];
+    size_t length = strlen(number);
+
+    memcpy(buffer, number, length);
+    randomNumber(buffer + length, QUERY_SUFFIX, 10);
+    return copyString(buffer);
+}
+
+/**
+ * Przygotowuje reguły i zapytania o danym kształcie.
+ * @param shape - kształt drzewa: "deep", "wide" lub "random".
+ * @param rules - liczba reguł.
+ * @param queries - liczba zapytań każdego rodzaju.
+ * @param length - długość numerów reguł dla kształtów deep i random.
+ * @param workload - wskaźnik na wypełniany opis pomiaru.
+ * @return true - jeśli kształt jest poprawny.
+ *         false - w przeciwnym przypadku.
+ */
+static bool prepareWorkload(char const *shape, size_t rules, size_t queries, size_t length, Workload *workload) {
+    bool deep = strcmp(shape, "deep") == 0;
+    bool wide = strcmp(shape, "wide") == 0;
+
+    if (!deep && !wide && strcmp(shape, "random") != 0)
+        return false;
+
+    size_t wideLength = 1;
+    for (size_t capacity = 12; capacity < rules && wideLength < MAX_LENGTH; capacity *= 12)
+        wideLength++;
+
+    workload->rules = rules;
+    workload->queries = queries;
+    workload->sources = (char **) malloc(sizeof(char *) * rules);
+    workload->targets = (char **) malloc(sizeof(char *) * rules);
+    workload->findQueries = (char **) malloc(sizeof(char *) * queries);
+    workload->reverseQueries = (char **) malloc(sizeof(char *) * queries);
+    if (workload->sources == NULL || workload->targets == NULL || workload->findQueries == NULL ||
+        workload->reverseQueries == NULL)
+        outOfMemory();
+
+    char number[MAX_LENGTH + 1];
+    for (size_t i = 0; i < rules; i++) {
+        if (deep) {
+            randomNumber(number, length, 2);
+        } else if (wide) {
+            // Kolejne numery w systemie dwunastkowym wypełniają wszystkie tablice dzieci.
+            size_t value = i;
+            for (size_t j = wideLength; j > 0; j--) {
+                number[j - 1] = numToChar((int) (value % 12));
+                value /= 12;
+            }
+            number[wideLength] = '\0';
+        } else {
+            randomNumber(number, 1 + (size_t) rand() % length, 12);
+        }
+        workload->sources[i] = copyString(number);
+
+        randomNumber(number, TARGET_LENGTH, 12);
+        workload->targets[i] = copyString(number);
+    }
+
+    // Zapytania są przedłużeniami numerów z reguł, więc dochodzą do liści drzew.
+    for (size_t i = 0; i < queries; i++) {
+        workload->findQueries[i] = extendNumber(workload->sources[(size_t) rand() % rules]);
+        workload->reverseQueries[i] = extendNumber(workload->targets[(size_t) rand() % rules]);
+    }
+    return true;
+}
+
+/**
+ * Zwalnia reguły i zapytania.
+ * @param workload - wskaźnik na opis pomiaru.
+ */
+static void freeWorkload(Workload *workload) {
+    for (size_t i = 0; i < workload->rules; i++) {
+        free(workload->sources[i]);
+        free(workload->targets[i]);
+    }
+    for (size_t i = 0; i < workload->queries; i++) {
+        free(workload->findQueries[i]);
+        free(workload->reverseQueries[i]);
+    }
+    free(workload->sources);
+    free(workload->targets);
+    free(workload->findQueries);
+    free(workload->reverseQueries);
+}
+
+/**
+ * Wykonuje jedno powtórzenie wszystkich operacji.
+ * @param workload - wskaźnik na reguły i zapytania.
+ * @param measurements - tablica sum pomiarów operacji lub NULL, jeśli wyniki mają zostać pominięte.
+ */
+static void runRound(Workload const *workload, Measurement *measurements) {
+    Measurement ignored[OPERATION_COUNT];
+    if (measurements == NULL) {
+        memset(ignored, 0, sizeof(ignored));
+        measurements = ignored;
+    }
+
+    PhoneForward *pf = phfwdNew();
+    if (pf == NULL)
+        outOfMemory();
+
+    // Suma wyników nie pozwala kompilatorowi pominąć wywołań.
+    size_t found = 0;
+    double start = startMeasurement();
+    for (size_t i = 0; i < workload->rules; i++)
+        found += phfwdAdd(pf, workload->sources[i], workload->targets[i]);
+    finishMeasurement(&measurements[0], start, workload->rules);
+
+    size_t length;
+    start = startMeasurement();
+    for (size_t i = 0; i < workload->queries; i++)
+        found += (findOnePrefix(pf->prefixes, workload->findQueries[i], &length) != NULL) ? length : 0;
+    finishMeasurement(&measurements[1], start, workload->queries);
+
+    Arena arena;
+    arenaInit(&arena, NULL);
+    start = startMeasurement();
+    for (size_t i = 0; i < workload->queries; i++)
+        found += (phfwdReverseInArena(pf, workload->reverseQueries[i], &arena) != NULL);
+    finishMeasurement(&measurements[2], start, workload->queries);
+    arenaFree(&arena);
+
+    start = startMeasurement();
+    phfwdDelete(pf);
+    finishMeasurement(&measurements[3], start, workload->rules);
+
+    if (found == SIZE_MAX)
+        printf("\n");
+}
+
+/**
+ * Wypisuje średnie wyniki operacji na jedno wywołanie.
+ * @param measurements - tablica sum pomiarów operacji.
+ */
+static void printResults(Measurement const *measurements) {
+    printf("%-14s", "operacja");
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (counters[i].fd >= 0)
+            printf("%12s", counters[i].name);
+    }
+    printf("%12s\n", "ns");
+
+    for (size_t op = 0; op < OPERATION_COUNT; op++) {
+        double calls = (measurements[op].calls > 0) ? measurements[op].calls : 1;
+
+        printf("%-14s", operationNames[op]);
+        for (size_t i = 0; i < COUNTER_COUNT; i++) {
+            if (counters[i].fd >= 0)
+                printf("%12.2f", measurements[op].values[i] / calls);
+        }
+        printf("%12.1f\n", measurements[op].nanoseconds / calls);
+    }
+}
+
+/**
+ * Przygotowuje drzewa o wybranym kształcie, mierzy operacje i wypisuje wyniki.
+ * @param argc - liczba argumentów.
+ * @param argv - opcje.
+ * @return - EXIT_SUCCESS lub EXIT_FAILURE.
+ */
+int main(int argc, char *argv[]) {
+    char const *shape = "random";
+    long rules = 100000;
+    long queries = 100000;
+    long length = 12;
+    long rounds = 5;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:n:q:l:r:")) != -1) {
+        switch (option) {
+            case 's':
+                shape = optarg;
+                break;
+            case 'n':
+                rules = strtol(optarg, NULL, 10);
+                break;
+            case 'q':
+                queries = strtol(optarg, NULL, 10);
+                break;
+            case 'l':
+                length = strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                rounds = strtol(optarg, NULL, 10);
+                break;
+            default:
+                rounds = 0;
+                break;
+        }
+    }
+
+    Workload workload;
+    srand(1);
+
+    if (rules <= 0 || queries <= 0 || length <= 0 || length > MAX_LENGTH || rounds <= 0 || optind != argc ||
+        !prepareWorkload(shape, (size_t) rules, (size_t) queries, (size_t) length, &workload)) {
+        fprintf(stderr, "Użycie: %s [-s deep|wide|random] [-n reguły] [-q zapytania] [-l długość] "
+                        "[-r powtórzenia]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (openCounters() == 0)
+        fprintf(stderr, "trie_bench: liczniki sprzętowe są niedostępne, mierzony jest tylko czas\n");
+
+    Measurement measurements[OPERATION_COUNT];
+    memset(measurements, 0, sizeof(measurements));
+
+    // Pierwsze powtórzenie tylko rozgrzewa pamięć podręczną i alokator.
+    runRound(&workload, NULL);
+    for (long i = 0; i < rounds; i++)
+        runRound(&workload, measurements);
+
+    printf("kształt: %s, reguły: %ld, zapytania: %ld, powtórzenia: %ld\n", shape, rules, queries, rounds);
+    printResults(measurements);
+
+    closeCounters();
+    freeWorkload(&workload);
+    return EXIT_SUCCESS;
+}